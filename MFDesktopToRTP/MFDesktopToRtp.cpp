@@ -16,8 +16,14 @@
 /// m = video 1234 RTP / AVP 96
 /// a = rtpmap:96 H264 / 90000
 /// a = fmtp : 96 packetization - mode = 1
+/// a = rtcp-fb:96 nack pli
+/// a = rtcp-fb:96 transport-cc
+/// a = extmap:3 http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01
+/// a = rtcp:1236
 /// 3. Start ffplay BEFORE running this sample:
 /// ffplay -i test.sdp -x 800 -y 600 -profile:v baseline
+/// (The "a=rtcp" line tells ffplay where to send its RTCP feedback (NACK, PLI and transport-cc): our RTCP port is 1236,
+/// not the RTP port + 1.  ffplay receives our own RTCP reports on port 1235.)
 ///
 /// History:
 /// 07 Sep 2015	Aaron Clauson (aaron@sipsorcery.com)	Created.
@@ -49,10 +55,14 @@ class MediaFoundationH264LiveSource :
 {
 private:
 	static const int TARGET_FRAME_RATE = 60;// 5; 15; 30	// Note that this if the video device does not support this frame rate the video source reader will fail to initialise.
+	static const int MIN_AVERAGE_BIT_RATE = 1000000; // The lowest bit rate that congestion control will ask the encoder for.
 	static const int TARGET_AVERAGE_BIT_RATE = 30000000; // Adjusting this affects the quality of the H264 bit stream.
 	const UINT64 VIDEO_FRAME_DURATION = 10 * 1000 * 1000 / TARGET_FRAME_RATE;
 
 	bool _isInitialised = false;
+	bool _keyFrameRequested = false;
+	UINT32 _targetBitRate = TARGET_AVERAGE_BIT_RATE;
+	bool _targetBitRateChanged = false;
 	EventTriggerId eventTriggerId = 0;
 	int _frameCount = 0;
 	long int _lastSendAt;
@@ -97,6 +107,26 @@ public:
 		return true;
 	}
 
+	// Called (via the RTP sink) when a receiver asks - in a RTCP PLI or FIR - for a key frame.
+	// The next frame that we pass to the encoder will be encoded as one.
+	virtual void requestKeyFrame() {
+		_keyFrameRequested = true;
+	}
+
+	// Has the RTP sink estimate - from the receiver's transport-wide congestion control feedback - the bit rate
+	// that the network can carry, and has the encoder follow this estimate (starting at TARGET_AVERAGE_BIT_RATE).
+	void enableCongestionControl(MultiFramedRTPSink* rtpSink, u_int8_t extensionId) {
+		rtpSink->enableTransportWideCC(extensionId, TARGET_AVERAGE_BIT_RATE, MIN_AVERAGE_BIT_RATE, TARGET_AVERAGE_BIT_RATE);
+		rtpSink->setTargetBitrateHandler(targetBitRateChanged, this);
+	}
+
+	static void targetBitRateChanged(void* clientData, unsigned bitsPerSecond) {
+		// The new bit rate is applied before the next frame is passed to the encoder.
+		MediaFoundationH264LiveSource* source = (MediaFoundationH264LiveSource*)clientData;
+		source->_targetBitRate = bitsPerSecond;
+		source->_targetBitRateChanged = true;
+	}
+
 	static void deliverFrame0(void* clientData) {
 		((MediaFoundationH264LiveSource*)clientData)->doGetNextFrame();
 	}
@@ -310,6 +340,32 @@ public:
 					CHECK_HR(videoSample->SetSampleTime(mTimeStamp), "Error setting the video sample time.\n");
 					CHECK_HR(videoSample->SetSampleDuration(VIDEO_FRAME_DURATION), "Error getting video sample duration.\n");
 
+					if (_keyFrameRequested)
+					{
+						CComQIPtr<ICodecAPI> codecApi = _pTransform;
+						if (codecApi)
+						{
+							VARIANT var;
+							var.vt = VT_UI4;
+							var.ulVal = 1;
+							codecApi->SetValue(&CODECAPI_AVEncVideoForceKeyFrame, &var);
+						}
+						_keyFrameRequested = false;
+					}
+
+					if (_targetBitRateChanged)
+					{
+						CComQIPtr<ICodecAPI> codecApi = _pTransform;
+						if (codecApi)
+						{
+							VARIANT var;
+							var.vt = VT_UI4;
+							var.ulVal = _targetBitRate;
+							codecApi->SetValue(&CODECAPI_AVEncCommonMeanBitRate, &var);
+						}
+						_targetBitRateChanged = false;
+					}
+
 					// Pass the video sample to the H.264 transform.
 
 					HRESULT hr = _pTransform->ProcessInput(inputStreamID, videoSample, 0);
@@ -471,15 +527,35 @@ int main()
 	in_addr dstAddr = { 127, 0, 0, 1 };
 	Groupsock rtpGroupsock(*env, dstAddr, 1233, 255);
 	rtpGroupsock.addDestination(dstAddr, 1234, 0);
-	RTPSink * rtpSink = H264VideoRTPSink::createNew(*env, &rtpGroupsock, 96);
+	MultiFramedRTPSink * rtpSink = H264VideoRTPSink::createNew(*env, &rtpGroupsock, 96);
+	// Keep the last 1000 packets, so that we can retransmit any that the receiver reports (in a RTCP NACK) as lost.
+	// (They are retransmitted as they were sent, because the SDP doesn't declare an "rtx" payload type.)
+	rtpSink->enableRetransmissions(1000);
+
+	// RTCP, so that the receiver can ask (in a PLI or FIR) for a key frame - e.g., after it loses packets - and can
+	// send the transport-wide congestion control feedback that our bit rate estimate is based on:
+	Groupsock rtcpGroupsock(*env, dstAddr, 1236, 255);
+	rtcpGroupsock.changeDestinationParameters(dstAddr, 1235, 255);
+	const unsigned estimatedSessionBandwidth = 30000; // in kbps
+	unsigned char CNAME[101];
+	gethostname((char*)CNAME, 100);
+	CNAME[100] = '\0';
+	RTCPInstance* rtcp = RTCPInstance::createNew(*env, &rtcpGroupsock, estimatedSessionBandwidth, CNAME,
+		rtpSink, NULL /* we're a server */);
 
 
 	MediaFoundationH264LiveSource * mediaFoundationH264Source = MediaFoundationH264LiveSource::createNew(*env);
 	//mediaFoundationH264Source->doGetNextFrame();
+	mediaFoundationH264Source->enableCongestionControl(rtpSink, 3 /* the "extmap" id in the SDP */);
 	rtpSink->startPlaying(*mediaFoundationH264Source, NULL, NULL);
 
 	// This function call does not return.
 	env->taskScheduler().doEventLoop();
 
+	rtpSink->stopPlaying();
+	Medium::close(mediaFoundationH264Source);
+	Medium::close(rtcp);
+	Medium::close(rtpSink);
+
 	return 0;
 }
\ No newline at end of file
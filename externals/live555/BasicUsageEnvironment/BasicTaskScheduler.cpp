@@ -28,12 +28,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 ////////// BasicTaskScheduler //////////
 
-BasicTaskScheduler* BasicTaskScheduler::createNew(unsigned maxSchedulerGranularity) {
-	return new BasicTaskScheduler(maxSchedulerGranularity);
+BasicTaskScheduler* BasicTaskScheduler::createNew(unsigned maxSchedulerGranularity, Boolean useTimerWheel) {
+	return new BasicTaskScheduler(maxSchedulerGranularity, useTimerWheel);
 }
 
-BasicTaskScheduler::BasicTaskScheduler(unsigned maxSchedulerGranularity)
-  : fMaxSchedulerGranularity(maxSchedulerGranularity), fMaxNumSockets(0)
+BasicTaskScheduler::BasicTaskScheduler(unsigned maxSchedulerGranularity, Boolean useTimerWheel)
+  : BasicTaskScheduler0(useTimerWheel), fMaxSchedulerGranularity(maxSchedulerGranularity), fMaxNumSockets(0)
 #if defined(__WIN32__) || defined(_WIN32)
   , fDummySocketNum(-1)
 #endif
@@ -42,6 +42,7 @@ BasicTaskScheduler::BasicTaskScheduler(unsigned maxSchedulerGranularity)
   FD_ZERO(&fWriteSet);
   FD_ZERO(&fExceptionSet);
 
+  enablePostedTaskWakeups();
   if (maxSchedulerGranularity > 0) schedulerTickTask(); // ensures that we handle events frequently
 }
 
@@ -64,11 +65,14 @@ void BasicTaskScheduler::schedulerTickTask() {
 #endif
 
 void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
+  // If we're about to wait for events, first handle any 'idle' tasks:
+  handleIdleTasksIfIdle();
+
   fd_set readSet = fReadSet; // make a copy for this select() call
   fd_set writeSet = fWriteSet; // ditto
   fd_set exceptionSet = fExceptionSet; // ditto
 
-  DelayInterval const& timeToDelay = fDelayQueue.timeToNextAlarm();
+  DelayInterval const& timeToDelay = timeToNextAlarm();
   struct timeval tv_timeToDelay;
   tv_timeToDelay.tv_sec = timeToDelay.seconds();
   tv_timeToDelay.tv_usec = timeToDelay.useconds();
@@ -126,38 +130,53 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
       }
   }
 
-  // Call the handler function for one readable socket:
-  HandlerIterator iter(*fHandlers);
-  HandlerDescriptor* handler;
-  // To ensure forward progress through the handlers, begin past the last
-  // socket number that we handled:
-  if (fLastHandledSocketNum >= 0) {
-    while ((handler = iter.next()) != NULL) {
-      if (handler->socketNum == fLastHandledSocketNum) break;
+  if (fMaxHandlersPerStep > 1) {
+    // Call the handler functions for (up to "fMaxHandlersPerStep") ready sockets from this "select()" result.
+    // To ensure forward progress through the handlers, begin past the last socket number that we handled,
+    // and wrap around (ending with that socket):
+    resetReadySockets();
+    HandlerIterator iter(*fHandlers);
+    HandlerDescriptor* handler;
+    HandlerDescriptor* lastHandled = NULL;
+    if (fLastHandledSocketNum >= 0) {
+      while ((lastHandled = iter.next()) != NULL) {
+	if (lastHandled->socketNum == fLastHandledSocketNum) break;
+      }
+      if (lastHandled == NULL) iter.reset(); // start from the beginning instead
     }
-    if (handler == NULL) {
-      fLastHandledSocketNum = -1;
-      iter.reset(); // start from the beginning instead
+    for (int pass = 0; pass < 2 && fNumReadySockets < fMaxHandlersPerStep; ++pass) {
+      if (pass == 1) {
+	if (lastHandled == NULL) break; // we've already checked all of the handlers
+	iter.reset();
+      }
+      while (fNumReadySockets < fMaxHandlersPerStep && (handler = iter.next()) != NULL) {
+	int sock = handler->socketNum; // alias
+	int resultConditionSet = 0;
+	if (FD_ISSET(sock, &readSet) && FD_ISSET(sock, &fReadSet)/*sanity check*/) resultConditionSet |= SOCKET_READABLE;
+	if (FD_ISSET(sock, &writeSet) && FD_ISSET(sock, &fWriteSet)/*sanity check*/) resultConditionSet |= SOCKET_WRITABLE;
+	if (FD_ISSET(sock, &exceptionSet) && FD_ISSET(sock, &fExceptionSet)/*sanity check*/) resultConditionSet |= SOCKET_EXCEPTION;
+	if ((resultConditionSet&handler->conditionSet) != 0 && handler->handlerProc != NULL) {
+	  noteReadySocket(sock, resultConditionSet);
+	}
+	if (pass == 1 && handler == lastHandled) break;
+      }
     }
-  }
-  while ((handler = iter.next()) != NULL) {
-    int sock = handler->socketNum; // alias
-    int resultConditionSet = 0;
-    if (FD_ISSET(sock, &readSet) && FD_ISSET(sock, &fReadSet)/*sanity check*/) resultConditionSet |= SOCKET_READABLE;
-    if (FD_ISSET(sock, &writeSet) && FD_ISSET(sock, &fWriteSet)/*sanity check*/) resultConditionSet |= SOCKET_WRITABLE;
-    if (FD_ISSET(sock, &exceptionSet) && FD_ISSET(sock, &fExceptionSet)/*sanity check*/) resultConditionSet |= SOCKET_EXCEPTION;
-    if ((resultConditionSet&handler->conditionSet) != 0 && handler->handlerProc != NULL) {
-      fLastHandledSocketNum = sock;
-          // Note: we set "fLastHandledSocketNum" before calling the handler,
-          // in case the handler calls "doEventLoop()" reentrantly.
-      (*handler->handlerProc)(handler->clientData, resultConditionSet);
-      break;
+    handleReadySockets();
+  } else {
+    // Call the handler function for one readable socket:
+    HandlerIterator iter(*fHandlers);
+    HandlerDescriptor* handler;
+    // To ensure forward progress through the handlers, begin past the last
+    // socket number that we handled:
+    if (fLastHandledSocketNum >= 0) {
+      while ((handler = iter.next()) != NULL) {
+	if (handler->socketNum == fLastHandledSocketNum) break;
+      }
+      if (handler == NULL) {
+	fLastHandledSocketNum = -1;
+	iter.reset(); // start from the beginning instead
+      }
     }
-  }
-  if (handler == NULL && fLastHandledSocketNum >= 0) {
-    // We didn't call a handler, but we didn't get to check all of them,
-    // so try again from the beginning:
-    iter.reset();
     while ((handler = iter.next()) != NULL) {
       int sock = handler->socketNum; // alias
       int resultConditionSet = 0;
@@ -167,49 +186,42 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
       if ((resultConditionSet&handler->conditionSet) != 0 && handler->handlerProc != NULL) {
 	fLastHandledSocketNum = sock;
 	    // Note: we set "fLastHandledSocketNum" before calling the handler,
-            // in case the handler calls "doEventLoop()" reentrantly.
+	    // in case the handler calls "doEventLoop()" reentrantly.
 	(*handler->handlerProc)(handler->clientData, resultConditionSet);
 	break;
       }
     }
-    if (handler == NULL) fLastHandledSocketNum = -1;//because we didn't call a handler
+    if (handler == NULL && fLastHandledSocketNum >= 0) {
+      // We didn't call a handler, but we didn't get to check all of them,
+      // so try again from the beginning:
+      iter.reset();
+      while ((handler = iter.next()) != NULL) {
+	int sock = handler->socketNum; // alias
+	int resultConditionSet = 0;
+	if (FD_ISSET(sock, &readSet) && FD_ISSET(sock, &fReadSet)/*sanity check*/) resultConditionSet |= SOCKET_READABLE;
+	if (FD_ISSET(sock, &writeSet) && FD_ISSET(sock, &fWriteSet)/*sanity check*/) resultConditionSet |= SOCKET_WRITABLE;
+	if (FD_ISSET(sock, &exceptionSet) && FD_ISSET(sock, &fExceptionSet)/*sanity check*/) resultConditionSet |= SOCKET_EXCEPTION;
+	if ((resultConditionSet&handler->conditionSet) != 0 && handler->handlerProc != NULL) {
+	  fLastHandledSocketNum = sock;
+	      // Note: we set "fLastHandledSocketNum" before calling the handler,
+	      // in case the handler calls "doEventLoop()" reentrantly.
+	  (*handler->handlerProc)(handler->clientData, resultConditionSet);
+	  break;
+	}
+      }
+      if (handler == NULL) fLastHandledSocketNum = -1;//because we didn't call a handler
+    }
   }
 
   // Also handle any newly-triggered event (Note that we do this *after* calling a socket handler,
   // in case the triggered event handler modifies The set of readable sockets.)
-  if (fTriggersAwaitingHandling != 0) {
-    if (fTriggersAwaitingHandling == fLastUsedTriggerMask) {
-      // Common-case optimization for a single event trigger:
-      fTriggersAwaitingHandling &=~ fLastUsedTriggerMask;
-      if (fTriggeredEventHandlers[fLastUsedTriggerNum] != NULL) {
-	(*fTriggeredEventHandlers[fLastUsedTriggerNum])(fTriggeredEventClientDatas[fLastUsedTriggerNum]);
-      }
-    } else {
-      // Look for an event trigger that needs handling (making sure that we make forward progress through all possible triggers):
-      unsigned i = fLastUsedTriggerNum;
-      EventTriggerId mask = fLastUsedTriggerMask;
-
-      do {
-	i = (i+1)%MAX_NUM_EVENT_TRIGGERS;
-	mask >>= 1;
-	if (mask == 0) mask = 0x80000000;
+  handleTriggeredEvents();
 
-	if ((fTriggersAwaitingHandling&mask) != 0) {
-	  fTriggersAwaitingHandling &=~ mask;
-	  if (fTriggeredEventHandlers[i] != NULL) {
-	    (*fTriggeredEventHandlers[i])(fTriggeredEventClientDatas[i]);
-	  }
-
-	  fLastUsedTriggerMask = mask;
-	  fLastUsedTriggerNum = i;
-	  break;
-	}
-      } while (i != fLastUsedTriggerNum);
-    }
-  }
+  // Also handle any newly-posted tasks:
+  handlePostedTasks();
 
   // Also handle any delayed event that may have come due.
-  fDelayQueue.handleAlarm();
+  handleAlarm();
 }
 
 void BasicTaskScheduler
@@ -218,6 +230,7 @@ void BasicTaskScheduler
 #if !defined(__WIN32__) && !defined(_WIN32) && defined(FD_SETSIZE)
   if (socketNum >= (int)(FD_SETSIZE)) return;
 #endif
+  cancelReadySocket(socketNum);
   FD_CLR((unsigned)socketNum, &fReadSet);
   FD_CLR((unsigned)socketNum, &fWriteSet);
   FD_CLR((unsigned)socketNum, &fExceptionSet);
@@ -242,6 +255,7 @@ void BasicTaskScheduler::moveSocketHandling(int oldSocketNum, int newSocketNum)
 #if !defined(__WIN32__) && !defined(_WIN32) && defined(FD_SETSIZE)
   if (oldSocketNum >= (int)(FD_SETSIZE) || newSocketNum >= (int)(FD_SETSIZE)) return; // sanity check
 #endif
+  cancelReadySocket(oldSocketNum); cancelReadySocket(newSocketNum);
   if (FD_ISSET(oldSocketNum, &fReadSet)) {FD_CLR((unsigned)oldSocketNum, &fReadSet); FD_SET((unsigned)newSocketNum, &fReadSet);}
   if (FD_ISSET(oldSocketNum, &fWriteSet)) {FD_CLR((unsigned)oldSocketNum, &fWriteSet); FD_SET((unsigned)newSocketNum, &fWriteSet);}
   if (FD_ISSET(oldSocketNum, &fExceptionSet)) {FD_CLR((unsigned)oldSocketNum, &fExceptionSet); FD_SET((unsigned)newSocketNum, &fExceptionSet);}
@@ -19,6 +19,20 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "BasicUsageEnvironment0.hh"
 #include "HandlerSet.hh"
+#include "TimerWheel.hh"
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#elif !defined(__WIN32__) && !defined(_WIN32)
+#include <fcntl.h>
+#endif
+
+// Atomic pointer operations, used to implement posted tasks:
+#if defined(__WIN32__) || defined(_WIN32)
+#define COMPARE_AND_SWAP_POINTER(ptr, oldValue, newValue) \
+  (InterlockedCompareExchangePointer((PVOID volatile*)(ptr), (PVOID)(newValue), (PVOID)(oldValue)) == (PVOID)(oldValue))
+#else
+#define COMPARE_AND_SWAP_POINTER(ptr, oldValue, newValue) __sync_bool_compare_and_swap((ptr), (oldValue), (newValue))
+#endif
 
 ////////// A subclass of DelayQueueEntry,
 //////////     used to implement BasicTaskScheduler0::scheduleDelayedTask()
@@ -41,19 +55,93 @@ private:
 };
 
 
+////////// PostedTask //////////
+
+class PostedTask {
+public:
+  PostedTask(TaskFunc* proc, void* clientData)
+    : fProc(proc), fClientData(clientData), fNext(NULL) {
+  }
+
+  TaskFunc* fProc;
+  void* fClientData;
+  PostedTask* fNext;
+};
+
+
 ////////// BasicTaskScheduler0 //////////
 
-BasicTaskScheduler0::BasicTaskScheduler0()
-  : fLastHandledSocketNum(-1), fTriggersAwaitingHandling(0), fLastUsedTriggerMask(1), fLastUsedTriggerNum(MAX_NUM_EVENT_TRIGGERS-1) {
+BasicTaskScheduler0::BasicTaskScheduler0(Boolean useTimerWheel)
+  : fTimerWheel(useTimerWheel ? new TimerWheel : NULL), fLastHandledSocketNum(-1), fMaxHandlersPerStep(1), fReadySocketNums(NULL), fReadyConditionSets(NULL),
+    fNumReadySockets(0), fReadySocketsBatchCount(0),
+    fTriggersAwaitingHandling(0), fLastUsedTriggerMask(1), fLastUsedTriggerNum(MAX_NUM_EVENT_TRIGGERS-1),
+    fPostedTasks(NULL), fPostedTaskWakeupReadSocket(-1), fPostedTaskWakeupWriteSocket(-1),
+    fIdleTasks(NULL), fIdleTasksBeingHandled(NULL) {
   fHandlers = new HandlerSet;
   for (unsigned i = 0; i < MAX_NUM_EVENT_TRIGGERS; ++i) {
     fTriggeredEventHandlers[i] = NULL;
     fTriggeredEventClientDatas[i] = NULL;
   }
+
+  // Create the socket (or pipe) that "postTask()" uses to wake up the event loop.  (We can't start handling it until our
+  // subclass's constructor calls "enablePostedTaskWakeups()", but it must exist before "postTask()" can be called.)
+#if defined(__WIN32__) || defined(_WIN32)
+  // Windows' "select()" works only on sockets, so use a loopback UDP socket that's 'connected' to itself:
+  int sock = (int)socket(AF_INET, SOCK_DGRAM, 0);
+  if (sock >= 0) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    SOCKLEN_T addrLen = sizeof addr;
+    u_long nonBlocking = 1;
+    if (bind(sock, (struct sockaddr*)&addr, sizeof addr) != 0
+	|| getsockname(sock, (struct sockaddr*)&addr, &addrLen) != 0
+	|| connect(sock, (struct sockaddr*)&addr, sizeof addr) != 0
+	|| ioctlsocket(sock, FIONBIO, &nonBlocking) != 0) {
+      closeSocket(sock);
+      sock = -1;
+    }
+  }
+  fPostedTaskWakeupReadSocket = fPostedTaskWakeupWriteSocket = sock;
+#elif defined(__linux__)
+  fPostedTaskWakeupReadSocket = fPostedTaskWakeupWriteSocket = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+#else
+  int pipeFds[2];
+  if (pipe(pipeFds) == 0) {
+    fcntl(pipeFds[0], F_SETFL, fcntl(pipeFds[0], F_GETFL)|O_NONBLOCK);
+    fcntl(pipeFds[1], F_SETFL, fcntl(pipeFds[1], F_GETFL)|O_NONBLOCK);
+    fPostedTaskWakeupReadSocket = pipeFds[0];
+    fPostedTaskWakeupWriteSocket = pipeFds[1];
+  }
+#endif
 }
 
 BasicTaskScheduler0::~BasicTaskScheduler0() {
+  // Delete any posted (or 'idle') tasks that didn't get handled:
+  while (fPostedTasks != NULL) {
+    PostedTask* task = fPostedTasks;
+    fPostedTasks = task->fNext;
+    delete task;
+  }
+  while (fIdleTasks != NULL) {
+    PostedTask* task = fIdleTasks;
+    fIdleTasks = task->fNext;
+    delete task;
+  }
+#if defined(__WIN32__) || defined(_WIN32)
+  if (fPostedTaskWakeupReadSocket >= 0) closeSocket(fPostedTaskWakeupReadSocket);
+#else
+  if (fPostedTaskWakeupReadSocket >= 0) close(fPostedTaskWakeupReadSocket);
+  if (fPostedTaskWakeupWriteSocket >= 0 && fPostedTaskWakeupWriteSocket != fPostedTaskWakeupReadSocket) {
+    close(fPostedTaskWakeupWriteSocket);
+  }
+#endif
+
+  delete[] fReadySocketNums; delete[] fReadyConditionSets;
   delete fHandlers;
+  delete fTimerWheel;
 }
 
 TaskToken BasicTaskScheduler0::scheduleDelayedTask(int64_t microseconds,
@@ -62,13 +150,18 @@ TaskToken BasicTaskScheduler0::scheduleDelayedTask(int64_t microseconds,
   if (microseconds < 0) microseconds = 0;
   DelayInterval timeToDelay((long)(microseconds/1000000), (long)(microseconds%1000000));
   AlarmHandler* alarmHandler = new AlarmHandler(proc, clientData, timeToDelay);
-  fDelayQueue.addEntry(alarmHandler);
+  if (fTimerWheel != NULL) {
+    fTimerWheel->addEntry(alarmHandler);
+  } else {
+    fDelayQueue.addEntry(alarmHandler);
+  }
 
   return (void*)(alarmHandler->token());
 }
 
 void BasicTaskScheduler0::unscheduleDelayedTask(TaskToken& prevTask) {
-  DelayQueueEntry* alarmHandler = fDelayQueue.removeEntry((intptr_t)prevTask);
+  DelayQueueEntry* alarmHandler = fTimerWheel != NULL ? fTimerWheel->removeEntry((intptr_t)prevTask)
+    : fDelayQueue.removeEntry((intptr_t)prevTask);
   prevTask = NULL;
   delete alarmHandler;
 }
@@ -143,6 +236,248 @@ void BasicTaskScheduler0::triggerEvent(EventTriggerId eventTriggerId, void* clie
 }
 
 
+DelayInterval const& BasicTaskScheduler0::timeToNextAlarm() {
+  return fTimerWheel != NULL ? fTimerWheel->timeToNextAlarm() : fDelayQueue.timeToNextAlarm();
+}
+
+void BasicTaskScheduler0::handleAlarm() {
+  if (fTimerWheel != NULL) {
+    fTimerWheel->handleAlarm();
+  } else {
+    fDelayQueue.handleAlarm();
+  }
+}
+
+void BasicTaskScheduler0::setMaxSocketHandlersPerStep(unsigned maxHandlersPerStep) {
+  if (maxHandlersPerStep == 0) maxHandlersPerStep = 1;
+  if (maxHandlersPerStep == fMaxHandlersPerStep) return;
+
+  resetReadySockets();
+  delete[] fReadySocketNums; fReadySocketNums = NULL;
+  delete[] fReadyConditionSets; fReadyConditionSets = NULL;
+
+  fMaxHandlersPerStep = maxHandlersPerStep;
+  if (fMaxHandlersPerStep > 1) {
+    fReadySocketNums = new int[fMaxHandlersPerStep];
+    fReadyConditionSets = new int[fMaxHandlersPerStep];
+  }
+}
+
+void BasicTaskScheduler0::resetReadySockets() {
+  fNumReadySockets = 0;
+  ++fReadySocketsBatchCount; // in case we're being called reentrantly, from within "handleReadySockets()"
+}
+
+void BasicTaskScheduler0::noteReadySocket(int socketNum, int resultConditionSet) {
+  if (fNumReadySockets >= fMaxHandlersPerStep || fReadySocketNums == NULL) return; // we're over budget
+
+  fReadySocketNums[fNumReadySockets] = socketNum;
+  fReadyConditionSets[fNumReadySockets] = resultConditionSet;
+  ++fNumReadySockets;
+}
+
+void BasicTaskScheduler0::handleReadySockets() {
+  unsigned batchCount = fReadySocketsBatchCount;
+
+  for (unsigned i = 0; i < fNumReadySockets; ++i) {
+    int sock = fReadySocketNums[i]; // alias
+    if (sock < 0) continue; // this socket's handling was changed by an earlier handler in this batch
+
+    // Look up the handler again, because an earlier handler in this batch might have changed it:
+    HandlerDescriptor* handler = fHandlers->lookupHandler(sock);
+    if (handler == NULL || handler->handlerProc == NULL) continue;
+    int resultConditionSet = fReadyConditionSets[i]&handler->conditionSet;
+    if (resultConditionSet == 0) continue;
+
+    fLastHandledSocketNum = sock;
+        // Note: we set "fLastHandledSocketNum" before calling the handler,
+        // in case the handler calls "doEventLoop()" reentrantly.
+    (*handler->handlerProc)(handler->clientData, resultConditionSet);
+
+    if (fReadySocketsBatchCount != batchCount) {
+      // The handler called "doEventLoop()" (or "SingleStep()") reentrantly (or changed our batch size),
+      // so the remaining entries in our batch are no longer valid:
+      return;
+    }
+  }
+  fNumReadySockets = 0;
+}
+
+void BasicTaskScheduler0::cancelReadySocket(int socketNum) {
+  for (unsigned i = 0; i < fNumReadySockets; ++i) {
+    if (fReadySocketNums[i] == socketNum) fReadySocketNums[i] = -1;
+  }
+}
+
+void BasicTaskScheduler0::handleTriggeredEvents() {
+  if (fTriggersAwaitingHandling != 0) {
+    if (fTriggersAwaitingHandling == fLastUsedTriggerMask) {
+      // Common-case optimization for a single event trigger:
+      fTriggersAwaitingHandling &=~ fLastUsedTriggerMask;
+      if (fTriggeredEventHandlers[fLastUsedTriggerNum] != NULL) {
+	(*fTriggeredEventHandlers[fLastUsedTriggerNum])(fTriggeredEventClientDatas[fLastUsedTriggerNum]);
+      }
+    } else {
+      // Look for an event trigger that needs handling (making sure that we make forward progress through all possible triggers):
+      unsigned i = fLastUsedTriggerNum;
+      EventTriggerId mask = fLastUsedTriggerMask;
+
+      do {
+	i = (i+1)%MAX_NUM_EVENT_TRIGGERS;
+	mask >>= 1;
+	if (mask == 0) mask = 0x80000000;
+
+	if ((fTriggersAwaitingHandling&mask) != 0) {
+	  fTriggersAwaitingHandling &=~ mask;
+	  if (fTriggeredEventHandlers[i] != NULL) {
+	    (*fTriggeredEventHandlers[i])(fTriggeredEventClientDatas[i]);
+	  }
+
+	  fLastUsedTriggerMask = mask;
+	  fLastUsedTriggerNum = i;
+	  break;
+	}
+      } while (i != fLastUsedTriggerNum);
+    }
+  }
+}
+
+Boolean BasicTaskScheduler0::postTask(TaskFunc* proc, void* clientData) {
+  if (proc == NULL) return False;
+  PostedTask* task = new PostedTask(proc, clientData);
+
+  // Push the new task onto our stack of posted tasks.  (Note that because this function (unlike others in the library)
+  // can be called from an external thread, we do this without locking, using an atomic 'compare and swap'.)
+  PostedTask* oldHead;
+  do {
+    oldHead = fPostedTasks;
+    task->fNext = oldHead;
+  } while (!COMPARE_AND_SWAP_POINTER(&fPostedTasks, oldHead, task));
+
+  if (oldHead == NULL && fPostedTaskWakeupWriteSocket >= 0) {
+    // The stack was empty (so the event loop might be waiting in "select()"); wake it up:
+#if defined(__WIN32__) || defined(_WIN32)
+    send(fPostedTaskWakeupWriteSocket, "", 1, 0);
+#elif defined(__linux__)
+    u_int64_t one = 1;
+    if (write(fPostedTaskWakeupWriteSocket, &one, sizeof one) < 0) {} // we don't care if this fails (if the counter is full)
+#else
+    if (write(fPostedTaskWakeupWriteSocket, "", 1) < 0) {} // we don't care if this fails (if the pipe is full)
+#endif
+  }
+
+  return True;
+}
+
+void BasicTaskScheduler0::enablePostedTaskWakeups() {
+  if (fPostedTaskWakeupReadSocket >= 0) {
+    setBackgroundHandling(fPostedTaskWakeupReadSocket, SOCKET_READABLE, postedTaskWakeupHandler, this);
+  }
+}
+
+void BasicTaskScheduler0::postedTaskWakeupHandler(void* clientData, int /*mask*/) {
+  BasicTaskScheduler0* scheduler = (BasicTaskScheduler0*)clientData;
+
+  // Drain any pending wakeup(s), before we check for posted tasks:
+  char buf[64];
+#if defined(__WIN32__) || defined(_WIN32)
+  while (recv(scheduler->fPostedTaskWakeupReadSocket, buf, sizeof buf, 0) > 0) {}
+#else
+  while (read(scheduler->fPostedTaskWakeupReadSocket, buf, sizeof buf) > 0) {}
+#endif
+
+  scheduler->handlePostedTasks();
+}
+
+void BasicTaskScheduler0::handlePostedTasks() {
+  if (fPostedTasks == NULL) return; // common case
+
+  // Atomically take all of the currently-posted tasks:
+  PostedTask* tasks;
+  do {
+    tasks = fPostedTasks;
+  } while (!COMPARE_AND_SWAP_POINTER(&fPostedTasks, tasks, (PostedTask*)NULL));
+
+  // Reverse the list, so that we handle the tasks in the order in which they were posted:
+  PostedTask* inOrder = NULL;
+  while (tasks != NULL) {
+    PostedTask* next = tasks->fNext;
+    tasks->fNext = inOrder;
+    inOrder = tasks;
+    tasks = next;
+  }
+
+  while (inOrder != NULL) {
+    PostedTask* task = inOrder;
+    inOrder = task->fNext;
+    (*task->fProc)(task->fClientData);
+    delete task;
+  }
+}
+
+// The longest that we'll put off 'idle' tasks if we never become idle:
+#define MAX_IDLE_TASK_DELAY 1000 /*microseconds*/
+
+Boolean BasicTaskScheduler0::scheduleWhenIdle(TaskFunc* proc, void* clientData) {
+  if (proc == NULL) return False;
+
+  if (fIdleTasks == NULL) {
+    fIdleTasksDeadline = TimeNow();
+    fIdleTasksDeadline += DelayInterval(0, MAX_IDLE_TASK_DELAY);
+  }
+  PostedTask* task = new PostedTask(proc, clientData);
+  task->fNext = fIdleTasks;
+  fIdleTasks = task;
+
+  return True;
+}
+
+static void removeMatchingTasks(PostedTask*& tasks, TaskFunc* proc, void* clientData) {
+  PostedTask** taskPtr = &tasks;
+  while (*taskPtr != NULL) {
+    PostedTask* task = *taskPtr;
+    if (task->fProc == proc && task->fClientData == clientData) {
+      *taskPtr = task->fNext;
+      delete task;
+    } else {
+      taskPtr = &task->fNext;
+    }
+  }
+}
+
+void BasicTaskScheduler0::unscheduleWhenIdle(TaskFunc* proc, void* clientData) {
+  removeMatchingTasks(fIdleTasks, proc, clientData);
+  removeMatchingTasks(fIdleTasksBeingHandled, proc, clientData); // in case we're called by an 'idle' task
+}
+
+void BasicTaskScheduler0::handleIdleTasksIfIdle() {
+  if (fIdleTasks == NULL) return; // common case
+  if (fIdleTasksBeingHandled != NULL) return; // we've been called reentrantly (from an 'idle' task)
+
+  // We're 'idle' only if no delayed task is due now.  But if we stay busy, then we handle the 'idle' tasks anyway, once the
+  // oldest of them has waited "MAX_IDLE_TASK_DELAY" - so that (e.g.) a partly-filled batch of packets can't be held forever:
+  DelayInterval const& timeToDelay = timeToNextAlarm();
+  if (timeToDelay.seconds() == 0 && timeToDelay.useconds() == 0 && TimeNow() < fIdleTasksDeadline) return;
+
+  // Take all of the current 'idle' tasks (any that get scheduled by these tasks will be handled next time),
+  // and handle them in the order in which they were scheduled:
+  PostedTask* tasks = fIdleTasks;
+  fIdleTasks = NULL;
+  while (tasks != NULL) {
+    PostedTask* next = tasks->fNext;
+    tasks->fNext = fIdleTasksBeingHandled;
+    fIdleTasksBeingHandled = tasks;
+    tasks = next;
+  }
+
+  while (fIdleTasksBeingHandled != NULL) {
+    PostedTask* task = fIdleTasksBeingHandled;
+    fIdleTasksBeingHandled = task->fNext; // before we call the task, in case it unschedules other 'idle' tasks
+    (*task->fProc)(task->fClientData);
+    delete task;
+  }
+}
+
 ////////// HandlerSet (etc.) implementation //////////
 
 HandlerDescriptor::HandlerDescriptor(HandlerDescriptor* nextHandler)
@@ -165,7 +500,7 @@ HandlerDescriptor::~HandlerDescriptor() {
 }
 
 HandlerSet::HandlerSet()
-  : fHandlers(&fHandlers) {
+  : fHandlers(&fHandlers), fHandlersBySocketNum(NULL), fTableSize(0) {
   fHandlers.socketNum = -1; // shouldn't ever get looked at, but in case...
 }
 
@@ -174,6 +509,7 @@ HandlerSet::~HandlerSet() {
   while (fHandlers.fNextHandler != &fHandlers) {
     delete fHandlers.fNextHandler; // changes fHandlers->fNextHandler
   }
+  delete[] fHandlersBySocketNum;
 }
 
 void HandlerSet
@@ -183,6 +519,7 @@ void HandlerSet
   if (handler == NULL) { // No existing handler, so create a new descr:
     handler = new HandlerDescriptor(fHandlers.fNextHandler);
     handler->socketNum = socketNum;
+    setTableEntry(socketNum, handler);
   }
 
   handler->conditionSet = conditionSet;
@@ -192,17 +529,33 @@ void HandlerSet
 
 void HandlerSet::clearHandler(int socketNum) {
   HandlerDescriptor* handler = lookupHandler(socketNum);
-  delete handler;
+  if (handler != NULL) {
+    setTableEntry(socketNum, NULL);
+    delete handler;
+  }
 }
 
 void HandlerSet::moveHandler(int oldSocketNum, int newSocketNum) {
+  if (newSocketNum == oldSocketNum) return;
+
   HandlerDescriptor* handler = lookupHandler(oldSocketNum);
   if (handler != NULL) {
+    // Any existing handler for "newSocketNum" is replaced:
+    clearHandler(newSocketNum);
+
+    setTableEntry(oldSocketNum, NULL);
     handler->socketNum = newSocketNum;
+    setTableEntry(newSocketNum, handler);
   }
 }
 
 HandlerDescriptor* HandlerSet::lookupHandler(int socketNum) {
+  if (socketNum >= 0 && socketNum < HANDLER_SET_MAX_TABLE_SIZE) {
+    // Common case: The handler (if any) is in our table:
+    return (unsigned)socketNum < fTableSize ? fHandlersBySocketNum[socketNum] : NULL;
+  }
+
+  // Search for the handler:
   HandlerDescriptor* handler;
   HandlerIterator iter(*this);
   while ((handler = iter.next()) != NULL) {
@@ -211,6 +564,28 @@ HandlerDescriptor* HandlerSet::lookupHandler(int socketNum) {
   return handler;
 }
 
+void HandlerSet::setTableEntry(int socketNum, HandlerDescriptor* handler) {
+  if (socketNum < 0 || socketNum >= HANDLER_SET_MAX_TABLE_SIZE) return; // this socket isn't in our table
+
+  if ((unsigned)socketNum >= fTableSize) {
+    if (handler == NULL) return; // no change
+
+    // Grow our table, to fit this socket number:
+    unsigned newTableSize = fTableSize == 0 ? 64 : fTableSize;
+    while (newTableSize <= (unsigned)socketNum) newTableSize *= 2;
+    if (newTableSize > HANDLER_SET_MAX_TABLE_SIZE) newTableSize = HANDLER_SET_MAX_TABLE_SIZE;
+
+    HandlerDescriptor** newTable = new HandlerDescriptor*[newTableSize];
+    unsigned i;
+    for (i = 0; i < fTableSize; ++i) newTable[i] = fHandlersBySocketNum[i];
+    for (; i < newTableSize; ++i) newTable[i] = NULL;
+    delete[] fHandlersBySocketNum;
+    fHandlersBySocketNum = newTable; fTableSize = newTableSize;
+  }
+
+  fHandlersBySocketNum[socketNum] = handler;
+}
+
 HandlerIterator::HandlerIterator(HandlerSet& handlerSet)
   : fOurSet(handlerSet) {
   reset();
@@ -58,7 +58,7 @@ all:	$(ALL)
 
 OBJS = BasicUsageEnvironment0.$(OBJ) BasicUsageEnvironment.$(OBJ) \
 	BasicTaskScheduler0.$(OBJ) BasicTaskScheduler.$(OBJ) \
-	DelayQueue.$(OBJ) BasicHashTable.$(OBJ)
+	EpollTaskScheduler.$(OBJ) DelayQueue.$(OBJ) TimerWheel.$(OBJ) BasicHashTable.$(OBJ)
 
 libBasicUsageEnvironment.$(LIB_SUFFIX): $(OBJS)
 	$(LIBRARY_LINK)$@ $(LIBRARY_LINK_OPTS) \
@@ -74,9 +74,12 @@ BasicUsageEnvironment0.$(CPP):	include/BasicUsageEnvironment0.hh
 include/BasicUsageEnvironment0.hh:	include/BasicUsageEnvironment_version.hh include/DelayQueue.hh
 BasicUsageEnvironment.$(CPP):	include/BasicUsageEnvironment.hh
 include/BasicUsageEnvironment.hh:	include/BasicUsageEnvironment0.hh
-BasicTaskScheduler0.$(CPP):	include/BasicUsageEnvironment0.hh include/HandlerSet.hh
+BasicTaskScheduler0.$(CPP):	include/BasicUsageEnvironment0.hh include/HandlerSet.hh include/TimerWheel.hh
 BasicTaskScheduler.$(CPP):	include/BasicUsageEnvironment.hh include/HandlerSet.hh
+EpollTaskScheduler.$(CPP):	include/BasicUsageEnvironment.hh include/HandlerSet.hh
 DelayQueue.$(CPP):		include/DelayQueue.hh
+TimerWheel.$(CPP):		include/TimerWheel.hh
+include/TimerWheel.hh:	include/DelayQueue.hh
 BasicHashTable.$(CPP):		include/BasicHashTable.hh
 
 clean:
@@ -95,7 +95,7 @@ const DelayInterval ETERNITY(INT_MAX, MILLION-1);
 intptr_t DelayQueueEntry::tokenCounter = 0;
 
 DelayQueueEntry::DelayQueueEntry(DelayInterval delay)
-  : fDeltaTimeRemaining(delay) {
+  : fDeltaTimeRemaining(delay), fDueTime(0) {
   fNext = fPrev = this;
   fToken = ++tokenCounter;
 }
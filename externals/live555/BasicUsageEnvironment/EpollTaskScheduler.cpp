@@ -0,0 +1,265 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// Basic Usage Environment: for a simple, non-scripted, console application
+// Implementation of an "epoll()"-based task scheduler
+
+#include "BasicUsageEnvironment.hh"
+#include "HandlerSet.hh"
+#include <stdio.h>
+
+#if defined(__linux__) && !defined(NO_EPOLL)
+#include <sys/epoll.h>
+
+// The maximum number of ready events that we fetch from the kernel in a single "epoll_wait()" call.
+// (Any additional ready events get returned - first - by the next call.)
+#ifndef EPOLL_MAX_READY_EVENTS
+#define EPOLL_MAX_READY_EVENTS 1024
+#endif
+
+////////// EpollTaskScheduler //////////
+
+EpollTaskScheduler* EpollTaskScheduler::createNew(unsigned maxSchedulerGranularity, Boolean useTimerWheel) {
+  int epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd < 0) return NULL;
+
+  return new EpollTaskScheduler(epollFd, maxSchedulerGranularity, useTimerWheel);
+}
+
+EpollTaskScheduler::EpollTaskScheduler(int epollFd, unsigned maxSchedulerGranularity, Boolean useTimerWheel)
+  : BasicTaskScheduler0(useTimerWheel), fMaxSchedulerGranularity(maxSchedulerGranularity), fEpollFd(epollFd),
+    fUnpollableSockets(NULL), fNumUnpollableSockets(0), fUnpollableSocketsSize(0), fNextUnpollableSocketIndex(0) {
+  fReadyEvents = new struct epoll_event[EPOLL_MAX_READY_EVENTS];
+
+  enablePostedTaskWakeups();
+  if (maxSchedulerGranularity > 0) schedulerTickTask(); // ensures that we handle events frequently
+}
+
+EpollTaskScheduler::~EpollTaskScheduler() {
+  delete[] fReadyEvents;
+  delete[] fUnpollableSockets;
+  close(fEpollFd);
+}
+
+void EpollTaskScheduler::schedulerTickTask(void* clientData) {
+  ((EpollTaskScheduler*)clientData)->schedulerTickTask();
+}
+
+void EpollTaskScheduler::schedulerTickTask() {
+  scheduleDelayedTask(fMaxSchedulerGranularity, schedulerTickTask, this);
+}
+
+#ifndef MILLION
+#define MILLION 1000000
+#endif
+
+static int conditionSetFromEpollEvents(u_int32_t events) {
+  int conditionSet = 0;
+  // As with "select()", we treat an error or hangup as making the socket both readable and writable:
+  if (events&(EPOLLIN|EPOLLERR|EPOLLHUP)) conditionSet |= SOCKET_READABLE;
+  if (events&(EPOLLOUT|EPOLLERR|EPOLLHUP)) conditionSet |= SOCKET_WRITABLE;
+  if (events&EPOLLPRI) conditionSet |= SOCKET_EXCEPTION;
+
+  return conditionSet;
+}
+
+void EpollTaskScheduler::SingleStep(unsigned maxDelayTime) {
+  // If we're about to wait for events, first handle any 'idle' tasks:
+  handleIdleTasksIfIdle();
+
+  DelayInterval const& timeToDelay = timeToNextAlarm();
+  // "epoll_wait()" takes a timeout in milliseconds.  Round up, so that we don't spin (with a 0 timeout)
+  // while waiting for an alarm that's less than 1 ms away.
+  // Don't make the timeout any larger than 1 million seconds (11.5 days)
+  int64_t usecsToDelay = timeToDelay.seconds() > MILLION ? (int64_t)MILLION*MILLION
+    : (int64_t)timeToDelay.seconds()*MILLION + timeToDelay.useconds();
+  // Also check our "maxDelayTime" parameter (if it's > 0):
+  if (maxDelayTime > 0 && usecsToDelay > (int64_t)maxDelayTime) usecsToDelay = maxDelayTime;
+  int64_t msecsToDelay = (usecsToDelay + 999)/1000;
+  if (msecsToDelay > 0x7FFFFFFF) msecsToDelay = 0x7FFFFFFF;
+  // If we have any 'unpollable' descriptors, then they're always ready, so we don't wait:
+  if (fNumUnpollableSockets > 0) msecsToDelay = 0;
+
+  // If we're handling several ready sockets per step, then we ask for no more ready events than we'll handle.
+  // (The kernel returns any remaining ready events - ahead of those that we handled - next time, so this is fair.)
+  // But we leave room in our budget for any 'unpollable' descriptors (up to half of it), because otherwise a steady
+  // stream of ready sockets would starve them:
+  int maxEvents = EPOLL_MAX_READY_EVENTS;
+  if (fMaxHandlersPerStep > 1) {
+    unsigned numToReserve = fNumUnpollableSockets < fMaxHandlersPerStep/2 ? fNumUnpollableSockets : fMaxHandlersPerStep/2;
+    if (fMaxHandlersPerStep - numToReserve < (unsigned)maxEvents) maxEvents = (int)(fMaxHandlersPerStep - numToReserve);
+  }
+
+  int numReadyEvents = epoll_wait(fEpollFd, fReadyEvents, maxEvents, (int)msecsToDelay);
+  if (numReadyEvents < 0) {
+    if (errno != EINTR && errno != EAGAIN) {
+      // Unexpected error - treat this as fatal:
+      perror("EpollTaskScheduler::SingleStep(): epoll_wait() fails");
+      internalError();
+    }
+    numReadyEvents = 0;
+  }
+
+  if (fMaxHandlersPerStep > 1) {
+    // Call the handler functions for all of the ready sockets that we got:
+    resetReadySockets();
+    for (int i = 0; i < numReadyEvents; ++i) {
+      noteReadySocket(fReadyEvents[i].data.fd, conditionSetFromEpollEvents(fReadyEvents[i].events));
+    }
+    // Then note as many 'unpollable' descriptors as our budget allows - starting, each time, where we left off last time,
+    // in case there are more of them than we can handle in one step:
+    unsigned numToNote = fMaxHandlersPerStep - (unsigned)numReadyEvents;
+    if (numToNote > fNumUnpollableSockets) numToNote = fNumUnpollableSockets;
+    for (unsigned j = 0; j < numToNote; ++j) {
+      if (fNextUnpollableSocketIndex >= fNumUnpollableSockets) fNextUnpollableSocketIndex = 0;
+      noteReadySocket(fUnpollableSockets[fNextUnpollableSocketIndex++], SOCKET_READABLE|SOCKET_WRITABLE);
+    }
+    handleReadySockets();
+  } else {
+    // Call the handler function for one ready socket.
+    // To ensure forward progress through the handlers, we choose the ready socket with the smallest socket
+    // number that's larger than the last socket number that we handled (wrapping around if there's none):
+    HandlerDescriptor* bestHandler = NULL; int bestConditionSet = 0;
+    HandlerDescriptor* firstHandler = NULL; int firstConditionSet = 0;
+    int numCandidates = numReadyEvents + (int)fNumUnpollableSockets;
+    for (int i = 0; i < numCandidates; ++i) {
+      int sock, resultConditionSet;
+      if (i < numReadyEvents) {
+	sock = fReadyEvents[i].data.fd;
+	resultConditionSet = conditionSetFromEpollEvents(fReadyEvents[i].events);
+      } else {
+	sock = fUnpollableSockets[i - numReadyEvents];
+	resultConditionSet = SOCKET_READABLE|SOCKET_WRITABLE;
+      }
+
+      HandlerDescriptor* handler = fHandlers->lookupHandler(sock);
+      if (handler == NULL || handler->handlerProc == NULL) continue;
+      resultConditionSet &= handler->conditionSet;
+      if (resultConditionSet == 0) continue;
+
+      if (sock > fLastHandledSocketNum && (bestHandler == NULL || sock < bestHandler->socketNum)) {
+        bestHandler = handler; bestConditionSet = resultConditionSet;
+      }
+      if (firstHandler == NULL || sock < firstHandler->socketNum) {
+        firstHandler = handler; firstConditionSet = resultConditionSet;
+      }
+    }
+    if (bestHandler == NULL) { // wrap around
+      bestHandler = firstHandler; bestConditionSet = firstConditionSet;
+    }
+    if (bestHandler != NULL) {
+      fLastHandledSocketNum = bestHandler->socketNum;
+          // Note: we set "fLastHandledSocketNum" before calling the handler,
+          // in case the handler calls "doEventLoop()" reentrantly.
+      (*bestHandler->handlerProc)(bestHandler->clientData, bestConditionSet);
+    } else {
+      fLastHandledSocketNum = -1;//because we didn't call a handler
+    }
+  }
+
+  // Also handle any newly-triggered event (Note that we do this *after* calling a socket handler,
+  // in case the triggered event handler modifies The set of readable sockets.)
+  handleTriggeredEvents();
+
+  // Also handle any newly-posted tasks:
+  handlePostedTasks();
+
+  // Also handle any delayed event that may have come due.
+  handleAlarm();
+}
+
+void EpollTaskScheduler::updateEpollRegistration(int socketNum, int conditionSet) {
+  removeUnpollableSocket(socketNum); // if it's there
+
+  if (conditionSet == 0) {
+    // Note: This fails (harmlessly) if the socket has already been closed (which removes it from the "epoll" set):
+    epoll_ctl(fEpollFd, EPOLL_CTL_DEL, socketNum, NULL);
+    return;
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof ev);
+  if (conditionSet&SOCKET_READABLE) ev.events |= EPOLLIN;
+  if (conditionSet&SOCKET_WRITABLE) ev.events |= EPOLLOUT;
+  if (conditionSet&SOCKET_EXCEPTION) ev.events |= EPOLLPRI;
+  ev.data.fd = socketNum;
+
+  // The socket might already be registered (or might have been closed - and its number reused - since it was
+  // registered), so try modifying an existing registration first:
+  if (epoll_ctl(fEpollFd, EPOLL_CTL_MOD, socketNum, &ev) < 0
+      && (errno != ENOENT || epoll_ctl(fEpollFd, EPOLL_CTL_ADD, socketNum, &ev) < 0)) {
+    if (errno == EPERM) {
+      // "epoll()" doesn't support this kind of descriptor (e.g., it's a regular file):
+      addUnpollableSocket(socketNum);
+    } else {
+      fprintf(stderr, "EpollTaskScheduler: epoll_ctl() fails for socket %d: %s\n", socketNum, strerror(errno));
+    }
+  }
+}
+
+void EpollTaskScheduler::addUnpollableSocket(int socketNum) {
+  if (fNumUnpollableSockets == fUnpollableSocketsSize) {
+    // Grow our array:
+    fUnpollableSocketsSize = fUnpollableSocketsSize == 0 ? 4 : 2*fUnpollableSocketsSize;
+    int* newArray = new int[fUnpollableSocketsSize];
+    for (unsigned i = 0; i < fNumUnpollableSockets; ++i) newArray[i] = fUnpollableSockets[i];
+    delete[] fUnpollableSockets; fUnpollableSockets = newArray;
+  }
+  fUnpollableSockets[fNumUnpollableSockets++] = socketNum;
+}
+
+void EpollTaskScheduler::removeUnpollableSocket(int socketNum) {
+  for (unsigned i = 0; i < fNumUnpollableSockets; ++i) {
+    if (fUnpollableSockets[i] == socketNum) {
+      fUnpollableSockets[i] = fUnpollableSockets[--fNumUnpollableSockets];
+      return;
+    }
+  }
+}
+
+void EpollTaskScheduler
+  ::setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData) {
+  if (socketNum < 0) return;
+  cancelReadySocket(socketNum);
+
+  if (conditionSet == 0) {
+    fHandlers->clearHandler(socketNum);
+  } else {
+    fHandlers->assignHandler(socketNum, conditionSet, handlerProc, clientData);
+  }
+  updateEpollRegistration(socketNum, conditionSet);
+}
+
+void EpollTaskScheduler::moveSocketHandling(int oldSocketNum, int newSocketNum) {
+  if (oldSocketNum < 0 || newSocketNum < 0) return; // sanity check
+  cancelReadySocket(oldSocketNum); cancelReadySocket(newSocketNum);
+
+  HandlerDescriptor* handler = fHandlers->lookupHandler(oldSocketNum);
+  if (handler == NULL) return;
+  int conditionSet = handler->conditionSet;
+
+  updateEpollRegistration(oldSocketNum, 0);
+  fHandlers->moveHandler(oldSocketNum, newSocketNum);
+  updateEpollRegistration(newSocketNum, conditionSet);
+}
+
+#else
+// "epoll()" is not available on this platform:
+
+EpollTaskScheduler* EpollTaskScheduler::createNew(unsigned /*maxSchedulerGranularity*/, Boolean /*useTimerWheel*/) {
+  return NULL;
+}
+#endif
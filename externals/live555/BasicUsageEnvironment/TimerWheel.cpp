@@ -0,0 +1,313 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A hierarchical timer wheel: an alternative to "DelayQueue" for large numbers of pending delayed tasks
+// Implementation
+
+#include "TimerWheel.hh"
+
+static const int MILLION = 1000000;
+
+#define SLOT_MASK (TIMER_WHEEL_NUM_SLOTS-1)
+#define NUM_SLOT_HEADS (TIMER_WHEEL_NUM_LEVELS*TIMER_WHEEL_NUM_SLOTS)
+#define MAX_TICKS_AHEAD (((u_int64_t)1)<<(TIMER_WHEEL_NUM_LEVELS*TIMER_WHEEL_SLOT_BITS))
+
+static const DelayInterval NO_ALARM(0x7FFFFFFF, MILLION-1); // (like "DelayQueue"s 'ETERNITY')
+
+// Returns the index of the lowest bit set in "bits" (which must be non-zero):
+static unsigned lowestBitSet(u_int64_t bits) {
+#if defined(__GNUC__)
+  return (unsigned)__builtin_ctzll(bits);
+#else
+  unsigned result = 0;
+  if ((bits&0xFFFFFFFF) == 0) { bits >>= 32; result += 32; }
+  if ((bits&0xFFFF) == 0) { bits >>= 16; result += 16; }
+  if ((bits&0xFF) == 0) { bits >>= 8; result += 8; }
+  if ((bits&0xF) == 0) { bits >>= 4; result += 4; }
+  if ((bits&0x3) == 0) { bits >>= 2; result += 2; }
+  if ((bits&0x1) == 0) ++result;
+  return result;
+#endif
+}
+
+///// TimerWheelSlotHead /////
+
+// A dummy entry, used to head each list of entries:
+class TimerWheelSlotHead: public DelayQueueEntry {
+public:
+  TimerWheelSlotHead()
+    : DelayQueueEntry(DELAY_ZERO) {
+  }
+};
+
+
+///// TimerWheel /////
+
+TimerWheel::TimerWheel()
+  : fTimeNow(0), fCurTick(0), fNumEntriesInWheel(0), fTimeToNextAlarm(NO_ALARM) {
+  fLastSyncTime = TimeNow();
+
+  fSlotHeads = new TimerWheelSlotHead[NUM_SLOT_HEADS+1];
+  fDueList = &fSlotHeads[NUM_SLOT_HEADS];
+  for (unsigned level = 0; level < TIMER_WHEEL_NUM_LEVELS; ++level) fSlotIsNonEmpty[level] = 0;
+
+  fEntriesByToken = HashTable::create(ONE_WORD_HASH_KEYS);
+}
+
+TimerWheel::~TimerWheel() {
+  // Delete each remaining entry:
+  DelayQueueEntry* entry;
+  while ((entry = (DelayQueueEntry*)fEntriesByToken->RemoveNext()) != NULL) {
+    unlinkEntry(entry);
+    delete entry;
+  }
+  delete fEntriesByToken;
+
+  delete[] fSlotHeads;
+}
+
+void TimerWheel::addEntry(DelayQueueEntry* newEntry) {
+  if (newEntry == NULL) return;
+
+  synchronize();
+  DelayInterval const& delay = newEntry->fDeltaTimeRemaining; // alias
+  newEntry->fDueTime = fTimeNow + (u_int64_t)delay.seconds()*MILLION + (u_int64_t)delay.useconds();
+
+  fEntriesByToken->Add((char const*)(newEntry->token()), newEntry);
+  placeEntry(newEntry);
+}
+
+void TimerWheel::updateEntry(DelayQueueEntry* entry, DelayInterval newDelay) {
+  if (entry == NULL) return;
+
+  removeEntry(entry);
+  entry->fDeltaTimeRemaining = newDelay;
+  addEntry(entry);
+}
+
+void TimerWheel::updateEntry(intptr_t tokenToFind, DelayInterval newDelay) {
+  DelayQueueEntry* entry = (DelayQueueEntry*)fEntriesByToken->Lookup((char const*)tokenToFind);
+  updateEntry(entry, newDelay);
+}
+
+void TimerWheel::removeEntry(DelayQueueEntry* entry) {
+  if (entry == NULL || entry->fNext == NULL) return;
+
+  fEntriesByToken->Remove((char const*)(entry->token()));
+  unlinkEntry(entry);
+}
+
+DelayQueueEntry* TimerWheel::removeEntry(intptr_t tokenToFind) {
+  DelayQueueEntry* entry = (DelayQueueEntry*)fEntriesByToken->Lookup((char const*)tokenToFind);
+  removeEntry(entry);
+  return entry;
+}
+
+DelayInterval const& TimerWheel::timeToNextAlarm() {
+  synchronize();
+  advance();
+
+  u_int64_t nextAlarmTime;
+  if (fDueList->fNext != fDueList) {
+    // The earliest entry is at the head of the 'due' list:
+    nextAlarmTime = fDueList->fNext->fDueTime;
+  } else if (fNumEntriesInWheel == 0) {
+    fTimeToNextAlarm = NO_ALARM;
+    return fTimeToNextAlarm;
+  } else {
+    // Look for the first non-empty slot in the rest of the current (lowest-level) block of ticks.  Each of these
+    // slots holds entries for a single tick, so the earliest entry is the earliest entry in this slot:
+    unsigned curSlot = (unsigned)(fCurTick&SLOT_MASK);
+    u_int64_t bits = fSlotIsNonEmpty[0]>>curSlot;
+    if (bits != 0) {
+      DelayQueueEntry* head = &fSlotHeads[curSlot + lowestBitSet(bits)];
+      nextAlarmTime = head->fNext->fDueTime;
+      for (DelayQueueEntry* entry = head->fNext->fNext; entry != head; entry = entry->fNext) {
+	if (entry->fDueTime < nextAlarmTime) nextAlarmTime = entry->fDueTime;
+      }
+    } else {
+      // Otherwise, there's nothing to handle until a slot from a higher level gets 'cascaded' (at the start of
+      // that slot's block of ticks).  Find the earliest such time:
+      u_int64_t nextTick = (fCurTick|SLOT_MASK) + 1; // the start of the next lowest-level block
+      if (fSlotIsNonEmpty[0] == 0) {
+	nextTick = ~(u_int64_t)0;
+	for (unsigned level = 1; level < TIMER_WHEEL_NUM_LEVELS; ++level) {
+	  if (fSlotIsNonEmpty[level] == 0) continue;
+
+	  unsigned shift = level*TIMER_WHEEL_SLOT_BITS;
+	  unsigned curLevelSlot = (unsigned)((fCurTick>>shift)&SLOT_MASK);
+	  // Rotate the bitmap so that bit 0 is for the slot after the current one:
+	  unsigned rotation = (curLevelSlot+1)&SLOT_MASK;
+	  u_int64_t rotatedBits = rotation == 0 ? fSlotIsNonEmpty[level]
+	    : (fSlotIsNonEmpty[level]>>rotation) | (fSlotIsNonEmpty[level]<<(TIMER_WHEEL_NUM_SLOTS-rotation));
+	  u_int64_t levelTick = (((fCurTick>>shift) + 1 + lowestBitSet(rotatedBits))<<shift);
+	  if (levelTick < nextTick) nextTick = levelTick;
+	}
+      }
+      nextAlarmTime = nextTick<<TIMER_WHEEL_TICK_BITS;
+    }
+  }
+
+  if (nextAlarmTime <= fTimeNow) {
+    fTimeToNextAlarm = DELAY_ZERO;
+  } else {
+    u_int64_t usecsToNextAlarm = nextAlarmTime - fTimeNow;
+    if (usecsToNextAlarm/MILLION >= 0x7FFFFFFF) {
+      fTimeToNextAlarm = NO_ALARM;
+    } else {
+      fTimeToNextAlarm = DelayInterval((time_base_seconds)(usecsToNextAlarm/MILLION),
+				       (time_base_seconds)(usecsToNextAlarm%MILLION));
+    }
+  }
+  return fTimeToNextAlarm;
+}
+
+void TimerWheel::handleAlarm() {
+  synchronize();
+  advance();
+
+  DelayQueueEntry* toRemove = fDueList->fNext;
+  if (toRemove != fDueList && toRemove->fDueTime <= fTimeNow) {
+    // This event is due to be handled:
+    removeEntry(toRemove); // do this first, in case handler accesses queue
+
+    toRemove->handleTimeout();
+  }
+}
+
+void TimerWheel::synchronize() {
+  _EventTime timeNow = TimeNow();
+  if (timeNow < fLastSyncTime) {
+    // The system clock has apparently gone back in time; reset our sync time and return:
+    fLastSyncTime = timeNow;
+    return;
+  }
+  DelayInterval timeSinceLastSync = timeNow - fLastSyncTime;
+  fLastSyncTime = timeNow;
+
+  fTimeNow += (u_int64_t)timeSinceLastSync.seconds()*MILLION + (u_int64_t)timeSinceLastSync.useconds();
+}
+
+void TimerWheel::advance() {
+  u_int64_t nowTick = fTimeNow>>TIMER_WHEEL_TICK_BITS;
+
+  while (fCurTick <= nowTick) {
+    // Move all entries in the current tick's slot onto the 'due' list:
+    unsigned slot = (unsigned)(fCurTick&SLOT_MASK);
+    if ((fSlotIsNonEmpty[0]&(((u_int64_t)1)<<slot)) != 0) {
+      DelayQueueEntry* head = &fSlotHeads[slot];
+      while (head->fNext != head) {
+	DelayQueueEntry* entry = head->fNext;
+	unlinkEntry(entry);
+	addToDueList(entry);
+      }
+    }
+
+    // Then move on to the next tick.  (But if there are no more entries in the rest of the current block of ticks,
+    // then skip ahead to the end of the block - or further, if there are no more entries at all.)
+    u_int64_t nextTick = fCurTick + 1;
+    if (fNumEntriesInWheel == 0) {
+      nextTick = nowTick + 1;
+    } else if ((nextTick&SLOT_MASK) != 0 && (fSlotIsNonEmpty[0]>>(nextTick&SLOT_MASK)) == 0) {
+      nextTick = (fCurTick|SLOT_MASK) + 1;
+      if (nextTick > nowTick + 1) nextTick = nowTick + 1;
+    }
+    fCurTick = nextTick;
+
+    if ((fCurTick&SLOT_MASK) == 0 && fNumEntriesInWheel > 0) {
+      // We're at the start of a new block of ticks, so move entries down from the higher level(s):
+      cascade(1);
+    }
+  }
+}
+
+void TimerWheel::placeEntry(DelayQueueEntry* entry) {
+  u_int64_t dueTick = entry->fDueTime>>TIMER_WHEEL_TICK_BITS;
+  if (dueTick < fCurTick) {
+    // This entry's tick has already been processed:
+    addToDueList(entry);
+    return;
+  }
+
+  u_int64_t ticksAhead = dueTick - fCurTick;
+  if (ticksAhead >= MAX_TICKS_AHEAD) {
+    // This entry is beyond the span of the wheel, so put it in the furthest slot.  (It'll get moved down as time passes.)
+    dueTick = fCurTick + MAX_TICKS_AHEAD - 1;
+    ticksAhead = MAX_TICKS_AHEAD - 1;
+  }
+
+  unsigned level = 0;
+  while ((ticksAhead>>((level+1)*TIMER_WHEEL_SLOT_BITS)) != 0) ++level;
+  unsigned slot = (unsigned)((dueTick>>(level*TIMER_WHEEL_SLOT_BITS))&SLOT_MASK);
+
+  // Add "entry" to the end of this slot's list:
+  DelayQueueEntry* head = &fSlotHeads[level*TIMER_WHEEL_NUM_SLOTS + slot];
+  entry->fNext = head;
+  entry->fPrev = head->fPrev;
+  head->fPrev = entry->fPrev->fNext = entry;
+
+  fSlotIsNonEmpty[level] |= ((u_int64_t)1)<<slot;
+  ++fNumEntriesInWheel;
+}
+
+void TimerWheel::cascade(unsigned level) {
+  // Re-place each entry in the current slot of "level" (each will end up at a lower level):
+  unsigned shift = level*TIMER_WHEEL_SLOT_BITS;
+  unsigned slot = (unsigned)((fCurTick>>shift)&SLOT_MASK);
+  if ((fSlotIsNonEmpty[level]&(((u_int64_t)1)<<slot)) != 0) {
+    DelayQueueEntry* head = &fSlotHeads[level*TIMER_WHEEL_NUM_SLOTS + slot];
+    while (head->fNext != head) {
+      DelayQueueEntry* entry = head->fNext;
+      unlinkEntry(entry);
+      placeEntry(entry);
+    }
+  }
+
+  // If we're also at the start of a block for the next level up, then cascade that level too:
+  if (slot == 0 && level+1 < TIMER_WHEEL_NUM_LEVELS) cascade(level+1);
+}
+
+void TimerWheel::addToDueList(DelayQueueEntry* entry) {
+  // Keep the list sorted by exact time (with equal-time entries in the order they were added).
+  // Entries are usually added in time order, so search backwards from the end of the list:
+  DelayQueueEntry* prev = fDueList->fPrev;
+  while (prev != fDueList && prev->fDueTime > entry->fDueTime) prev = prev->fPrev;
+
+  entry->fPrev = prev;
+  entry->fNext = prev->fNext;
+  prev->fNext = entry->fNext->fPrev = entry;
+}
+
+void TimerWheel::unlinkEntry(DelayQueueEntry* entry) {
+  if (entry->fNext == NULL) return; // already unlinked
+
+  DelayQueueEntry* next = entry->fNext;
+  next->fPrev = entry->fPrev;
+  entry->fPrev->fNext = next;
+  entry->fNext = entry->fPrev = NULL;
+
+  // Entries whose tick has not yet been processed are in a slot of the wheel (rather than in the 'due' list).
+  // For these, update our bookkeeping:
+  if ((entry->fDueTime>>TIMER_WHEEL_TICK_BITS) >= fCurTick) {
+    --fNumEntriesInWheel;
+
+    if (next->fNext == next) {
+      // "entry" was the only entry in its slot, so "next" is the (now empty) slot's head:
+      unsigned headIndex = (unsigned)((TimerWheelSlotHead*)next - fSlotHeads);
+      fSlotIsNonEmpty[headIndex/TIMER_WHEEL_NUM_SLOTS] &=~ (((u_int64_t)1)<<(headIndex%TIMER_WHEEL_NUM_SLOTS));
+    }
+  }
+}
@@ -46,15 +46,19 @@ protected:
 
 class BasicTaskScheduler: public BasicTaskScheduler0 {
 public:
-  static BasicTaskScheduler* createNew(unsigned maxSchedulerGranularity = 10000/*microseconds*/);
+  static BasicTaskScheduler* createNew(unsigned maxSchedulerGranularity = 10000/*microseconds*/,
+				       Boolean useTimerWheel = False);
     // "maxSchedulerGranularity" (default value: 10 ms) specifies the maximum time that we wait (in "select()") before
     // returning to the event loop to handle non-socket or non-timer-based events, such as 'triggered events'.
     // You can change this is you wish (but only if you know what you're doing!), or set it to 0, to specify no such maximum time.
     // (You should set it to 0 only if you know that you will not be using 'event triggers'.)
+    // If "useTimerWheel" is True, delayed tasks are kept in a "TimerWheel" (in which scheduling and unscheduling
+    // each take constant time) rather than in a "DelayQueue".  This is worthwhile if there are many (thousands of)
+    // delayed tasks pending at once.
   virtual ~BasicTaskScheduler();
 
 protected:
-  BasicTaskScheduler(unsigned maxSchedulerGranularity);
+  BasicTaskScheduler(unsigned maxSchedulerGranularity, Boolean useTimerWheel);
       // called only by "createNew()"
 
   static void schedulerTickTask(void* clientData);
@@ -83,4 +87,52 @@ private:
 #endif
 };
 
+
+// A "TaskScheduler" that uses Linux's "epoll()" (rather than "select()") to wait for socket events.
+// Unlike "BasicTaskScheduler", it is not limited to socket numbers < FD_SETSIZE, and its cost per
+// event loop iteration does not grow with the largest socket number being handled.
+struct epoll_event; // forward
+
+class EpollTaskScheduler: public BasicTaskScheduler0 {
+public:
+  static EpollTaskScheduler* createNew(unsigned maxSchedulerGranularity = 10000/*microseconds*/,
+				       Boolean useTimerWheel = False);
+    // "maxSchedulerGranularity" and "useTimerWheel" are as for "BasicTaskScheduler::createNew()".
+    // Returns NULL if "epoll()" is not available on this platform (or if the "epoll" instance could
+    // not be created); in this case, the application should fall back to "BasicTaskScheduler".
+  virtual ~EpollTaskScheduler();
+
+protected:
+  EpollTaskScheduler(int epollFd, unsigned maxSchedulerGranularity, Boolean useTimerWheel);
+      // called only by "createNew()"
+
+  static void schedulerTickTask(void* clientData);
+  void schedulerTickTask();
+
+protected:
+  // Redefined virtual functions:
+  virtual void SingleStep(unsigned maxDelayTime);
+
+  virtual void setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData);
+  virtual void moveSocketHandling(int oldSocketNum, int newSocketNum);
+
+private:
+  void updateEpollRegistration(int socketNum, int conditionSet);
+  void addUnpollableSocket(int socketNum);
+  void removeUnpollableSocket(int socketNum);
+
+protected:
+  unsigned fMaxSchedulerGranularity;
+
+  // To implement background operations:
+  int fEpollFd;
+  struct epoll_event* fReadyEvents;
+
+  // Descriptors (e.g., regular files) that "epoll()" can't watch.  ("select()" always reports these as ready,
+  // so we do the same.)
+  int* fUnpollableSockets;
+  unsigned fNumUnpollableSockets, fUnpollableSocketsSize;
+  unsigned fNextUnpollableSocketIndex; // when handling several ready sockets per step, where we start, in "fUnpollableSockets"
+};
+
 #endif
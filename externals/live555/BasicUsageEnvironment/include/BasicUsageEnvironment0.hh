@@ -66,6 +66,8 @@ private:
 };
 
 class HandlerSet; // forward
+class TimerWheel; // forward
+class PostedTask; // forward
 
 #define MAX_NUM_EVENT_TRIGGERS 32
 
@@ -92,16 +94,58 @@ public:
   virtual void deleteEventTrigger(EventTriggerId eventTriggerId);
   virtual void triggerEvent(EventTriggerId eventTriggerId, void* clientData = NULL);
 
+  virtual Boolean postTask(TaskFunc* proc, void* clientData = NULL);
+  virtual Boolean scheduleWhenIdle(TaskFunc* proc, void* clientData);
+  virtual void unscheduleWhenIdle(TaskFunc* proc, void* clientData);
+
+  void setMaxSocketHandlersPerStep(unsigned maxHandlersPerStep);
+      // By default, each call to "SingleStep()" calls the handler for (at most) one ready socket, even if
+      // "select()" (or "epoll_wait()") reported several ready sockets.  Setting "maxHandlersPerStep" > 1
+      // instead lets "SingleStep()" call the handlers for up to this many ready sockets (in round-robin order)
+      // from a single poll result.  Under load, this greatly reduces the number of system calls.
+  unsigned maxSocketHandlersPerStep() const { return fMaxHandlersPerStep; }
+
 protected:
-  BasicTaskScheduler0();
+  BasicTaskScheduler0(Boolean useTimerWheel = False);
+      // If "useTimerWheel" is True, delayed tasks are kept in a "TimerWheel" rather than in "fDelayQueue".
+
+  // Called (by a subclass's "SingleStep()") to implement delayed tasks (using either "fDelayQueue" or "fTimerWheel"):
+  DelayInterval const& timeToNextAlarm();
+  void handleAlarm();
+
+  void handleTriggeredEvents();
+      // Called (by a subclass's "SingleStep()") to handle any newly-triggered event(s)
+
+  void enablePostedTaskWakeups();
+      // Called by a subclass's constructor, so that the event loop wakes up whenever a task gets posted
+  void handlePostedTasks();
+      // Called (by a subclass's "SingleStep()") to handle any newly-posted tasks
+  void handleIdleTasksIfIdle();
+      // Called (by a subclass's "SingleStep()") before it waits for events
+
+  // To implement batched socket handling (when "fMaxHandlersPerStep" > 1), a subclass's "SingleStep()" calls
+  // "resetReadySockets()", then "noteReadySocket()" for each ready socket (up to "fMaxHandlersPerStep"),
+  // then "handleReadySockets()":
+  void resetReadySockets();
+  void noteReadySocket(int socketNum, int resultConditionSet);
+  void handleReadySockets();
+  void cancelReadySocket(int socketNum);
+      // Called by a subclass's "setBackgroundHandling()" and "moveSocketHandling()", so that a socket's (now stale)
+      // ready state doesn't get delivered later in the current batch
 
 protected:
   // To implement delayed operations:
   DelayQueue fDelayQueue;
+  TimerWheel* fTimerWheel; // if non-NULL, used instead of "fDelayQueue"
 
   // To implement background reads:
   HandlerSet* fHandlers;
   int fLastHandledSocketNum;
+  unsigned fMaxHandlersPerStep;
+  int* fReadySocketNums;
+  int* fReadyConditionSets;
+  unsigned fNumReadySockets;
+  unsigned fReadySocketsBatchCount; // used to detect reentrant calls to "handleReadySockets()"
 
   // To implement event triggers:
   EventTriggerId volatile fTriggersAwaitingHandling; // implemented as a 32-bit bitmap
@@ -109,6 +153,19 @@ protected:
   TaskFunc* fTriggeredEventHandlers[MAX_NUM_EVENT_TRIGGERS];
   void* fTriggeredEventClientDatas[MAX_NUM_EVENT_TRIGGERS];
   unsigned fLastUsedTriggerNum; // in the range [0,MAX_NUM_EVENT_TRIGGERS)
+
+  // To implement posted tasks:
+  PostedTask* volatile fPostedTasks; // a lock-free stack (most recently posted first)
+  int fPostedTaskWakeupReadSocket;
+  int fPostedTaskWakeupWriteSocket;
+
+  // To implement 'idle' tasks:
+  PostedTask* fIdleTasks; // most recently scheduled first
+  PostedTask* fIdleTasksBeingHandled; // in the order in which they were scheduled
+  _EventTime fIdleTasksDeadline; // when we handle 'idle' tasks even if we're not idle
+
+private:
+  static void postedTaskWakeupHandler(void* clientData, int mask);
 };
 
 #endif
@@ -147,9 +147,11 @@ protected: // abstract base class
 
 private:
   friend class DelayQueue;
+  friend class TimerWheel;
   DelayQueueEntry* fNext;
   DelayQueueEntry* fPrev;
   DelayInterval fDeltaTimeRemaining;
+  u_int64_t fDueTime; // used only by "TimerWheel"
 
   intptr_t fToken;
   static intptr_t tokenCounter;
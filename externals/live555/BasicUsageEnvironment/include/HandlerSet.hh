@@ -26,6 +26,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 ////////// HandlerSet (etc.) definition //////////
 
+// Handlers for socket numbers less than this are found (by "HandlerSet::lookupHandler()") directly, using a table
+// that's indexed by socket number.  (Handlers for larger socket numbers - if any - are found by searching.)
+#ifndef HANDLER_SET_MAX_TABLE_SIZE
+#define HANDLER_SET_MAX_TABLE_SIZE (1<<20)
+#endif
+
 class HandlerDescriptor {
   HandlerDescriptor(HandlerDescriptor* nextHandler);
   virtual ~HandlerDescriptor();
@@ -53,12 +59,18 @@ public:
   void clearHandler(int socketNum);
   void moveHandler(int oldSocketNum, int newSocketNum);
 
+  HandlerDescriptor* lookupHandler(int socketNum); // returns NULL if none
+
 private:
-  HandlerDescriptor* lookupHandler(int socketNum);
+  void setTableEntry(int socketNum, HandlerDescriptor* handler);
 
 private:
   friend class HandlerIterator;
   HandlerDescriptor fHandlers;
+
+  // A table of handlers, indexed by socket number (grown as needed):
+  HandlerDescriptor** fHandlersBySocketNum;
+  unsigned fTableSize;
 };
 
 class HandlerIterator {
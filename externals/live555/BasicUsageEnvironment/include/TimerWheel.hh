@@ -0,0 +1,86 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A hierarchical timer wheel: an alternative to "DelayQueue" for large numbers of pending delayed tasks
+// C++ header
+
+#ifndef _TIMER_WHEEL_HH
+#define _TIMER_WHEEL_HH
+
+#ifndef _DELAY_QUEUE_HH
+#include "DelayQueue.hh"
+#endif
+
+#ifndef _HASH_TABLE_HH
+#include "HashTable.hh"
+#endif
+
+// Each 'tick' of the wheel is 2^TIMER_WHEEL_TICK_BITS microseconds (i.e., ~1 ms).  (Entries are still handled
+// in the order of their exact (microsecond) time; the tick size affects only how entries are bucketed.)
+#define TIMER_WHEEL_TICK_BITS 10
+// Each level of the wheel has 2^TIMER_WHEEL_SLOT_BITS slots, each covering 2^TIMER_WHEEL_SLOT_BITS times as many
+// ticks as a slot in the level below.  With 6 levels, the wheel spans 2^(10+6*6) microseconds (more than 2 years);
+// any entry that's further in the future than this is re-bucketed as time passes.
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_NUM_SLOTS (1<<TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_NUM_LEVELS 6
+
+class TimerWheelSlotHead; // forward
+
+// Like a "DelayQueue", a "TimerWheel" holds "DelayQueueEntry"s, and has the same interface.  However, whereas adding
+// or removing an entry in a "DelayQueue" takes time proportional to the number of entries in the queue, it takes
+// constant time in a "TimerWheel".
+class TimerWheel {
+public:
+  TimerWheel();
+  virtual ~TimerWheel();
+
+  void addEntry(DelayQueueEntry* newEntry);
+  void updateEntry(DelayQueueEntry* entry, DelayInterval newDelay);
+  void updateEntry(intptr_t tokenToFind, DelayInterval newDelay);
+  void removeEntry(DelayQueueEntry* entry); // but doesn't delete it
+  DelayQueueEntry* removeEntry(intptr_t tokenToFind); // but doesn't delete it
+
+  DelayInterval const& timeToNextAlarm();
+  void handleAlarm();
+
+private:
+  void synchronize(); // bring "fTimeNow" up-to-date
+  void advance(); // process all ticks up to (and including) the current tick
+  void placeEntry(DelayQueueEntry* entry);
+  void cascade(unsigned level);
+  void addToDueList(DelayQueueEntry* entry);
+  void unlinkEntry(DelayQueueEntry* entry);
+
+private:
+  // The wheel's own clock - in microseconds - advanced from "TimeNow()" (but never backwards):
+  u_int64_t fTimeNow;
+  _EventTime fLastSyncTime;
+
+  u_int64_t fCurTick; // all ticks before this one have been processed
+  unsigned fNumEntriesInWheel; // not counting entries in "fDueList"
+
+  // Each slot is a circular, doubly-linked list of entries, headed by a dummy entry.  (The last of these dummy
+  // entries heads the list of entries whose tick has been processed, sorted by their exact time.)
+  TimerWheelSlotHead* fSlotHeads;
+  DelayQueueEntry* fDueList;
+  u_int64_t fSlotIsNonEmpty[TIMER_WHEEL_NUM_LEVELS]; // a bitmap for each level
+
+  HashTable* fEntriesByToken;
+  DelayInterval fTimeToNextAlarm;
+};
+
+#endif
@@ -56,6 +56,17 @@ void TaskScheduler::rescheduleDelayedTask(TaskToken& task,
   task = scheduleDelayedTask(microseconds, proc, clientData);
 }
 
+Boolean TaskScheduler::postTask(TaskFunc* /*proc*/, void* /*clientData*/) {
+  return False; // by default, posted tasks are not supported
+}
+
+Boolean TaskScheduler::scheduleWhenIdle(TaskFunc* /*proc*/, void* /*clientData*/) {
+  return False; // by default, 'idle' tasks are not supported
+}
+
+void TaskScheduler::unscheduleWhenIdle(TaskFunc* /*proc*/, void* /*clientData*/) {
+}
+
 // By default, we handle 'should not occur'-type library errors by calling abort().  Subclasses can redefine this, if desired.
 void TaskScheduler::internalError() {
   abort();
@@ -152,6 +152,22 @@ public:
       // The handler function is called with "clientData" as parameter.
       // Note: This function (unlike other library functions) may be called from an external thread - to signal an external event.
 
+  virtual Boolean postTask(TaskFunc* proc, void* clientData = NULL);
+      // Causes "proc(clientData)" to be called (once) from the event loop, as soon as possible.
+      // Note: Like "triggerEvent()", this function may be called from an external thread.  However, unlike 'event triggers',
+      // there's no limit on the number of posted tasks, and posted tasks are never coalesced: each call results in a call to "proc".
+      // (Returns False iff this scheduler doesn't support posted tasks.  The default implementation does not.)
+
+  virtual Boolean scheduleWhenIdle(TaskFunc* proc, void* clientData);
+      // Causes "proc(clientData)" to be called (once) from the event loop, the next time that it has nothing else to do
+      // right away - i.e., once there are no more delayed tasks that are due, and just before it would wait for new events.
+      // (If the event loop stays busy, then it calls "proc(clientData)" anyway, after a short time - at most 1 ms, for the
+      //  schedulers in "BasicUsageEnvironment" - so that it can't be put off indefinitely.)
+      // This can be used to collect work that's done by several tasks (e.g., packets to send), then do it all at once.
+      // (Returns False iff this scheduler doesn't support 'idle' tasks.  The default implementation does not.)
+  virtual void unscheduleWhenIdle(TaskFunc* proc, void* clientData);
+      // Cancels any not-yet-called 'idle' task(s) that were scheduled with the same "proc" and "clientData".
+
   // The following two functions are deprecated, and are provided for backwards-compatibility only:
   void turnOnBackgroundReadHandling(int socketNum, BackgroundHandlerProc* handlerProc, void* clientData) {
     setBackgroundHandling(socketNum, SOCKET_READABLE, handlerProc, clientData);
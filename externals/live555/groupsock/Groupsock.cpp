@@ -29,30 +29,240 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 ///////// OutputSocket //////////
 
+#if defined(__linux__) && !defined(NO_SENDMMSG)
+#define USE_SENDMMSG 1
+#include <sys/socket.h>
+#ifndef NO_UDP_SEGMENT
+// Also use UDP 'generic segmentation offload' (Linux 4.18 and later) - if available - to send runs of equal-size
+// packets (to the same destination) as a single large buffer, which the kernel (or network card) splits into packets:
+#define USE_UDP_SEGMENT 1
+#include <netinet/udp.h>
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+// The kernel's limits on each such buffer:
+#define UDP_SEGMENT_MAX_SEGMENTS 64
+#define UDP_SEGMENT_MAX_BUFFER_SIZE 65000
+#endif
+#endif
+
+// The largest packet that we'll add to an output batch.  (Any larger packet gets sent by itself.)
+#ifndef OUTPUT_BATCH_MAX_PACKET_SIZE
+#define OUTPUT_BATCH_MAX_PACKET_SIZE 2048
+#endif
+
+// An "OutputBatch" holds the packets that an "OutputSocket" has collected, but not yet sent.
+// The packets' data is copied (contiguously) into a single buffer.
+class OutputBatch {
+public:
+  OutputBatch(unsigned maxPackets);
+  virtual ~OutputBatch();
+
+  Boolean isEmpty() const { return fNumPackets == 0; }
+
+#ifdef USE_SENDMMSG
+  Boolean isFull() const { return fNumPackets == fMaxPackets; }
+  void addPacket(netAddressBits address, portNumBits portNum,
+		 unsigned char const* header, unsigned headerSize, unsigned char const* payload, unsigned payloadSize,
+		 Boolean sameDataAsPreviousPacket);
+
+  unsigned prepareMessages(unsigned firstPacket, Boolean useSegmentation);
+      // Fills in "fMsgs" for the packets from "firstPacket" onwards; returns the number of messages.
+      // If "useSegmentation" is True, then each run of equal-size packets (except that the last one may be smaller)
+      // to the same destination becomes a single message.
+
+  unsigned fMaxPackets;
+  unsigned fNumPackets;
+  unsigned char* fData;
+  unsigned fDataSize; // the number of bytes of "fData" that are in use
+  struct iovec* fIovecs; // one for each packet
+  struct sockaddr_in* fDestAddrs; // one for each packet
+  struct mmsghdr* fMsgs;
+  unsigned* fMsgFirstPacket; // for each message: the index of its first packet
+#ifdef USE_UDP_SEGMENT
+  char* fControlBuffers; // for each message: space for a "UDP_SEGMENT" control message
+#endif
+#else
+  unsigned fNumPackets; // always 0
+#endif
+};
+
+#ifdef USE_SENDMMSG
+#ifdef USE_UDP_SEGMENT
+#define OUTPUT_BATCH_CONTROL_BUFFER_SIZE CMSG_SPACE(sizeof (u_int16_t))
+#endif
+
+OutputBatch::OutputBatch(unsigned maxPackets)
+  : fMaxPackets(maxPackets), fNumPackets(0), fDataSize(0) {
+  fData = new unsigned char[maxPackets*OUTPUT_BATCH_MAX_PACKET_SIZE];
+  fIovecs = new struct iovec[maxPackets];
+  fDestAddrs = new struct sockaddr_in[maxPackets];
+  fMsgs = new struct mmsghdr[maxPackets];
+  fMsgFirstPacket = new unsigned[maxPackets];
+#ifdef USE_UDP_SEGMENT
+  fControlBuffers = new char[maxPackets*OUTPUT_BATCH_CONTROL_BUFFER_SIZE];
+#endif
+}
+
+OutputBatch::~OutputBatch() {
+#ifdef USE_UDP_SEGMENT
+  delete[] fControlBuffers;
+#endif
+  delete[] fMsgFirstPacket;
+  delete[] fMsgs;
+  delete[] fDestAddrs;
+  delete[] fIovecs;
+  delete[] fData;
+}
+
+void OutputBatch::addPacket(netAddressBits address, portNumBits portNum,
+			    unsigned char const* header, unsigned headerSize,
+			    unsigned char const* payload, unsigned payloadSize,
+			    Boolean sameDataAsPreviousPacket) {
+  struct iovec& iov = fIovecs[fNumPackets];
+  unsigned packetSize = headerSize + payloadSize;
+  if (sameDataAsPreviousPacket && fNumPackets > 0 && fIovecs[fNumPackets-1].iov_len == packetSize) {
+    // Share the previous packet's copy of the data:
+    iov = fIovecs[fNumPackets-1];
+  } else {
+    iov.iov_base = &fData[fDataSize];
+    iov.iov_len = packetSize;
+    memmove(iov.iov_base, header, headerSize);
+    if (payloadSize > 0) memmove(&fData[fDataSize + headerSize], payload, payloadSize);
+    fDataSize += packetSize;
+  }
+
+  MAKE_SOCKADDR_IN(destAddr, address, portNum);
+  fDestAddrs[fNumPackets] = destAddr;
+
+  ++fNumPackets;
+}
+
+unsigned OutputBatch::prepareMessages(unsigned firstPacket, Boolean useSegmentation) {
+  unsigned numMsgs = 0;
+  unsigned i = firstPacket;
+  while (i < fNumPackets) {
+    // Figure out how many packets (starting with packet "i") go in this message:
+    unsigned numPacketsInMsg = 1;
+#ifdef USE_UDP_SEGMENT
+    if (useSegmentation) {
+      unsigned const segmentSize = fIovecs[i].iov_len;
+      unsigned totalSize = segmentSize;
+      while (i + numPacketsInMsg < fNumPackets && numPacketsInMsg < UDP_SEGMENT_MAX_SEGMENTS) {
+	unsigned j = i + numPacketsInMsg;
+	if (fIovecs[j].iov_len > segmentSize
+	    || totalSize + fIovecs[j].iov_len > UDP_SEGMENT_MAX_BUFFER_SIZE
+	    || fDestAddrs[j].sin_addr.s_addr != fDestAddrs[i].sin_addr.s_addr
+	    || fDestAddrs[j].sin_port != fDestAddrs[i].sin_port) break;
+
+	totalSize += fIovecs[j].iov_len;
+	++numPacketsInMsg;
+	if (fIovecs[j].iov_len < segmentSize) break; // a smaller packet can only be the last in the message
+      }
+    }
+#endif
+
+    struct msghdr& msg = fMsgs[numMsgs].msg_hdr;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_name = &fDestAddrs[i];
+    msg.msg_namelen = sizeof fDestAddrs[i];
+    msg.msg_iov = &fIovecs[i];
+    msg.msg_iovlen = numPacketsInMsg;
+#ifdef USE_UDP_SEGMENT
+    if (numPacketsInMsg > 1) {
+      msg.msg_control = &fControlBuffers[numMsgs*OUTPUT_BATCH_CONTROL_BUFFER_SIZE];
+      msg.msg_controllen = OUTPUT_BATCH_CONTROL_BUFFER_SIZE;
+      memset(msg.msg_control, 0, OUTPUT_BATCH_CONTROL_BUFFER_SIZE);
+      struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN(sizeof (u_int16_t));
+      u_int16_t segmentSize = (u_int16_t)fIovecs[i].iov_len;
+      memmove(CMSG_DATA(cmsg), &segmentSize, sizeof segmentSize);
+    }
+#endif
+    fMsgs[numMsgs].msg_len = 0;
+    fMsgFirstPacket[numMsgs] = i;
+
+    ++numMsgs;
+    i += numPacketsInMsg;
+  }
+
+  return numMsgs;
+}
+#else
+OutputBatch::OutputBatch(unsigned /*maxPackets*/)
+  : fNumPackets(0) {
+}
+
+OutputBatch::~OutputBatch() {
+}
+#endif
+
 OutputSocket::OutputSocket(UsageEnvironment& env)
   : Socket(env, 0 /* let kernel choose port */),
-    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/) {
+    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/),
+    fOutputBatchSize(0), fOutputBatch(NULL), fUseSegmentationOffload(False),
+    fNumBatchedPacketsSent(0), fNumBatchSendCalls(0), fNumSegmentationOffloadSends(0) {
+  if (DefaultOutputBatchSize > 1) setOutputBatchSize(DefaultOutputBatchSize);
 }
 
 OutputSocket::OutputSocket(UsageEnvironment& env, Port port)
   : Socket(env, port),
-    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/) {
+    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/),
+    fOutputBatchSize(0), fOutputBatch(NULL), fUseSegmentationOffload(False),
+    fNumBatchedPacketsSent(0), fNumBatchSendCalls(0), fNumSegmentationOffloadSends(0) {
+  if (DefaultOutputBatchSize > 1) setOutputBatchSize(DefaultOutputBatchSize);
 }
 
 OutputSocket::~OutputSocket() {
+  // Send any packets that we've collected (but not yet sent):
+  setOutputBatchSize(0);
 }
 
 Boolean OutputSocket::write(netAddressBits address, portNumBits portNum, u_int8_t ttl,
-			    unsigned char* buffer, unsigned bufferSize) {
+			    unsigned char* buffer, unsigned bufferSize, Boolean sameDataAsPreviousWrite) {
+  return write(address, portNum, ttl, buffer, bufferSize, NULL, 0, sameDataAsPreviousWrite);
+}
+
+Boolean OutputSocket::write(netAddressBits address, portNumBits portNum, u_int8_t ttl,
+			    unsigned char const* header, unsigned headerSize,
+			    unsigned char const* payload, unsigned payloadSize, Boolean sameDataAsPreviousWrite) {
+  if (fOutputBatchSize > 1 && (unsigned)ttl == fLastSentTTL && headerSize + payloadSize <= OUTPUT_BATCH_MAX_PACKET_SIZE) {
+    return addToOutputBatch(address, portNum, header, headerSize, payload, payloadSize, sameDataAsPreviousWrite);
+  }
+
+  // Send the packet now - but after any packets that we've already collected:
+  flushOutput();
+  return writeNow(address, portNum, ttl, header, headerSize, payload, payloadSize);
+}
+
+Boolean OutputSocket::writeNow(netAddressBits address, portNumBits portNum, u_int8_t ttl,
+			       unsigned char const* header, unsigned headerSize,
+			       unsigned char const* payload, unsigned payloadSize) {
   struct in_addr destAddr; destAddr.s_addr = address;
+  Boolean writeSuccess;
   if ((unsigned)ttl == fLastSentTTL) {
     // Optimization: Don't do a 'set TTL' system call again
-    if (!writeSocket(env(), socketNum(), destAddr, portNum, buffer, bufferSize)) return False;
+    writeSuccess = payloadSize == 0
+      ? writeSocket(env(), socketNum(), destAddr, portNum, (unsigned char*)header, headerSize)
+      : writeSocket(env(), socketNum(), destAddr, portNum, header, headerSize, payload, payloadSize);
   } else {
-    if (!writeSocket(env(), socketNum(), destAddr, portNum, ttl, buffer, bufferSize)) return False;
-    fLastSentTTL = (unsigned)ttl;
+    writeSuccess = payloadSize == 0
+      ? writeSocket(env(), socketNum(), destAddr, portNum, ttl, (unsigned char*)header, headerSize)
+      : writeSocket(env(), socketNum(), destAddr, portNum, ttl, header, headerSize, payload, payloadSize);
+    if (writeSuccess) fLastSentTTL = (unsigned)ttl;
   }
+  if (!writeSuccess) return False;
+
+  noteSourcePort();
+  return sourcePortNum() != 0;
+}
 
+void OutputSocket::noteSourcePort() {
   if (sourcePortNum() == 0) {
     // Now that we've sent a packet, we can find out what the
     // kernel chose as our ephemeral source port number:
@@ -61,11 +271,116 @@ Boolean OutputSocket::write(netAddressBits address, portNumBits portNum, u_int8_
 	env() << *this
 	     << ": failed to get source port: "
 	     << env().getResultMsg() << "\n";
-      return False;
     }
   }
+}
+
+Boolean OutputSocket::setOutputBatchSize(unsigned maxPacketsPerBatch) {
+  if (maxPacketsPerBatch == fOutputBatchSize) return True;
+
+  // Send any packets that we've already collected, before changing the batch size:
+  flushOutput();
+  env().taskScheduler().unscheduleWhenIdle(flushOutputTask, this);
+  delete fOutputBatch; fOutputBatch = NULL;
+  fOutputBatchSize = 0;
+
+#ifdef USE_SENDMMSG
+  if (maxPacketsPerBatch > 1) {
+    fOutputBatchSize = maxPacketsPerBatch; // the batch itself gets created when needed
+    setSegmentationOffload(True); // if we can
+  }
+  return True;
+#else
+  return maxPacketsPerBatch <= 1;
+#endif
+}
+
+Boolean OutputSocket::setSegmentationOffload(Boolean enable) {
+  flushOutput();
+  fUseSegmentationOffload = False;
+#ifdef USE_UDP_SEGMENT
+  if (enable) {
+    // Check whether the kernel supports "UDP_SEGMENT":
+    int segmentSize; SOCKLEN_T optLen = sizeof segmentSize;
+    if (getsockopt(socketNum(), SOL_UDP, UDP_SEGMENT, (char*)&segmentSize, &optLen) == 0) {
+      fUseSegmentationOffload = True;
+    }
+  }
+#endif
+
+  return fUseSegmentationOffload == enable;
+}
+
+Boolean OutputSocket::addToOutputBatch(netAddressBits address, portNumBits portNum,
+				       unsigned char const* header, unsigned headerSize,
+				       unsigned char const* payload, unsigned payloadSize, Boolean sameDataAsPreviousWrite) {
+#ifdef USE_SENDMMSG
+  if (fOutputBatch == NULL) fOutputBatch = new OutputBatch(fOutputBatchSize);
+
+  if (fOutputBatch->isEmpty()) {
+    // Arrange to send the batch once the event loop becomes idle.  (If our task scheduler can't do this, then we
+    // instead send each packet right away.)
+    if (!env().taskScheduler().scheduleWhenIdle(flushOutputTask, this)) {
+      return writeNow(address, portNum, (u_int8_t)fLastSentTTL, header, headerSize, payload, payloadSize);
+    }
+  }
+
+  fOutputBatch->addPacket(address, portNum, header, headerSize, payload, payloadSize, sameDataAsPreviousWrite);
+  if (fOutputBatch->isFull()) flushOutput();
 
   return True;
+#else
+  // We never batch output, so this isn't called:
+  return writeNow(address, portNum, (u_int8_t)fLastSentTTL, header, headerSize, payload, payloadSize);
+#endif
+}
+
+void OutputSocket::flushOutputTask(void* outputSocket) {
+  ((OutputSocket*)outputSocket)->flushOutput();
+}
+
+void OutputSocket::flushOutput() {
+  if (fOutputBatch == NULL || fOutputBatch->isEmpty()) return;
+
+#ifdef USE_SENDMMSG
+  env().taskScheduler().unscheduleWhenIdle(flushOutputTask, this);
+
+  unsigned firstPacket = 0; // the first packet that we've yet to send
+  while (firstPacket < fOutputBatch->fNumPackets) {
+    unsigned numMsgs = fOutputBatch->prepareMessages(firstPacket, fUseSegmentationOffload);
+
+    int result = sendmmsg(socketNum(), fOutputBatch->fMsgs, numMsgs, 0);
+    ++fNumBatchSendCalls;
+    if (result < 0) {
+      if (errno == EINTR) continue;
+#ifdef USE_UDP_SEGMENT
+      if (fUseSegmentationOffload && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT)
+	  && fOutputBatch->fMsgs[0].msg_hdr.msg_iovlen > 1) {
+	// The kernel (or network interface) couldn't segment the first message for us.  Stop using segmentation
+	// offload on this socket, and send the packets individually instead:
+	fUseSegmentationOffload = False;
+	continue;
+      }
+#endif
+
+      // "sendmmsg()" fails only if it couldn't send even the first message.  As with "writeSocket()", we
+      // report the error, and drop that message's packets - then try again with the rest:
+      env().setResultErrMsg("sendmmsg() error: ");
+      result = 1;
+    } else {
+      for (int i = 0; i < result; ++i) {
+	fNumBatchedPacketsSent += fOutputBatch->fMsgs[i].msg_hdr.msg_iovlen;
+	if (fOutputBatch->fMsgs[i].msg_hdr.msg_iovlen > 1) ++fNumSegmentationOffloadSends;
+      }
+    }
+
+    firstPacket = (unsigned)result < numMsgs ? fOutputBatch->fMsgFirstPacket[result] : fOutputBatch->fNumPackets;
+  }
+
+  fOutputBatch->fNumPackets = 0;
+  fOutputBatch->fDataSize = 0;
+  noteSourcePort();
+#endif
 }
 
 // By default, we don't do reads:
@@ -258,17 +573,7 @@ Boolean Groupsock::output(UsageEnvironment& env, unsigned char* buffer, unsigned
 			  DirectedNetInterface* interfaceNotToFwdBackTo) {
   do {
     // First, do the datagram send, to each destination:
-    Boolean writeSuccess = True;
-    for (destRecord* dests = fDests; dests != NULL; dests = dests->fNext) {
-      if (!write(dests->fGroupEId.groupAddress().s_addr, dests->fGroupEId.portNum(), dests->fGroupEId.ttl(),
-		 buffer, bufferSize)) {
-	writeSuccess = False;
-	break;
-      }
-    }
-    if (!writeSuccess) break;
-    statsOutgoing.countPacket(bufferSize);
-    statsGroupOutgoing.countPacket(bufferSize);
+    if (!writeToAllDestinations(buffer, bufferSize, NULL, 0)) break;
 
     // Then, forward to our members:
     int numMembers = 0;
@@ -298,6 +603,51 @@ Boolean Groupsock::output(UsageEnvironment& env, unsigned char* buffer, unsigned
   return False;
 }
 
+Boolean Groupsock::output(UsageEnvironment& env, unsigned char* header, unsigned headerSize,
+			  unsigned char const* payload, unsigned payloadSize) {
+  if (payloadSize == 0 || !members().IsEmpty()) {
+    // Relaying to members requires the packet to be contiguous, so copy it together, and output it the usual way:
+    unsigned char* packet = header;
+    if (payloadSize > 0) {
+      packet = new unsigned char[headerSize + payloadSize];
+      memmove(packet, header, headerSize);
+      memmove(&packet[headerSize], payload, payloadSize);
+    }
+    Boolean result = output(env, packet, headerSize + payloadSize);
+    if (packet != header) delete[] packet;
+    return result;
+  }
+
+  // Common case: Send "header" and "payload" together, without copying them:
+  if (!writeToAllDestinations(header, headerSize, payload, payloadSize)) {
+    if (DebugLevel >= 0) { // this is a fatal error
+      UsageEnvironment::MsgString msg = strDup(env.getResultMsg());
+      env.setResultMsg("Groupsock write failed: ", msg);
+      delete[] (char*)msg;
+    }
+    return False;
+  }
+
+  if (DebugLevel >= 3) {
+    env << *this << ": wrote " << headerSize + payloadSize << " bytes, ttl " << (unsigned)ttl() << "\n";
+  }
+  return True;
+}
+
+Boolean Groupsock::writeToAllDestinations(unsigned char const* header, unsigned headerSize,
+					  unsigned char const* payload, unsigned payloadSize) {
+  for (destRecord* dests = fDests; dests != NULL; dests = dests->fNext) {
+    if (!write(dests->fGroupEId.groupAddress().s_addr, dests->fGroupEId.portNum(), dests->fGroupEId.ttl(),
+	       header, headerSize, payload, payloadSize, dests != fDests/*same data as before*/)) {
+      return False;
+    }
+  }
+
+  statsOutgoing.countPacket(headerSize + payloadSize);
+  statsGroupOutgoing.countPacket(headerSize + payloadSize);
+  return True;
+}
+
 Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 			      unsigned& bytesRead,
 			      struct sockaddr_in& fromAddressAndPort) {
@@ -318,10 +668,48 @@ Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
     return False;
   }
 
+  handleIncomingPacket(buffer, numBytes, bytesRead, fromAddressAndPort);
+  return True;
+}
+
+#define GROUPSOCK_MAX_READ_BATCH_SIZE 64
+
+Boolean Groupsock::handleReadBatch(unsigned char** buffers, unsigned const* bufferMaxSizes, unsigned numBuffers,
+				   unsigned* bytesRead, struct sockaddr_in* fromAddressesAndPorts,
+				   unsigned& numPacketsRead) {
+  numPacketsRead = 0;
+  if (numBuffers > GROUPSOCK_MAX_READ_BATCH_SIZE) numBuffers = GROUPSOCK_MAX_READ_BATCH_SIZE;
+
+  unsigned maxBytesToRead[GROUPSOCK_MAX_READ_BATCH_SIZE];
+  for (unsigned i = 0; i < numBuffers; ++i) {
+    maxBytesToRead[i] = bufferMaxSizes[i] - TunnelEncapsulationTrailerMaxSize;
+  }
+  int numRead = readSocketBatch(env(), socketNum(), buffers, maxBytesToRead, numBuffers,
+				bytesRead, fromAddressesAndPorts);
+  if (numRead < 0) {
+    if (DebugLevel >= 0) { // this is a fatal error
+      UsageEnvironment::MsgString msg = strDup(env().getResultMsg());
+      env().setResultMsg("Groupsock read failed: ", msg);
+      delete[] (char*)msg;
+    }
+    return False;
+  }
+
+  for (int i = 0; i < numRead; ++i) {
+    handleIncomingPacket(buffers[i], (int)bytesRead[i], bytesRead[i], fromAddressesAndPorts[i]);
+  }
+  numPacketsRead = (unsigned)numRead;
+  return True;
+}
+
+void Groupsock::handleIncomingPacket(unsigned char* buffer, int numBytes, unsigned& bytesRead,
+				     struct sockaddr_in& fromAddressAndPort) {
+  bytesRead = 0;
+
   // If we're a SSM group, make sure the source address matches:
   if (isSSM()
       && fromAddressAndPort.sin_addr.s_addr != sourceFilterAddress().s_addr) {
-    return True;
+    return;
   }
 
   // We'll handle this data.
@@ -349,8 +737,6 @@ Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
     }
     env() << "\n";
   }
-
-  return True;
 }
 
 Boolean Groupsock::wasLoopedBackFromUs(UsageEnvironment& env,
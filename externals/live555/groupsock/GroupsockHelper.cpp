@@ -29,6 +29,14 @@ extern "C" int initializeWinsockIfNecessary();
 #include <fcntl.h>
 #define initializeWinsockIfNecessary() 1
 #endif
+#if defined(__linux__) && !defined(NO_RECVMMSG)
+#include <sys/socket.h>
+#define USE_RECVMMSG 1
+// The maximum number of datagrams that "readSocketBatch()" reads with a single "recvmmsg()" call:
+#ifndef MAX_READ_SOCKET_BATCH_SIZE
+#define MAX_READ_SOCKET_BATCH_SIZE 64
+#endif
+#endif
 #if defined(__WIN32__) || defined(_WIN32) || defined(_QNX4)
 #else
 #include <signal.h>
@@ -39,6 +47,7 @@ extern "C" int initializeWinsockIfNecessary();
 // By default, use INADDR_ANY for the sending and receiving interfaces:
 netAddressBits SendingInterfaceAddr = INADDR_ANY;
 netAddressBits ReceivingInterfaceAddr = INADDR_ANY;
+unsigned DefaultOutputBatchSize = 0;
 
 static void socketErr(UsageEnvironment& env, char const* errorMsg) {
   env.setResultErrMsg(errorMsg);
@@ -212,7 +221,7 @@ Boolean makeSocketBlocking(int sock, unsigned writeTimeoutInMilliseconds) {
 }
 
 int setupStreamSocket(UsageEnvironment& env,
-                      Port port, Boolean makeNonBlocking) {
+                      Port port, Boolean makeNonBlocking, Boolean shareListeningPort) {
   if (!initializeWinsockIfNecessary()) {
     socketErr(env, "Failed to initialize 'winsock': ");
     return -1;
@@ -251,6 +260,22 @@ int setupStreamSocket(UsageEnvironment& env,
 #endif
 #endif
 
+  if (shareListeningPort) {
+#if defined(SO_REUSEPORT) && !defined(__WIN32__) && !defined(_WIN32)
+    int const shareFlag = 1;
+    if (setsockopt(newSocket, SOL_SOCKET, SO_REUSEPORT,
+		   (const char*)&shareFlag, sizeof shareFlag) < 0) {
+      socketErr(env, "setsockopt(SO_REUSEPORT) error: ");
+      closeSocket(newSocket);
+      return -1;
+    }
+#else
+    env.setResultMsg("Sharing a listening port is not supported on this platform");
+    closeSocket(newSocket);
+    return -1;
+#endif
+  }
+
   // Note: Windoze requires binding, even if the port number is 0
 #if defined(__WIN32__) || defined(_WIN32)
 #else
@@ -317,6 +342,46 @@ int readSocket(UsageEnvironment& env,
   return bytesRead;
 }
 
+int readSocketBatch(UsageEnvironment& env,
+		    int socket, unsigned char** buffers, unsigned const* bufferSizes, unsigned numBuffers,
+		    unsigned* bytesRead, struct sockaddr_in* fromAddresses) {
+  if (numBuffers == 0) return 0;
+#ifdef USE_RECVMMSG
+  if (numBuffers > MAX_READ_SOCKET_BATCH_SIZE) numBuffers = MAX_READ_SOCKET_BATCH_SIZE;
+
+  struct mmsghdr msgs[MAX_READ_SOCKET_BATCH_SIZE];
+  struct iovec iovecs[MAX_READ_SOCKET_BATCH_SIZE];
+  for (unsigned i = 0; i < numBuffers; ++i) {
+    iovecs[i].iov_base = buffers[i];
+    iovecs[i].iov_len = bufferSizes[i];
+    memset(&msgs[i].msg_hdr, 0, sizeof msgs[i].msg_hdr);
+    msgs[i].msg_hdr.msg_name = &fromAddresses[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof fromAddresses[i];
+    msgs[i].msg_hdr.msg_iov = &iovecs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int numRead = recvmmsg(socket, msgs, numBuffers, MSG_DONTWAIT, NULL);
+  if (numRead < 0) {
+    // As in "readSocket()", some errors are not treated as errors:
+    int err = env.getErrno();
+    if (err == ECONNREFUSED || err == EAGAIN || err == EWOULDBLOCK || err == EHOSTUNREACH || err == EINTR) return 0;
+    socketErr(env, "recvmmsg() error: ");
+    return -1;
+  }
+
+  for (int i = 0; i < numRead; ++i) bytesRead[i] = msgs[i].msg_len;
+  return numRead;
+#else
+  int numBytes = readSocket(env, socket, buffers[0], bufferSizes[0], fromAddresses[0]);
+  if (numBytes < 0) return -1;
+  if (numBytes == 0) return 0;
+
+  bytesRead[0] = (unsigned)numBytes;
+  return 1;
+#endif
+}
+
 Boolean writeSocket(UsageEnvironment& env,
 		    int socket, struct in_addr address, portNumBits portNum,
 		    u_int8_t ttlArg,
@@ -357,6 +422,61 @@ Boolean writeSocket(UsageEnvironment& env,
   return False;
 }
 
+Boolean writeSocket(UsageEnvironment& env,
+		    int socket, struct in_addr address, portNumBits portNum,
+		    u_int8_t ttlArg,
+		    unsigned char const* header, unsigned headerSize,
+		    unsigned char const* payload, unsigned payloadSize) {
+  // Before sending, set the socket's TTL:
+  TTL_TYPE ttl = (TTL_TYPE)ttlArg;
+  if (setsockopt(socket, IPPROTO_IP, IP_MULTICAST_TTL,
+		 (const char*)&ttl, sizeof ttl) < 0) {
+    socketErr(env, "setsockopt(IP_MULTICAST_TTL) error: ");
+    return False;
+  }
+
+  return writeSocket(env, socket, address, portNum, header, headerSize, payload, payloadSize);
+}
+
+Boolean writeSocket(UsageEnvironment& env,
+		    int socket, struct in_addr address, portNumBits portNum,
+		    unsigned char const* header, unsigned headerSize,
+		    unsigned char const* payload, unsigned payloadSize) {
+  do {
+    MAKE_SOCKADDR_IN(dest, address.s_addr, portNum);
+    unsigned totSize = headerSize + payloadSize;
+#if defined(__WIN32__) || defined(_WIN32)
+    WSABUF bufs[2];
+    bufs[0].buf = (char*)header; bufs[0].len = headerSize;
+    bufs[1].buf = (char*)payload; bufs[1].len = payloadSize;
+    DWORD numBytesSent = 0;
+    int bytesSent = WSASendTo(socket, bufs, 2, &numBytesSent, 0, (struct sockaddr*)&dest, sizeof dest, NULL, NULL) == 0
+      ? (int)numBytesSent : -1;
+#else
+    struct iovec iov[2];
+    iov[0].iov_base = (void*)header; iov[0].iov_len = headerSize;
+    iov[1].iov_base = (void*)payload; iov[1].iov_len = payloadSize;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_name = &dest;
+    msg.msg_namelen = sizeof dest;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    int bytesSent = sendmsg(socket, &msg, 0);
+#endif
+    if (bytesSent != (int)totSize) {
+      char tmpBuf[100];
+      sprintf(tmpBuf, "writeSocket(%d), sendmsg() error: wrote %d bytes instead of %u: ", socket, bytesSent, totSize);
+      socketErr(env, tmpBuf);
+      break;
+    }
+
+    return True;
+  } while (0);
+
+  return False;
+}
+
 void ignoreSigPipeOnSocket(int socketNum) {
   #ifdef USE_SIGNALS
   #ifdef SO_NOSIGPIPE
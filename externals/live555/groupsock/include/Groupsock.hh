@@ -36,17 +36,51 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // An "OutputSocket" is (by default) used only to send packets.
 // No packets are received on it (unless a subclass arranges this)
 
+class OutputBatch; // forward
+
 class OutputSocket: public Socket {
 public:
   OutputSocket(UsageEnvironment& env);
   virtual ~OutputSocket();
 
   Boolean write(netAddressBits address, portNumBits portNum/*in network order*/, u_int8_t ttl,
-		unsigned char* buffer, unsigned bufferSize);
+		unsigned char* buffer, unsigned bufferSize, Boolean sameDataAsPreviousWrite = False);
   Boolean write(struct sockaddr_in& addressAndPort, u_int8_t ttl,
 		unsigned char* buffer, unsigned bufferSize) {
     return write(addressAndPort.sin_addr.s_addr, addressAndPort.sin_port, ttl, buffer, bufferSize);
   }
+      // If "sameDataAsPreviousWrite" is True, then the caller promises that the data is the same as that of the previous
+      // call to "write()" (e.g., because the same packet is being sent to several destinations).  This lets us avoid
+      // copying it again, if we're batching output.
+  Boolean write(netAddressBits address, portNumBits portNum/*in network order*/, u_int8_t ttl,
+		unsigned char const* header, unsigned headerSize, unsigned char const* payload, unsigned payloadSize,
+		Boolean sameDataAsPreviousWrite = False);
+      // Writes a packet that consists of "header" followed by "payload" (which needn't be contiguous with it).
+      // Unless we're batching output, these are not copied; instead, they are sent using a 'gather' system call.
+
+  // Batched output:
+  Boolean setOutputBatchSize(unsigned maxPacketsPerBatch);
+      // If "maxPacketsPerBatch" > 1, then packets that are written are not sent right away.  Instead, they are collected,
+      // then sent all at once - using a single "sendmmsg()" system call - when the event loop next becomes idle
+      // (see "TaskScheduler::scheduleWhenIdle()"), or when "maxPacketsPerBatch" packets have been collected.
+      // (Note that errors in sending these packets are not reported by "write()".)
+      // Returns False (and leaves output unbatched) if batched output is not supported on this platform.
+  unsigned outputBatchSize() const { return fOutputBatchSize; }
+  void flushOutput(); // sends any packets that have been collected for batched output
+
+  Boolean setSegmentationOffload(Boolean enable);
+      // When output is batched, and the platform supports it (Linux's "UDP_SEGMENT"), each run of collected packets that
+      // have the same size (except that the last may be smaller), and the same destination, is passed to the kernel
+      // as a single buffer, which the kernel (or network interface) then splits into packets.  This is enabled by default
+      // (if possible) whenever "setOutputBatchSize()" enables batching.  (If the kernel later turns out to be unable to
+      // segment packets for this socket, then this is disabled automatically.)
+      // Returns False if "enable" was True, but this is not supported.
+
+  // Statistics about batched output:
+  u_int64_t numBatchedPacketsSent() const { return fNumBatchedPacketsSent; }
+  u_int64_t numBatchSendCalls() const { return fNumBatchSendCalls; } // the number of system calls used to send them
+  u_int64_t numSegmentationOffloadSends() const { return fNumSegmentationOffloadSends; }
+      // the number of multiple-packet buffers that were sent using segmentation offload
 
 protected:
   OutputSocket(UsageEnvironment& env, Port port);
@@ -58,9 +92,23 @@ private: // redefined virtual function
 			     unsigned& bytesRead,
 			     struct sockaddr_in& fromAddressAndPort);
 
+private:
+  Boolean writeNow(netAddressBits address, portNumBits portNum, u_int8_t ttl,
+		   unsigned char const* header, unsigned headerSize, unsigned char const* payload, unsigned payloadSize);
+  Boolean addToOutputBatch(netAddressBits address, portNumBits portNum,
+			   unsigned char const* header, unsigned headerSize,
+			   unsigned char const* payload, unsigned payloadSize, Boolean sameDataAsPreviousWrite);
+  static void flushOutputTask(void* outputSocket);
+  void noteSourcePort();
+
 private:
   Port fSourcePort;
   unsigned fLastSentTTL;
+
+  unsigned fOutputBatchSize;
+  OutputBatch* fOutputBatch; // created when first needed
+  Boolean fUseSegmentationOffload;
+  u_int64_t fNumBatchedPacketsSent, fNumBatchSendCalls, fNumSegmentationOffloadSends;
 };
 
 class destRecord {
@@ -129,6 +177,10 @@ public:
 
   virtual Boolean output(UsageEnvironment& env, unsigned char* buffer, unsigned bufferSize,
 			 DirectedNetInterface* interfaceNotToFwdBackTo = NULL);
+  Boolean output(UsageEnvironment& env, unsigned char* header, unsigned headerSize,
+		 unsigned char const* payload, unsigned payloadSize);
+      // Outputs a packet that consists of "header" followed by "payload" (which needn't be contiguous with it),
+      // without first copying them together (unless we have members to relay the packet to).
 
   DirectedNetInterfaceSet& members() { return fMembers; }
 
@@ -151,10 +203,25 @@ public: // redefined virtual functions
 			     unsigned& bytesRead,
 			     struct sockaddr_in& fromAddressAndPort);
 
+public:
+  Boolean handleReadBatch(unsigned char** buffers, unsigned const* bufferMaxSizes, unsigned numBuffers,
+			  unsigned* bytesRead, struct sockaddr_in* fromAddressesAndPorts,
+			  unsigned& numPacketsRead);
+      // Like "handleRead()", except that it reads up to "numBuffers" packets at once (see "readSocketBatch()").
+      // (As with "handleRead()", a packet that's read, but should be ignored, is returned with "bytesRead[i]" == 0.)
+
 protected:
   destRecord* lookupDestRecordFromDestination(struct sockaddr_in const& destAddrAndPort) const;
 
 private:
+  void handleIncomingPacket(unsigned char* buffer, int numBytes, unsigned& bytesRead,
+			    struct sockaddr_in& fromAddressAndPort);
+      // processes a packet that has just been read from our socket
+
+  Boolean writeToAllDestinations(unsigned char const* header, unsigned headerSize,
+				 unsigned char const* payload, unsigned payloadSize);
+      // used to implement "output()"
+
   int outputToAllMembersExcept(DirectedNetInterface* exceptInterface,
 			       u_int8_t ttlToFwd,
 			       unsigned char* data, unsigned size,
@@ -27,12 +27,22 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 int setupDatagramSocket(UsageEnvironment& env, Port port);
 int setupStreamSocket(UsageEnvironment& env,
-		      Port port, Boolean makeNonBlocking = True);
+		      Port port, Boolean makeNonBlocking = True, Boolean shareListeningPort = False);
+    // If "shareListeningPort" is True, then the socket is set up (using "SO_REUSEPORT") so that several sockets
+    // - each typically handled by a different thread - can listen on the same port, with the kernel distributing
+    // incoming connections among them.  (This fails on platforms that don't support this.)
 
 int readSocket(UsageEnvironment& env,
 	       int socket, unsigned char* buffer, unsigned bufferSize,
 	       struct sockaddr_in& fromAddress);
 
+int readSocketBatch(UsageEnvironment& env,
+		    int socket, unsigned char** buffers, unsigned const* bufferSizes, unsigned numBuffers,
+		    unsigned* bytesRead, struct sockaddr_in* fromAddresses);
+    // Reads up to "numBuffers" datagrams (one into each buffer) - using a single "recvmmsg()" system call, if the
+    // platform supports it (otherwise, this reads just one datagram).  Returns the number of datagrams read
+    // (which may be 0), or -1 on error.
+
 Boolean writeSocket(UsageEnvironment& env,
 		    int socket, struct in_addr address, portNumBits portNum/*network byte order*/,
 		    u_int8_t ttlArg,
@@ -43,6 +53,19 @@ Boolean writeSocket(UsageEnvironment& env,
 		    unsigned char* buffer, unsigned bufferSize);
     // An optimized version of "writeSocket" that omits the "setsockopt()" call to set the TTL.
 
+Boolean writeSocket(UsageEnvironment& env,
+		    int socket, struct in_addr address, portNumBits portNum/*network byte order*/,
+		    u_int8_t ttlArg,
+		    unsigned char const* header, unsigned headerSize,
+		    unsigned char const* payload, unsigned payloadSize);
+
+Boolean writeSocket(UsageEnvironment& env,
+		    int socket, struct in_addr address, portNumBits portNum/*network byte order*/,
+		    unsigned char const* header, unsigned headerSize,
+		    unsigned char const* payload, unsigned payloadSize);
+    // Versions of "writeSocket" that send a datagram consisting of "header" followed by "payload", without first
+    // copying them into a single buffer.  (They are sent using "sendmsg()" - or "WSASendTo()" on Windows.)
+
 void ignoreSigPipeOnSocket(int socketNum);
 
 unsigned getSendBufferSize(UsageEnvironment& env, int socket);
@@ -82,6 +105,10 @@ netAddressBits ourIPAddress(UsageEnvironment& env); // in network order
 extern netAddressBits SendingInterfaceAddr;
 extern netAddressBits ReceivingInterfaceAddr;
 
+// The maximum number of packets that each newly-created "OutputSocket" (e.g., "Groupsock") collects, before sending
+// them all with a single system call.  (By default, 0, meaning 'no batching'.)  See "OutputSocket::setOutputBatchSize()".
+extern unsigned DefaultOutputBatchSize;
+
 // Allocates a randomly-chosen IPv4 SSM (multicast) address:
 netAddressBits chooseRandomIPv4SSMAddress(UsageEnvironment& env);
 
@@ -0,0 +1,344 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A per-environment pool of threads that read from files, so that the event loop never blocks on disk I/O
+// (used by "ByteStreamFileSource")
+// Implementation
+
+#include "AsyncFileReader.hh"
+#include "OurThread.hh"
+#include <string.h>
+#if defined(__WIN32__) || defined(_WIN32)
+#include <io.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+#endif
+
+////////// AsyncFileReadRequest //////////
+
+AsyncFileReadRequest::AsyncFileReadRequest(unsigned bufferSize)
+  : fBufferSize(bufferSize), fFileNum(-1), fFileOffset(0), fNumBytesRead(0), fHadError(False),
+    fIsPending(False), fIsQueued(False), fIsCancelled(False),
+    fScheduler(NULL), fCompletionFunc(NULL), fClientData(NULL), fNext(NULL) {
+  fBuffer = new unsigned char[fBufferSize];
+}
+
+AsyncFileReadRequest::~AsyncFileReadRequest() {
+  delete[] fBuffer;
+}
+
+void AsyncFileReadRequest::completionHandler(void* clientData) {
+  AsyncFileReadRequest* request = (AsyncFileReadRequest*)clientData;
+  request->fIsPending = False;
+
+  if (request->fIsCancelled) {
+    // Our owner no longer wants us (and our reader's thread has finished with us), so we can now be deleted:
+    delete request;
+    return;
+  }
+
+  (*request->fCompletionFunc)(request->fClientData, request);
+}
+
+void AsyncFileReadRequest::doRead() {
+  // Read until we've filled our buffer, or until we reach the end of the file (or an error):
+  fNumBytesRead = 0;
+  fHadError = False;
+  while (fNumBytesRead < fBufferSize) {
+    u_int64_t offset = fFileOffset + fNumBytesRead;
+#if defined(__WIN32__) || defined(_WIN32)
+    OVERLAPPED overlapped;
+    memset(&overlapped, 0, sizeof overlapped);
+    overlapped.Offset = (DWORD)offset;
+    overlapped.OffsetHigh = (DWORD)(offset>>32);
+
+    DWORD numBytesRead = 0;
+    if (!ReadFile((HANDLE)_get_osfhandle(fFileNum), &fBuffer[fNumBytesRead], fBufferSize - fNumBytesRead,
+		  &numBytesRead, &overlapped)) {
+      if (GetLastError() != ERROR_HANDLE_EOF) fHadError = True;
+      break;
+    }
+    if (numBytesRead == 0) break; // end of file
+#else
+    ssize_t numBytesRead = pread(fFileNum, &fBuffer[fNumBytesRead], fBufferSize - fNumBytesRead, (off_t)offset);
+    if (numBytesRead < 0) {
+      if (errno == EINTR) continue;
+      fHadError = True;
+      break;
+    }
+    if (numBytesRead == 0) break; // end of file
+#endif
+    fNumBytesRead += (unsigned)numBytesRead;
+  }
+}
+
+////////// AsyncFileReader //////////
+
+unsigned AsyncFileReader::numThreads = 4;
+
+static void checkForPostedTasks(void* /*clientData*/) {
+}
+
+AsyncFileReader* AsyncFileReader::ourReader(UsageEnvironment& env) {
+  _Tables* ourTables = _Tables::getOurTables(env);
+  if (ourTables->asyncFileReader == NULL) {
+    // Check that our environment's "TaskScheduler" implements "postTask()", because we'll need it:
+    if (!env.taskScheduler().postTask(checkForPostedTasks, NULL)) {
+      ourTables->reclaimIfPossible();
+      return NULL;
+    }
+
+    AsyncFileReader* newReader = new AsyncFileReader(env);
+    if (!newReader->startThreads()) {
+      delete newReader;
+      ourTables->reclaimIfPossible();
+      return NULL;
+    }
+    ourTables->asyncFileReader = newReader;
+  }
+  return (AsyncFileReader*)(ourTables->asyncFileReader);
+}
+
+void AsyncFileReader::decrementReferenceCount() {
+  if (fReferenceCount > 0) --fReferenceCount;
+  if (fReferenceCount == 0) {
+    _Tables* ourTables = _Tables::getOurTables(fEnv);
+    ourTables->asyncFileReader = NULL;
+    ourTables->reclaimIfPossible();
+
+    delete this;
+  }
+}
+
+Boolean AsyncFileReader::submit(AsyncFileReadRequest* request, FILE* fid, u_int64_t fileOffset,
+				CompletionFunc* completionFunc, void* clientData) {
+  if (request == NULL || request->fIsPending || fid == NULL || completionFunc == NULL) return False;
+
+  request->fFileNum = fileno(fid);
+      // (We don't use "fid" itself from our threads, because its owner might close it while a read is still pending.)
+  request->fFileOffset = fileOffset;
+  request->fNumBytesRead = 0;
+  request->fHadError = False;
+  request->fIsPending = True;
+  request->fIsCancelled = False;
+  request->fScheduler = &fEnv.taskScheduler();
+  request->fCompletionFunc = completionFunc;
+  request->fClientData = clientData;
+
+  // Add the request to the end of our queue, and wake up a thread to handle it:
+  lock();
+  request->fIsQueued = True;
+  request->fNext = NULL;
+  if (fQueueTail == NULL) {
+    fQueueHead = fQueueTail = request;
+  } else {
+    fQueueTail->fNext = request;
+    fQueueTail = request;
+  }
+#if defined(__WIN32__) || defined(_WIN32)
+  WakeConditionVariable((PCONDITION_VARIABLE)fCondition);
+#else
+  pthread_cond_signal((pthread_cond_t*)fCondition);
+#endif
+  unlock();
+
+  ++fNumReadsSubmitted;
+  return True;
+}
+
+unsigned AsyncFileReader::readIfCached(FILE* fid, u_int64_t fileOffset, unsigned char* to, unsigned maxNumBytes,
+				       Boolean& reachedEOF) {
+  unsigned numBytesRead = 0;
+  reachedEOF = False;
+#if defined(__linux__) && defined(RWF_NOWAIT)
+  // "RWF_NOWAIT" makes the read fail (with "EAGAIN"), rather than block, if the data isn't in the page cache:
+  while (numBytesRead < maxNumBytes) {
+    struct iovec iov;
+    iov.iov_base = &to[numBytesRead];
+    iov.iov_len = maxNumBytes - numBytesRead;
+    ssize_t result = preadv2(fileno(fid), &iov, 1, (off_t)(fileOffset + numBytesRead), RWF_NOWAIT);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      break; // the data isn't cached (or "RWF_NOWAIT" isn't supported for this file)
+    }
+    if (result == 0) {
+      reachedEOF = True;
+      break;
+    }
+    numBytesRead += (unsigned)result;
+  }
+#endif
+  return numBytesRead;
+}
+
+void AsyncFileReader::cancel(AsyncFileReadRequest* request) {
+  if (request == NULL) return;
+  if (!request->fIsPending) {
+    // Nothing is using the request, so we can just delete it:
+    delete request;
+    return;
+  }
+  ++fNumReadsCancelled;
+
+  lock();
+  if (request->fIsQueued) {
+    // No thread has started reading into the request yet, so we can remove it from our queue, and delete it now:
+    AsyncFileReadRequest* prev = NULL;
+    for (AsyncFileReadRequest* r = fQueueHead; r != NULL; prev = r, r = r->fNext) {
+      if (r == request) {
+	if (prev == NULL) fQueueHead = r->fNext; else prev->fNext = r->fNext;
+	if (fQueueTail == r) fQueueTail = prev;
+	break;
+      }
+    }
+    unlock();
+
+    delete request;
+  } else {
+    // A thread is reading into the request (or has done so, and posted its completion), so we delete it later,
+    // from "completionHandler()":
+    request->fIsCancelled = True;
+    unlock();
+  }
+}
+
+unsigned AsyncFileReader::numReadsQueued() const {
+  unsigned result = 0;
+
+  lock();
+  for (AsyncFileReadRequest* r = fQueueHead; r != NULL; r = r->fNext) ++result;
+  unlock();
+
+  return result;
+}
+
+AsyncFileReader::AsyncFileReader(UsageEnvironment& env)
+  : fEnv(env), fReferenceCount(0), fThreads(NULL), fNumThreads(0), fStopping(False),
+    fQueueHead(NULL), fQueueTail(NULL), fNumReadsSubmitted(0), fNumReadsCancelled(0) {
+#if defined(__WIN32__) || defined(_WIN32)
+  fLock = new CRITICAL_SECTION;
+  InitializeCriticalSection((LPCRITICAL_SECTION)fLock);
+  fCondition = new CONDITION_VARIABLE;
+  InitializeConditionVariable((PCONDITION_VARIABLE)fCondition);
+#else
+  fLock = new pthread_mutex_t;
+  pthread_mutex_init((pthread_mutex_t*)fLock, NULL);
+  fCondition = new pthread_cond_t;
+  pthread_cond_init((pthread_cond_t*)fCondition, NULL);
+#endif
+}
+
+AsyncFileReader::~AsyncFileReader() {
+  // Tell our threads to stop, then wait for them to do so:
+  lock();
+  fStopping = True;
+#if defined(__WIN32__) || defined(_WIN32)
+  WakeAllConditionVariable((PCONDITION_VARIABLE)fCondition);
+#else
+  pthread_cond_broadcast((pthread_cond_t*)fCondition);
+#endif
+  unlock();
+
+  for (unsigned i = 0; i < fNumThreads; ++i) delete fThreads[i];
+  delete[] fThreads;
+
+  // Any requests that are still queued were cancelled (because we're deleted only after each of our users is).
+  // Delete them:
+  while (fQueueHead != NULL) {
+    AsyncFileReadRequest* next = fQueueHead->fNext;
+    delete fQueueHead;
+    fQueueHead = next;
+  }
+
+#if defined(__WIN32__) || defined(_WIN32)
+  DeleteCriticalSection((LPCRITICAL_SECTION)fLock);
+  delete (LPCRITICAL_SECTION)fLock;
+  delete (PCONDITION_VARIABLE)fCondition;
+#else
+  pthread_cond_destroy((pthread_cond_t*)fCondition);
+  delete (pthread_cond_t*)fCondition;
+  pthread_mutex_destroy((pthread_mutex_t*)fLock);
+  delete (pthread_mutex_t*)fLock;
+#endif
+}
+
+Boolean AsyncFileReader::startThreads() {
+  unsigned const numThreadsWanted = numThreads == 0 ? 1 : numThreads;
+
+  fThreads = new OurThread*[numThreadsWanted];
+  for (fNumThreads = 0; fNumThreads < numThreadsWanted; ++fNumThreads) {
+    fThreads[fNumThreads] = OurThread::createNew(threadMain, this);
+    if (fThreads[fNumThreads] == NULL) break;
+  }
+  if (fNumThreads > 0) return True;
+
+  // We couldn't start any threads:
+  delete[] fThreads; fThreads = NULL;
+  return False;
+}
+
+void AsyncFileReader::threadMain(void* reader) {
+  ((AsyncFileReader*)reader)->threadMain1();
+}
+
+void AsyncFileReader::threadMain1() {
+  lock();
+  while (!fStopping) {
+    if (fQueueHead == NULL) {
+      // Wait for a request:
+#if defined(__WIN32__) || defined(_WIN32)
+      SleepConditionVariableCS((PCONDITION_VARIABLE)fCondition, (LPCRITICAL_SECTION)fLock, INFINITE);
+#else
+      pthread_cond_wait((pthread_cond_t*)fCondition, (pthread_mutex_t*)fLock);
+#endif
+      continue;
+    }
+
+    // Take the first request from the queue:
+    AsyncFileReadRequest* request = fQueueHead;
+    fQueueHead = request->fNext;
+    if (fQueueHead == NULL) fQueueTail = NULL;
+    request->fIsQueued = False;
+    unlock();
+
+    // Do the read (without holding our lock), then have the event loop handle its completion:
+    request->doRead();
+    request->fScheduler->postTask(AsyncFileReadRequest::completionHandler, request);
+
+    lock();
+  }
+  unlock();
+}
+
+void AsyncFileReader::lock() const {
+#if defined(__WIN32__) || defined(_WIN32)
+  EnterCriticalSection((LPCRITICAL_SECTION)fLock);
+#else
+  pthread_mutex_lock((pthread_mutex_t*)fLock);
+#endif
+}
+
+void AsyncFileReader::unlock() const {
+#if defined(__WIN32__) || defined(_WIN32)
+  LeaveCriticalSection((LPCRITICAL_SECTION)fLock);
+#else
+  pthread_mutex_unlock((pthread_mutex_t*)fLock);
+#endif
+}
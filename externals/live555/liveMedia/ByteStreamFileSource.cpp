@@ -21,6 +21,13 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "ByteStreamFileSource.hh"
 #include "InputFile.hh"
 #include "GroupsockHelper.hh"
+#include "AsyncFileReader.hh"
+#include <string.h>
+
+#define READ_AHEAD_CHUNK_SIZE 131072
+#define READ_AHEAD_NUM_CHUNKS 4
+    // When a file's data isn't already in the OS's cache, each source reads ahead - one chunk at a time - up to this many
+    // chunks, of this size
 
 ////////// ByteStreamFileSource //////////
 
@@ -51,14 +58,23 @@ ByteStreamFileSource::createNew(UsageEnvironment& env, FILE* fid,
 }
 
 void ByteStreamFileSource::seekToByteAbsolute(u_int64_t byteNumber, u_int64_t numBytesToStream) {
-  SeekFile64(fFid, (int64_t)byteNumber, SEEK_SET);
+  if (fAsyncReader != NULL) {
+    resetReadAhead(byteNumber);
+  } else {
+    SeekFile64(fFid, (int64_t)byteNumber, SEEK_SET);
+  }
 
   fNumBytesToStream = numBytesToStream;
   fLimitNumBytesToStream = fNumBytesToStream > 0;
 }
 
 void ByteStreamFileSource::seekToByteRelative(int64_t offset, u_int64_t numBytesToStream) {
-  SeekFile64(fFid, offset, SEEK_CUR);
+  if (fAsyncReader != NULL) {
+    int64_t newOffset = (int64_t)currentReadAheadOffset() + offset;
+    resetReadAhead(newOffset < 0 ? 0 : (u_int64_t)newOffset);
+  } else {
+    SeekFile64(fFid, offset, SEEK_CUR);
+  }
 
   fNumBytesToStream = numBytesToStream;
   fLimitNumBytesToStream = fNumBytesToStream > 0;
@@ -66,14 +82,18 @@ void ByteStreamFileSource::seekToByteRelative(int64_t offset, u_int64_t numBytes
 
 void ByteStreamFileSource::seekToEnd() {
   SeekFile64(fFid, 0, SEEK_END);
+  if (fAsyncReader != NULL) resetReadAhead((u_int64_t)TellFile64(fFid));
 }
 
 ByteStreamFileSource::ByteStreamFileSource(UsageEnvironment& env, FILE* fid,
 					   unsigned preferredFrameSize,
 					   unsigned playTimePerFrame)
   : FramedFileSource(env, fid), fFileSize(0), fPreferredFrameSize(preferredFrameSize),
-    fPlayTimePerFrame(playTimePerFrame), fLastPlayTime(0),
-    fHaveStartedReading(False), fLimitNumBytesToStream(False), fNumBytesToStream(0) {
+    fPlayTimePerFrame(playTimePerFrame), fLimitNumBytesToStream(False), fNumBytesToStream(0),
+    fLastPlayTime(0), fHaveStartedReading(False),
+    fAsyncReader(NULL), fHaveCheckedForReadAhead(False), fReadAheadChunks(NULL),
+    fFirstReadAheadChunk(0), fNumReadAheadChunksInUse(0), fReadAheadChunkPosition(0), fNextReadAheadOffset(0),
+    fReadAheadReachedEOF(False), fReadAheadIsPending(False), fIsAwaitingReadAheadData(False) {
 #ifndef READ_FROM_FILES_SYNCHRONOUSLY
   makeSocketNonBlocking(fileno(fFid));
 #endif
@@ -89,6 +109,13 @@ ByteStreamFileSource::~ByteStreamFileSource() {
   envir().taskScheduler().turnOffBackgroundReadHandling(fileno(fFid));
 #endif
 
+  if (fAsyncReader != NULL) {
+    // Give each of our read-ahead chunks back to the reader, to be deleted (once any pending read into it has completed):
+    for (unsigned i = 0; i < READ_AHEAD_NUM_CHUNKS; ++i) fAsyncReader->cancel(fReadAheadChunks[i]);
+    delete[] fReadAheadChunks;
+    fAsyncReader->decrementReferenceCount();
+  }
+
   CloseInputFile(fFid);
 }
 
@@ -101,7 +128,18 @@ void ByteStreamFileSource::doGetNextFrame() {
 #ifdef READ_FROM_FILES_SYNCHRONOUSLY
   doReadFromFile();
 #else
-  if (!fHaveStartedReading) {
+  if (!fHaveCheckedForReadAhead) {
+    // This is our first read.  If the file is seekable (i.e., a regular file, which the OS will always say is
+    // 'readable', even though reading it might block), then read it ahead, from other threads:
+    fHaveCheckedForReadAhead = True;
+    if (fFidIsSeekable) startReadingAhead();
+  }
+
+  if (fAsyncReader != NULL) {
+    fFrameSize = 0;
+    fIsAwaitingReadAheadData = True;
+    deliverReadAheadData(False);
+  } else if (!fHaveStartedReading) {
     // Await readable data from the file:
     envir().taskScheduler().turnOnBackgroundReadHandling(fileno(fFid),
 	       (TaskScheduler::BackgroundHandlerProc*)&fileReadableHandler, this);
@@ -111,6 +149,16 @@ void ByteStreamFileSource::doGetNextFrame() {
 }
 
 void ByteStreamFileSource::doStopGettingFrames() {
+#ifndef READ_FROM_FILES_SYNCHRONOUSLY
+  if (fAsyncReader != NULL && (fIsAwaitingReadAheadData || nextTask() != NULL) && fFrameSize > 0) {
+    // We'd already filled (all or part of) a frame, which won't now be delivered.  Make sure that its data gets
+    // delivered next time:
+    if (!fIsAwaitingReadAheadData) fNumBytesToStream += fFrameSize;
+    fIsAwaitingReadAheadData = False;
+    resetReadAhead(currentReadAheadOffset() - fFrameSize);
+  }
+  fIsAwaitingReadAheadData = False;
+#endif
   envir().taskScheduler().unscheduleDelayedTask(nextTask());
 #ifndef READ_FROM_FILES_SYNCHRONOUSLY
   envir().taskScheduler().turnOffBackgroundReadHandling(fileno(fFid));
@@ -150,7 +198,21 @@ void ByteStreamFileSource::doReadFromFile() {
   }
   fNumBytesToStream -= fFrameSize;
 
-  // Set the 'presentation time':
+  setPresentationTime();
+
+  // Inform the reader that he has data:
+#ifdef READ_FROM_FILES_SYNCHRONOUSLY
+  // To avoid possible infinite recursion, we need to return to the event loop to do this:
+  nextTask() = envir().taskScheduler().scheduleDelayedTask(0,
+				(TaskFunc*)FramedSource::afterGetting, this);
+#else
+  // Because the file read was done from the event loop, we can call the
+  // 'after getting' function directly, without risk of infinite recursion:
+  FramedSource::afterGetting(this);
+#endif
+}
+
+void ByteStreamFileSource::setPresentationTime() {
   if (fPlayTimePerFrame > 0 && fPreferredFrameSize > 0) {
     if (fPresentationTime.tv_sec == 0 && fPresentationTime.tv_usec == 0) {
       // This is the first frame, so use the current time:
@@ -170,15 +232,144 @@ void ByteStreamFileSource::doReadFromFile() {
     // so just record the current time as being the 'presentation time':
     gettimeofday(&fPresentationTime, NULL);
   }
+}
+
+Boolean ByteStreamFileSource::startReadingAhead() {
+  fAsyncReader = AsyncFileReader::ourReader(envir());
+  if (fAsyncReader == NULL) return False; // our environment doesn't support it
+  fAsyncReader->incrementReferenceCount();
+
+  fReadAheadChunks = new AsyncFileReadRequest*[READ_AHEAD_NUM_CHUNKS];
+  for (unsigned i = 0; i < READ_AHEAD_NUM_CHUNKS; ++i) {
+    fReadAheadChunks[i] = new AsyncFileReadRequest(READ_AHEAD_CHUNK_SIZE);
+  }
+
+  int64_t curOffset = TellFile64(fFid);
+  resetReadAhead(curOffset < 0 ? 0 : (u_int64_t)curOffset);
+  return True;
+}
+
+void ByteStreamFileSource::resetReadAhead(u_int64_t fileOffset) {
+  // Discard any data that we've already read ahead (giving any chunk that's still being read back to the reader):
+  for (unsigned i = 0; i < fNumReadAheadChunksInUse; ++i) {
+    unsigned chunkIndex = (fFirstReadAheadChunk + i)%READ_AHEAD_NUM_CHUNKS;
+    if (fReadAheadChunks[chunkIndex]->isPending()) {
+      fAsyncReader->cancel(fReadAheadChunks[chunkIndex]);
+      fReadAheadChunks[chunkIndex] = new AsyncFileReadRequest(READ_AHEAD_CHUNK_SIZE);
+    }
+  }
+  fFirstReadAheadChunk = fNumReadAheadChunksInUse = 0;
+  fReadAheadChunkPosition = 0;
+  fReadAheadIsPending = fReadAheadReachedEOF = False;
+  if (fIsAwaitingReadAheadData) fFrameSize = 0; // discard any part of a frame that we'd already filled
+
+  fNextReadAheadOffset = fileOffset;
+}
+
+void ByteStreamFileSource::continueReadingAhead() {
+  // Note that we have at most one read pending at a time, so that - if our file is on a slow disk - we'll tie up at
+  // most one of the reader's threads (leaving the others for other sources):
+  if (fReadAheadIsPending || fReadAheadReachedEOF || fNumReadAheadChunksInUse == READ_AHEAD_NUM_CHUNKS) return;
+
+  AsyncFileReadRequest* chunk
+    = fReadAheadChunks[(fFirstReadAheadChunk + fNumReadAheadChunksInUse)%READ_AHEAD_NUM_CHUNKS];
+  if (!fAsyncReader->submit(chunk, fFid, fNextReadAheadOffset, readAheadCompletionHandler, this)) {
+    fReadAheadReachedEOF = True; // treat this like a read error
+    return;
+  }
+
+  ++fNumReadAheadChunksInUse;
+  fNextReadAheadOffset += chunk->bufferSize();
+  fReadAheadIsPending = True;
+}
+
+void ByteStreamFileSource
+::readAheadCompletionHandler(void* clientData, AsyncFileReadRequest* request) {
+  ByteStreamFileSource* source = (ByteStreamFileSource*)clientData;
+  source->fReadAheadIsPending = False;
+  if (request->numBytesRead() < request->bufferSize()) {
+    // We reached the end of the file (or got an error), so don't read any further:
+    source->fReadAheadReachedEOF = True;
+    source->fNextReadAheadOffset = request->fileOffset() + request->numBytesRead();
+  }
+
+  source->continueReadingAhead();
+  if (source->fIsAwaitingReadAheadData) source->deliverReadAheadData(True);
+}
+
+void ByteStreamFileSource::deliverReadAheadData(Boolean isFromCompletionHandler) {
+  // Try to deliver as many bytes as will fit in the buffer provided (or "fPreferredFrameSize" if less)
+  if (fLimitNumBytesToStream && fNumBytesToStream < (u_int64_t)fMaxSize) {
+    fMaxSize = (unsigned)fNumBytesToStream;
+  }
+  if (fPreferredFrameSize > 0 && fPreferredFrameSize < fMaxSize) {
+    fMaxSize = fPreferredFrameSize;
+  }
+
+  // Fill the frame (adding to whatever we've already put in it) - first with any data that we've read ahead, and then
+  // (once that's all used) with data that's already in the OS's cache.  Only if some data isn't cached do we read
+  // ahead (using a thread), and wait for the read to complete.  (Like "fread()", we don't deliver a partial frame,
+  // except at the end of the file.)
+  while (fFrameSize < fMaxSize) {
+    if (fNumReadAheadChunksInUse > 0) {
+      AsyncFileReadRequest* chunk = fReadAheadChunks[fFirstReadAheadChunk];
+      if (chunk->isPending()) return; // we'll be called again when the read completes
+
+      unsigned numBytesToCopy = chunk->numBytesRead() - fReadAheadChunkPosition;
+      if (numBytesToCopy > fMaxSize - fFrameSize) numBytesToCopy = fMaxSize - fFrameSize;
+      memmove(&fTo[fFrameSize], &chunk->buffer()[fReadAheadChunkPosition], numBytesToCopy);
+      fFrameSize += numBytesToCopy;
+      fReadAheadChunkPosition += numBytesToCopy;
+
+      if (fReadAheadChunkPosition == chunk->numBytesRead()) {
+	// We've finished with this chunk, so free it up:
+	fFirstReadAheadChunk = (fFirstReadAheadChunk + 1)%READ_AHEAD_NUM_CHUNKS;
+	--fNumReadAheadChunksInUse;
+	fReadAheadChunkPosition = 0;
+      }
+    } else if (fReadAheadReachedEOF) {
+      break;
+    } else {
+      Boolean reachedEOF;
+      unsigned numBytesRead
+	= AsyncFileReader::readIfCached(fFid, fNextReadAheadOffset, &fTo[fFrameSize], fMaxSize - fFrameSize, reachedEOF);
+      fFrameSize += numBytesRead;
+      fNextReadAheadOffset += numBytesRead;
+      if (reachedEOF) fReadAheadReachedEOF = True;
+      else if (fFrameSize < fMaxSize) continueReadingAhead(); // the rest of the data isn't cached
+    }
+  }
+  fIsAwaitingReadAheadData = False;
+
+  if (fFrameSize == 0) {
+    // We've delivered everything up to the end of the file:
+    handleClosure();
+    return;
+  }
+  fNumBytesToStream -= fFrameSize;
+
+  setPresentationTime();
+  if (fNumReadAheadChunksInUse > 0) continueReadingAhead(); // into the space that we've just freed up
 
   // Inform the reader that he has data:
-#ifdef READ_FROM_FILES_SYNCHRONOUSLY
-  // To avoid possible infinite recursion, we need to return to the event loop to do this:
-  nextTask() = envir().taskScheduler().scheduleDelayedTask(0,
-				(TaskFunc*)FramedSource::afterGetting, this);
-#else
-  // Because the file read was done from the event loop, we can call the
-  // 'after getting' function directly, without risk of infinite recursion:
-  FramedSource::afterGetting(this);
-#endif
+  if (isFromCompletionHandler) {
+    // We're being called from the event loop, so we can call the 'after getting' function directly, without risk of
+    // infinite recursion:
+    FramedSource::afterGetting(this);
+  } else {
+    // To avoid possible infinite recursion, we need to return to the event loop to do this:
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0,
+				(TaskFunc*)afterGettingReadAheadData, this);
+  }
+}
+
+void ByteStreamFileSource::afterGettingReadAheadData(ByteStreamFileSource* source) {
+  source->nextTask() = NULL; // so that "doStopGettingFrames()" knows that the frame has been delivered
+  FramedSource::afterGetting(source);
+}
+
+u_int64_t ByteStreamFileSource::currentReadAheadOffset() const {
+  // The file offset of the next byte to be delivered:
+  if (fNumReadAheadChunksInUse == 0) return fNextReadAheadOffset;
+  return fReadAheadChunks[fFirstReadAheadChunk]->fileOffset() + fReadAheadChunkPosition;
 }
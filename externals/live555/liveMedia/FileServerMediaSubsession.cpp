@@ -20,15 +20,45 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "FileServerMediaSubsession.hh"
+#include "MappedFileSource.hh"
+#include "InputFile.hh"
 
 FileServerMediaSubsession
 ::FileServerMediaSubsession(UsageEnvironment& env, char const* fileName,
 			    Boolean reuseFirstSource)
   : OnDemandServerMediaSubsession(env, reuseFirstSource),
-    fFileSize(0) {
+    fFileSize(0), fUseMappedFile(False) {
   fFileName = strDup(fileName);
 }
 
 FileServerMediaSubsession::~FileServerMediaSubsession() {
   delete[] (char*)fFileName;
 }
+
+ByteStreamFileSource* FileServerMediaSubsession
+::createByteStreamFileSource(unsigned preferredFrameSize, unsigned playTimePerFrame) {
+  if (fUseMappedFile) {
+    MappedFileSource* mappedFileSource
+      = MappedFileSource::createNew(envir(), fFileName, preferredFrameSize, playTimePerFrame);
+    if (mappedFileSource != NULL) return mappedFileSource;
+    // Otherwise, the file couldn't be mapped (e.g., because it's not a regular file), so read it as usual:
+  }
+
+  return ByteStreamFileSource::createNew(envir(), fFileName, preferredFrameSize, playTimePerFrame);
+}
+
+Boolean FileServerMediaSubsession::fileSDPCacheKey(char*& key, char*& version) {
+#ifndef _WIN32_WCE
+  struct stat sb;
+  if (fFileName == NULL || stat(fFileName, &sb) != 0) return False;
+  fFileSize = sb.st_size;
+
+  key = new char[strlen(fFileName) + 1/*'#'*/ + 10/*max unsigned len*/ + 1];
+  sprintf(key, "%s#%u", fFileName, trackNumber());
+  version = new char[2*20/*max 64-bit int len*/ + 1/*':'*/ + 1];
+  sprintf(version, "%llu:%lld", (unsigned long long)fFileSize, (long long)sb.st_mtime);
+  return True;
+#else
+  return False;
+#endif
+}
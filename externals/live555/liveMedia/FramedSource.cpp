@@ -27,8 +27,9 @@ FramedSource::FramedSource(UsageEnvironment& env)
   : MediaSource(env),
     fAfterGettingFunc(NULL), fAfterGettingClientData(NULL),
     fOnCloseFunc(NULL), fOnCloseClientData(NULL),
-    fIsCurrentlyAwaitingData(False) {
+    fIsCurrentlyAwaitingData(False), fNextFrameMayBeReferenced(False) {
   fPresentationTime.tv_sec = fPresentationTime.tv_usec = 0; // initially
+  fFrameMayBeReferenced = False;
 }
 
 FramedSource::~FramedSource() {
@@ -69,6 +70,7 @@ void FramedSource::getNextFrame(unsigned char* to, unsigned maxSize,
   fMaxSize = maxSize;
   fNumTruncatedBytes = 0; // by default; could be changed by doGetNextFrame()
   fDurationInMicroseconds = 0; // by default; could be changed by doGetNextFrame()
+  fFrameMayBeReferenced = fNextFrameMayBeReferenced; fNextFrameMayBeReferenced = False; // for this frame only
   fAfterGettingFunc = afterGettingFunc;
   fAfterGettingClientData = afterGettingClientData;
   fOnCloseFunc = onCloseFunc;
@@ -119,6 +121,14 @@ void FramedSource::doStopGettingFrames() {
   // Subclasses may wish to redefine this function.
 }
 
+void FramedSource::requestKeyFrame() {
+  // Default implementation: Do nothing
+}
+
+unsigned char const* FramedSource::referencedFrameData() {
+  return NULL; // by default, we copy each frame to our reader's buffer
+}
+
 unsigned FramedSource::maxFrameSize() const {
   // By default, this source has no maximum frame size.
   return 0;
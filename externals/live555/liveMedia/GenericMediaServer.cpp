@@ -91,7 +91,8 @@ GenericMediaServer
     fServerSocket(ourSocket), fServerPort(ourPort), fReclamationSeconds(reclamationSeconds),
     fServerMediaSessions(HashTable::create(STRING_HASH_KEYS)),
     fClientConnections(HashTable::create(ONE_WORD_HASH_KEYS)),
-    fClientSessions(HashTable::create(STRING_HASH_KEYS)) {
+    fClientSessions(HashTable::create(STRING_HASH_KEYS)),
+    fNumShards(1), fShardIndex(0), fShards(NULL) {
   ignoreSigPipeOnSocket(fServerSocket); // so that clients on the same host that are killed don't also kill us
   
   // Arrange to handle connections from others:
@@ -135,18 +136,23 @@ void GenericMediaServer::cleanup() {
 
 #define LISTEN_BACKLOG_SIZE 20
 
-int GenericMediaServer::setUpOurSocket(UsageEnvironment& env, Port& ourPort) {
+int GenericMediaServer::setUpOurSocket(UsageEnvironment& env, Port& ourPort, Boolean shareOurPort) {
   int ourSocket = -1;
   
   do {
-    // The following statement is enabled by default.
-    // Don't disable it (by defining ALLOW_SERVER_PORT_REUSE) unless you know what you're doing.
+    if (shareOurPort) {
+      // Other servers will be listening on this port also:
+      ourSocket = setupStreamSocket(env, ourPort, True, True);
+    } else {
+      // The following statement is enabled by default.
+      // Don't disable it (by defining ALLOW_SERVER_PORT_REUSE) unless you know what you're doing.
 #if !defined(ALLOW_SERVER_PORT_REUSE) && !defined(ALLOW_RTSP_SERVER_PORT_REUSE)
-    // ALLOW_RTSP_SERVER_PORT_REUSE is for backwards-compatibility #####
-    NoReuse dummy(env); // Don't use this socket if there's already a local server using it
+      // ALLOW_RTSP_SERVER_PORT_REUSE is for backwards-compatibility #####
+      NoReuse dummy(env); // Don't use this socket if there's already a local server using it
 #endif
-    
-    ourSocket = setupStreamSocket(env, ourPort);
+
+      ourSocket = setupStreamSocket(env, ourPort);
+    }
     if (ourSocket < 0) break;
     
     // Make sure we have a big send buffer:
@@ -201,6 +207,64 @@ void GenericMediaServer::incomingConnectionHandlerOnSocket(int serverSocket) {
   (void)createNewClientConnection(clientSocket, clientAddr);
 }
 
+// A data structure that's used to implement "handOffClientSocket()":
+class ClientSocketHandOff {
+public:
+  ClientSocketHandOff(GenericMediaServer* toServer, int clientSocket, struct sockaddr_in const& clientAddr,
+		      unsigned char const* requestBytes, unsigned numRequestBytes)
+    : fToServer(toServer), fClientSocket(clientSocket), fClientAddr(clientAddr),
+      fRequestBytes(new unsigned char[numRequestBytes+1]), fNumRequestBytes(numRequestBytes) {
+    memmove(fRequestBytes, requestBytes, numRequestBytes);
+  }
+  virtual ~ClientSocketHandOff() {
+    delete[] fRequestBytes;
+  }
+
+  GenericMediaServer* fToServer;
+  int fClientSocket;
+  struct sockaddr_in fClientAddr;
+  unsigned char* fRequestBytes;
+  unsigned fNumRequestBytes;
+};
+
+void GenericMediaServer
+::handOffClientSocket(int clientSocket, struct sockaddr_in const& clientAddr, unsigned toShardIndex,
+		      unsigned char const* requestBytes, unsigned numRequestBytes) {
+  if (fShards == NULL || toShardIndex >= fNumShards || toShardIndex == fShardIndex) {
+    // There's nowhere to hand the socket to (this shouldn't happen); just close it:
+    ::closeSocket(clientSocket);
+    return;
+  }
+
+  GenericMediaServer* toServer = fShards[toShardIndex];
+  ClientSocketHandOff* handOff
+    = new ClientSocketHandOff(toServer, clientSocket, clientAddr, requestBytes, numRequestBytes);
+
+  // The other shard's event loop is running in another thread, so we can't call it directly.
+  // Instead, we post a task to it:
+  if (!toServer->envir().taskScheduler().postTask(adoptClientSocket, handOff)) {
+    ::closeSocket(clientSocket);
+    delete handOff;
+  }
+}
+
+void GenericMediaServer::adoptClientSocket(void* clientSocketHandOff) {
+  ClientSocketHandOff* handOff = (ClientSocketHandOff*)clientSocketHandOff;
+  GenericMediaServer* server = handOff->fToServer;
+
+  ClientConnection* connection = server->createNewClientConnection(handOff->fClientSocket, handOff->fClientAddr);
+  if (connection != NULL && handOff->fNumRequestBytes > 0) {
+    // Handle the bytes that the other shard had already read from the socket, as if we had just read them ourself:
+    if (handOff->fNumRequestBytes > connection->fRequestBufferBytesLeft) {
+      handOff->fNumRequestBytes = connection->fRequestBufferBytesLeft; // "handleRequestBytes()" will treat this as an error
+    }
+    memmove(&connection->fRequestBuffer[connection->fRequestBytesAlreadySeen], handOff->fRequestBytes, handOff->fNumRequestBytes);
+    connection->handleRequestBytes(handOff->fNumRequestBytes);
+  }
+
+  delete handOff;
+}
+
 
 ////////// GenericMediaServer::ClientConnection implementation //////////
 
@@ -23,6 +23,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "H264VideoRTPSink.hh"
 #include "ByteStreamFileSource.hh"
 #include "H264VideoStreamFramer.hh"
+#include "H264VideoStreamDiscreteFramer.hh"
 
 H264VideoFileServerMediaSubsession*
 H264VideoFileServerMediaSubsession::createNew(UsageEnvironment& env,
@@ -103,7 +104,7 @@ FramedSource* H264VideoFileServerMediaSubsession::createNewStreamSource(unsigned
   estBitrate = 500; // kbps, estimate
 
   // Create the video source:
-  ByteStreamFileSource* fileSource = ByteStreamFileSource::createNew(envir(), fFileName);
+  ByteStreamFileSource* fileSource = createByteStreamFileSource();
   if (fileSource == NULL) return NULL;
   fFileSize = fileSource->fileSize();
 
@@ -117,3 +118,12 @@ RTPSink* H264VideoFileServerMediaSubsession
 		   FramedSource* /*inputSource*/) {
   return H264VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic);
 }
+
+Boolean H264VideoFileServerMediaSubsession::sdpCacheKey(char*& key, char*& version) {
+  return fileSDPCacheKey(key, version);
+}
+
+FramedSource* H264VideoFileServerMediaSubsession::createNewStreamSourceFromReplica(FramedSource* replica) {
+  // Each replica delivers NAL units (without start codes), so use a 'discrete' framer for it:
+  return H264VideoStreamDiscreteFramer::createNew(envir(), replica);
+}
@@ -37,6 +37,9 @@ public:
   virtual ~H264or5Fragmenter();
 
   Boolean lastFragmentCompletedNALUnit() const { return fLastFragmentCompletedNALUnit; }
+  unsigned char const* deliveredFrameData() const { return fDeliveredFrameData; }
+      // We deliver each frame (NAL unit or fragment) 'by reference': Rather than copying it to "fTo", we leave it in
+      // our input buffer - at "deliveredFrameData()" - for our "H264or5VideoRTPSink" to send from there.
 
 private: // redefined virtual functions:
   virtual void doGetNextFrame();
@@ -62,6 +65,7 @@ private:
   unsigned fCurDataOffset;
   unsigned fSaveNumTruncatedBytes;
   Boolean fLastFragmentCompletedNALUnit;
+  unsigned char const* fDeliveredFrameData;
 };
 
 
@@ -117,7 +121,7 @@ Boolean H264or5VideoRTPSink::continuePlaying() {
   // If not, create it now:
   if (fOurFragmenter == NULL) {
     fOurFragmenter = new H264or5Fragmenter(fHNumber, envir(), fSource, OutPacketBuffer::maxSize,
-					   ourMaxPacketSize() - 12/*RTP hdr size*/);
+					   ourMaxPacketSize() - 12/*RTP hdr size*/ - rtpHeaderExtensionSize());
   } else {
     fOurFragmenter->reassignInputSource(fSource);
   }
@@ -149,12 +153,39 @@ void H264or5VideoRTPSink::doSpecialFrameHandling(unsigned /*fragmentationOffset*
   setTimestamp(framePresentationTime);
 }
 
+unsigned char const* H264or5VideoRTPSink::referencedFrameData() {
+  return fOurFragmenter == NULL ? NULL : ((H264or5Fragmenter*)fOurFragmenter)->deliveredFrameData();
+}
+
 Boolean H264or5VideoRTPSink
 ::frameCanAppearAfterPacketStart(unsigned char const* /*frameStart*/,
 				 unsigned /*numBytesInFrame*/) const {
   return False;
 }
 
+Boolean H264or5VideoRTPSink
+::frameBeginsKeyFrame(unsigned char const* frameStart, unsigned numBytesInFrame) const {
+  // Each 'frame' delivered by our fragmenter is either a complete NAL unit, or a FU (fragmentation unit).
+  // A receiver can start decoding at a parameter set (VPS, SPS or PPS) or at a IDR (or other 'IRAP') picture.
+  if (fHNumber == 264) {
+    if (numBytesInFrame < 1) return False;
+    u_int8_t nal_unit_type = frameStart[0]&0x1F;
+    if (nal_unit_type == 28) { // FU-A
+      if (numBytesInFrame < 2 || (frameStart[1]&0x80) == 0) return False; // not the start of the NAL unit
+      nal_unit_type = frameStart[1]&0x1F;
+    }
+    return isH264or5KeyFrameNALUnitType(264, nal_unit_type);
+  } else { // 265
+    if (numBytesInFrame < 2) return False;
+    u_int8_t nal_unit_type = (frameStart[0]&0x7E)>>1;
+    if (nal_unit_type == 49) { // FU
+      if (numBytesInFrame < 3 || (frameStart[2]&0x80) == 0) return False; // not the start of the NAL unit
+      nal_unit_type = frameStart[2]&0x3F;
+    }
+    return isH264or5KeyFrameNALUnitType(265, nal_unit_type);
+  }
+}
+
 
 ////////// H264or5Fragmenter implementation //////////
 
@@ -163,7 +194,7 @@ H264or5Fragmenter::H264or5Fragmenter(int hNumber,
 				     unsigned inputBufferMax, unsigned maxOutputPacketSize)
   : FramedFilter(env, inputSource),
     fHNumber(hNumber),
-    fInputBufferSize(inputBufferMax+1), fMaxOutputPacketSize(maxOutputPacketSize) {
+    fInputBufferSize(inputBufferMax+1), fMaxOutputPacketSize(maxOutputPacketSize), fDeliveredFrameData(NULL) {
   fInputBuffer = new unsigned char[fInputBufferSize];
   reset();
 }
@@ -201,7 +232,7 @@ void H264or5Fragmenter::doGetNextFrame() {
     fLastFragmentCompletedNALUnit = True; // by default
     if (fCurDataOffset == 1) { // case 1 or 2
       if (fNumValidDataBytes - 1 <= fMaxSize) { // case 1
-	memmove(fTo, &fInputBuffer[1], fNumValidDataBytes - 1);
+	fDeliveredFrameData = &fInputBuffer[1];
 	fFrameSize = fNumValidDataBytes - 1;
 	fCurDataOffset = fNumValidDataBytes;
       } else { // case 2
@@ -217,7 +248,7 @@ void H264or5Fragmenter::doGetNextFrame() {
 	  fInputBuffer[1] = fInputBuffer[2]; // Payload header (2nd byte)
 	  fInputBuffer[2] = 0x80 | nal_unit_type; // FU header (with S bit)
 	}
-	memmove(fTo, fInputBuffer, fMaxSize);
+	fDeliveredFrameData = fInputBuffer;
 	fFrameSize = fMaxSize;
 	fCurDataOffset += fMaxSize - 1;
 	fLastFragmentCompletedNALUnit = False;
@@ -249,7 +280,7 @@ void H264or5Fragmenter::doGetNextFrame() {
 	fInputBuffer[fCurDataOffset-1] |= 0x40; // set the E bit in the FU header
 	fNumTruncatedBytes = fSaveNumTruncatedBytes;
       }
-      memmove(fTo, &fInputBuffer[fCurDataOffset-numExtraHeaderBytes], numBytesToSend);
+      fDeliveredFrameData = &fInputBuffer[fCurDataOffset-numExtraHeaderBytes];
       fFrameSize = numBytesToSend;
       fCurDataOffset += numBytesToSend - numExtraHeaderBytes;
     }
@@ -1005,9 +1005,11 @@ unsigned H264or5VideoStreamParser::parse() {
       while (next4Bytes != 0x00000001 && (next4Bytes&0xFFFFFF00) != 0x00000100) {
 	// We save at least some of "next4Bytes".
 	if ((unsigned)(next4Bytes&0xFF) > 1) {
-	  // Common case: 0x00000001 or 0x000001 definitely doesn't begin anywhere in "next4Bytes", so we save all of it:
+	  // Common case: 0x00000001 or 0x000001 definitely doesn't begin anywhere in "next4Bytes", so we save all of it -
+	  // and then everything else that we've already read, up until the next start code:
 	  save4Bytes(next4Bytes);
 	  skipBytes(4);
+	  saveBytesBeforeStartCode();
 	} else {
 	  // Save the first byte, and continue testing the rest:
 	  saveByte(next4Bytes>>24);
@@ -1178,3 +1180,9 @@ unsigned removeH264or5EmulationBytes(u_int8_t* to, unsigned toMaxSize,
 
   return toSize;
 }
+
+Boolean isH264or5KeyFrameNALUnitType(int hNumber, u_int8_t nal_unit_type) {
+  return hNumber == 264
+    ? (nal_unit_type == 5/*IDR*/ || nal_unit_type == 7/*SPS*/ || nal_unit_type == 8/*PPS*/)
+    : ((nal_unit_type >= 16 && nal_unit_type <= 21)/*IRAP*/ || (nal_unit_type >= 32 && nal_unit_type <= 34)/*VPS,SPS,PPS*/);
+}
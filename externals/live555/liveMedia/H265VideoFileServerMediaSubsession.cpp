@@ -23,6 +23,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "H265VideoRTPSink.hh"
 #include "ByteStreamFileSource.hh"
 #include "H265VideoStreamFramer.hh"
+#include "H265VideoStreamDiscreteFramer.hh"
 
 H265VideoFileServerMediaSubsession*
 H265VideoFileServerMediaSubsession::createNew(UsageEnvironment& env,
@@ -104,7 +105,7 @@ FramedSource* H265VideoFileServerMediaSubsession::createNewStreamSource(unsigned
   estBitrate = 500; // kbps, estimate
 
   // Create the video source:
-  ByteStreamFileSource* fileSource = ByteStreamFileSource::createNew(envir(), fFileName);
+  ByteStreamFileSource* fileSource = createByteStreamFileSource();
   if (fileSource == NULL) return NULL;
   fFileSize = fileSource->fileSize();
 
@@ -118,3 +119,12 @@ RTPSink* H265VideoFileServerMediaSubsession
 		   FramedSource* /*inputSource*/) {
   return H265VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic);
 }
+
+Boolean H265VideoFileServerMediaSubsession::sdpCacheKey(char*& key, char*& version) {
+  return fileSDPCacheKey(key, version);
+}
+
+FramedSource* H265VideoFileServerMediaSubsession::createNewStreamSourceFromReplica(FramedSource* replica) {
+  // Each replica delivers NAL units (without start codes), so use a 'discrete' framer for it:
+  return H265VideoStreamDiscreteFramer::createNew(envir(), replica);
+}
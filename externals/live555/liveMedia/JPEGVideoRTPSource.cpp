@@ -29,6 +29,7 @@ public:
 private:
   // Redefined virtual functions:
   virtual void reset();
+  virtual unsigned tailroom() const;
   virtual unsigned nextEnclosedFrameSize(unsigned char*& framePtr,
 					 unsigned dataSize);
 };
@@ -447,6 +448,10 @@ void JPEGBufferedPacket::reset() {
   fHead = fTail = offset;
 }
 
+unsigned JPEGBufferedPacket::tailroom() const {
+  return 2; // for the "EOI" marker that "nextEnclosedFrameSize()" might append
+}
+
 unsigned JPEGBufferedPacket
 ::nextEnclosedFrameSize(unsigned char*& framePtr, unsigned dataSize) {
   // Normally, the enclosed frame size is just "dataSize".  If, however,
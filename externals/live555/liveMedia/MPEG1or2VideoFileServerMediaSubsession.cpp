@@ -52,8 +52,7 @@ FramedSource* MPEG1or2VideoFileServerMediaSubsession
 ::createNewStreamSource(unsigned /*clientSessionId*/, unsigned& estBitrate) {
   estBitrate = 500; // kbps, estimate
 
-  ByteStreamFileSource* fileSource
-    = ByteStreamFileSource::createNew(envir(), fFileName);
+  ByteStreamFileSource* fileSource = createByteStreamFileSource();
   if (fileSource == NULL) return NULL;
   fFileSize = fileSource->fileSize();
 
@@ -160,8 +160,7 @@ FramedSource* MPEG2TransportFileServerMediaSubsession
   // Create the video source:
   unsigned const inputDataChunkSize
     = TRANSPORT_PACKETS_PER_NETWORK_PACKET*TRANSPORT_PACKET_SIZE;
-  ByteStreamFileSource* fileSource
-    = ByteStreamFileSource::createNew(envir(), fFileName, inputDataChunkSize);
+  ByteStreamFileSource* fileSource = createByteStreamFileSource(inputDataChunkSize);
   if (fileSource == NULL) return NULL;
   fFileSize = fileSource->fileSize();
 
@@ -21,9 +21,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "MPEG2TransportStreamFramer.hh"
+#include "CRC32.hh" // for "calculateCRC()"
 #include <GroupsockHelper.hh> // for "gettimeofday()"
 
 #define TRANSPORT_PACKET_SIZE 188
+#define NUM_PIDS 8192
+#define PAT_PID 0
 
 ////////// Definitions of constants that control the behavior of this code /////////
 
@@ -75,13 +78,15 @@ MPEG2TransportStreamFramer
   : FramedFilter(env, inputSource),
     fTSPacketCount(0), fTSPacketDurationEstimate(0.0), fTSPCRCount(0),
     fLimitNumTSPacketsToStream(False), fNumTSPacketsToStream(0),
-    fLimitTSPacketsToStreamByPCR(False), fPCRLimit(0.0) {
+    fLimitTSPacketsToStreamByPCR(False), fPCRLimit(0.0), fReferencedFrameData(NULL),
+    fPMT_PIDs(NULL), fNumPSISectionsChecked(0), fNumPSICRCErrors(0) {
   fPIDStatusTable = HashTable::create(ONE_WORD_HASH_KEYS);
 }
 
 MPEG2TransportStreamFramer::~MPEG2TransportStreamFramer() {
   clearPIDStatusTable();
   delete fPIDStatusTable;
+  delete[] fPMT_PIDs;
 }
 
 void MPEG2TransportStreamFramer::clearPIDStatusTable() {
@@ -101,6 +106,17 @@ void MPEG2TransportStreamFramer::setPCRLimit(float pcrLimit) {
   fLimitTSPacketsToStreamByPCR = pcrLimit != 0.0;
 }
 
+void MPEG2TransportStreamFramer::setPSICRCChecking(Boolean checkCRCs) {
+  if (checkCRCs) {
+    if (fPMT_PIDs == NULL) {
+      fPMT_PIDs = new u_int8_t[NUM_PIDS/8];
+      memset(fPMT_PIDs, 0, NUM_PIDS/8);
+    }
+  } else {
+    delete[] fPMT_PIDs; fPMT_PIDs = NULL;
+  }
+}
+
 void MPEG2TransportStreamFramer::doGetNextFrame() {
   if (fLimitNumTSPacketsToStream) {
     if (fNumTSPacketsToStream == 0) {
@@ -112,8 +128,11 @@ void MPEG2TransportStreamFramer::doGetNextFrame() {
     }
   }
 
-  // Read directly from our input source into our client's buffer:
+  // Read directly from our input source into our client's buffer (or - if our client allows it - have our input source
+  // deliver its data 'by reference'; we'll then do the same):
   fFrameSize = 0;
+  fReferencedFrameData = NULL;
+  if (fFrameMayBeReferenced) fInputSource->allowNextFrameByReference();
   fInputSource->getNextFrame(fTo, fMaxSize,
 			     afterGettingFrame, this,
 			     FramedSource::handleClosure, this);
@@ -138,8 +157,14 @@ void MPEG2TransportStreamFramer
 
 #define TRANSPORT_SYNC_BYTE 0x47
 
+unsigned char const* MPEG2TransportStreamFramer::referencedFrameData() {
+  return fReferencedFrameData;
+}
+
 void MPEG2TransportStreamFramer::afterGettingFrame1(unsigned frameSize,
 						    struct timeval presentationTime) {
+  unsigned char const* frameData = fInputSource->referencedFrameData();
+  if (frameData == NULL) frameData = fTo; // the usual case: the data was copied into our client's buffer
   fFrameSize += frameSize;
   unsigned const numTSPackets = fFrameSize/TRANSPORT_PACKET_SIZE;
   fNumTSPacketsToStream -= numTSPackets;
@@ -153,7 +178,7 @@ void MPEG2TransportStreamFramer::afterGettingFrame1(unsigned frameSize,
   // Make sure the data begins with a sync byte:
   unsigned syncBytePosition;
   for (syncBytePosition = 0; syncBytePosition < fFrameSize; ++syncBytePosition) {
-    if (fTo[syncBytePosition] == TRANSPORT_SYNC_BYTE) break;
+    if (frameData[syncBytePosition] == TRANSPORT_SYNC_BYTE) break;
   }
   if (syncBytePosition == fFrameSize) {
     envir() << "No Transport Stream sync byte in data.";
@@ -162,7 +187,7 @@ void MPEG2TransportStreamFramer::afterGettingFrame1(unsigned frameSize,
   } else if (syncBytePosition > 0) {
     // There's a sync byte, but not at the start of the data.  Move the good data
     // to the start of the buffer, then read more to fill it up again:
-    memmove(fTo, &fTo[syncBytePosition], fFrameSize - syncBytePosition);
+    memmove(fTo, &frameData[syncBytePosition], fFrameSize - syncBytePosition);
     fFrameSize -= syncBytePosition;
     fInputSource->getNextFrame(&fTo[fFrameSize], syncBytePosition,
 			       afterGettingFrame, this,
@@ -178,21 +203,24 @@ void MPEG2TransportStreamFramer::afterGettingFrame1(unsigned frameSize,
   gettimeofday(&tvNow, NULL);
   double timeNow = tvNow.tv_sec + tvNow.tv_usec/1000000.0;
   for (unsigned i = 0; i < numTSPackets; ++i) {
-    if (!updateTSPacketDurationEstimate(&fTo[i*TRANSPORT_PACKET_SIZE], timeNow)) {
+    if (!updateTSPacketDurationEstimate(&frameData[i*TRANSPORT_PACKET_SIZE], timeNow)) {
       // We hit a preset limit (based on PCR) within the stream.  Handle this as if the input source has closed:
       handleClosure();
       return;
     }
+    if (fPMT_PIDs != NULL) checkPSICRCs(&frameData[i*TRANSPORT_PACKET_SIZE]);
   }
 
   fDurationInMicroseconds
     = numTSPackets * (unsigned)(fTSPacketDurationEstimate*1000000);
 
+  if (frameData != fTo) fReferencedFrameData = frameData;
+
   // Complete the delivery to our client:
   afterGetting(this);
 }
 
-Boolean MPEG2TransportStreamFramer::updateTSPacketDurationEstimate(unsigned char* pkt, double timeNow) {
+Boolean MPEG2TransportStreamFramer::updateTSPacketDurationEstimate(unsigned char const* pkt, double timeNow) {
   // Sanity check: Make sure we start with the sync byte:
   if (pkt[0] != TRANSPORT_SYNC_BYTE) {
     envir() << "Missing sync byte!\n";
@@ -288,3 +316,53 @@ Boolean MPEG2TransportStreamFramer::updateTSPacketDurationEstimate(unsigned char
 
   return True;
 }
+
+void MPEG2TransportStreamFramer::checkPSICRCs(unsigned char const* pkt) {
+  if (pkt[0] != TRANSPORT_SYNC_BYTE) return;
+
+  // We check only sections that begin - and end - within this packet (which is the usual case for PATs and PMTs):
+  u_int8_t const payload_unit_start_indicator = pkt[1]&0x40;
+  if (payload_unit_start_indicator == 0) return;
+
+  u_int16_t const PID = ((pkt[1]&0x1F)<<8) | pkt[2];
+  Boolean const isPAT = PID == PAT_PID;
+  if (!isPAT && (fPMT_PIDs[PID>>3]&(1<<(PID&7))) == 0) return;
+
+  u_int8_t const adaptation_field_control = (pkt[3]&0x30)>>4;
+  if ((adaptation_field_control&1) == 0) return; // there's no payload
+  unsigned offset = 4;
+  if (adaptation_field_control == 3) offset += 1 + pkt[4];
+  if (offset >= TRANSPORT_PACKET_SIZE) return;
+  offset += 1 + pkt[offset]; // skip over the "pointer_field" (and the end of any previous section)
+
+  while (offset + 3 <= TRANSPORT_PACKET_SIZE) {
+    u_int8_t const table_id = pkt[offset];
+    if (table_id == 0xFF) break; // the rest of the packet is stuffing
+    u_int8_t const section_syntax_indicator = pkt[offset+1]&0x80;
+    unsigned const sectionSize = 3 + (((pkt[offset+1]&0x0F)<<8) | pkt[offset+2]);
+    if (section_syntax_indicator == 0 || sectionSize < 12/*header+CRC*/) break; // not a section with a "CRC_32"
+    if (offset + sectionSize > TRANSPORT_PACKET_SIZE) break; // the section continues in a later packet
+
+    ++fNumPSISectionsChecked;
+    if (calculateCRC(&pkt[offset], sectionSize) != 0) {
+      ++fNumPSICRCErrors;
+#ifdef DEBUG_PSI_CRC
+      fprintf(stderr, "PID 0x%x, table_id 0x%02x: bad CRC_32, pkt #%lu\n", PID, table_id, fTSPacketCount);
+#endif
+      break; // don't trust the rest of this packet
+    }
+
+    if (isPAT && table_id == 0x00) {
+      // Note the PMT PIDs that this PAT lists, so that we'll check their sections too:
+      unsigned const programsEnd = offset + sectionSize - 4/*CRC_32*/;
+      for (unsigned i = offset + 8; i + 4 <= programsEnd; i += 4) {
+	u_int16_t const program_number = (pkt[i]<<8) | pkt[i+1];
+	if (program_number == 0) continue; // this entry is for the network PID, not a PMT
+	u_int16_t const program_map_PID = ((pkt[i+2]&0x1F)<<8) | pkt[i+3];
+	fPMT_PIDs[program_map_PID>>3] |= 1<<(program_map_PID&7);
+      }
+    }
+
+    offset += sectionSize;
+  }
+}
@@ -107,8 +107,7 @@ FramedSource* MPEG4VideoFileServerMediaSubsession
   estBitrate = 500; // kbps, estimate
 
   // Create the video source:
-  ByteStreamFileSource* fileSource
-    = ByteStreamFileSource::createNew(envir(), fFileName);
+  ByteStreamFileSource* fileSource = createByteStreamFileSource();
   if (fileSource == NULL) return NULL;
   fFileSize = fileSource->fileSize();
 
@@ -123,3 +122,7 @@ RTPSink* MPEG4VideoFileServerMediaSubsession
   return MPEG4ESVideoRTPSink::createNew(envir(), rtpGroupsock,
 					rtpPayloadTypeIfDynamic);
 }
+
+Boolean MPEG4VideoFileServerMediaSubsession::sdpCacheKey(char*& key, char*& version) {
+  return fileSDPCacheKey(key, version);
+}
@@ -55,6 +55,10 @@ void MPEGVideoStreamFramer::flushInput() {
   if (fParser != NULL) fParser->flushInput();
 }
 
+void MPEGVideoStreamFramer::setMaxParserBufferSize(unsigned maxBufferSize) {
+  if (fParser != NULL) fParser->setMaxBankSize(maxBufferSize);
+}
+
 void MPEGVideoStreamFramer::reset() {
   fPictureCount = 0;
   fPictureEndMarker = False;
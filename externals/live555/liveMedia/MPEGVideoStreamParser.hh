@@ -27,6 +27,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _MPEG_VIDEO_STREAM_FRAMER_HH
 #include "MPEGVideoStreamFramer.hh"
 #endif
+#include <string.h>
 
 ////////// MPEGVideoStreamParser definition //////////
 
@@ -70,6 +71,21 @@ protected:
     *fTo++ = word>>24; *fTo++ = word>>16; *fTo++ = word>>8; *fTo++ = word;
   }
 
+  void saveBytes(unsigned char const* from, unsigned numBytes) {
+    unsigned numBytesToSave = fTo >= fLimit ? 0 : fLimit - fTo;
+    if (numBytesToSave > numBytes) numBytesToSave = numBytes;
+    memmove(fTo, from, numBytesToSave);
+    fTo += numBytesToSave;
+    fNumTruncatedBytes += numBytes - numBytesToSave; // if there wasn't enough space left
+  }
+
+  // Save (in bulk) the bytes that we've already read that precede the next sync word:
+  void saveBytesBeforeStartCode() {
+    unsigned numBytes;
+    unsigned char const* from = skipBytesBeforeStartCode(numBytes);
+    saveBytes(from, numBytes);
+  }
+
   // Save data until we see a sync word (0x000001xx):
   void saveToNextCode(u_int32_t& curWord) {
     saveByte(curWord>>24);
@@ -78,6 +94,7 @@ protected:
       if ((unsigned)(curWord&0xFF) > 1) {
 	// a sync word definitely doesn't begin anywhere in "curWord"
 	save4Bytes(curWord);
+	saveBytesBeforeStartCode();
 	curWord = get4Bytes();
       } else {
 	// a sync word might begin in "curWord", although not at its start
@@ -94,6 +111,8 @@ protected:
     while ((curWord&0xFFFFFF00) != 0x00000100) {
       if ((unsigned)(curWord&0xFF) > 1) {
 	// a sync word definitely doesn't begin anywhere in "curWord"
+	unsigned numBytesSkipped;
+	(void)skipBytesBeforeStartCode(numBytesSkipped);
 	curWord = get4Bytes();
       } else {
 	// a sync word might begin in "curWord", although not at its start
@@ -0,0 +1,198 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A file source that is a plain byte stream (rather than frames), read from a memory-mapped file
+// Implementation
+
+#include "MappedFileSource.hh"
+#include "InputFile.hh"
+#include <string.h>
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define READ_AHEAD_SIZE (4*1024*1024)
+    // As we read through the mapping, we ask the OS to read (this much) ahead of us.  (A multiple of the page size.)
+    // Each time we do so, we also check that the file hasn't been truncated.
+
+////////// MappedFileSource //////////
+
+MappedFileSource*
+MappedFileSource::createNew(UsageEnvironment& env, char const* fileName,
+			    unsigned preferredFrameSize, unsigned playTimePerFrame) {
+  FILE* fid = OpenInputFile(env, fileName);
+  if (fid == NULL) return NULL;
+
+  MappedFileSource* newSource = new MappedFileSource(env, fid, preferredFrameSize, playTimePerFrame);
+  newSource->fFileSize = GetFileSize(fileName, fid);
+  if (!newSource->mapFile()) {
+    env.setResultMsg("unable to memory-map file \"", fileName, "\"");
+    Medium::close(newSource);
+    return NULL;
+  }
+
+  return newSource;
+}
+
+unsigned char const* MappedFileSource::getMappedBytes(unsigned maxNumBytes, unsigned& numBytes) {
+  // If we're getting close to the end of the data that we've asked the OS to read ahead (and have checked is still in the
+  // file), ask for some more:
+  if (fCurPosition + maxNumBytes + READ_AHEAD_SIZE > fReadAheadPosition && fReadAheadPosition < fFileSize) {
+    extendReadAhead(fCurPosition + maxNumBytes + READ_AHEAD_SIZE);
+  }
+
+  u_int64_t numBytesRemaining = fFileSize - fCurPosition;
+  if (fLimitNumBytesToStream && fNumBytesToStream < numBytesRemaining) numBytesRemaining = fNumBytesToStream;
+  numBytes = numBytesRemaining < (u_int64_t)maxNumBytes ? (unsigned)numBytesRemaining : maxNumBytes;
+
+  unsigned char const* result = &fMappedData[fCurPosition];
+  fCurPosition += numBytes;
+  fNumBytesToStream -= numBytes;
+
+  return result;
+}
+
+void MappedFileSource::seekToByteAbsolute(u_int64_t byteNumber, u_int64_t numBytesToStream) {
+  fCurPosition = byteNumber < fFileSize ? byteNumber : fFileSize;
+  fReadAheadPosition = fCurPosition - fCurPosition%READ_AHEAD_SIZE;
+
+  fNumBytesToStream = numBytesToStream;
+  fLimitNumBytesToStream = fNumBytesToStream > 0;
+}
+
+void MappedFileSource::seekToByteRelative(int64_t offset, u_int64_t numBytesToStream) {
+  int64_t newPosition = (int64_t)fCurPosition + offset;
+  seekToByteAbsolute(newPosition < 0 ? 0 : (u_int64_t)newPosition, numBytesToStream);
+}
+
+void MappedFileSource::seekToEnd() {
+  fCurPosition = fFileSize;
+}
+
+unsigned char const* MappedFileSource::referencedFrameData() {
+  return fReferencedFrameData;
+}
+
+MappedFileSource::MappedFileSource(UsageEnvironment& env, FILE* fid,
+				   unsigned preferredFrameSize, unsigned playTimePerFrame)
+  : ByteStreamFileSource(env, fid, preferredFrameSize, playTimePerFrame),
+    fMappedData(NULL),
+#if defined(__WIN32__) || defined(_WIN32)
+    fMappingHandle(NULL),
+#endif
+    fMappingSize(0), fCurPosition(0), fReadAheadPosition(0), fReferencedFrameData(NULL) {
+}
+
+MappedFileSource::~MappedFileSource() {
+#if defined(__WIN32__) || defined(_WIN32)
+#ifndef _WIN32_WCE
+  if (fMappedData != NULL) UnmapViewOfFile(fMappedData);
+  if (fMappingHandle != NULL) CloseHandle((HANDLE)fMappingHandle);
+#endif
+#else
+  if (fMappedData != NULL) munmap((void*)fMappedData, (size_t)fMappingSize);
+#endif
+}
+
+Boolean MappedFileSource::mapFile() {
+  if (fFid == NULL || fFid == stdin || fFileSize == 0) return False;
+  if ((u_int64_t)(size_t)fFileSize != fFileSize) return False; // the file is too large to be mapped
+
+#if defined(__WIN32__) || defined(_WIN32)
+#ifndef _WIN32_WCE
+  HANDLE fileHandle = (HANDLE)_get_osfhandle(_fileno(fFid));
+  if (fileHandle == INVALID_HANDLE_VALUE) return False;
+
+  fMappingHandle = (void*)CreateFileMapping(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (fMappingHandle == NULL) return False;
+
+  fMappedData = (unsigned char const*)MapViewOfFile((HANDLE)fMappingHandle, FILE_MAP_READ, 0, 0, (SIZE_T)fFileSize);
+  return fMappedData != NULL;
+#else
+  return False;
+#endif
+#else
+  void* mapping = mmap(NULL, (size_t)fFileSize, PROT_READ, MAP_SHARED, fileno(fFid), 0);
+  if (mapping == MAP_FAILED) return False;
+  fMappedData = (unsigned char const*)mapping;
+  fMappingSize = fFileSize;
+
+#ifdef MADV_SEQUENTIAL
+  // We'll be reading the file in order, so the OS can read ahead aggressively (and drop pages once we've read them):
+  madvise(mapping, (size_t)fFileSize, MADV_SEQUENTIAL);
+#endif
+  return True;
+#endif
+}
+
+void MappedFileSource::extendReadAhead(u_int64_t newReadAheadPosition) {
+#if !defined(__WIN32__) && !defined(_WIN32)
+  // Our mapping is shared with the file, so if the file has been truncated (e.g., because it's being rewritten), then
+  // touching a page of the mapping that now lies beyond the end of the file would raise SIGBUS.  So check the file's
+  // size first, and - if it has shrunk - stop reading at its new end:
+  struct stat sb;
+  if (fstat(fileno(fFid), &sb) == 0 && (u_int64_t)sb.st_size < fFileSize) {
+    envir() << "MappedFileSource: Warning: The file was truncated while being read; treating its new end as its end\n";
+    fFileSize = (u_int64_t)sb.st_size;
+    if (fCurPosition > fFileSize) fCurPosition = fFileSize;
+  }
+#endif
+
+  if (fReadAheadPosition < fCurPosition) fReadAheadPosition = fCurPosition - fCurPosition%READ_AHEAD_SIZE; // after a seek
+  while (fReadAheadPosition < newReadAheadPosition && fReadAheadPosition < fFileSize) {
+    u_int64_t numBytesToReadAhead = fFileSize - fReadAheadPosition;
+    if (numBytesToReadAhead > READ_AHEAD_SIZE) numBytesToReadAhead = READ_AHEAD_SIZE;
+#if !defined(__WIN32__) && !defined(_WIN32) && defined(MADV_WILLNEED)
+    madvise((void*)&fMappedData[fReadAheadPosition], (size_t)numBytesToReadAhead, MADV_WILLNEED);
+#endif
+    fReadAheadPosition += numBytesToReadAhead;
+  }
+}
+
+Boolean MappedFileSource::isMappedFileSource() const {
+  return True;
+}
+
+void MappedFileSource::doGetNextFrame() {
+  unsigned maxSize = fMaxSize;
+  if (fPreferredFrameSize > 0 && fPreferredFrameSize < maxSize) maxSize = fPreferredFrameSize;
+
+  unsigned char const* frameData = getMappedBytes(maxSize, fFrameSize);
+  if (fFrameSize == 0) {
+    fReferencedFrameData = NULL;
+    handleClosure();
+    return;
+  }
+
+  if (fFrameMayBeReferenced) {
+    // Our reader can use the data where it is, in the mapping:
+    fReferencedFrameData = frameData;
+  } else {
+    memcpy(fTo, frameData, fFrameSize);
+    fReferencedFrameData = NULL;
+  }
+  setPresentationTime();
+
+  // To avoid possible infinite recursion, we need to return to the event loop to do this:
+  nextTask() = envir().taskScheduler().scheduleDelayedTask(0,
+				(TaskFunc*)FramedSource::afterGetting, this);
+}
+
+void MappedFileSource::doStopGettingFrames() {
+  envir().taskScheduler().unscheduleDelayedTask(nextTask());
+}
@@ -23,6 +23,10 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include <ByteStreamFileSource.hh>
 #include <GroupsockHelper.hh> // for "gettimeofday()
 
+// The most bytes that we get or skip (from the parser's 'bank') at a time.  This is no more than half the bank's
+// initial size, so that getting or skipping a large amount of data (in chunks) never causes the bank to grow:
+#define MAX_CHUNK_SIZE 75000
+
 MatroskaFileParser::MatroskaFileParser(MatroskaFile& ourFile, FramedSource* inputSource,
 				       FramedSource::onCloseFunc* onEndFunc, void* onEndClientData,
 				       MatroskaDemux* ourDemux)
@@ -1150,10 +1154,9 @@ void MatroskaFileParser::deliverFrameBytes() {
     MatroskaDemuxedTrack* demuxedTrack = fOurDemux->lookupDemuxedTrack(fBlockTrackNumber);
     if (demuxedTrack == NULL) break; // shouldn't happen
 
-    unsigned const BANK_SIZE = bankSize();
     while (fCurFrameNumBytesToGet > 0) {
-      // Hack: We can get no more than BANK_SIZE bytes at a time:
-      unsigned numBytesToGet = fCurFrameNumBytesToGet > BANK_SIZE ? BANK_SIZE : fCurFrameNumBytesToGet;
+      // Hack: We can get no more than MAX_CHUNK_SIZE bytes at a time:
+      unsigned numBytesToGet = fCurFrameNumBytesToGet > MAX_CHUNK_SIZE ? MAX_CHUNK_SIZE : fCurFrameNumBytesToGet;
       getBytes(fCurFrameTo, numBytesToGet);
       fCurFrameTo += numBytesToGet;
       fCurFrameNumBytesToGet -= numBytesToGet;
@@ -1161,8 +1164,8 @@ void MatroskaFileParser::deliverFrameBytes() {
       setParseState();
     }
     while (fCurFrameNumBytesToSkip > 0) {
-      // Hack: We can skip no more than BANK_SIZE bytes at a time:
-      unsigned numBytesToSkip = fCurFrameNumBytesToSkip > BANK_SIZE ? BANK_SIZE : fCurFrameNumBytesToSkip;
+      // Hack: We can skip no more than MAX_CHUNK_SIZE bytes at a time:
+      unsigned numBytesToSkip = fCurFrameNumBytesToSkip > MAX_CHUNK_SIZE ? MAX_CHUNK_SIZE : fCurFrameNumBytesToSkip;
       skipBytes(numBytesToSkip);
       fCurFrameNumBytesToSkip -= numBytesToSkip;
       fCurOffsetWithinFrame += numBytesToSkip;
@@ -1382,7 +1385,7 @@ void MatroskaFileParser::skipRemainingHeaderBytes(Boolean isContinuation) {
 
   // Hack: To avoid tripping into a parser 'internal error' if we try to skip an excessively large
   // distance, break up the skipping into manageable chunks, to ensure forward progress:
-  unsigned const maxBytesToSkip = bankSize();
+  unsigned const maxBytesToSkip = MAX_CHUNK_SIZE;
   while (fNumHeaderBytesToSkip > 0) {
     unsigned numBytesToSkipNow
       = fNumHeaderBytesToSkip < maxBytesToSkip ? (unsigned)fNumHeaderBytesToSkip : maxBytesToSkip;
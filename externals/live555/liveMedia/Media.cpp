@@ -98,14 +98,16 @@ _Tables* _Tables::getOurTables(UsageEnvironment& env, Boolean createIfNotPresent
 }
 
 void _Tables::reclaimIfPossible() {
-  if (mediaTable == NULL && socketTable == NULL) {
+  if (mediaTable == NULL && socketTable == NULL && packetBufferPool == NULL && sdpCache == NULL
+      && asyncFileReader == NULL) {
     fEnv.liveMediaPriv = NULL;
     delete this;
   }
 }
 
 _Tables::_Tables(UsageEnvironment& env)
-  : mediaTable(NULL), socketTable(NULL), fEnv(env) {
+  : mediaTable(NULL), socketTable(NULL), packetBufferPool(NULL), sdpCache(NULL),
+    asyncFileReader(NULL), fEnv(env) {
 }
 
 _Tables::~_Tables() {
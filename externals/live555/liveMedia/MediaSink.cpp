@@ -120,6 +120,7 @@ OutPacketBuffer
   unsigned maxNumPackets = (maxBufferSize + (maxPacketSize-1))/maxPacketSize;
   fLimit = maxNumPackets*maxPacketSize;
   fBuf = new unsigned char[fLimit];
+  fPayloadReference = NULL; fPayloadReferenceSize = 0;
   resetPacketStart();
   resetOffset();
   resetOverflowData();
@@ -130,6 +131,8 @@ OutPacketBuffer::~OutPacketBuffer() {
 }
 
 void OutPacketBuffer::enqueue(unsigned char const* from, unsigned numBytes) {
+  if (fPayloadReference != NULL) copyInPayloadReference(); // so that the new data follows it
+
   if (numBytes > totalBytesAvailable()) {
 #ifdef DEBUG
     fprintf(stderr, "OutPacketBuffer::enqueue() warning: %d > %d\n", numBytes, totalBytesAvailable());
@@ -141,9 +144,22 @@ void OutPacketBuffer::enqueue(unsigned char const* from, unsigned numBytes) {
   increment(numBytes);
 }
 
+// The following 'word' functions (used for RTP and other headers) read or write the bytes directly (in network order),
+// rather than using "memmove()":
+static void putWord(unsigned char* to, u_int32_t word) {
+  to[0] = (unsigned char)(word>>24); to[1] = (unsigned char)(word>>16);
+  to[2] = (unsigned char)(word>>8); to[3] = (unsigned char)word;
+}
+
 void OutPacketBuffer::enqueueWord(u_int32_t word) {
-  u_int32_t nWord = htonl(word);
-  enqueue((unsigned char*)&nWord, 4);
+  if (fPayloadReference != NULL || totalBytesAvailable() < 4) { // unusual case
+    u_int32_t nWord = htonl(word);
+    enqueue((unsigned char*)&nWord, 4);
+    return;
+  }
+
+  putWord(curPtr(), word);
+  increment(4);
 }
 
 void OutPacketBuffer::insert(unsigned char const* from, unsigned numBytes,
@@ -161,8 +177,17 @@ void OutPacketBuffer::insert(unsigned char const* from, unsigned numBytes,
 }
 
 void OutPacketBuffer::insertWord(u_int32_t word, unsigned toPosition) {
-  u_int32_t nWord = htonl(word);
-  insert((unsigned char*)&nWord, 4, toPosition);
+  unsigned realToPosition = fPacketStart + toPosition;
+  if (realToPosition + 4 > fLimit) { // unusual case
+    u_int32_t nWord = htonl(word);
+    insert((unsigned char*)&nWord, 4, toPosition);
+    return;
+  }
+
+  putWord(&fBuf[realToPosition], word);
+  if (toPosition + 4 > fCurOffset) {
+    fCurOffset = toPosition + 4;
+  }
 }
 
 void OutPacketBuffer::extract(unsigned char* to, unsigned numBytes,
@@ -177,9 +202,24 @@ void OutPacketBuffer::extract(unsigned char* to, unsigned numBytes,
 }
 
 u_int32_t OutPacketBuffer::extractWord(unsigned fromPosition) {
-  u_int32_t nWord;
-  extract((unsigned char*)&nWord, 4, fromPosition);
-  return ntohl(nWord);
+  unsigned realFromPosition = fPacketStart + fromPosition;
+  if (realFromPosition + 4 > fLimit) { // unusual case
+    u_int32_t nWord = 0;
+    extract((unsigned char*)&nWord, 4, fromPosition);
+    return ntohl(nWord);
+  }
+
+  unsigned char const* from = &fBuf[realFromPosition];
+  return (from[0]<<24)|(from[1]<<16)|(from[2]<<8)|from[3];
+}
+
+void OutPacketBuffer::copyInPayloadReference() {
+  if (fPayloadReference == NULL) return;
+
+  unsigned char const* payload = fPayloadReference;
+  unsigned payloadSize = fPayloadReferenceSize;
+  fPayloadReference = NULL; fPayloadReferenceSize = 0;
+  enqueue(payload, payloadSize);
 }
 
 void OutPacketBuffer::skipBytes(unsigned numBytes) {
@@ -20,6 +20,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "MultiFramedRTPSink.hh"
+#include "ULPFEC.hh"
+#include "TransportWideCC.hh"
 #include "GroupsockHelper.hh"
 
 ////////// MultiFramedRTPSink //////////
@@ -43,16 +45,138 @@ MultiFramedRTPSink::MultiFramedRTPSink(UsageEnvironment& env,
   : RTPSink(env, rtpGS, rtpPayloadType, rtpTimestampFrequency,
 	    rtpPayloadFormatName, numChannels),
     fOutBuf(NULL), fCurFragmentationOffset(0), fPreviousFrameEndedFragmentation(False),
-    fOnSendErrorFunc(NULL), fOnSendErrorData(NULL) {
+    fRTPHeaderExtensionSize(0), fTransportSeqNoPosition(0),
+    fOnSendErrorFunc(NULL), fOnSendErrorData(NULL),
+    fRetransmissionHistory(NULL), fRetransmissionHistoryBuffer(NULL),
+    fRetransmissionHistorySize(0), fRetransmissionHistoryMaxPacketSize(0), fNumPacketsInRetransmissionHistory(0),
+    fRTXPayloadType(0), fRTXSSRC(0), fRTXSeqNo(0),
+    fNumPacketsNACKed(0), fNumPacketsRetransmitted(0), fNumNACKedPacketsNotInHistory(0), fNumRetransmissionsSuppressed(0),
+    fNumBytesRetransmitted(0),
+    fFECEncoder(NULL), fFECGroupsock(NULL), fNumFECPacketsSent(0), fNumFECBytesSent(0),
+    fTransportWideCCExtensionId(0), fTransportSeqNo(0), fBandwidthEstimator(NULL),
+    fTargetBitrateHandler(NULL), fTargetBitrateHandlerData(NULL) {
   setPacketSizes(1000, 1456);
       // Default max packet size (1500, minus allowance for IP, UDP, UMTP headers)
       // (Also, make it a multiple of 4 bytes, just in case that matters.)
 }
 
 MultiFramedRTPSink::~MultiFramedRTPSink() {
+  deleteRetransmissionHistory();
+  delete fFECEncoder;
+  delete fBandwidthEstimator;
   delete fOutBuf;
 }
 
+// A packet that we've sent, and that we can retransmit:
+struct RetransmissionHistoryEntry {
+  unsigned char* packet; // (within "fRetransmissionHistoryBuffer")
+  unsigned packetSize; // 0 if the entry is unused
+  u_int16_t seqNo;
+  struct timeval lastRetransmissionTime; // (0 if it hasn't been retransmitted)
+};
+
+unsigned MultiFramedRTPSink::minRetransmissionInterval = 10000;
+
+#define MAX_RETRANSMISSION_HISTORY_SIZE 32768 // (half of the sequence number space)
+
+Boolean MultiFramedRTPSink
+::enableRetransmissions(unsigned historySize, unsigned char rtxPayloadType, u_int32_t rtxSSRC) {
+  if (historySize > MAX_RETRANSMISSION_HISTORY_SIZE) return False;
+
+  deleteRetransmissionHistory();
+  if (historySize == 0) return True;
+
+  fRetransmissionHistorySize = historySize;
+  fRetransmissionHistoryMaxPacketSize = fOurMaxPacketSize;
+  fRetransmissionHistory = new RetransmissionHistoryEntry[historySize];
+  fRetransmissionHistoryBuffer = new unsigned char[historySize*fRetransmissionHistoryMaxPacketSize];
+  for (unsigned i = 0; i < historySize; ++i) {
+    RetransmissionHistoryEntry& entry = fRetransmissionHistory[i];
+    entry.packet = &fRetransmissionHistoryBuffer[i*fRetransmissionHistoryMaxPacketSize];
+    entry.packetSize = 0;
+    entry.seqNo = 0;
+    entry.lastRetransmissionTime.tv_sec = entry.lastRetransmissionTime.tv_usec = 0;
+  }
+
+  fRTXPayloadType = rtxPayloadType;
+  if (fRTXPayloadType != 0) {
+    fRTXSSRC = rtxSSRC != 0 ? rtxSSRC : our_random32();
+    fRTXSeqNo = (u_int16_t)our_random();
+  }
+
+  return True;
+}
+
+void MultiFramedRTPSink::deleteRetransmissionHistory() {
+  delete[] fRetransmissionHistory; fRetransmissionHistory = NULL;
+  delete[] fRetransmissionHistoryBuffer; fRetransmissionHistoryBuffer = NULL;
+  fRetransmissionHistorySize = fRetransmissionHistoryMaxPacketSize = fNumPacketsInRetransmissionHistory = 0;
+  fRTXPayloadType = 0;
+  fRTXSSRC = 0;
+}
+
+Boolean MultiFramedRTPSink
+::enableFEC(unsigned numColumns, unsigned numRows, unsigned char fecPayloadType,
+	    Groupsock* fecGroupsock, u_int32_t fecSSRC) {
+  if (numColumns != 0 && !ULPFECEncoder::matrixIsValid(numColumns, numRows)) return False;
+
+  delete fFECEncoder; fFECEncoder = NULL;
+  fFECGroupsock = NULL;
+  if (numColumns == 0) return True;
+
+  fFECEncoder = new ULPFECEncoder(numColumns, numRows, fecPayloadType,
+				  fecSSRC != 0 ? fecSSRC : our_random32(), (u_int16_t)our_random());
+  fFECGroupsock = fecGroupsock;
+  return True;
+}
+
+void MultiFramedRTPSink::sendFECPackets() {
+  // Protect the packet that we've just sent, then send any FEC packets that are now ready:
+  fFECEncoder->addMediaPacket(fOutBuf->packet(), fOutBuf->curPacketSize(),
+			      fOutBuf->payloadReference(), fOutBuf->payloadReferenceSize());
+
+  unsigned char* fecPacket;
+  unsigned fecPacketSize;
+  while ((fecPacket = fFECEncoder->nextFECPacket(fecPacketSize)) != NULL) {
+    Boolean sendResult = fFECGroupsock != NULL
+      ? fFECGroupsock->output(envir(), fecPacket, fecPacketSize)
+      : fRTPInterface.sendPacket(fecPacket, fecPacketSize, False);
+    if (!sendResult) {
+      if (fOnSendErrorFunc != NULL) (*fOnSendErrorFunc)(fOnSendErrorData);
+      continue;
+    }
+    ++fNumFECPacketsSent;
+    fNumFECBytesSent += fecPacketSize;
+  }
+}
+
+Boolean MultiFramedRTPSink
+::enableTransportWideCC(u_int8_t extensionId, unsigned initialBitrate, unsigned minBitrate, unsigned maxBitrate) {
+  if (extensionId > 14) return False; // (15 is reserved in one-byte header extensions)
+
+  delete fBandwidthEstimator; fBandwidthEstimator = NULL;
+  fTransportWideCCExtensionId = extensionId;
+  fRTPHeaderExtensionSize = 0;
+  if (extensionId == 0) return True;
+
+  fBandwidthEstimator = new SendSideBandwidthEstimator(initialBitrate, minBitrate, maxBitrate);
+  fTransportSeqNo = (u_int16_t)our_random();
+  fRTPHeaderExtensionSize = 8; // a 4-byte extension header, then a 3-byte element, plus 1 byte of padding
+  return True;
+}
+
+unsigned MultiFramedRTPSink::targetBitrate() const {
+  return fBandwidthEstimator == NULL ? 0 : fBandwidthEstimator->targetBitrate();
+}
+
+void MultiFramedRTPSink::handleTransportWideCCFeedback(unsigned char const* fci, unsigned fciSize) {
+  if (fBandwidthEstimator == NULL) return;
+
+  if (fBandwidthEstimator->handleFeedback(fci, fciSize) && fTargetBitrateHandler != NULL) {
+    (*fTargetBitrateHandler)(fTargetBitrateHandlerData, fBandwidthEstimator->targetBitrate());
+  }
+}
+
 void MultiFramedRTPSink
 ::doSpecialFrameHandling(unsigned /*fragmentationOffset*/,
 			 unsigned char* /*frameStart*/,
@@ -80,6 +204,17 @@ Boolean MultiFramedRTPSink
   return True; // by default
 }
 
+Boolean MultiFramedRTPSink
+::frameBeginsKeyFrame(unsigned char const* /*frameStart*/,
+		      unsigned /*numBytesInFrame*/) const {
+  return True; // by default
+}
+
+unsigned char const* MultiFramedRTPSink::referencedFrameData() {
+  // By default, ask our source (which delivers frames by reference only if we allowed it to):
+  return fSource == NULL ? NULL : fSource->referencedFrameData();
+}
+
 unsigned MultiFramedRTPSink::specialHeaderSize() const {
   // default implementation: Assume no special header:
   return 0;
@@ -164,9 +299,11 @@ void MultiFramedRTPSink::stopPlaying() {
 
 void MultiFramedRTPSink::buildAndSendPacket(Boolean isFirstPacket) {
   fIsFirstPacket = isFirstPacket;
+  fPacketBeginsKeyFrame = False; // by default; set below if a key frame starts in this packet
 
   // Set up the RTP header:
   unsigned rtpHdr = 0x80000000; // RTP version 2; marker ('M') bit not set (by default; it can be set later)
+  if (fTransportWideCCExtensionId != 0) rtpHdr |= 0x10000000; // there's a header extension
   rtpHdr |= (fRTPPayloadType<<16);
   rtpHdr |= fSeqNo; // sequence number
   fOutBuf->enqueueWord(rtpHdr);
@@ -178,6 +315,14 @@ void MultiFramedRTPSink::buildAndSendPacket(Boolean isFirstPacket) {
 
   fOutBuf->enqueueWord(SSRC());
 
+  if (fTransportWideCCExtensionId != 0) {
+    // Add a one-byte header extension (RFC 8285), containing just the transport-wide sequence number.
+    // (We fill in this number only when we send the packet.)
+    fOutBuf->enqueueWord(0xBEDE0001); // 'defined by profile' value; length (in words)
+    fTransportSeqNoPosition = fOutBuf->curPacketSize();
+    fOutBuf->enqueueWord((fTransportWideCCExtensionId<<28)|(1<<24)); // id; length-1; (seq no); padding
+  }
+
   // Allow for a special, payload-format-specific header following the
   // RTP header:
   fSpecialHeaderPosition = fOutBuf->curPacketSize();
@@ -212,6 +357,11 @@ void MultiFramedRTPSink::packFrame() {
     fOutBuf->skipBytes(fCurFrameSpecificHeaderSize);
     fTotalFrameSpecificHeaderSizes += fCurFrameSpecificHeaderSize;
 
+    if (fNumFramesUsedSoFar == 0) {
+      // This frame will begin a new packet, so - if our source can - it can give us the frame 'by reference', to
+      // be sent from where it is (see "referencedFrameData()"):
+      fSource->allowNextFrameByReference();
+    }
     fSource->getNextFrame(fOutBuf->curPtr(), fOutBuf->totalBytesAvailable(),
 			  afterGettingFrame, this, ourHandleClosure, this);
   }
@@ -224,13 +374,13 @@ void MultiFramedRTPSink
 		    unsigned durationInMicroseconds) {
   MultiFramedRTPSink* sink = (MultiFramedRTPSink*)clientData;
   sink->afterGettingFrame1(numBytesRead, numTruncatedBytes,
-			   presentationTime, durationInMicroseconds);
+			   presentationTime, durationInMicroseconds, sink->referencedFrameData());
 }
 
 void MultiFramedRTPSink
 ::afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes,
 		     struct timeval presentationTime,
-		     unsigned durationInMicroseconds) {
+		     unsigned durationInMicroseconds, unsigned char const* frameReference) {
   if (fIsFirstPacket) {
     // Record the fact that we're starting to play now:
     gettimeofday(&fNextSendTime, NULL);
@@ -249,6 +399,14 @@ void MultiFramedRTPSink
 	    << OutPacketBuffer::maxSize + numTruncatedBytes << ", *before* creating this 'RTPSink'.  (Current value is "
 	    << OutPacketBuffer::maxSize << ".)\n";
   }
+  if (frameReference != NULL && (fNumFramesUsedSoFar > 0 || fOutBuf->wouldOverflow(frameSize))) {
+    // We can't send this frame by reference (because it would share its packet with other data), so copy it into
+    // our buffer (where it would have been delivered normally), and continue as usual:
+    if (frameSize > fOutBuf->totalBytesAvailable()) frameSize = fOutBuf->totalBytesAvailable(); // sanity check
+    memmove(fOutBuf->curPtr(), frameReference, frameSize);
+    frameReference = NULL;
+  }
+
   unsigned curFragmentationOffset = fCurFragmentationOffset;
   unsigned numFrameBytesToUse = frameSize;
   unsigned overflowBytes = 0;
@@ -302,15 +460,25 @@ void MultiFramedRTPSink
     sendPacketIfNecessary();
   } else {
     // Use this frame in our outgoing packet:
-    unsigned char* frameStart = fOutBuf->curPtr();
-    fOutBuf->increment(numFrameBytesToUse);
+    unsigned char* frameStart;
+    if (frameReference != NULL) {
+      // Send the frame from where it is, rather than copying it into our buffer:
+      frameStart = (unsigned char*)frameReference;
+      fOutBuf->setPayloadReference(frameReference, numFrameBytesToUse);
+    } else {
+      frameStart = fOutBuf->curPtr();
+      fOutBuf->increment(numFrameBytesToUse);
         // do this now, in case "doSpecialFrameHandling()" calls "setFramePadding()" to append padding bytes
+    }
 
     // Here's where any payload format specific processing gets done:
     doSpecialFrameHandling(curFragmentationOffset, frameStart,
 			   numFrameBytesToUse, presentationTime,
 			   overflowBytes);
 
+    if (curFragmentationOffset == 0 && frameBeginsKeyFrame(frameStart, numFrameBytesToUse)) {
+      fPacketBeginsKeyFrame = True;
+    }
     ++fNumFramesUsedSoFar;
 
     // Update the time at which the next packet should be sent, based
@@ -328,8 +496,10 @@ void MultiFramedRTPSink
     //      read would overflow the packet, or
     // (iii) it contains the last fragment of a fragmented frame, and we
     //      don't allow anything else to follow this or
-    // (iv) one frame per packet is allowed:
-    if (fOutBuf->isPreferredSize()
+    // (iv) one frame per packet is allowed, or
+    // (v) the frame is being sent by reference:
+    if (fOutBuf->havePayloadReference()
+	|| fOutBuf->isPreferredSize()
         || fOutBuf->wouldOverflow(numFrameBytesToUse)
         || (fPreviousFrameEndedFragmentation &&
             !allowOtherFramesAfterLastFragment())
@@ -347,27 +517,117 @@ void MultiFramedRTPSink
 static unsigned const rtpHeaderSize = 12;
 
 Boolean MultiFramedRTPSink::isTooBigForAPacket(unsigned numBytes) const {
-  // Check whether a 'numBytes'-byte frame - together with a RTP header and
+  // Check whether a 'numBytes'-byte frame - together with a RTP header (and any header extension) and
   // (possible) special headers - would be too big for an output packet:
-  // (Later allow for RTP extension header!) #####
-  numBytes += rtpHeaderSize + specialHeaderSize() + frameSpecificHeaderSize();
+  numBytes += rtpHeaderSize + fRTPHeaderExtensionSize + specialHeaderSize() + frameSpecificHeaderSize();
   return fOutBuf->isTooBigForAPacket(numBytes);
 }
 
+void MultiFramedRTPSink::addPacketToRetransmissionHistory() {
+  // Copy the packet that we've just sent (with sequence number "fSeqNo") into its history entry:
+  unsigned headerSize = fOutBuf->curPacketSize();
+  unsigned payloadSize = fOutBuf->payloadReferenceSize();
+  if (headerSize + payloadSize > fRetransmissionHistoryMaxPacketSize) return; // the max packet size has since increased
+
+  RetransmissionHistoryEntry& entry = fRetransmissionHistory[fSeqNo%fRetransmissionHistorySize];
+  if (entry.packetSize == 0) ++fNumPacketsInRetransmissionHistory;
+  memcpy(entry.packet, fOutBuf->packet(), headerSize);
+  if (payloadSize > 0) memcpy(&entry.packet[headerSize], fOutBuf->payloadReference(), payloadSize);
+  entry.packetSize = headerSize + payloadSize;
+  entry.seqNo = fSeqNo;
+  entry.lastRetransmissionTime.tv_sec = entry.lastRetransmissionTime.tv_usec = 0;
+}
+
+Boolean MultiFramedRTPSink::retransmitPacket(u_int16_t seqNo) {
+  ++fNumPacketsNACKed;
+  if (fRetransmissionHistory == NULL) return False;
+
+  RetransmissionHistoryEntry& entry = fRetransmissionHistory[seqNo%fRetransmissionHistorySize];
+  if (entry.packetSize == 0 || entry.seqNo != seqNo) {
+    ++fNumNACKedPacketsNotInHistory;
+    return False;
+  }
+
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  if (entry.lastRetransmissionTime.tv_sec != 0 || entry.lastRetransmissionTime.tv_usec != 0) {
+    int64_t uSecondsSince = (timeNow.tv_sec - entry.lastRetransmissionTime.tv_sec)*(int64_t)1000000
+      + (timeNow.tv_usec - entry.lastRetransmissionTime.tv_usec);
+    if (uSecondsSince >= 0 && uSecondsSince < (int64_t)minRetransmissionInterval) {
+      ++fNumRetransmissionsSuppressed;
+      return False;
+    }
+  }
+  entry.lastRetransmissionTime = timeNow;
+
+  // Note: A retransmitted packet doesn't 'begin a key frame' (for the purpose of resuming output to a slow
+  // RTP-over-TCP client), because it's out of order.
+  Boolean sendResult;
+  unsigned numBytesSent;
+  if (fRTXPayloadType == 0) {
+    // Retransmit the packet 'in place' - i.e., exactly as it was originally sent:
+    sendResult = fRTPInterface.sendPacket(entry.packet, entry.packetSize, False);
+    numBytesSent = entry.packetSize;
+  } else {
+    // Retransmit the packet using the "rtx" payload format (RFC 4588): Its RTP header is the same as the
+    // original's, except for the payload type, sequence number, and SSRC; its payload is the original sequence
+    // number, followed by the original payload:
+    unsigned char* packet = entry.packet;
+    unsigned headerSize = 12 + 4*(packet[0]&0x0F); // RTP header + CSRCs
+    if ((packet[0]&0x10) != 0 && headerSize + 4 <= entry.packetSize) { // there's a header extension
+      headerSize += 4 + 4*((packet[headerSize+2]<<8)|packet[headerSize+3]);
+    }
+    unsigned char rtxHeader[12 + 4*15 + 64 + 2];
+    if (headerSize > entry.packetSize || headerSize + 2 > sizeof rtxHeader) return False; // we can't handle this packet
+
+    memmove(rtxHeader, packet, headerSize);
+    rtxHeader[1] = (packet[1]&0x80)|(fRTXPayloadType&0x7F); // keep the 'M' bit
+    rtxHeader[2] = fRTXSeqNo>>8; rtxHeader[3] = (unsigned char)fRTXSeqNo;
+    rtxHeader[8] = fRTXSSRC>>24; rtxHeader[9] = fRTXSSRC>>16; rtxHeader[10] = fRTXSSRC>>8; rtxHeader[11] = fRTXSSRC;
+    rtxHeader[headerSize] = seqNo>>8; rtxHeader[headerSize+1] = (unsigned char)seqNo; // 'OSN'
+    ++fRTXSeqNo;
+
+    sendResult = fRTPInterface.sendPacket(rtxHeader, headerSize + 2,
+					  &packet[headerSize], entry.packetSize - headerSize, False);
+    numBytesSent = entry.packetSize + 2;
+  }
+  if (!sendResult) {
+    if (fOnSendErrorFunc != NULL) (*fOnSendErrorFunc)(fOnSendErrorData);
+    return False;
+  }
+
+  ++fNumPacketsRetransmitted;
+  fNumBytesRetransmitted += numBytesSent;
+  return True;
+}
+
 void MultiFramedRTPSink::sendPacketIfNecessary() {
   if (fNumFramesUsedSoFar > 0) {
+    if (fBandwidthEstimator != NULL) {
+      fOutBuf->insertWord((fTransportWideCCExtensionId<<28)|(1<<24)|(fTransportSeqNo<<8), fTransportSeqNoPosition);
+    }
+
     // Send the packet:
 #ifdef TEST_LOSS
     if ((our_random()%10) != 0) // simulate 10% packet loss #####
 #endif
-      if (!fRTPInterface.sendPacket(fOutBuf->packet(), fOutBuf->curPacketSize())) {
+      if (!fRTPInterface.sendPacket(fOutBuf->packet(), fOutBuf->curPacketSize(),
+				    fOutBuf->payloadReference(), fOutBuf->payloadReferenceSize(), fPacketBeginsKeyFrame)) {
 	// if failure handler has been specified, call it
 	if (fOnSendErrorFunc != NULL) (*fOnSendErrorFunc)(fOnSendErrorData);
       }
+    unsigned packetSize = fOutBuf->curPacketSize() + fOutBuf->payloadReferenceSize();
+    if (fRetransmissionHistory != NULL) addPacketToRetransmissionHistory();
+    if (fFECEncoder != NULL) sendFECPackets();
+    if (fBandwidthEstimator != NULL) {
+      struct timeval timeNow;
+      gettimeofday(&timeNow, NULL);
+      fBandwidthEstimator->noteSentPacket(fTransportSeqNo++, packetSize, timeNow);
+    }
     ++fPacketCount;
-    fTotalOctetCount += fOutBuf->curPacketSize();
-    fOctetCount += fOutBuf->curPacketSize()
-      - rtpHeaderSize - fSpecialHeaderSize - fTotalFrameSpecificHeaderSizes;
+    fTotalOctetCount += packetSize;
+    fOctetCount += packetSize
+      - rtpHeaderSize - fRTPHeaderExtensionSize - fSpecialHeaderSize - fTotalFrameSpecificHeaderSizes;
 
     ++fSeqNo; // for next time
   }
@@ -379,7 +639,7 @@ void MultiFramedRTPSink::sendPacketIfNecessary() {
     // so that we probably don't have to "memmove()" the overflow data
     // into place when building the next packet:
     unsigned newPacketStart = fOutBuf->curPacketSize()
-      - (rtpHeaderSize + fSpecialHeaderSize + frameSpecificHeaderSize());
+      - (rtpHeaderSize + fRTPHeaderExtensionSize + fSpecialHeaderSize + frameSpecificHeaderSize());
     fOutBuf->adjustPacketStart(newPacketStart);
   } else {
     // Normal case: Reset the packet start pointer back to the start:
@@ -20,15 +20,26 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "MultiFramedRTPSource.hh"
+#include "PacketBufferPool.hh"
 #include "RTCP.hh"
+#include "ULPFEC.hh"
+#include "TransportWideCC.hh"
 #include "GroupsockHelper.hh"
 #include <string.h>
 
 ////////// ReorderingPacketBuffer definition //////////
 
+// The most missing packets that we keep track of (for NACKing) at once:
+#define MAX_NUM_MISSING_PACKETS 128
+// The most times that we NACK each missing packet:
+#define MAX_NACKS_PER_PACKET 3
+// How long we wait before NACKing a missing packet again, if we don't yet know how long retransmissions take:
+#define INITIAL_NACK_RETRY_INTERVAL 50000 /* uSeconds */
+#define MIN_NACK_RETRY_INTERVAL 5000 /* uSeconds */
+
 class ReorderingPacketBuffer {
 public:
-  ReorderingPacketBuffer(BufferedPacketFactory* packetFactory);
+  ReorderingPacketBuffer(UsageEnvironment& env, BufferedPacketFactory* packetFactory);
   virtual ~ReorderingPacketBuffer();
   void reset();
 
@@ -37,19 +48,56 @@ public:
   BufferedPacket* getNextCompletedPacket(Boolean& packetLossPreceded);
   void releaseUsedPacket(BufferedPacket* packet);
   void freePacket(BufferedPacket* packet) {
-    if (packet != fSavedPacket) {
-      delete packet;
-    } else {
+    packet->releaseBuffer();
+    if (packet == fSavedPacket) {
       fSavedPacketFree = True;
+    } else if (fNumFreePackets < fMaxNumFreePackets) {
+      packet->nextPacket() = fFreePackets;
+      fFreePackets = packet;
+      ++fNumFreePackets;
+    } else {
+      delete packet;
     }
   }
   Boolean isEmpty() const { return fHeadPacket == NULL; }
 
   void setThresholdTime(unsigned uSeconds) { fThresholdTime = uSeconds; }
-  void resetHaveSeenFirstPacket() { fHaveSeenFirstPacket = False; }
+  unsigned thresholdTime() const { return fThresholdTime; }
+  void resetHaveSeenFirstPacket() { fHaveSeenFirstPacket = False; fNumMissingPackets = 0; }
+  void setMaxNumFreePackets(unsigned maxNumFreePackets);
+
+  Boolean isWaitingForMissingPacket() const {
+    return fHeadPacket != NULL && fHeadPacket->rtpSeqNo() != fNextExpectedSeqNo;
+  }
+  unsigned uSecondsUntilThresholdExceeded(struct timeval const& timeNow) const;
+      // (assumes that "isWaitingForMissingPacket()")
+
+  // Tracking of missing packets (i.e., gaps in sequence numbers), so that they can be NACKed.  (This is done only
+  // if "trackMissingPackets()" is set.)
+  Boolean& trackMissingPackets() { return fTrackMissingPackets; }
+  unsigned numMissingPackets() const { return fNumMissingPackets; }
+  Boolean wasNACKed(u_int16_t seqNo) const;
+  unsigned getPacketsToNACK(u_int16_t* seqNos, struct timeval const& timeNow, unsigned& numNewlyNACKed);
+      // Fills in "seqNos" (in order) with the missing packets that are due to be NACKed (again) now, and notes that
+      // they have been.  Returns the number of these.  (Room for MAX_NUM_MISSING_PACKETS is assumed.)
+  unsigned uSecondsUntilNextNACK(struct timeval const& timeNow) const; // ~0 if there's no NACK to be sent again
+  unsigned estimatedRetransmissionTime() const { return fEstimatedRetransmissionTime; }
+  unsigned expectedRetransmissionTime() const {
+    // like "estimatedRetransmissionTime()", except that - until we've measured it - we assume a default value:
+    return fEstimatedRetransmissionTime == 0 ? INITIAL_NACK_RETRY_INTERVAL : fEstimatedRetransmissionTime;
+  }
+  unsigned numPacketsRecovered() const { return fNumPacketsRecovered; }
+  unsigned numPacketsLost() const { return fNumPacketsLost; }
+
+private:
+  void noteMissingPackets(u_int16_t fromSeqNo, u_int16_t toSeqNo); // those >= "fromSeqNo" and < "toSeqNo"
+  void noteArrivingPacket(u_int16_t seqNo); // in case it's one that we've noted as missing
+  void forgetMissingPacketsBefore(u_int16_t seqNo);
+  unsigned nackRetryInterval() const;
 
 private:
   BufferedPacketFactory* fPacketFactory;
+  PacketBufferPool* fPacketBufferPool;
   unsigned fThresholdTime; // uSeconds
   Boolean fHaveSeenFirstPacket; // used to set initial "fNextExpectedSeqNo"
   unsigned short fNextExpectedSeqNo;
@@ -58,19 +106,49 @@ private:
   BufferedPacket* fSavedPacket;
       // to avoid calling new/free in the common case
   Boolean fSavedPacketFree;
+  BufferedPacket* fFreePackets; // other packets that we keep around for reuse (when reading packets in batches)
+  unsigned fNumFreePackets, fMaxNumFreePackets;
+
+  Boolean fTrackMissingPackets;
+  struct MissingPacket {
+    u_int16_t seqNo;
+    unsigned numNACKs; // so far
+    struct timeval firstNACKTime, lastNACKTime;
+  } fMissingPackets[MAX_NUM_MISSING_PACKETS]; // in sequence number order
+  unsigned fNumMissingPackets;
+  unsigned fEstimatedRetransmissionTime; // uSeconds (0 if we don't yet know)
+  unsigned fNumPacketsRecovered, fNumPacketsLost;
 };
 
 
 ////////// MultiFramedRTPSource implementation //////////
 
+// The most packets that we'll read at once:
+#define MAX_PACKET_READ_BATCH_SIZE 64
+
+#define MAX_PACKET_SIZE 65536
+
+unsigned MultiFramedRTPSource::defaultPacketReadBatchSize = 1;
+
 MultiFramedRTPSource
 ::MultiFramedRTPSource(UsageEnvironment& env, Groupsock* RTPgs,
 		       unsigned char rtpPayloadFormat,
 		       unsigned rtpTimestampFrequency,
 		       BufferedPacketFactory* packetFactory)
-  : RTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency) {
+  : RTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency),
+    fPacketReadBatchSize(1), fDirectDeliveryDepth(0),
+    fNACKRTCPInstance(NULL), fRTXPayloadType(0),
+    fHaveAdaptiveThresholdTime(False), fMinThresholdTime(0), fMaxThresholdTime(0),
+    fPacketLossTimeoutTask(NULL), fNumPacketsNACKed(0), fNumNACKsSent(0),
+    fKeyFrameRequestRTCPInstance(NULL), fMinKeyFrameRequestInterval(0),
+    fKeyFrameRequestTask(NULL), fNumKeyFrameRequestsSent(0),
+    fFECDecoder(NULL), fFECPayloadType(0), fFECGroupsock(NULL), fFECReadBuffer(NULL), fLastReceivedFECSSRC(0),
+    fTransportWideCCRTCPInstance(NULL), fTransportWideCCExtensionId(0), fTransportWideCCFeedbackInterval(0),
+    fTransportWideCCFeedbackGenerator(NULL), fTransportWideCCFeedbackTask(NULL), fNumTransportWideCCFeedbacksSent(0) {
+  fLastKeyFrameRequestTime.tv_sec = fLastKeyFrameRequestTime.tv_usec = 0;
   reset();
-  fReorderingBuffer = new ReorderingPacketBuffer(packetFactory);
+  fReorderingBuffer = new ReorderingPacketBuffer(env, packetFactory);
+  setPacketReadBatchSize(defaultPacketReadBatchSize);
 
   // Try to use a big receive buffer for RTP:
   increaseReceiveBufferTo(env, RTPgs->socketNum(), 50*1024);
@@ -86,9 +164,172 @@ void MultiFramedRTPSource::reset() {
 }
 
 MultiFramedRTPSource::~MultiFramedRTPSource() {
+  envir().taskScheduler().unscheduleDelayedTask(fPacketLossTimeoutTask);
+  envir().taskScheduler().unscheduleDelayedTask(fKeyFrameRequestTask);
+  enableFEC(0); // stops reading from any separate FEC groupsock
+  enableTransportWideCCFeedback(NULL, 0);
   delete fReorderingBuffer;
 }
 
+void MultiFramedRTPSource::setPacketReadBatchSize(unsigned maxPacketsPerRead) {
+  if (maxPacketsPerRead == 0) maxPacketsPerRead = 1;
+  else if (maxPacketsPerRead > MAX_PACKET_READ_BATCH_SIZE) maxPacketsPerRead = MAX_PACKET_READ_BATCH_SIZE;
+
+  fPacketReadBatchSize = maxPacketsPerRead;
+  fReorderingBuffer->setMaxNumFreePackets(maxPacketsPerRead - 1); // in addition to its 'saved' packet
+}
+
+void MultiFramedRTPSource::enableNACKs(RTCPInstance* rtcpInstance, unsigned char rtxPayloadType) {
+  fNACKRTCPInstance = rtcpInstance;
+  fRTXPayloadType = rtcpInstance == NULL ? 0 : rtxPayloadType;
+  fReorderingBuffer->trackMissingPackets() = rtcpInstance != NULL;
+}
+
+void MultiFramedRTPSource::setAdaptivePacketReorderingThresholdTime(unsigned minUSeconds, unsigned maxUSeconds) {
+  if (maxUSeconds < minUSeconds) maxUSeconds = minUSeconds;
+  fHaveAdaptiveThresholdTime = True;
+  fMinThresholdTime = minUSeconds;
+  fMaxThresholdTime = maxUSeconds;
+  fReorderingBuffer->setThresholdTime(minUSeconds); // initially
+}
+
+unsigned MultiFramedRTPSource::packetReorderingThresholdTime() const {
+  return fReorderingBuffer->thresholdTime();
+}
+
+void MultiFramedRTPSource::enableKeyFrameRequests(RTCPInstance* rtcpInstance, unsigned minUSecondsBetweenRequests) {
+  fKeyFrameRequestRTCPInstance = rtcpInstance;
+  fMinKeyFrameRequestInterval = minUSecondsBetweenRequests;
+  if (rtcpInstance == NULL) {
+    envir().taskScheduler().unscheduleDelayedTask(fKeyFrameRequestTask);
+  }
+}
+
+void MultiFramedRTPSource::requestKeyFrame() {
+  if (fKeyFrameRequestRTCPInstance == NULL || fKeyFrameRequestTask != NULL) return; // disabled, or already pending
+
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  int64_t uSecondsSinceLastRequest
+    = (int64_t)(timeNow.tv_sec - fLastKeyFrameRequestTime.tv_sec)*1000000
+    + (timeNow.tv_usec - fLastKeyFrameRequestTime.tv_usec);
+  if (uSecondsSinceLastRequest >= 0 && uSecondsSinceLastRequest < (int64_t)fMinKeyFrameRequestInterval) {
+    // We sent a request too recently; send this one later:
+    fKeyFrameRequestTask
+      = envir().taskScheduler().scheduleDelayedTask(fMinKeyFrameRequestInterval - uSecondsSinceLastRequest,
+						    keyFrameRequestHandler, this);
+    return;
+  }
+
+  sendKeyFrameRequest();
+}
+
+void MultiFramedRTPSource::sendKeyFrameRequest() {
+  fKeyFrameRequestTask = NULL;
+  if (fKeyFrameRequestRTCPInstance == NULL) return;
+
+  fKeyFrameRequestRTCPInstance->sendPLI(fLastReceivedSSRC);
+  ++fNumKeyFrameRequestsSent;
+  gettimeofday(&fLastKeyFrameRequestTime, NULL);
+}
+
+void MultiFramedRTPSource::keyFrameRequestHandler(void* clientData) {
+  ((MultiFramedRTPSource*)clientData)->sendKeyFrameRequest();
+}
+
+void MultiFramedRTPSource::enableFEC(unsigned char fecPayloadType, Groupsock* fecGroupsock) {
+  if (fFECGroupsock != NULL) {
+    envir().taskScheduler().turnOffBackgroundReadHandling(fFECGroupsock->socketNum());
+    fFECGroupsock = NULL;
+  }
+  delete[] fFECReadBuffer; fFECReadBuffer = NULL;
+  delete fFECDecoder; fFECDecoder = NULL;
+  fFECPayloadType = 0;
+  fLastReceivedFECSSRC = 0;
+  if (fecPayloadType == 0) return;
+
+  fFECDecoder = new ULPFECDecoder;
+  fFECPayloadType = fecPayloadType;
+  if (fecGroupsock != NULL) {
+    fFECGroupsock = fecGroupsock;
+    fFECReadBuffer = new unsigned char[MAX_PACKET_SIZE];
+    envir().taskScheduler().turnOnBackgroundReadHandling(fFECGroupsock->socketNum(),
+			 (TaskScheduler::BackgroundHandlerProc*)&fecNetworkReadHandler, this);
+  }
+}
+
+void MultiFramedRTPSource
+::enableTransportWideCCFeedback(RTCPInstance* rtcpInstance, u_int8_t extensionId, unsigned feedbackIntervalUSeconds) {
+  envir().taskScheduler().unscheduleDelayedTask(fTransportWideCCFeedbackTask);
+  delete fTransportWideCCFeedbackGenerator; fTransportWideCCFeedbackGenerator = NULL;
+  fTransportWideCCRTCPInstance = rtcpInstance;
+  if (rtcpInstance == NULL) return;
+
+  fTransportWideCCExtensionId = extensionId;
+  fTransportWideCCFeedbackInterval = feedbackIntervalUSeconds;
+  fTransportWideCCFeedbackGenerator = new TransportWideCCFeedbackGenerator;
+  fTransportWideCCFeedbackTask
+    = envir().taskScheduler().scheduleDelayedTask(fTransportWideCCFeedbackInterval,
+						  transportWideCCFeedbackHandler, this);
+}
+
+void MultiFramedRTPSource::noteTransportWideSeqNo(unsigned char const* headerExtension, unsigned headerExtensionSize,
+						  struct timeval const& timeReceived) {
+  // Look for our element in this (one-byte) header extension.  Each element is a byte containing a 4-bit id and
+  // (length-1), followed by its data.  (A 0 byte is padding; id 15 means 'stop'.)
+  unsigned i = 0;
+  while (i < headerExtensionSize) {
+    u_int8_t id = headerExtension[i]>>4;
+    unsigned length = (headerExtension[i]&0x0F) + 1;
+    if (id == 0) { ++i; continue; } // padding
+    if (id == 15 || i + 1 + length > headerExtensionSize) break;
+    if (id == fTransportWideCCExtensionId && length == 2) {
+      u_int16_t transportSeqNo = (headerExtension[i+1]<<8)|headerExtension[i+2];
+      fTransportWideCCFeedbackGenerator->noteIncomingPacket(transportSeqNo, timeReceived);
+      break;
+    }
+    i += 1 + length;
+  }
+}
+
+void MultiFramedRTPSource::sendTransportWideCCFeedback() {
+  // Report the packets that have arrived since the last feedback (which might need more than one feedback packet):
+  unsigned char fci[1000];
+  unsigned fciSize;
+  while ((fciSize = fTransportWideCCFeedbackGenerator->nextFeedback(fci, sizeof fci)) > 0) {
+    fTransportWideCCRTCPInstance->sendTransportWideCCFeedback(fLastReceivedSSRC, fci, fciSize);
+    ++fNumTransportWideCCFeedbacksSent;
+  }
+
+  fTransportWideCCFeedbackTask
+    = envir().taskScheduler().scheduleDelayedTask(fTransportWideCCFeedbackInterval,
+						  transportWideCCFeedbackHandler, this);
+}
+
+void MultiFramedRTPSource::transportWideCCFeedbackHandler(void* clientData) {
+  ((MultiFramedRTPSource*)clientData)->sendTransportWideCCFeedback();
+}
+
+unsigned MultiFramedRTPSource::numFECPacketsReceived() const {
+  return fFECDecoder == NULL ? 0 : fFECDecoder->numFECPacketsReceived();
+}
+
+unsigned MultiFramedRTPSource::numPacketsRecoveredByFEC() const {
+  return fFECDecoder == NULL ? 0 : fFECDecoder->numPacketsRecovered();
+}
+
+unsigned MultiFramedRTPSource::numPacketsRecovered() const {
+  return fReorderingBuffer->numPacketsRecovered();
+}
+
+unsigned MultiFramedRTPSource::numPacketsLost() const {
+  return fReorderingBuffer->numPacketsLost();
+}
+
+unsigned MultiFramedRTPSource::estimatedRetransmissionTime() const {
+  return fReorderingBuffer->estimatedRetransmissionTime();
+}
+
 Boolean MultiFramedRTPSource
 ::processSpecialHeader(BufferedPacket* /*packet*/,
 		       unsigned& resultSpecialHeaderSize) {
@@ -110,6 +351,7 @@ void MultiFramedRTPSource::doStopGettingFrames() {
     fPacketReadInProgress = NULL;
   }
   envir().taskScheduler().unscheduleDelayedTask(nextTask());
+  envir().taskScheduler().unscheduleDelayedTask(fPacketLossTimeoutTask);
   fRTPInterface.stopNetworkReading();
   fReorderingBuffer->reset();
   reset();
@@ -141,6 +383,12 @@ void MultiFramedRTPSource::doGetNextFrame1() {
 
     fNeedDelivery = False;
 
+    if (packetLossPrecededThis && !nextPacket->isFirstPacket()) {
+      // We gave up waiting for a missing packet, so our receiver won't be able to decode properly until the next key
+      // frame.  Ask for one now (if we've been set up to do so):
+      requestKeyFrame();
+    }
+
     if (nextPacket->useCount() == 0) {
       // Before using the packet, check whether it has a special header
       // that needs to be processed:
@@ -201,6 +449,12 @@ void MultiFramedRTPSource::doGetNextFrame1() {
 	// executed again without having first returned to the event loop.  Call our 'after getting' function
 	// directly, because there's no risk of a long chain of recursion (and thus stack overflow):
 	afterGetting(this);
+      } else if (fDirectDeliveryDepth + 1 < fPacketReadBatchSize) {
+	// We're reading packets in batches, so there'll often be more queued packets.  Deliver them directly
+	// too - but limit the resulting chain of recursion to the size of a batch:
+	++fDirectDeliveryDepth;
+	afterGetting(this);
+	--fDirectDeliveryDepth;
       } else {
 	// Special case: Call our 'after getting' function via the event loop.
 	nextTask() = envir().taskScheduler().scheduleDelayedTask(0,
@@ -213,10 +467,69 @@ void MultiFramedRTPSource::doGetNextFrame1() {
       fNeedDelivery = True;
     }
   }
+
+  if (fReorderingBuffer->isWaitingForMissingPacket() || fReorderingBuffer->numMissingPackets() > 0
+      || fPacketLossTimeoutTask != NULL) {
+    handlePacketLoss();
+  }
+}
+
+void MultiFramedRTPSource::handlePacketLoss() {
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+
+  // Send a NACK for any missing packets that haven't yet been NACKed (or that are due to be NACKed again):
+  if (fNACKRTCPInstance != NULL && fReorderingBuffer->numMissingPackets() > 0) {
+    u_int16_t seqNos[MAX_NUM_MISSING_PACKETS];
+    unsigned numNewlyNACKed;
+    unsigned numSeqNos = fReorderingBuffer->getPacketsToNACK(seqNos, timeNow, numNewlyNACKed);
+    if (numSeqNos > 0) {
+      fNACKRTCPInstance->sendNACK(fLastReceivedSSRC, seqNos, numSeqNos);
+      ++fNumNACKsSent;
+      fNumPacketsNACKed += numNewlyNACKed;
+    }
+  }
+
+  // Arrange to be called again when either we next need to NACK a missing packet, or we should give up waiting
+  // for a missing packet (whichever comes first):
+  envir().taskScheduler().unscheduleDelayedTask(fPacketLossTimeoutTask);
+  unsigned uSecondsToGo = ~0;
+  if (fNACKRTCPInstance != NULL) uSecondsToGo = fReorderingBuffer->uSecondsUntilNextNACK(timeNow);
+  if (fReorderingBuffer->isWaitingForMissingPacket()) {
+    if (fHaveAdaptiveThresholdTime) {
+      // Wait for (a multiple of) the current interarrival jitter, plus - if we're sending NACKs - enough time for
+      // a retransmission (allowing for one retry, which we'd send after 1.5 times the retransmission time):
+      RTPReceptionStats* stats = receptionStatsDB().lookup(fLastReceivedSSRC);
+      double jitter = stats == NULL || timestampFrequency() == 0 ? 0.0
+	: (stats->jitter()*1000000.0)/timestampFrequency(); // uSeconds
+      double thresholdTime = 4*jitter;
+      if (fNACKRTCPInstance != NULL) thresholdTime += 3*fReorderingBuffer->expectedRetransmissionTime();
+      if (thresholdTime < fMinThresholdTime) thresholdTime = fMinThresholdTime;
+      else if (thresholdTime > fMaxThresholdTime) thresholdTime = fMaxThresholdTime;
+      fReorderingBuffer->setThresholdTime((unsigned)thresholdTime);
+    }
+
+    unsigned uSecondsUntilThresholdExceeded = fReorderingBuffer->uSecondsUntilThresholdExceeded(timeNow);
+    if (uSecondsUntilThresholdExceeded < uSecondsToGo) uSecondsToGo = uSecondsUntilThresholdExceeded;
+  }
+  if (uSecondsToGo != (unsigned)(~0)) {
+    fPacketLossTimeoutTask
+      = envir().taskScheduler().scheduleDelayedTask(uSecondsToGo, packetLossTimeoutHandler, this);
+  }
+}
+
+void MultiFramedRTPSource::packetLossTimeoutHandler(void* clientData) {
+  ((MultiFramedRTPSource*)clientData)->packetLossTimeoutHandler1();
+}
+
+void MultiFramedRTPSource::packetLossTimeoutHandler1() {
+  fPacketLossTimeoutTask = NULL;
+  doGetNextFrame1(); // delivers any packet that we've now given up waiting for, then calls "handlePacketLoss()" again
 }
 
 void MultiFramedRTPSource
 ::setPacketReorderingThresholdTime(unsigned uSeconds) {
+  fHaveAdaptiveThresholdTime = False;
   fReorderingBuffer->setThresholdTime(uSeconds);
 }
 
@@ -227,6 +540,13 @@ void MultiFramedRTPSource::networkReadHandler(MultiFramedRTPSource* source, int
 }
 
 void MultiFramedRTPSource::networkReadHandler1() {
+  if (fPacketReadBatchSize > 1 && fPacketReadInProgress == NULL && !fRTPInterface.nextReadIsOverTCP()) {
+    // Read (and store) several packets at once, then deliver whatever we can:
+    readPacketBatch();
+    doGetNextFrame1();
+    return;
+  }
+
   BufferedPacket* bPacket = fPacketReadInProgress;
   if (bPacket == NULL) {
     // Normal case: Get a free BufferedPacket descriptor to hold the new network packet:
@@ -252,107 +572,265 @@ void MultiFramedRTPSource::networkReadHandler1() {
     } else {
       fPacketReadInProgress = NULL;
     }
-#ifdef TEST_LOSS
-    setPacketReorderingThresholdTime(0);
-       // don't wait for 'lost' packets to arrive out-of-order later
-    if ((our_random()%10) == 0) break; // simulate 10% packet loss
-#endif
 
-    // Check for the 12-byte RTP header:
-    if (bPacket->dataSize() < 12) break;
-    unsigned rtpHdr = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
-    Boolean rtpMarkerBit = (rtpHdr&0x00800000) != 0;
-    unsigned rtpTimestamp = ntohl(*(u_int32_t*)(bPacket->data()));ADVANCE(4);
-    unsigned rtpSSRC = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
-
-    // Check the RTP version number (it should be 2):
-    if ((rtpHdr&0xC0000000) != 0x80000000) break;
-
-    // Check the Payload Type.
-    unsigned char rtpPayloadType = (unsigned char)((rtpHdr&0x007F0000)>>16);
-    if (rtpPayloadType != rtpPayloadFormat()) {
-      if (fRTCPInstanceForMultiplexedRTCPPackets != NULL
-	  && rtpPayloadType >= 64 && rtpPayloadType <= 95) {
-	// This is a multiplexed RTCP packet, and we've been asked to deliver such packets.
-	// Do so now:
-	fRTCPInstanceForMultiplexedRTCPPackets
-	  ->injectReport(bPacket->data()-12, bPacket->dataSize()+12, fromAddress);
-      }
-      break;
+    readSuccess = storeIncomingPacket(bPacket, fromAddress);
+  } while (0);
+  if (!readSuccess) fReorderingBuffer->freePacket(bPacket);
+
+  doGetNextFrame1();
+  // If we didn't get proper data this time, we'll get another chance
+}
+
+void MultiFramedRTPSource::readPacketBatch() {
+  BufferedPacket* packets[MAX_PACKET_READ_BATCH_SIZE];
+  struct sockaddr_in fromAddresses[MAX_PACKET_READ_BATCH_SIZE];
+
+  unsigned i;
+  for (i = 0; i < fPacketReadBatchSize; ++i) packets[i] = fReorderingBuffer->getFreePacket(this);
+
+  unsigned numPacketsRead
+    = BufferedPacket::fillInDataBatch(fRTPInterface, packets, fPacketReadBatchSize, fromAddresses);
+
+  // Store the packets that we read (and perform sanity checks on their RTP headers), and free the rest:
+  for (i = 0; i < fPacketReadBatchSize; ++i) {
+    if (i >= numPacketsRead || !storeIncomingPacket(packets[i], fromAddresses[i])) {
+      fReorderingBuffer->freePacket(packets[i]);
     }
+  }
+}
+
+void MultiFramedRTPSource::fecNetworkReadHandler(MultiFramedRTPSource* source, int /*mask*/) {
+  source->fecNetworkReadHandler1();
+}
+
+void MultiFramedRTPSource::fecNetworkReadHandler1() {
+  unsigned bytesRead;
+  struct sockaddr_in fromAddress;
+  if (!fFECGroupsock->handleRead(fFECReadBuffer, MAX_PACKET_SIZE, bytesRead, fromAddress) || bytesRead == 0) return;
+
+  handleFECPacket(fFECReadBuffer, bytesRead, fromAddress);
+  doGetNextFrame1();
+}
+
+void MultiFramedRTPSource::handleFECPacket(unsigned char const* packet, unsigned packetSize,
+					   struct sockaddr_in& fromAddress) {
+  if (packetSize < 12) return;
+
+  // (A FEC packet has its own SSRC, which needn't be the same as that of the media packets.)
+  u_int32_t const fecSSRC = (packet[8]<<24) | (packet[9]<<16) | (packet[10]<<8) | packet[11];
+  if (fecSSRC != fLastReceivedFECSSRC) {
+    // The SSRC of incoming FEC packets has changed (e.g., because their sender restarted), so any that we're holding
+    // no longer apply:
+    if (fLastReceivedFECSSRC != 0) fFECDecoder->reset();
+    fLastReceivedFECSSRC = fecSSRC;
+  }
+  if (fLastReceivedSSRC == 0) return; // we haven't yet received any media packets (so couldn't recover any)
+
+  // Use this FEC packet to recover any missing packet(s) that we can:
+  fFECDecoder->addFECPacket(packet, packetSize);
+  storeRecoveredPackets(fromAddress);
+}
 
-    // Skip over any CSRC identifiers in the header:
-    unsigned cc = (rtpHdr>>24)&0x0F;
-    if (bPacket->dataSize() < cc*4) break;
-    ADVANCE(cc*4);
-
-    // Check for (& ignore) any RTP header extension
-    if (rtpHdr&0x10000000) {
-      if (bPacket->dataSize() < 4) break;
-      unsigned extHdr = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
-      unsigned remExtSize = 4*(extHdr&0xFFFF);
-      if (bPacket->dataSize() < remExtSize) break;
-      ADVANCE(remExtSize);
+void MultiFramedRTPSource::storeRecoveredPackets(struct sockaddr_in& fromAddress) {
+  unsigned char* packet;
+  unsigned packetSize;
+  while ((packet = fFECDecoder->nextRecoveredPacket(packetSize)) != NULL) {
+    BufferedPacket* bPacket = fReorderingBuffer->getFreePacket(this);
+    if (!bPacket->fillInData(packet, packetSize) || !storeIncomingPacket(bPacket, fromAddress, True)) {
+      fReorderingBuffer->freePacket(bPacket);
     }
+  }
+}
+
+Boolean MultiFramedRTPSource::storeIncomingPacket(BufferedPacket* bPacket, struct sockaddr_in& fromAddress,
+						  Boolean isRecoveredPacket) {
+#ifdef TEST_LOSS
+  setPacketReorderingThresholdTime(0);
+     // don't wait for 'lost' packets to arrive out-of-order later
+  if ((our_random()%10) == 0) return False; // simulate 10% packet loss
+#endif
 
-    // Discard any padding bytes:
-    if (rtpHdr&0x20000000) {
-      if (bPacket->dataSize() == 0) break;
-      unsigned numPaddingBytes
-	= (unsigned)(bPacket->data())[bPacket->dataSize()-1];
-      if (bPacket->dataSize() < numPaddingBytes) break;
-      bPacket->removePadding(numPaddingBytes);
+  // Remember where the complete packet is (in case we need to give it to our FEC decoder):
+  unsigned char const* const packetStart = bPacket->data();
+  unsigned const packetSize = bPacket->dataSize();
+
+  // Check for the 12-byte RTP header:
+  if (bPacket->dataSize() < 12) return False;
+  unsigned rtpHdr = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
+  Boolean rtpMarkerBit = (rtpHdr&0x00800000) != 0;
+  unsigned rtpTimestamp = ntohl(*(u_int32_t*)(bPacket->data()));ADVANCE(4);
+  unsigned rtpSSRC = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
+
+  // Check the RTP version number (it should be 2):
+  if ((rtpHdr&0xC0000000) != 0x80000000) return False;
+
+  // Check the Payload Type.
+  unsigned char rtpPayloadType = (unsigned char)((rtpHdr&0x007F0000)>>16);
+  Boolean isRTXPacket = fRTXPayloadType != 0 && rtpPayloadType == fRTXPayloadType;
+      // a retransmitted packet (in the "rtx" payload format)
+  if (fFECDecoder != NULL && !isRecoveredPacket && rtpPayloadType == fFECPayloadType && fFECGroupsock == NULL) {
+    // This is a FEC packet:
+    handleFECPacket(packetStart, packetSize, fromAddress);
+    return False;
+  }
+  if (rtpPayloadType != rtpPayloadFormat() && !isRTXPacket) {
+    if (fRTCPInstanceForMultiplexedRTCPPackets != NULL
+	&& rtpPayloadType >= 64 && rtpPayloadType <= 95) {
+      // This is a multiplexed RTCP packet, and we've been asked to deliver such packets.
+      // Do so now:
+      fRTCPInstanceForMultiplexedRTCPPackets
+	->injectReport(bPacket->data()-12, bPacket->dataSize()+12, fromAddress);
     }
+    return False;
+  }
 
-    // The rest of the packet is the usable data.  Record and save it:
-    if (rtpSSRC != fLastReceivedSSRC) {
-      // The SSRC of incoming packets has changed.  Unfortunately we don't yet handle streams that contain multiple SSRCs,
-      // but we can handle a single-SSRC stream where the SSRC changes occasionally:
-      fLastReceivedSSRC = rtpSSRC;
-      fReorderingBuffer->resetHaveSeenFirstPacket();
+  // Skip over any CSRC identifiers in the header:
+  unsigned cc = (rtpHdr>>24)&0x0F;
+  if (bPacket->dataSize() < cc*4) return False;
+  ADVANCE(cc*4);
+
+  // Check for any RTP header extension.  (We use only a 'transport-wide sequence number' - if we've been asked to -
+  // and ignore anything else.)
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  if (rtpHdr&0x10000000) {
+    if (bPacket->dataSize() < 4) return False;
+    unsigned extHdr = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
+    unsigned remExtSize = 4*(extHdr&0xFFFF);
+    if (bPacket->dataSize() < remExtSize) return False;
+    if (fTransportWideCCFeedbackGenerator != NULL && (extHdr>>16) == 0xBEDE && !isRTXPacket && !isRecoveredPacket) {
+      // (A retransmitted or recovered packet has the original packet's transport-wide sequence number.)
+      noteTransportWideSeqNo(bPacket->data(), remExtSize, timeNow);
     }
-    unsigned short rtpSeqNo = (unsigned short)(rtpHdr&0xFFFF);
-    Boolean usableInJitterCalculation
-      = packetIsUsableInJitterCalculation((bPacket->data()),
-						  bPacket->dataSize());
-    struct timeval presentationTime; // computed by:
-    Boolean hasBeenSyncedUsingRTCP; // computed by:
-    receptionStatsDB()
-      .noteIncomingPacket(rtpSSRC, rtpSeqNo, rtpTimestamp,
-			  timestampFrequency(),
-			  usableInJitterCalculation, presentationTime,
-			  hasBeenSyncedUsingRTCP, bPacket->dataSize());
-
-    // Fill in the rest of the packet descriptor, and store it:
-    struct timeval timeNow;
-    gettimeofday(&timeNow, NULL);
-    bPacket->assignMiscParams(rtpSeqNo, rtpTimestamp, presentationTime,
-			      hasBeenSyncedUsingRTCP, rtpMarkerBit,
-			      timeNow);
-    if (!fReorderingBuffer->storePacket(bPacket)) break;
+    ADVANCE(remExtSize);
+  }
 
-    readSuccess = True;
-  } while (0);
-  if (!readSuccess) fReorderingBuffer->freePacket(bPacket);
+  // Discard any padding bytes:
+  if (rtpHdr&0x20000000) {
+    if (bPacket->dataSize() == 0) return False;
+    unsigned numPaddingBytes
+      = (unsigned)(bPacket->data())[bPacket->dataSize()-1];
+    if (bPacket->dataSize() < numPaddingBytes) return False;
+    bPacket->removePadding(numPaddingBytes);
+  }
 
-  doGetNextFrame1();
-  // If we didn't get proper data this time, we'll get another chance
+  unsigned short rtpSeqNo = (unsigned short)(rtpHdr&0xFFFF);
+  if (isRTXPacket) {
+    // The payload begins with the original packet's sequence number.  Treat the rest of the packet as if it were
+    // the original packet (from the original SSRC):
+    if (bPacket->dataSize() < 2 || fLastReceivedSSRC == 0) return False;
+    rtpSeqNo = (bPacket->data()[0]<<8)|bPacket->data()[1]; ADVANCE(2);
+    rtpSSRC = fLastReceivedSSRC;
+  }
+
+  // The rest of the packet is the usable data.  Record and save it:
+  if (rtpSSRC != fLastReceivedSSRC) {
+    // The SSRC of incoming packets has changed.  Unfortunately we don't yet handle streams that contain multiple SSRCs,
+    // but we can handle a single-SSRC stream where the SSRC changes occasionally:
+    fLastReceivedSSRC = rtpSSRC;
+    fReorderingBuffer->resetHaveSeenFirstPacket();
+    if (fFECDecoder != NULL) fFECDecoder->reset(); // its packets are from the old SSRC
+  }
+  if (fFECDecoder != NULL && !isRTXPacket && !isRecoveredPacket) {
+    // Give our FEC decoder the complete packet (now that we know it's from our media stream's current SSRC):
+    fFECDecoder->addMediaPacket(packetStart, packetSize);
+  }
+  Boolean usableInJitterCalculation
+    = packetIsUsableInJitterCalculation((bPacket->data()),
+					bPacket->dataSize())
+    && !isRTXPacket && !isRecoveredPacket && !fReorderingBuffer->wasNACKed(rtpSeqNo);
+      // (A retransmitted (or recovered) packet's late arrival shouldn't count as jitter.)
+  struct timeval presentationTime; // computed by:
+  Boolean hasBeenSyncedUsingRTCP; // computed by:
+  receptionStatsDB()
+    .noteIncomingPacket(rtpSSRC, rtpSeqNo, rtpTimestamp,
+			timestampFrequency(),
+			usableInJitterCalculation, presentationTime,
+			hasBeenSyncedUsingRTCP, bPacket->dataSize());
+
+  // Fill in the rest of the packet descriptor, and store it:
+  bPacket->assignMiscParams(rtpSeqNo, rtpTimestamp, presentationTime,
+			    hasBeenSyncedUsingRTCP, rtpMarkerBit,
+			    timeNow);
+  Boolean result = fReorderingBuffer->storePacket(bPacket);
+
+  // If this packet allowed our FEC decoder to recover any packets (protected by FEC packets that arrived earlier),
+  // store these too:
+  if (fFECDecoder != NULL && !isRecoveredPacket) storeRecoveredPackets(fromAddress);
+  return result;
 }
 
 
 ////////// BufferedPacket and BufferedPacketFactory implementation /////
 
-#define MAX_PACKET_SIZE 65536
-
 BufferedPacket::BufferedPacket()
-  : fPacketSize(MAX_PACKET_SIZE),
-    fBuf(new unsigned char[MAX_PACKET_SIZE]),
-    fNextPacket(NULL) {
+  : fPacketSize(0), fBuf(NULL), fHead(0), fTail(0), // our buffer gets allocated when we first need it
+    fPool(NULL), fNextPacket(NULL) {
 }
 
 BufferedPacket::~BufferedPacket() {
   delete fNextPacket;
-  delete[] fBuf;
+  if (fPool != NULL) {
+    releaseBuffer();
+  } else {
+    delete[] fBuf;
+  }
+}
+
+void BufferedPacket::releaseBuffer() {
+  if (fPool == NULL) return; // we keep our own buffer
+
+  fPool->releaseBuffer(fBuf, fPacketSize);
+  fBuf = NULL; fPacketSize = 0;
+  fHead = fTail = 0;
+}
+
+Boolean BufferedPacket::resizeBuffer(unsigned minSize) {
+  unsigned char* newBuf;
+  unsigned newSize;
+  if (fPool != NULL) {
+    newBuf = fPool->allocateBuffer(minSize, newSize);
+    if (newBuf == NULL) return False;
+  } else {
+    if (minSize > MAX_PACKET_SIZE) return False;
+    newSize = MAX_PACKET_SIZE;
+    newBuf = new unsigned char[newSize];
+  }
+
+  // Move any existing data into the new buffer:
+  if (fBuf != NULL) {
+    memmove(newBuf, fBuf, fTail < newSize ? fTail : newSize);
+    if (fPool != NULL) {
+      fPool->releaseBuffer(fBuf, fPacketSize);
+    } else {
+      delete[] fBuf;
+    }
+  }
+
+  fBuf = newBuf;
+  fPacketSize = newSize;
+  if (fTail > fPacketSize) fTail = fPacketSize;
+  if (fHead > fTail) fHead = fTail;
+  return True;
+}
+
+Boolean BufferedPacket::prepareBufferForNewData() {
+  // We make sure that we have a (full size) buffer *before* calling "reset()", because subclasses (e.g.,
+  // "JPEGBufferedPacket") use our buffer when they reset "fHead" and "fTail" (e.g., to leave space for a header):
+  fHead = fTail = 0; // we don't keep any old data
+  if (fPacketSize < MAX_PACKET_SIZE && !resizeBuffer(MAX_PACKET_SIZE)) return False;
+
+  reset();
+  return True;
+}
+
+void BufferedPacket::shrinkBuffer() {
+  if (fPool == NULL) return; // we keep our own buffer
+
+  // Move our data into a smaller buffer (freeing our large one for the next read), but keeping enough space after the
+  // data for anything that our subclass might append to it:
+  unsigned const minSize = fTail + tailroom();
+  if (PacketBufferPool::bufferSizeFor(minSize) < fPacketSize) resizeBuffer(minSize);
 }
 
 void BufferedPacket::reset() {
@@ -361,6 +839,10 @@ void BufferedPacket::reset() {
   fIsFirstPacket = False; // by default
 }
 
+unsigned BufferedPacket::tailroom() const {
+  return 0; // by default
+}
+
 // The following function has been deprecated:
 unsigned BufferedPacket
 ::nextEnclosedFrameSize(unsigned char*& /*framePtr*/, unsigned dataSize) {
@@ -387,10 +869,14 @@ void BufferedPacket
 
 Boolean BufferedPacket::fillInData(RTPInterface& rtpInterface, struct sockaddr_in& fromAddress,
 				   Boolean& packetReadWasIncomplete) {
-  if (!packetReadWasIncomplete) reset();
+  if (!packetReadWasIncomplete) {
+    // Make sure that our buffer can hold any packet:
+    if (!prepareBufferForNewData()) return False;
+  }
 
-  unsigned const maxBytesToRead = bytesAvailable();
-  if (maxBytesToRead == 0) return False; // exceeded buffer size when reading over TCP
+  unsigned maxBytesToRead = bytesAvailable();
+  if (maxBytesToRead <= tailroom()) return False; // exceeded buffer size when reading over TCP
+  maxBytesToRead -= tailroom();
 
   unsigned numBytesRead;
   int tcpSocketNum; // not used
@@ -402,9 +888,54 @@ Boolean BufferedPacket::fillInData(RTPInterface& rtpInterface, struct sockaddr_i
     return False;
   }
   fTail += numBytesRead;
+
+  if (!packetReadWasIncomplete) shrinkBuffer();
+  return True;
+}
+
+Boolean BufferedPacket::fillInData(unsigned char const* packet, unsigned packetSize) {
+  if (!prepareBufferForNewData()) return False;
+  if (bytesAvailable() < packetSize + tailroom() && !resizeBuffer(fTail + packetSize + tailroom())) return False;
+
+  // Note: "reset()" might have moved "fTail" forward (e.g., to leave space for a header), so we copy the packet there:
+  memmove(&fBuf[fTail], packet, packetSize);
+  fTail += packetSize;
+
+  shrinkBuffer();
   return True;
 }
 
+unsigned BufferedPacket::fillInDataBatch(RTPInterface& rtpInterface, BufferedPacket** packets, unsigned numPackets,
+					 struct sockaddr_in* fromAddresses) {
+  if (numPackets > MAX_PACKET_READ_BATCH_SIZE) numPackets = MAX_PACKET_READ_BATCH_SIZE;
+
+  unsigned char* buffers[MAX_PACKET_READ_BATCH_SIZE];
+  unsigned bufferSizes[MAX_PACKET_READ_BATCH_SIZE];
+  unsigned bytesRead[MAX_PACKET_READ_BATCH_SIZE];
+  unsigned i;
+  for (i = 0; i < numPackets; ++i) {
+    BufferedPacket* packet = packets[i];
+    if (!packet->prepareBufferForNewData() || packet->bytesAvailable() <= packet->tailroom()) {
+      numPackets = i; // we ran out of memory(!)
+      break;
+    }
+    buffers[i] = &packet->fBuf[packet->fTail];
+    bufferSizes[i] = packet->bytesAvailable() - packet->tailroom();
+  }
+
+  unsigned numPacketsRead;
+  if (!rtpInterface.handleReadBatch(buffers, bufferSizes, numPackets, bytesRead, fromAddresses, numPacketsRead)) {
+    return 0;
+  }
+
+  for (i = 0; i < numPacketsRead; ++i) {
+    BufferedPacket* packet = packets[i];
+    packet->fTail += bytesRead[i];
+    packet->shrinkBuffer();
+  }
+  return numPacketsRead;
+}
+
 void BufferedPacket
 ::assignMiscParams(unsigned short rtpSeqNo, unsigned rtpTimestamp,
 		   struct timeval presentationTime,
@@ -429,6 +960,7 @@ void BufferedPacket::removePadding(unsigned numBytes) {
 }
 
 void BufferedPacket::appendData(unsigned char* newData, unsigned numBytes) {
+  if (numBytes > fPacketSize-fTail) resizeBuffer(fTail + numBytes); // if we can
   if (numBytes > fPacketSize-fTail) numBytes = fPacketSize - fTail;
   memmove(&fBuf[fTail], newData, numBytes);
   fTail += numBytes;
@@ -486,37 +1018,65 @@ BufferedPacket* BufferedPacketFactory
 ////////// ReorderingPacketBuffer implementation //////////
 
 ReorderingPacketBuffer
-::ReorderingPacketBuffer(BufferedPacketFactory* packetFactory)
-  : fThresholdTime(100000) /* default reordering threshold: 100 ms */,
-    fHaveSeenFirstPacket(False), fHeadPacket(NULL), fTailPacket(NULL), fSavedPacket(NULL), fSavedPacketFree(True) {
+::ReorderingPacketBuffer(UsageEnvironment& env, BufferedPacketFactory* packetFactory)
+  : fPacketBufferPool(PacketBufferPool::ourPool(env)), fThresholdTime(100000) /* default reordering threshold: 100 ms */,
+    fHaveSeenFirstPacket(False), fHeadPacket(NULL), fTailPacket(NULL), fSavedPacket(NULL), fSavedPacketFree(True),
+    fFreePackets(NULL), fNumFreePackets(0), fMaxNumFreePackets(0),
+    fTrackMissingPackets(False), fNumMissingPackets(0), fEstimatedRetransmissionTime(0),
+    fNumPacketsRecovered(0), fNumPacketsLost(0) {
   fPacketFactory = (packetFactory == NULL)
     ? (new BufferedPacketFactory)
     : packetFactory;
+  fPacketBufferPool->incrementReferenceCount();
 }
 
 ReorderingPacketBuffer::~ReorderingPacketBuffer() {
   reset();
   delete fPacketFactory;
+  fPacketBufferPool->decrementReferenceCount(); // after our packets have released their buffers
 }
 
 void ReorderingPacketBuffer::reset() {
   if (fSavedPacketFree) delete fSavedPacket; // because fSavedPacket is not in the list
   delete fHeadPacket; // will also delete fSavedPacket if it's in the list
+  delete fFreePackets;
   resetHaveSeenFirstPacket();
-  fHeadPacket = fTailPacket = fSavedPacket = NULL;
+  fHeadPacket = fTailPacket = fSavedPacket = fFreePackets = NULL;
+  fNumFreePackets = 0;
+}
+
+void ReorderingPacketBuffer::setMaxNumFreePackets(unsigned maxNumFreePackets) {
+  fMaxNumFreePackets = maxNumFreePackets;
+
+  while (fNumFreePackets > fMaxNumFreePackets) {
+    BufferedPacket* packet = fFreePackets;
+    fFreePackets = packet->nextPacket();
+    packet->nextPacket() = NULL;
+    delete packet;
+    --fNumFreePackets;
+  }
 }
 
 BufferedPacket* ReorderingPacketBuffer::getFreePacket(MultiFramedRTPSource* ourSource) {
   if (fSavedPacket == NULL) { // we're being called for the first time
     fSavedPacket = fPacketFactory->createNewPacket(ourSource);
+    fSavedPacket->setPacketBufferPool(fPacketBufferPool);
     fSavedPacketFree = True;
   }
 
   if (fSavedPacketFree == True) {
     fSavedPacketFree = False;
     return fSavedPacket;
+  } else if (fFreePackets != NULL) {
+    BufferedPacket* packet = fFreePackets;
+    fFreePackets = packet->nextPacket();
+    packet->nextPacket() = NULL;
+    --fNumFreePackets;
+    return packet;
   } else {
-    return fPacketFactory->createNewPacket(ourSource);
+    BufferedPacket* packet = fPacketFactory->createNewPacket(ourSource);
+    packet->setPacketBufferPool(fPacketBufferPool);
+    return packet;
   }
 }
 
@@ -535,6 +1095,7 @@ Boolean ReorderingPacketBuffer::storePacket(BufferedPacket* bPacket) {
 
   if (fTailPacket == NULL) {
     // Common case: There are no packets in the queue; this will be the first one:
+    if (fTrackMissingPackets && rtpSeqNo != fNextExpectedSeqNo) noteMissingPackets(fNextExpectedSeqNo, rtpSeqNo);
     bPacket->nextPacket() = NULL;
     fHeadPacket = fTailPacket = bPacket;
     return True;
@@ -542,6 +1103,9 @@ Boolean ReorderingPacketBuffer::storePacket(BufferedPacket* bPacket) {
 
   if (seqNumLT(fTailPacket->rtpSeqNo(), rtpSeqNo)) {
     // The next-most common case: There are packets already in the queue; this packet arrived in order => put it at the tail:
+    if (fTrackMissingPackets && rtpSeqNo != (u_int16_t)(fTailPacket->rtpSeqNo()+1)) {
+      noteMissingPackets(fTailPacket->rtpSeqNo()+1, rtpSeqNo);
+    }
     bPacket->nextPacket() = NULL;
     fTailPacket->nextPacket() = bPacket;
     fTailPacket = bPacket;
@@ -574,6 +1138,7 @@ Boolean ReorderingPacketBuffer::storePacket(BufferedPacket* bPacket) {
   } else {
     beforePtr->nextPacket() = bPacket;
   }
+  if (fNumMissingPackets > 0) noteArrivingPacket(rtpSeqNo);
 
   return True;
 }
@@ -620,8 +1185,10 @@ BufferedPacket* ReorderingPacketBuffer
     timeThresholdHasBeenExceeded = uSecondsSinceReceived > fThresholdTime;
   }
   if (timeThresholdHasBeenExceeded) {
+    fNumPacketsLost += (u_int16_t)(fHeadPacket->rtpSeqNo() - fNextExpectedSeqNo);
     fNextExpectedSeqNo = fHeadPacket->rtpSeqNo();
         // we've given up on earlier packets now
+    if (fNumMissingPackets > 0) forgetMissingPacketsBefore(fNextExpectedSeqNo);
     packetLossPreceded = True;
     return fHeadPacket;
   }
@@ -629,3 +1196,118 @@ BufferedPacket* ReorderingPacketBuffer
   // Otherwise, keep waiting for our desired packet to arrive:
   return NULL;
 }
+
+unsigned ReorderingPacketBuffer::uSecondsUntilThresholdExceeded(struct timeval const& timeNow) const {
+  // ASSERT: isWaitingForMissingPacket()
+  int uSecondsSinceReceived
+    = (timeNow.tv_sec - fHeadPacket->timeReceived().tv_sec)*1000000
+    + (timeNow.tv_usec - fHeadPacket->timeReceived().tv_usec);
+  if (uSecondsSinceReceived < 0) uSecondsSinceReceived = 0; // sanity check
+  if ((unsigned)uSecondsSinceReceived > fThresholdTime) return 0;
+  return fThresholdTime - uSecondsSinceReceived + 1; // because "getNextCompletedPacket()" waits until it's *exceeded*
+}
+
+Boolean ReorderingPacketBuffer::wasNACKed(u_int16_t seqNo) const {
+  for (unsigned i = 0; i < fNumMissingPackets; ++i) {
+    if (fMissingPackets[i].seqNo == seqNo) return fMissingPackets[i].numNACKs > 0;
+  }
+  return False;
+}
+
+unsigned ReorderingPacketBuffer
+::getPacketsToNACK(u_int16_t* seqNos, struct timeval const& timeNow, unsigned& numNewlyNACKed) {
+  unsigned const retryInterval = nackRetryInterval();
+  unsigned numSeqNos = 0;
+  numNewlyNACKed = 0;
+
+  for (unsigned i = 0; i < fNumMissingPackets; ++i) {
+    MissingPacket& mp = fMissingPackets[i];
+    if (mp.numNACKs > 0) {
+      if (mp.numNACKs >= MAX_NACKS_PER_PACKET) continue;
+      int uSecondsSinceLastNACK
+	= (timeNow.tv_sec - mp.lastNACKTime.tv_sec)*1000000 + (timeNow.tv_usec - mp.lastNACKTime.tv_usec);
+      if (uSecondsSinceLastNACK >= 0 && (unsigned)uSecondsSinceLastNACK < retryInterval) continue; // not yet
+    } else {
+      mp.firstNACKTime = timeNow;
+      ++numNewlyNACKed;
+    }
+    ++mp.numNACKs;
+    mp.lastNACKTime = timeNow;
+    seqNos[numSeqNos++] = mp.seqNo;
+  }
+
+  return numSeqNos;
+}
+
+unsigned ReorderingPacketBuffer::uSecondsUntilNextNACK(struct timeval const& timeNow) const {
+  unsigned const retryInterval = nackRetryInterval();
+  unsigned result = ~0;
+
+  for (unsigned i = 0; i < fNumMissingPackets; ++i) {
+    MissingPacket const& mp = fMissingPackets[i];
+    if (mp.numNACKs == 0) return 0; // (shouldn't happen, because we NACK new missing packets immediately)
+    if (mp.numNACKs >= MAX_NACKS_PER_PACKET) continue;
+
+    int uSecondsSinceLastNACK
+      = (timeNow.tv_sec - mp.lastNACKTime.tv_sec)*1000000 + (timeNow.tv_usec - mp.lastNACKTime.tv_usec);
+    if (uSecondsSinceLastNACK < 0) uSecondsSinceLastNACK = 0; // sanity check
+    unsigned uSecondsToGo = (unsigned)uSecondsSinceLastNACK >= retryInterval ? 0 : retryInterval - uSecondsSinceLastNACK;
+    if (uSecondsToGo < result) result = uSecondsToGo;
+  }
+
+  return result;
+}
+
+void ReorderingPacketBuffer::noteMissingPackets(u_int16_t fromSeqNo, u_int16_t toSeqNo) {
+  for (u_int16_t seqNo = fromSeqNo; seqNo != toSeqNo && fNumMissingPackets < MAX_NUM_MISSING_PACKETS; ++seqNo) {
+    MissingPacket& mp = fMissingPackets[fNumMissingPackets++];
+    mp.seqNo = seqNo;
+    mp.numNACKs = 0;
+  }
+}
+
+void ReorderingPacketBuffer::noteArrivingPacket(u_int16_t seqNo) {
+  for (unsigned i = 0; i < fNumMissingPackets; ++i) {
+    MissingPacket& mp = fMissingPackets[i];
+    if (mp.seqNo != seqNo) continue;
+
+    if (mp.numNACKs > 0) {
+      // A NACKed packet has arrived.  Use the time that this took to update our estimate of the retransmission time:
+      struct timeval timeNow;
+      gettimeofday(&timeNow, NULL);
+      int uSecondsSinceFirstNACK
+	= (timeNow.tv_sec - mp.firstNACKTime.tv_sec)*1000000 + (timeNow.tv_usec - mp.firstNACKTime.tv_usec);
+      if (uSecondsSinceFirstNACK >= 0) {
+	if (fEstimatedRetransmissionTime == 0) {
+	  fEstimatedRetransmissionTime = uSecondsSinceFirstNACK;
+	} else {
+	  // (a moving average, with gain 1/8:)
+	  fEstimatedRetransmissionTime
+	    = (int)fEstimatedRetransmissionTime + (uSecondsSinceFirstNACK - (int)fEstimatedRetransmissionTime)/8;
+	}
+      }
+      ++fNumPacketsRecovered;
+    }
+
+    // Remove this entry:
+    --fNumMissingPackets;
+    for (unsigned j = i; j < fNumMissingPackets; ++j) fMissingPackets[j] = fMissingPackets[j+1];
+    return;
+  }
+}
+
+void ReorderingPacketBuffer::forgetMissingPacketsBefore(u_int16_t seqNo) {
+  unsigned i;
+  for (i = 0; i < fNumMissingPackets; ++i) {
+    if (!seqNumLT(fMissingPackets[i].seqNo, seqNo)) break;
+  }
+  fNumMissingPackets -= i;
+  for (unsigned j = 0; j < fNumMissingPackets; ++j) fMissingPackets[j] = fMissingPackets[j+i];
+}
+
+unsigned ReorderingPacketBuffer::nackRetryInterval() const {
+  if (fEstimatedRetransmissionTime == 0) return INITIAL_NACK_RETRY_INTERVAL;
+
+  unsigned interval = fEstimatedRetransmissionTime + fEstimatedRetransmissionTime/2;
+  return interval < MIN_NACK_RETRY_INTERVAL ? MIN_NACK_RETRY_INTERVAL : interval;
+}
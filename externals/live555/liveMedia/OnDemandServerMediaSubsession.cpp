@@ -30,7 +30,8 @@ OnDemandServerMediaSubsession
   : ServerMediaSubsession(env),
     fSDPLines(NULL), fReuseFirstSource(reuseFirstSource),
     fMultiplexRTCPWithRTP(multiplexRTCPWithRTP), fLastStreamToken(NULL),
-    fAppHandlerTask(NULL), fAppHandlerClientData(NULL) {
+    fAppHandlerTask(NULL), fAppHandlerClientData(NULL),
+    fGOPCacheFrameRingSize(0), fGOPCacheBurstSpeedup(0), fReplicator(NULL), fReplicatorInputBitrate(0) {
   fDestinationsHashTable = HashTable::create(ONE_WORD_HASH_KEYS);
   if (fMultiplexRTCPWithRTP) {
     fInitialPortNum = initialPortNum;
@@ -53,18 +54,38 @@ OnDemandServerMediaSubsession::~OnDemandServerMediaSubsession() {
     delete destinations;
   }
   delete fDestinationsHashTable;
+
+  closeReplicatorIfUnused(); // in case our last client's stream has already been deleted
 }
 
 char const*
 OnDemandServerMediaSubsession::sdpLines() {
   if (fSDPLines == NULL) {
+    // If our environment has a "SDPCache", and we have a valid entry in it, then we use it, rather than probing our source:
+    SDPCache* sdpCache = SDPCache::ourCache(envir());
+    char* cacheKey = NULL; char* cacheVersion = NULL;
+    if (sdpCache != NULL && sdpCacheKey(cacheKey, cacheVersion)) {
+      SDPCacheEntry const* entry = sdpCache->lookup(cacheKey, cacheVersion);
+      if (entry != NULL) {
+	setSDPLines(entry->mediaType(), entry->rtpPayloadType(), entry->estBitrate(),
+		    entry->rtpmapLine(), entry->auxSDPLine());
+	delete[] cacheKey; delete[] cacheVersion;
+	return fSDPLines;
+      }
+    } else {
+      sdpCache = NULL; // we're not cacheable
+    }
+
     // We need to construct a set of SDP lines that describe this
     // subsession (as a unicast stream).  To do so, we first create
     // dummy (unused) source and "RTPSink" objects,
     // whose parameters we use for the SDP lines:
     unsigned estBitrate;
     FramedSource* inputSource = createNewStreamSource(0, estBitrate);
-    if (inputSource == NULL) return NULL; // file not found
+    if (inputSource == NULL) { // file not found
+      delete[] cacheKey; delete[] cacheVersion;
+      return NULL;
+    }
 
     struct in_addr dummyAddr;
     dummyAddr.s_addr = 0;
@@ -73,10 +94,11 @@ OnDemandServerMediaSubsession::sdpLines() {
     RTPSink* dummyRTPSink = createNewRTPSink(dummyGroupsock, rtpPayloadType, inputSource);
     if (dummyRTPSink != NULL && dummyRTPSink->estimatedBitrate() > 0) estBitrate = dummyRTPSink->estimatedBitrate();
 
-    setSDPLinesFromRTPSink(dummyRTPSink, inputSource, estBitrate);
+    setSDPLinesFromRTPSink(dummyRTPSink, inputSource, estBitrate, sdpCache, cacheKey, cacheVersion);
     Medium::close(dummyRTPSink);
     delete dummyGroupsock;
     closeStreamSource(inputSource);
+    delete[] cacheKey; delete[] cacheVersion;
   }
 
   return fSDPLines;
@@ -100,7 +122,7 @@ void OnDemandServerMediaSubsession
   struct in_addr destinationAddr; destinationAddr.s_addr = destinationAddress;
   isMulticast = False;
 
-  if (fLastStreamToken != NULL && fReuseFirstSource) {
+  if (fLastStreamToken != NULL && fReuseFirstSource && fGOPCacheFrameRingSize == 0) {
     // Special case: Rather than creating a new 'StreamState',
     // we reuse the one that we've already created:
     serverRTPPort = ((StreamState*)fLastStreamToken)->serverRTPPort();
@@ -108,10 +130,11 @@ void OnDemandServerMediaSubsession
     ++((StreamState*)fLastStreamToken)->referenceCount();
     streamToken = fLastStreamToken;
   } else {
-    // Normal case: Create a new media source:
+    // Normal case: Create a new media source (or, if we have a GOP cache, a new replica of our one media source):
     unsigned streamBitrate;
-    FramedSource* mediaSource
-      = createNewStreamSource(clientSessionId, streamBitrate);
+    FramedSource* mediaSource = fGOPCacheFrameRingSize > 0
+      ? createNewReplicaSource(clientSessionId, streamBitrate)
+      : createNewStreamSource(clientSessionId, streamBitrate);
 
     // Create 'groupsock' and 'sink' objects for the destination,
     // using previously unused server port numbers:
@@ -337,6 +360,7 @@ void OnDemandServerMediaSubsession::deleteStream(unsigned clientSessionId,
     if (streamState->referenceCount() == 0) {
       delete streamState;
       streamToken = NULL;
+      closeReplicatorIfUnused();
     }
   }
 
@@ -378,6 +402,11 @@ void OnDemandServerMediaSubsession::closeStreamSource(FramedSource *inputSource)
   Medium::close(inputSource);
 }
 
+FramedSource* OnDemandServerMediaSubsession::createNewStreamSourceFromReplica(FramedSource* replica) {
+  // Default implementation; may be redefined by subclasses:
+  return replica;
+}
+
 Groupsock* OnDemandServerMediaSubsession
 ::createGroupsock(struct in_addr const& addr, Port port) {
   // Default implementation; may be redefined by subclasses:
@@ -406,19 +435,66 @@ void OnDemandServerMediaSubsession
   }
 }
 
+Boolean OnDemandServerMediaSubsession::enableGOPCache(unsigned frameRingSize, unsigned burstSpeedup) {
+  if (!fReuseFirstSource || frameRingSize == 0) return False;
+
+  fGOPCacheFrameRingSize = frameRingSize;
+  fGOPCacheBurstSpeedup = burstSpeedup;
+  return True;
+}
+
+FramedSource* OnDemandServerMediaSubsession
+::createNewReplicaSource(unsigned clientSessionId, unsigned& estBitrate) {
+  if (fReplicator == NULL) {
+    // This is the first client's stream.  Create our (one) stream source, and a replicator for it:
+    FramedSource* inputSource = createNewStreamSource(clientSessionId, fReplicatorInputBitrate);
+    if (inputSource != NULL) {
+      fReplicator = StreamReplicator::createNew(envir(), inputSource, False, fGOPCacheFrameRingSize);
+      if (!fReplicator->enableGOPCache(fGOPCacheBurstSpeedup)) {
+	envir() << "OnDemandServerMediaSubsession::enableGOPCache(): Warning: The stream source is not a H.264 or H.265 "
+	  "framer, so new clients will not start at a key frame\n";
+      }
+    }
+  }
+
+  estBitrate = fReplicatorInputBitrate;
+  return fReplicator == NULL ? NULL : createNewStreamSourceFromReplica(fReplicator->createStreamReplica());
+}
+
+void OnDemandServerMediaSubsession::closeReplicatorIfUnused() {
+  if (fReplicator == NULL || fReplicator->numReplicas() > 0) return;
+
+  // Close our stream source the same way that we'd close any other stream source (and so that the next client starts afresh):
+  FramedSource* inputSource = fReplicator->inputSource();
+  fReplicator->detachInputSource();
+  Medium::close(fReplicator); fReplicator = NULL;
+  closeStreamSource(inputSource);
+}
+
 void OnDemandServerMediaSubsession
-::setSDPLinesFromRTPSink(RTPSink* rtpSink, FramedSource* inputSource, unsigned estBitrate) {
+::setSDPLinesFromRTPSink(RTPSink* rtpSink, FramedSource* inputSource, unsigned estBitrate,
+			 SDPCache* sdpCache, char const* cacheKey, char const* cacheVersion) {
   if (rtpSink == NULL) return;
 
-  char const* mediaType = rtpSink->sdpMediaType();
-  unsigned char rtpPayloadType = rtpSink->rtpPayloadType();
-  AddressString ipAddressStr(fServerAddressForSDP);
   char* rtpmapLine = rtpSink->rtpmapLine();
-  char const* rtcpmuxLine = fMultiplexRTCPWithRTP ? "a=rtcp-mux\r\n" : "";
-  char const* rangeLine = rangeSDPLine();
   char const* auxSDPLine = getAuxSDPLine(rtpSink, inputSource);
   if (auxSDPLine == NULL) auxSDPLine = "";
 
+  setSDPLines(rtpSink->sdpMediaType(), rtpSink->rtpPayloadType(), estBitrate, rtpmapLine, auxSDPLine);
+  if (sdpCache != NULL) {
+    sdpCache->add(cacheKey, cacheVersion,
+		  rtpSink->sdpMediaType(), rtpSink->rtpPayloadType(), estBitrate, rtpmapLine, auxSDPLine);
+  }
+  delete[] rtpmapLine;
+}
+
+void OnDemandServerMediaSubsession
+::setSDPLines(char const* mediaType, unsigned char rtpPayloadType, unsigned estBitrate,
+	      char const* rtpmapLine, char const* auxSDPLine) {
+  AddressString ipAddressStr(fServerAddressForSDP);
+  char const* rtcpmuxLine = fMultiplexRTCPWithRTP ? "a=rtcp-mux\r\n" : "";
+  char const* rangeLine = rangeSDPLine();
+
   char const* const sdpFmt =
     "m=%s %u RTP/AVP %d\r\n"
     "c=IN IP4 %s\r\n"
@@ -449,12 +525,16 @@ void OnDemandServerMediaSubsession
 	  rangeLine, // a=range:... (if present)
 	  auxSDPLine, // optional extra SDP line
 	  trackId()); // a=control:<track-id>
-  delete[] (char*)rangeLine; delete[] rtpmapLine;
+  delete[] (char*)rangeLine;
 
   fSDPLines = strDup(sdpLines);
   delete[] sdpLines;
 }
 
+Boolean OnDemandServerMediaSubsession::sdpCacheKey(char*& /*key*/, char*& /*version*/) {
+  return False; // by default, our SDP description isn't cached
+}
+
 
 ////////// StreamState implementation //////////
 
@@ -0,0 +1,82 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A minimal, portable wrapper around an operating system thread
+// Implementation
+
+#include "OurThread.hh"
+#include "NetCommon.h"
+#if defined(__WIN32__) || defined(_WIN32)
+#include <process.h>
+#endif
+
+OurThread* OurThread::createNew(ThreadFunc* threadFunc, void* clientData) {
+  if (threadFunc == NULL) return NULL;
+
+  OurThread* thread = new OurThread(threadFunc, clientData);
+  if (!thread->start()) {
+    delete thread;
+    return NULL;
+  }
+
+  return thread;
+}
+
+OurThread::OurThread(ThreadFunc* threadFunc, void* clientData)
+  : fThreadFunc(threadFunc), fClientData(clientData), fIsRunning(False) {
+#if defined(__WIN32__) || defined(_WIN32)
+  fThreadHandle = NULL;
+#endif
+}
+
+OurThread::~OurThread() {
+  if (!fIsRunning) return;
+
+  // Wait for the thread to finish:
+#if defined(__WIN32__) || defined(_WIN32)
+  WaitForSingleObject((HANDLE)fThreadHandle, INFINITE);
+  CloseHandle((HANDLE)fThreadHandle);
+#else
+  pthread_join(fThread, NULL);
+#endif
+}
+
+Boolean OurThread::start() {
+#if defined(__WIN32__) || defined(_WIN32)
+  // Use "_beginthreadex()" rather than "CreateThread()", so that the C runtime library is initialized for the thread:
+  fThreadHandle = (void*)_beginthreadex(NULL, 0, threadMain, this, 0, NULL);
+  fIsRunning = fThreadHandle != NULL;
+#else
+  fIsRunning = pthread_create(&fThread, NULL, threadMain, this) == 0;
+#endif
+
+  return fIsRunning;
+}
+
+#if defined(__WIN32__) || defined(_WIN32)
+unsigned __stdcall OurThread::threadMain(void* ourThread) {
+  OurThread* thread = (OurThread*)ourThread;
+  (*thread->fThreadFunc)(thread->fClientData);
+  return 0;
+}
+#else
+void* OurThread::threadMain(void* ourThread) {
+  OurThread* thread = (OurThread*)ourThread;
+  (*thread->fThreadFunc)(thread->fClientData);
+  return NULL;
+}
+#endif
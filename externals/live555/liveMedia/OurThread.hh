@@ -0,0 +1,63 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A minimal, portable wrapper around an operating system thread
+// C++ header
+
+#ifndef _OUR_THREAD_HH
+#define _OUR_THREAD_HH
+
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+// Note: The rest of the library is not thread-safe.  A thread created using this class must use only objects
+// (and a "UsageEnvironment") of its own - communicating with other threads only via "TaskScheduler::postTask()".
+
+class OurThread {
+public:
+  typedef void (ThreadFunc)(void* clientData);
+  static OurThread* createNew(ThreadFunc* threadFunc, void* clientData);
+      // Starts a new thread that calls "threadFunc(clientData)".  Returns NULL if the thread could not be started.
+
+  virtual ~OurThread(); // waits for the thread to finish (i.e., for "threadFunc()" to return)
+
+private:
+  OurThread(ThreadFunc* threadFunc, void* clientData); // called only by "createNew()"
+  Boolean start();
+
+#if defined(__WIN32__) || defined(_WIN32)
+  static unsigned __stdcall threadMain(void* ourThread);
+#else
+  static void* threadMain(void* ourThread);
+#endif
+
+private:
+  ThreadFunc* fThreadFunc;
+  void* fClientData;
+  Boolean fIsRunning;
+#if defined(__WIN32__) || defined(_WIN32)
+  void* fThreadHandle; // a Windows "HANDLE"
+#else
+  pthread_t fThread;
+#endif
+};
+
+#endif
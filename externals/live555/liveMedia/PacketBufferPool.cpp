@@ -0,0 +1,157 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A per-environment pool of packet buffers, used by the "BufferedPacket"s of all "MultiFramedRTPSource"s
+// Implementation
+
+#include "PacketBufferPool.hh"
+
+static unsigned const sizeClassSizes[PACKET_BUFFER_POOL_NUM_SIZE_CLASSES] = { 256, 2048, 16384, 65536 };
+
+unsigned PacketBufferPool::slabSize = 0;
+
+PacketBufferPool* PacketBufferPool::ourPool(UsageEnvironment& env) {
+  _Tables* ourTables = _Tables::getOurTables(env);
+  if (ourTables->packetBufferPool == NULL) {
+    ourTables->packetBufferPool = new PacketBufferPool(env);
+  }
+  return (PacketBufferPool*)(ourTables->packetBufferPool);
+}
+
+void PacketBufferPool::decrementReferenceCount() {
+  if (fReferenceCount > 0) --fReferenceCount;
+  if (fReferenceCount == 0) {
+    _Tables* ourTables = _Tables::getOurTables(fEnv);
+    ourTables->packetBufferPool = NULL;
+    ourTables->reclaimIfPossible();
+
+    delete this;
+  }
+}
+
+PacketBufferPool::PacketBufferPool(UsageEnvironment& env)
+  : fEnv(env), fReferenceCount(0),
+    fSlab(NULL), fSlabSize(slabSize), fNumSlabBytesUsed(0),
+    fNumBytesInUse(0), fMaxNumBytesInUse(0) {
+  if (fSlabSize > 0) fSlab = new unsigned char[fSlabSize];
+
+  for (unsigned i = 0; i < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES; ++i) {
+    SizeClass& sc = fSizeClasses[i];
+    sc.freeList = NULL;
+    sc.numInUse = sc.maxNumInUse = sc.numFree = sc.numFromSlab = 0;
+  }
+}
+
+PacketBufferPool::~PacketBufferPool() {
+  // Delete each free buffer that came from the heap (rather than from our slab):
+  for (unsigned i = 0; i < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES; ++i) {
+    unsigned char* buffer = fSizeClasses[i].freeList;
+    while (buffer != NULL) {
+      unsigned char* next = *(unsigned char**)buffer;
+      if (buffer < fSlab || buffer >= fSlab + fSlabSize) delete[] buffer;
+      buffer = next;
+    }
+  }
+
+  delete[] fSlab;
+}
+
+unsigned char* PacketBufferPool::allocateBuffer(unsigned minSize, unsigned& resultBufferSize) {
+  // Find the smallest size class that will hold "minSize" bytes:
+  unsigned i;
+  for (i = 0; i < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES; ++i) {
+    if (sizeClassSizes[i] >= minSize) break;
+  }
+  if (i == PACKET_BUFFER_POOL_NUM_SIZE_CLASSES) {
+    resultBufferSize = 0;
+    return NULL;
+  }
+  SizeClass& sc = fSizeClasses[i];
+  resultBufferSize = sizeClassSizes[i];
+
+  unsigned char* buffer;
+  if (sc.freeList != NULL) {
+    // Common case: Reuse a free buffer:
+    buffer = sc.freeList;
+    sc.freeList = *(unsigned char**)buffer;
+    --sc.numFree;
+  } else if (fNumSlabBytesUsed + resultBufferSize <= fSlabSize) {
+    // Carve a new buffer from our slab:
+    buffer = &fSlab[fNumSlabBytesUsed];
+    fNumSlabBytesUsed += resultBufferSize;
+    ++sc.numFromSlab;
+  } else {
+    buffer = new unsigned char[resultBufferSize];
+  }
+  // Note that we never delete a (heap-allocated) buffer until the pool itself is deleted, so the number of buffers
+  // that we hold is never more than the 'high-water mark' of the number in use.
+
+  if (++sc.numInUse > sc.maxNumInUse) sc.maxNumInUse = sc.numInUse;
+  fNumBytesInUse += resultBufferSize;
+  if (fNumBytesInUse > fMaxNumBytesInUse) fMaxNumBytesInUse = fNumBytesInUse;
+
+  return buffer;
+}
+
+void PacketBufferPool::releaseBuffer(unsigned char* buffer, unsigned bufferSize) {
+  if (buffer == NULL) return;
+
+  unsigned i;
+  for (i = 0; i < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES; ++i) {
+    if (sizeClassSizes[i] == bufferSize) break;
+  }
+  if (i == PACKET_BUFFER_POOL_NUM_SIZE_CLASSES) return; // shouldn't happen
+  SizeClass& sc = fSizeClasses[i];
+
+  *(unsigned char**)buffer = sc.freeList;
+  sc.freeList = buffer;
+  ++sc.numFree;
+
+  --sc.numInUse;
+  fNumBytesInUse -= bufferSize;
+}
+
+unsigned PacketBufferPool::maxBufferSize() {
+  return sizeClassSizes[PACKET_BUFFER_POOL_NUM_SIZE_CLASSES-1];
+}
+
+unsigned PacketBufferPool::bufferSizeFor(unsigned minSize) {
+  for (unsigned i = 0; i < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES; ++i) {
+    if (sizeClassSizes[i] >= minSize) return sizeClassSizes[i];
+  }
+  return 0;
+}
+
+unsigned PacketBufferPool::bufferSizeForSizeClass(unsigned sizeClass) {
+  return sizeClass < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES ? sizeClassSizes[sizeClass] : 0;
+}
+
+unsigned PacketBufferPool::numBuffersInUse(unsigned sizeClass) const {
+  return sizeClass < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES ? fSizeClasses[sizeClass].numInUse : 0;
+}
+
+unsigned PacketBufferPool::maxNumBuffersInUse(unsigned sizeClass) const {
+  return sizeClass < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES ? fSizeClasses[sizeClass].maxNumInUse : 0;
+}
+
+unsigned PacketBufferPool::numFreeBuffers(unsigned sizeClass) const {
+  return sizeClass < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES ? fSizeClasses[sizeClass].numFree : 0;
+}
+
+unsigned PacketBufferPool::numBuffersFromSlab(unsigned sizeClass) const {
+  return sizeClass < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES ? fSizeClasses[sizeClass].numFromSlab : 0;
+}
@@ -136,7 +136,8 @@ RTCPInstance::RTCPInstance(UsageEnvironment& env, Groupsock* RTCPgs,
     fSRHandlerTask(NULL), fSRHandlerClientData(NULL),
     fRRHandlerTask(NULL), fRRHandlerClientData(NULL),
     fSpecificRRHandlerTable(NULL),
-    fAppHandlerTask(NULL), fAppHandlerClientData(NULL) {
+    fAppHandlerTask(NULL), fAppHandlerClientData(NULL),
+    fLastFIRSenderSSRC(0), fLastFIRSeqNo(-1) {
 #ifdef DEBUG
   fprintf(stderr, "RTCPInstance[%p]::RTCPInstance()\n", this);
 #endif
@@ -366,6 +367,80 @@ void RTCPInstance::sendAppPacket(u_int8_t subtype, char const* name,
   sendBuiltPacket();
 }
 
+void RTCPInstance::sendNACK(u_int32_t mediaSourceSSRC, u_int16_t const* seqNos, unsigned numSeqNos) {
+  if (numSeqNos == 0) return;
+
+  // Leave room for the first 4 bytes: V,P,FMT,PT,length (which we fill in once we know the length):
+  unsigned headerPosition = fOutBuf->curPacketSize();
+  fOutBuf->skipBytes(4);
+
+  // Set up the next 8 bytes: our SSRC, then the media source's SSRC:
+  fOutBuf->enqueueWord(fSource != NULL ? fSource->SSRC() : fSink != NULL ? fSink->SSRC() : 0);
+  fOutBuf->enqueueWord(mediaSourceSSRC);
+
+  // Then, the 'FCI' entries.  Each is a 16-bit "PID" (a lost packet's sequence number), and a 16-bit "BLP" (a bitmask
+  // of which of the following 16 packets were also lost):
+  unsigned numFCIs = 0;
+  unsigned i = 0;
+  while (i < numSeqNos && fOutBuf->totalBytesAvailable() >= 4) {
+    u_int16_t pid = seqNos[i++];
+    u_int16_t blp = 0;
+    while (i < numSeqNos) {
+      u_int16_t diff = seqNos[i] - pid;
+      if (diff == 0 || diff > 16) break;
+      blp |= 1<<(diff-1);
+      ++i;
+    }
+    fOutBuf->enqueueWord((pid<<16)|blp);
+    ++numFCIs;
+  }
+
+  u_int32_t rtcpHdr = 0x80000000; // version 2, no padding
+  rtcpHdr |= 1<<24; // FMT 1: Generic NACK
+  rtcpHdr |= (RTCP_PT_RTPFB<<16);
+  rtcpHdr |= (2 + numFCIs)&0xFFFF; // length
+  fOutBuf->insertWord(rtcpHdr, headerPosition);
+
+  // Finally, send the packet:
+  sendBuiltPacket();
+}
+
+void RTCPInstance::sendPLI(u_int32_t mediaSourceSSRC) {
+  u_int32_t rtcpHdr = 0x80000000; // version 2, no padding
+  rtcpHdr |= 1<<24; // FMT 1: Picture Loss Indication
+  rtcpHdr |= (RTCP_PT_PSFB<<16);
+  rtcpHdr |= 2; // length (there's no 'FCI')
+  fOutBuf->enqueueWord(rtcpHdr);
+
+  // Then, our SSRC, and the media source's SSRC:
+  fOutBuf->enqueueWord(fSource != NULL ? fSource->SSRC() : fSink != NULL ? fSink->SSRC() : 0);
+  fOutBuf->enqueueWord(mediaSourceSSRC);
+
+  // Finally, send the packet:
+  sendBuiltPacket();
+}
+
+void RTCPInstance
+::sendTransportWideCCFeedback(u_int32_t mediaSourceSSRC, unsigned char const* fci, unsigned fciSize) {
+  u_int32_t rtcpHdr = 0x80000000; // version 2, no padding
+  rtcpHdr |= 15<<24; // FMT 15: Transport-wide congestion control
+  rtcpHdr |= (RTCP_PT_RTPFB<<16);
+  rtcpHdr |= (2 + (fciSize+3)/4)&0xFFFF; // length
+  fOutBuf->enqueueWord(rtcpHdr);
+
+  // Then, our SSRC, and the media source's SSRC:
+  fOutBuf->enqueueWord(fSource != NULL ? fSource->SSRC() : fSink != NULL ? fSink->SSRC() : 0);
+  fOutBuf->enqueueWord(mediaSourceSSRC);
+
+  // Then, the 'FCI' (padded, if necessary, to a multiple of 4 bytes):
+  fOutBuf->enqueue(fci, fciSize);
+  u_int8_t const paddingByte = 0x00;
+  for (unsigned i = fciSize; i%4 != 0; ++i) fOutBuf->enqueue(&paddingByte, 1);
+
+  // Finally, send the packet:
+  sendBuiltPacket();
+}
+
 void RTCPInstance::setStreamSocket(int sockNum,
 				   unsigned char streamChannelId) {
   // Turn off background read handling:
@@ -511,11 +586,14 @@ void RTCPInstance
     // Check the RTCP packet for validity:
     // It must at least contain a header (4 bytes), and this header
     // must be version=2, with no padding bit, and a payload type of
-    // SR (200), RR (201), or APP (204):
+    // SR (200), RR (201), APP (204), or - because feedback packets may be sent
+    // on their own ('reduced-size RTCP'; RFC 5506) - RTPFB (205) or PSFB (206):
     if (packetSize < 4) break;
     unsigned rtcpHdr = ntohl(*(u_int32_t*)pkt);
     if ((rtcpHdr & 0xE0FE0000) != (0x80000000 | (RTCP_PT_SR<<16)) &&
-	(rtcpHdr & 0xE0FF0000) != (0x80000000 | (RTCP_PT_APP<<16))) {
+	(rtcpHdr & 0xE0FF0000) != (0x80000000 | (RTCP_PT_APP<<16)) &&
+	(rtcpHdr & 0xE0FF0000) != (0x80000000 | (RTCP_PT_RTPFB<<16)) &&
+	(rtcpHdr & 0xE0FF0000) != (0x80000000 | (RTCP_PT_PSFB<<16))) {
 #ifdef DEBUG
       fprintf(stderr, "rejected bad RTCP packet: header 0x%08x\n", rtcpHdr);
 #endif
@@ -705,15 +783,44 @@ void RTCPInstance
 	  break;
 	}
         case RTCP_PT_RTPFB: {
+	  u_int8_t& fmt = rc; // In feedback packets, the "rc" field gets used as "FMT"
+#ifdef DEBUG
+	  fprintf(stderr, "RTPFB (FMT %d)\n", fmt);
+#endif
+	  if (length < 4) break;
+	  length -= 4;
+	  u_int32_t mediaSourceSSRC = ntohl(*(u_int32_t*)pkt); ADVANCE(4);
+
+	  if (fmt == 1/*Generic NACK*/ && fSink != NULL && mediaSourceSSRC == fSink->SSRC()) {
+	    // Each 'FCI' entry is a 16-bit "PID" (the sequence number of a lost packet), followed by a 16-bit "BLP"
+	    // (a bitmask of lost packets among the following 16).  Ask our sink to retransmit each of these:
+	    while (length >= 4) {
+	      u_int16_t pid = (pkt[0]<<8)|pkt[1];
+	      u_int16_t blp = (pkt[2]<<8)|pkt[3];
+	      ADVANCE(4); length -= 4;
 #ifdef DEBUG
-	  fprintf(stderr, "RTPFB(unhandled)\n");
+	      fprintf(stderr, "\tGeneric NACK: PID %d, BLP 0x%04x\n", pid, blp);
 #endif
+	      fSink->retransmitPacket(pid);
+	      for (unsigned i = 0; i < 16; ++i) {
+		if ((blp&(1<<i)) != 0) fSink->retransmitPacket((u_int16_t)(pid+i+1));
+	      }
+	    }
+	  }
+	  if (fmt == 15/*Transport-wide congestion control*/ && fSink != NULL && mediaSourceSSRC == fSink->SSRC()) {
+	    // The 'FCI' reports which of the packets that our sink sent have arrived, and when.  Let our sink use it:
+#ifdef DEBUG
+	    fprintf(stderr, "\tTransport-wide CC feedback (%d bytes)\n", length);
+#endif
+	    fSink->handleTransportWideCCFeedback(pkt, length);
+	  }
 	  subPacketOK = True;
 	  break;
 	}
         case RTCP_PT_PSFB: {
+	  u_int8_t& fmt = rc; // In feedback packets, the "rc" field gets used as "FMT"
 #ifdef DEBUG
-	  fprintf(stderr, "PSFB(unhandled)\n");
+	  fprintf(stderr, "PSFB (FMT %d)\n", fmt);
 	  // Temporary code to show "Receiver Estimated Maximum Bitrate" (REMB) feedback reports:
 	  //#####
 	  if (length >= 12 && pkt[4] == 'R' && pkt[5] == 'E' && pkt[6] == 'M' && pkt[7] == 'B') {
@@ -727,6 +834,33 @@ void RTCPInstance
 	    fprintf(stderr, "\tReceiver Estimated Max Bitrate (REMB): %g bps\n", remb);
 	  }
 #endif
+	  if (length < 4 || fSink == NULL) { subPacketOK = True; break; }
+	  u_int32_t mediaSourceSSRC = ntohl(*(u_int32_t*)pkt);
+
+	  if (fmt == 1/*Picture Loss Indication*/) {
+	    if (mediaSourceSSRC == fSink->SSRC()) {
+#ifdef DEBUG
+	      fprintf(stderr, "\tPicture Loss Indication\n");
+#endif
+	      fSink->handleKeyFrameRequest();
+	    }
+	  } else if (fmt == 4/*Full Intra Request*/) {
+	    // (RFC 5104) Each 'FCI' entry is the SSRC of the media sender being asked for a key frame, an 8-bit
+	    // command sequence number, and 24 reserved bits.  A receiver repeats a request (with the same
+	    // sequence number) until it sees a key frame, so we act only on requests that we haven't already seen:
+	    for (unsigned i = 4; i + 8 <= length; i += 8) {
+	      u_int32_t firSSRC = ntohl(*(u_int32_t*)&pkt[i]);
+	      u_int8_t firSeqNo = pkt[i+4];
+	      if (firSSRC != fSink->SSRC()) continue;
+#ifdef DEBUG
+	      fprintf(stderr, "\tFull Intra Request: seq nr %d\n", firSeqNo);
+#endif
+	      if (reportSenderSSRC == fLastFIRSenderSSRC && (int)firSeqNo == fLastFIRSeqNo) continue; // a repeat
+	      fLastFIRSenderSSRC = reportSenderSSRC;
+	      fLastFIRSeqNo = firSeqNo;
+	      fSink->handleKeyFrameRequest();
+	    }
+	  }
 	  subPacketOK = True;
 	  break;
 	}
@@ -23,6 +23,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "RTPInterface.hh"
 #include <GroupsockHelper.hh>
 #include <stdio.h>
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <sys/uio.h>
+#endif
 
 ////////// Helper Functions - Definition //////////
 
@@ -45,11 +48,67 @@ static HashTable* socketHashTable(UsageEnvironment& env, Boolean createIfNotPres
   return (HashTable*)(ourTables->socketTable);
 }
 
+// Writing RTP-over-TCP is never blocking.  Instead, data that can't be written immediately is queued, as a list of
+// "TCPOutputChunk"s, in the socket's "SocketDescriptor", and written later, when the socket becomes writable.
+
+class TCPOutputChunk {
+public:
+  TCPOutputChunk(u_int8_t const* const* buffers, unsigned const* bufferSizes, unsigned numBuffers,
+		 unsigned numBytesAlreadySent);
+  virtual ~TCPOutputChunk();
+
+  unsigned numBytesRemaining() const { return fSize - fNumBytesSent; }
+
+public:
+  TCPOutputChunk* fNext;
+  u_int8_t* fData;
+  unsigned fSize, fNumBytesSent;
+};
+
+#define MAX_TCP_OUTPUT_CHUNKS_PER_WRITE 32
+
+static int writeBuffers(int socketNum, u_int8_t const* const* buffers, unsigned const* bufferSizes, unsigned numBuffers) {
+  // Writes several buffers, using a single system call:
+#if defined(__WIN32__) || defined(_WIN32)
+  WSABUF bufs[MAX_TCP_OUTPUT_CHUNKS_PER_WRITE];
+  if (numBuffers > MAX_TCP_OUTPUT_CHUNKS_PER_WRITE) numBuffers = MAX_TCP_OUTPUT_CHUNKS_PER_WRITE;
+  for (unsigned i = 0; i < numBuffers; ++i) {
+    bufs[i].buf = (char*)buffers[i];
+    bufs[i].len = bufferSizes[i];
+  }
+  DWORD numBytesSent;
+  if (WSASend(socketNum, bufs, numBuffers, &numBytesSent, 0, NULL, NULL) != 0) return -1;
+  return (int)numBytesSent;
+#else
+  struct iovec iov[MAX_TCP_OUTPUT_CHUNKS_PER_WRITE];
+  if (numBuffers > MAX_TCP_OUTPUT_CHUNKS_PER_WRITE) numBuffers = MAX_TCP_OUTPUT_CHUNKS_PER_WRITE;
+  for (unsigned i = 0; i < numBuffers; ++i) {
+    iov[i].iov_base = (void*)buffers[i];
+    iov[i].iov_len = bufferSizes[i];
+  }
+  return writev(socketNum, iov, numBuffers);
+#endif
+}
+
 class SocketDescriptor {
 public:
   SocketDescriptor(UsageEnvironment& env, int socketNum);
   virtual ~SocketDescriptor();
 
+  enum OutputResult { OUTPUT_OK/*sent or queued*/, OUTPUT_DROPPED, OUTPUT_FAILED };
+  OutputResult output(u_int8_t const* const* buffers, unsigned const* bufferSizes, unsigned numBuffers,
+		      int streamChannelId, Boolean beginsKeyFrame);
+      // Outputs the concatenation of "buffers" (at most MAX_TCP_OUTPUT_CHUNKS_PER_WRITE of them).
+      // "streamChannelId" < 0 means that the data is not a RTP/RTCP packet (e.g., it's a RTSP response), and so
+      // must never be dropped.  (If there's no room to queue it, the connection is closed instead.)
+  void setOutputQueueParameters(unsigned maxQueueSize, TCPOutputOverflowPolicy overflowPolicy) {
+    fMaxOutputQueueSize = maxQueueSize;
+    fOutputOverflowPolicy = overflowPolicy;
+  }
+  unsigned outputQueueSize() const { return fOutputQueueSize; }
+  unsigned numPacketsDropped() const { return fNumPacketsDropped; }
+  void discardOutput();
+
   void registerRTPInterface(unsigned char streamChannelId,
 			    RTPInterface* rtpInterface);
   RTPInterface* lookupRTPInterface(unsigned char streamChannelId);
@@ -64,6 +123,14 @@ private:
   static void tcpReadHandler(SocketDescriptor*, int mask);
   Boolean tcpReadHandler1(int mask);
 
+  Boolean writeQueuedData(); // returns False iff there was an error writing the socket
+  void setSocketHandling();
+  Boolean isDroppingChannel(u_int8_t streamChannelId) const {
+    return (fChannelsBeingDropped[streamChannelId>>5]&(1<<(streamChannelId&0x1F))) != 0;
+  }
+  void setDroppingChannel(u_int8_t streamChannelId, Boolean isDropping);
+  static void outputOverflowDisconnect(SocketDescriptor* socketDescriptor);
+
 private:
   UsageEnvironment& fEnv;
   int fOurSocketNum;
@@ -73,6 +140,16 @@ private:
   u_int8_t fStreamChannelId, fSizeByte1;
   Boolean fReadErrorOccurred, fDeleteMyselfNext, fAreInReadHandlerLoop;
   enum { AWAITING_DOLLAR, AWAITING_STREAM_CHANNEL_ID, AWAITING_SIZE1, AWAITING_SIZE2, AWAITING_PACKET_DATA } fTCPReadingState;
+
+  // Output:
+  TCPOutputChunk* fOutputQueueHead;
+  TCPOutputChunk* fOutputQueueTail;
+  unsigned fOutputQueueSize, fMaxOutputQueueSize;
+  TCPOutputOverflowPolicy fOutputOverflowPolicy;
+  u_int32_t fChannelsBeingDropped[256/32]; // a bitmap
+  unsigned fNumPacketsDropped;
+  Boolean fOutputHasFailed, fDeleteMyselfWhenOutputDrained;
+  TaskToken fDisconnectTask;
 };
 
 static SocketDescriptor* lookupSocketDescriptor(UsageEnvironment& env, int sockNum, Boolean createIfNotFound = True) {
@@ -208,18 +285,61 @@ void RTPInterface::clearServerRequestAlternativeByteHandler(UsageEnvironment& en
   setServerRequestAlternativeByteHandler(env, socketNum, NULL, NULL);
 }
 
-Boolean RTPInterface::sendPacket(unsigned char* packet, unsigned packetSize) {
+unsigned RTPInterface::defaultMaxTCPOutputQueueSize = 1000000;
+TCPOutputOverflowPolicy RTPInterface::defaultTCPOutputOverflowPolicy = TCP_OUTPUT_DROP_UNTIL_KEY_FRAME;
+
+void RTPInterface::setTCPOutputQueueParameters(UsageEnvironment& env, int socketNum,
+					       unsigned maxQueueSize, TCPOutputOverflowPolicy overflowPolicy) {
+  SocketDescriptor* socketDescriptor = lookupSocketDescriptor(env, socketNum, False);
+
+  if (socketDescriptor != NULL) socketDescriptor->setOutputQueueParameters(maxQueueSize, overflowPolicy);
+}
+
+unsigned RTPInterface::numBytesQueuedForTCPOutput(UsageEnvironment& env, int socketNum) {
+  SocketDescriptor* socketDescriptor = lookupSocketDescriptor(env, socketNum, False);
+
+  return socketDescriptor == NULL ? 0 : socketDescriptor->outputQueueSize();
+}
+
+unsigned RTPInterface::numPacketsDroppedForTCPOutput(UsageEnvironment& env, int socketNum) {
+  SocketDescriptor* socketDescriptor = lookupSocketDescriptor(env, socketNum, False);
+
+  return socketDescriptor == NULL ? 0 : socketDescriptor->numPacketsDropped();
+}
+
+void RTPInterface::discardQueuedTCPOutput(UsageEnvironment& env, int socketNum) {
+  SocketDescriptor* socketDescriptor = lookupSocketDescriptor(env, socketNum, False);
+
+  if (socketDescriptor != NULL) socketDescriptor->discardOutput(); // this also deletes "socketDescriptor"
+}
+
+int RTPInterface::sendDataOverTCPSocket(UsageEnvironment& env, int socketNum, u_int8_t const* data, unsigned dataSize) {
+  SocketDescriptor* socketDescriptor = lookupSocketDescriptor(env, socketNum, False);
+  if (socketDescriptor == NULL) {
+    // Normal case: The socket isn't being used for RTP-over-TCP, so just write the data:
+    return send(socketNum, (char const*)data, dataSize, 0/*flags*/);
+  }
+
+  return socketDescriptor->output(&data, &dataSize, 1, -1, True) == SocketDescriptor::OUTPUT_OK ? (int)dataSize : -1;
+}
+
+Boolean RTPInterface::sendPacket(unsigned char* packet, unsigned packetSize, Boolean packetBeginsKeyFrame) {
+  return sendPacket(packet, packetSize, NULL, 0, packetBeginsKeyFrame);
+}
+
+Boolean RTPInterface::sendPacket(unsigned char* header, unsigned headerSize,
+				 unsigned char const* payload, unsigned payloadSize, Boolean packetBeginsKeyFrame) {
   Boolean success = True; // we'll return False instead if any of the sends fail
 
   // Normal case: Send as a UDP packet:
-  if (!fGS->output(envir(), packet, packetSize)) success = False;
+  if (!fGS->output(envir(), header, headerSize, payload, payloadSize)) success = False;
 
   // Also, send over each of our TCP sockets:
   tcpStreamRecord* nextStream;
   for (tcpStreamRecord* stream = fTCPStreams; stream != NULL; stream = nextStream) {
     nextStream = stream->fNext; // Set this now, in case the following deletes "stream":
-    if (!sendRTPorRTCPPacketOverTCP(packet, packetSize,
-				    stream->fStreamSocketNum, stream->fStreamChannelId)) {
+    if (!sendRTPorRTCPPacketOverTCP(header, headerSize, payload, payloadSize,
+				    stream->fStreamSocketNum, stream->fStreamChannelId, packetBeginsKeyFrame)) {
       success = False;
     }
   }
@@ -295,6 +415,24 @@ Boolean RTPInterface::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
   return readSuccess;
 }
 
+Boolean RTPInterface::handleReadBatch(unsigned char** buffers, unsigned const* bufferMaxSizes, unsigned numBuffers,
+				      unsigned* bytesRead, struct sockaddr_in* fromAddresses, unsigned& numPacketsRead) {
+  numPacketsRead = 0;
+  if (fGS == NULL || nextReadIsOverTCP()) return False;
+
+  if (!fGS->handleReadBatch(buffers, bufferMaxSizes, numBuffers, bytesRead, fromAddresses, numPacketsRead)) {
+    return False;
+  }
+
+  if (fAuxReadHandlerFunc != NULL) {
+    // Also pass the newly-read packets' data to our auxilliary handler:
+    for (unsigned i = 0; i < numPacketsRead; ++i) {
+      (*fAuxReadHandlerFunc)(fAuxReadHandlerClientData, buffers[i], bytesRead[i]);
+    }
+  }
+  return True;
+}
+
 void RTPInterface::stopNetworkReading() {
   // Normal case
   if (fGS != NULL) envir().taskScheduler().turnOffBackgroundReadHandling(fGS->socketNum());
@@ -309,96 +447,97 @@ void RTPInterface::stopNetworkReading() {
 ////////// Helper Functions - Implementation /////////
 
 Boolean RTPInterface::sendRTPorRTCPPacketOverTCP(u_int8_t* packet, unsigned packetSize,
-						 int socketNum, unsigned char streamChannelId) {
+						 u_int8_t const* payload, unsigned payloadSize,
+						 int socketNum, unsigned char streamChannelId,
+						 Boolean packetBeginsKeyFrame) {
+  // (The packet's data is "packet", followed by "payload" (if any).)
 #ifdef DEBUG_SEND
   fprintf(stderr, "sendRTPorRTCPPacketOverTCP: %d bytes over channel %d (socket %d)\n",
-	  packetSize, streamChannelId, socketNum); fflush(stderr);
+	  packetSize + payloadSize, streamChannelId, socketNum); fflush(stderr);
 #endif
   // Send a RTP/RTCP packet over TCP, using the encoding defined in RFC 2326, section 10.12:
   //     $<streamChannelId><packetSize><packet>
-  // (If the initial "send()" of '$<streamChannelId><packetSize>' succeeds, then we force
-  // the subsequent "send()" for the <packet> data to succeed, even if we have to do so with
-  // a blocking "send()".)
-  do {
-    u_int8_t framingHeader[4];
-    framingHeader[0] = '$';
-    framingHeader[1] = streamChannelId;
-    framingHeader[2] = (u_int8_t) ((packetSize&0xFF00)>>8);
-    framingHeader[3] = (u_int8_t) (packetSize&0xFF);
-    if (!sendDataOverTCP(socketNum, framingHeader, 4, False)) break;
-
-    if (!sendDataOverTCP(socketNum, packet, packetSize, True)) break;
+  // (The framing header and the packet are written together, with a single system call.  If they can't be written
+  // completely, the rest is queued, to be written later, when the socket becomes writable.)
+  u_int8_t framingHeader[4];
+  framingHeader[0] = '$';
+  framingHeader[1] = streamChannelId;
+  unsigned totPacketSize = packetSize + payloadSize;
+  framingHeader[2] = (u_int8_t) ((totPacketSize&0xFF00)>>8);
+  framingHeader[3] = (u_int8_t) (totPacketSize&0xFF);
+
+  u_int8_t const* buffers[3] = { framingHeader, packet, payload };
+  unsigned bufferSizes[3] = { 4, packetSize, payloadSize };
+  SocketDescriptor* socketDescriptor = lookupSocketDescriptor(envir(), socketNum);
+  SocketDescriptor::OutputResult result
+    = socketDescriptor->output(buffers, bufferSizes, payloadSize > 0 ? 3 : 2, streamChannelId, packetBeginsKeyFrame);
+  if (result == SocketDescriptor::OUTPUT_OK) {
 #ifdef DEBUG_SEND
     fprintf(stderr, "sendRTPorRTCPPacketOverTCP: completed\n"); fflush(stderr);
 #endif
-
     return True;
-  } while (0);
+  }
 
 #ifdef DEBUG_SEND
-  fprintf(stderr, "sendRTPorRTCPPacketOverTCP: failed! (errno %d)\n", envir().getErrno()); fflush(stderr);
+  fprintf(stderr, "sendRTPorRTCPPacketOverTCP: %s! (errno %d)\n",
+	  result == SocketDescriptor::OUTPUT_DROPPED ? "dropped" : "failed", envir().getErrno()); fflush(stderr);
 #endif
+  if (result == SocketDescriptor::OUTPUT_FAILED) {
+    // Because the write failed, assume that the socket is now unusable, so stop
+    // using it (for both RTP and RTCP):
+    removeStreamSocket(socketNum, 0xFF);
+  }
   return False;
 }
 
-#ifndef RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS
-#define RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS 500
-#endif
-
-Boolean RTPInterface::sendDataOverTCP(int socketNum, u_int8_t const* data, unsigned dataSize, Boolean forceSendToSucceed) {
-  int sendResult = send(socketNum, (char const*)data, dataSize, 0/*flags*/);
-  if (sendResult < (int)dataSize) {
-    // The TCP send() failed - at least partially.
-
-    unsigned numBytesSentSoFar = sendResult < 0 ? 0 : (unsigned)sendResult;
-    if (numBytesSentSoFar > 0 || (forceSendToSucceed && envir().getErrno() == EAGAIN)) {
-      // The OS's TCP send buffer has filled up (because the stream's bitrate has exceeded
-      // the capacity of the TCP connection!).
-      // Force this data write to succeed, by blocking if necessary until it does:
-      unsigned numBytesRemainingToSend = dataSize - numBytesSentSoFar;
-#ifdef DEBUG_SEND
-      fprintf(stderr, "sendDataOverTCP: resending %d-byte send (blocking)\n", numBytesRemainingToSend); fflush(stderr);
-#endif
-      makeSocketBlocking(socketNum, RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS);
-      sendResult = send(socketNum, (char const*)(&data[numBytesSentSoFar]), numBytesRemainingToSend, 0/*flags*/);
-      if ((unsigned)sendResult != numBytesRemainingToSend) {
-	// The blocking "send()" failed, or timed out.  In either case, we assume that the
-	// TCP connection has failed (or is 'hanging' indefinitely), and we stop using it
-	// (for both RTP and RTP).
-	// (If we kept using the socket here, the RTP or RTCP packet write would be in an
-	//  incomplete, inconsistent state.)
-#ifdef DEBUG_SEND
-	fprintf(stderr, "sendDataOverTCP: blocking send() failed (delivering %d bytes out of %d); closing socket %d\n", sendResult, numBytesRemainingToSend, socketNum); fflush(stderr);
-#endif
-	removeStreamSocket(socketNum, 0xFF);
-	return False;
-      }
-      makeSocketNonBlocking(socketNum);
+////////// TCPOutputChunk implementation //////////
 
-      return True;
-    } else if (sendResult < 0 && envir().getErrno() != EAGAIN) {
-      // Because the "send()" call failed, assume that the socket is now unusable, so stop
-      // using it (for both RTP and RTCP):
-      removeStreamSocket(socketNum, 0xFF);
-    }
+TCPOutputChunk::TCPOutputChunk(u_int8_t const* const* buffers, unsigned const* bufferSizes, unsigned numBuffers,
+			       unsigned numBytesAlreadySent)
+  : fNext(NULL), fSize(0), fNumBytesSent(numBytesAlreadySent) {
+  unsigned i;
+  for (i = 0; i < numBuffers; ++i) fSize += bufferSizes[i];
 
-    return False;
+  fData = new u_int8_t[fSize];
+  unsigned offset = 0;
+  for (i = 0; i < numBuffers; ++i) {
+    memmove(&fData[offset], buffers[i], bufferSizes[i]);
+    offset += bufferSizes[i];
   }
+}
 
-  return True;
+TCPOutputChunk::~TCPOutputChunk() {
+  delete[] fData;
 }
 
+////////// SocketDescriptor implementation //////////
+
 SocketDescriptor::SocketDescriptor(UsageEnvironment& env, int socketNum)
   :fEnv(env), fOurSocketNum(socketNum),
     fSubChannelHashTable(HashTable::create(ONE_WORD_HASH_KEYS)),
    fServerRequestAlternativeByteHandler(NULL), fServerRequestAlternativeByteHandlerClientData(NULL),
-   fReadErrorOccurred(False), fDeleteMyselfNext(False), fAreInReadHandlerLoop(False), fTCPReadingState(AWAITING_DOLLAR) {
+   fReadErrorOccurred(False), fDeleteMyselfNext(False), fAreInReadHandlerLoop(False), fTCPReadingState(AWAITING_DOLLAR),
+   fOutputQueueHead(NULL), fOutputQueueTail(NULL), fOutputQueueSize(0),
+   fMaxOutputQueueSize(RTPInterface::defaultMaxTCPOutputQueueSize),
+   fOutputOverflowPolicy(RTPInterface::defaultTCPOutputOverflowPolicy),
+   fNumPacketsDropped(0), fOutputHasFailed(False), fDeleteMyselfWhenOutputDrained(False), fDisconnectTask(NULL) {
+  for (unsigned i = 0; i < 256/32; ++i) fChannelsBeingDropped[i] = 0;
 }
 
 SocketDescriptor::~SocketDescriptor() {
   fEnv.taskScheduler().turnOffBackgroundReadHandling(fOurSocketNum);
+  fEnv.taskScheduler().unscheduleDelayedTask(fDisconnectTask);
   removeSocketDescription(fEnv, fOurSocketNum);
 
+  // Normally, our output queue is empty by now (see "deregisterRTPInterface()").  If it's not - because the socket failed,
+  // or is about to be closed - then make one last (non-blocking) attempt to write it, then discard whatever remains:
+  if (!fOutputHasFailed) writeQueuedData();
+  while (fOutputQueueHead != NULL) {
+    TCPOutputChunk* next = fOutputQueueHead->fNext;
+    delete fOutputQueueHead;
+    fOutputQueueHead = next;
+  }
+
   if (fSubChannelHashTable != NULL) {
     // Remove knowledge of this socket from any "RTPInterface"s that are using it:
     HashTable::Iterator* iter = HashTable::Iterator::create(*fSubChannelHashTable);
@@ -431,6 +570,7 @@ SocketDescriptor::~SocketDescriptor() {
 void SocketDescriptor::registerRTPInterface(unsigned char streamChannelId,
 					    RTPInterface* rtpInterface) {
   Boolean isFirstRegistration = fSubChannelHashTable->IsEmpty();
+  fDeleteMyselfWhenOutputDrained = False; // in case we were just finishing writing our queued output
 #if defined(DEBUG_SEND)||defined(DEBUG_RECEIVE)
   fprintf(stderr, "SocketDescriptor(socket %d)::registerRTPInterface(channel %d): isFirstRegistration %d\n", fOurSocketNum, streamChannelId, isFirstRegistration);
 #endif
@@ -439,11 +579,145 @@ void SocketDescriptor::registerRTPInterface(unsigned char streamChannelId,
 
   if (isFirstRegistration) {
     // Arrange to handle reads on this TCP socket:
-    TaskScheduler::BackgroundHandlerProc* handler
-      = (TaskScheduler::BackgroundHandlerProc*)&tcpReadHandler;
-    fEnv.taskScheduler().
-      setBackgroundHandling(fOurSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION, handler, this);
+    setSocketHandling();
+  }
+}
+
+void SocketDescriptor::setSocketHandling() {
+  // We always handle reads on this TCP socket, but we handle writes only while we have queued output data:
+  int conditionSet = SOCKET_READABLE|SOCKET_EXCEPTION;
+  if (fOutputQueueHead != NULL) conditionSet |= SOCKET_WRITABLE;
+
+  TaskScheduler::BackgroundHandlerProc* handler
+    = (TaskScheduler::BackgroundHandlerProc*)&tcpReadHandler;
+  fEnv.taskScheduler().setBackgroundHandling(fOurSocketNum, conditionSet, handler, this);
+}
+
+SocketDescriptor::OutputResult SocketDescriptor
+::output(u_int8_t const* const* buffers, unsigned const* bufferSizes, unsigned numBuffers,
+	 int streamChannelId, Boolean beginsKeyFrame) {
+  if (fOutputHasFailed) return OUTPUT_DROPPED;
+  unsigned totSize = 0;
+  for (unsigned i = 0; i < numBuffers; ++i) totSize += bufferSizes[i];
+
+  if (streamChannelId >= 0 && isDroppingChannel(streamChannelId)) {
+    // We're dropping packets on this channel, because of an earlier queue overflow.  We resume sending only
+    // at the start of a 'key frame', and only once the queue has drained to half of its maximum size:
+    if (!beginsKeyFrame || fOutputQueueSize + totSize > fMaxOutputQueueSize/2) {
+      ++fNumPacketsDropped;
+      return OUTPUT_DROPPED;
+    }
+    setDroppingChannel(streamChannelId, False);
   }
+
+  unsigned numBytesSent = 0;
+  if (fOutputQueueHead == NULL) {
+    // Common case: Nothing is already queued, so try to write the data now:
+    int result = writeBuffers(fOurSocketNum, buffers, bufferSizes, numBuffers);
+    if (result == (int)totSize) return OUTPUT_OK;
+    if (result < 0) {
+      if (fEnv.getErrno() != EAGAIN) return OUTPUT_FAILED;
+      result = 0;
+    }
+    numBytesSent = (unsigned)result;
+  }
+
+  // Queue the (rest of the) data, unless it's data that we haven't started writing, and there's no room for it.
+  // (Data that can't be dropped - e.g., a RTSP response - may use up to twice as much room as RTP/RTCP packets.)
+  unsigned maxQueueSize = fMaxOutputQueueSize;
+  if (streamChannelId < 0 && maxQueueSize < 0x80000000) maxQueueSize *= 2;
+  if (numBytesSent == 0 && fOutputQueueSize + totSize > maxQueueSize) {
+    ++fNumPacketsDropped;
+    if (streamChannelId < 0 || fOutputOverflowPolicy == TCP_OUTPUT_DISCONNECT) {
+      // Stop writing, and (after we return) close the connection:
+      fOutputHasFailed = True;
+      fDisconnectTask = fEnv.taskScheduler().scheduleDelayedTask(0, (TaskFunc*)outputOverflowDisconnect, this);
+    } else {
+      setDroppingChannel(streamChannelId, True);
+    }
+    return OUTPUT_DROPPED;
+  }
+
+  TCPOutputChunk* chunk = new TCPOutputChunk(buffers, bufferSizes, numBuffers, numBytesSent);
+  fOutputQueueSize += chunk->numBytesRemaining();
+  if (fOutputQueueHead == NULL) {
+    fOutputQueueHead = fOutputQueueTail = chunk;
+    setSocketHandling(); // to start handling writes
+  } else {
+    fOutputQueueTail->fNext = chunk;
+    fOutputQueueTail = chunk;
+  }
+  return OUTPUT_OK;
+}
+
+Boolean SocketDescriptor::writeQueuedData() {
+  while (fOutputQueueHead != NULL) {
+    // Write as many queued chunks as we can, using a single system call:
+    u_int8_t const* buffers[MAX_TCP_OUTPUT_CHUNKS_PER_WRITE];
+    unsigned bufferSizes[MAX_TCP_OUTPUT_CHUNKS_PER_WRITE];
+    unsigned numBuffers = 0, numBytesToWrite = 0;
+    for (TCPOutputChunk* chunk = fOutputQueueHead;
+	 chunk != NULL && numBuffers < MAX_TCP_OUTPUT_CHUNKS_PER_WRITE; chunk = chunk->fNext) {
+      buffers[numBuffers] = &chunk->fData[chunk->fNumBytesSent];
+      bufferSizes[numBuffers++] = chunk->numBytesRemaining();
+      numBytesToWrite += chunk->numBytesRemaining();
+    }
+
+    int result = writeBuffers(fOurSocketNum, buffers, bufferSizes, numBuffers);
+    if (result < 0) {
+      if (fEnv.getErrno() == EAGAIN) break; // the socket's send buffer is still full
+      return False;
+    }
+
+    // Remove the chunks that were written completely:
+    unsigned numBytesWritten = (unsigned)result;
+    fOutputQueueSize -= numBytesWritten;
+    while (numBytesWritten > 0) {
+      TCPOutputChunk* chunk = fOutputQueueHead;
+      if (numBytesWritten < chunk->numBytesRemaining()) {
+	chunk->fNumBytesSent += numBytesWritten;
+	break;
+      }
+      numBytesWritten -= chunk->numBytesRemaining();
+      fOutputQueueHead = chunk->fNext;
+      delete chunk;
+    }
+    if ((unsigned)result < numBytesToWrite) break; // the socket's send buffer is full again
+  }
+  if (fOutputQueueHead == NULL) fOutputQueueTail = NULL;
+
+  return True;
+}
+
+void SocketDescriptor::setDroppingChannel(u_int8_t streamChannelId, Boolean isDropping) {
+  u_int32_t bit = 1<<(streamChannelId&0x1F);
+  if (isDropping) {
+    fChannelsBeingDropped[streamChannelId>>5] |= bit;
+  } else {
+    fChannelsBeingDropped[streamChannelId>>5] &=~ bit;
+  }
+}
+
+void SocketDescriptor::discardOutput() {
+  // Our owner is about to close the socket, so don't write to it (or tell anyone about it) any more:
+  fOutputHasFailed = True;
+  fServerRequestAlternativeByteHandler = NULL;
+
+  if (fAreInReadHandlerLoop) {
+    fDeleteMyselfNext = True; // we'll delete ourself from "tcpReadHandler()" below
+  } else {
+    delete this;
+  }
+}
+
+void SocketDescriptor::outputOverflowDisconnect(SocketDescriptor* socketDescriptor) {
+  socketDescriptor->fDisconnectTask = NULL;
+#if defined(DEBUG_SEND)
+  fprintf(stderr, "SocketDescriptor(socket %d): output queue overflow; closing the connection\n", socketDescriptor->fOurSocketNum);
+#endif
+  // Treat this like a read error, so that our (RTSP server) 'alternative byte handler' - if any - closes the connection:
+  socketDescriptor->fReadErrorOccurred = True;
+  delete socketDescriptor;
 }
 
 RTPInterface* SocketDescriptor
@@ -460,8 +734,14 @@ void SocketDescriptor
   fSubChannelHashTable->Remove((char const*)(long)streamChannelId);
 
   if (fSubChannelHashTable->IsEmpty() || streamChannelId == 0xFF) {
-    // No more interfaces are using us, so it's curtains for us now:
-    if (fAreInReadHandlerLoop) {
+    // No more interfaces are using us, so it's curtains for us now.
+    if (streamChannelId != 0xFF && fOutputQueueHead != NULL && !fOutputHasFailed) {
+      // But first, we need to finish writing our queued output - which may include a partly-written packet, or RTSP
+      // responses - so that the TCP stream stays in sync when our 'alternative byte handler' takes back control of the
+      // socket.  (Meanwhile, we continue to pass any RTSP requests that we read to this handler.)
+      // We'll delete ourself from "tcpReadHandler()" below, once the queue has drained:
+      fDeleteMyselfWhenOutputDrained = True;
+    } else if (fAreInReadHandlerLoop) {
       fDeleteMyselfNext = True; // we can't delete ourself yet, but we'll do so from "tcpReadHandler()" below
     } else {
       delete this;
@@ -470,10 +750,28 @@ void SocketDescriptor
 }
 
 void SocketDescriptor::tcpReadHandler(SocketDescriptor* socketDescriptor, int mask) {
-  // Call the read handler until it returns false, with a limit to avoid starving other sockets
-  unsigned count = 2000;
   socketDescriptor->fAreInReadHandlerLoop = True;
-  while (!socketDescriptor->fDeleteMyselfNext && socketDescriptor->tcpReadHandler1(mask) && --count > 0) {}
+  if ((mask&SOCKET_WRITABLE) != 0) {
+    // Write any queued output data:
+    if (!socketDescriptor->writeQueuedData()) {
+      // The write failed, so - as with a read error - we will no longer handle this socket:
+      socketDescriptor->fOutputHasFailed = True;
+      socketDescriptor->fReadErrorOccurred = True;
+      socketDescriptor->fDeleteMyselfNext = True;
+    } else if (socketDescriptor->fOutputQueueHead == NULL) {
+      if (socketDescriptor->fDeleteMyselfWhenOutputDrained) {
+	socketDescriptor->fDeleteMyselfNext = True;
+      } else {
+	socketDescriptor->setSocketHandling(); // to stop handling writes
+      }
+    }
+  }
+
+  if ((mask&(SOCKET_READABLE|SOCKET_EXCEPTION)) != 0) {
+    // Call the read handler until it returns false, with a limit to avoid starving other sockets
+    unsigned count = 2000;
+    while (!socketDescriptor->fDeleteMyselfNext && socketDescriptor->tcpReadHandler1(mask) && --count > 0) {}
+  }
   socketDescriptor->fAreInReadHandlerLoop = False;
   if (socketDescriptor->fDeleteMyselfNext) delete socketDescriptor;
 }
@@ -52,7 +52,7 @@ RTPSink::RTPSink(UsageEnvironment& env,
     fRTPPayloadType(rtpPayloadType),
     fPacketCount(0), fOctetCount(0), fTotalOctetCount(0),
     fTimestampFrequency(rtpTimestampFrequency), fNextTimestampHasBeenPreset(False), fEnableRTCPReports(True),
-    fNumChannels(numChannels), fEstimatedBitrate(0) {
+    fNumChannels(numChannels), fEstimatedBitrate(0), fNumKeyFrameRequests(0) {
   fRTPPayloadFormatName
     = strDup(rtpPayloadFormatName == NULL ? "???" : rtpPayloadFormatName);
   gettimeofday(&fCreationTime, NULL);
@@ -97,6 +97,19 @@ u_int32_t RTPSink::convertToRTPTimestamp(struct timeval tv) {
   return rtpTimestamp;
 }
 
+Boolean RTPSink::retransmitPacket(u_int16_t /*seqNo*/) {
+  return False; // by default
+}
+
+void RTPSink::handleKeyFrameRequest() {
+  ++fNumKeyFrameRequests;
+  if (fSource != NULL) fSource->requestKeyFrame();
+}
+
+void RTPSink::handleTransportWideCCFeedback(unsigned char const* /*fci*/, unsigned /*fciSize*/) {
+  // by default, we don't do congestion control
+}
+
 u_int32_t RTPSink::presetNextTimestamp() {
   struct timeval timeNow;
   gettimeofday(&timeNow, NULL);
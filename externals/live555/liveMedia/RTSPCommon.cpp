@@ -334,11 +334,27 @@ Boolean RTSPOptionIsSupported(char const* commandName, char const* optionsRespon
   return False;
 }
 
+// "dateHeader()" returns a static buffer, which must be per-thread, because servers (e.g., the shards of a
+// "ShardedRTSPServer") may call it from several threads at once:
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL
+#endif
+
 char const* dateHeader() {
-  static char buf[200];
+  static THREAD_LOCAL char buf[200];
 #if !defined(_WIN32_WCE)
   time_t tt = time(NULL);
-  strftime(buf, sizeof buf, "Date: %a, %b %d %Y %H:%M:%S GMT\r\n", gmtime(&tt));
+#if defined(__WIN32__) || defined(_WIN32)
+  struct tm* gmt = gmtime(&tt); // Windows' "gmtime()" already uses a per-thread result
+#else
+  struct tm gmtBuf;
+  struct tm* gmt = gmtime_r(&tt, &gmtBuf);
+#endif
+  strftime(buf, sizeof buf, "Date: %a, %b %d %Y %H:%M:%S GMT\r\n", gmt);
 #else
   // WinCE apparently doesn't have "time()", "strftime()", or "gmtime()",
   // so generate the "Date:" header a different, WinCE-specific way.
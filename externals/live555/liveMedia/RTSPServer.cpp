@@ -183,7 +183,7 @@ UserAuthenticationDatabase* RTSPServer::setAuthenticationDatabase(UserAuthentica
 }
 
 Boolean RTSPServer::setUpTunnelingOverHTTP(Port httpPort) {
-  fHTTPServerSocket = setUpOurSocket(envir(), httpPort);
+  fHTTPServerSocket = setUpOurSocket(envir(), httpPort, fNumShards > 1/*share the port with the other shards*/);
   if (fHTTPServerSocket >= 0) {
     fHTTPServerPort = httpPort;
     envir().taskScheduler().turnOnBackgroundReadHandling(fHTTPServerSocket,
@@ -706,6 +706,7 @@ void RTSPServer::RTSPClientConnection::resetRequestBuffer() {
 void RTSPServer::RTSPClientConnection::closeSocketsRTSP() {
   // First, tell our server to stop any streaming that it might be doing over our output socket:
   fOurRTSPServer.stopTCPStreamingOnSocket(fClientOutputSocket);
+  RTPInterface::discardQueuedTCPOutput(envir(), fClientOutputSocket); // in case it's still writing queued output
 
   // Turn off background handling on our input socket (and output socket, if different); then close it (or them):
   if (fClientOutputSocket != fClientInputSocket) {
@@ -779,6 +780,29 @@ static void parseTransportHeaderForREGISTER(char const* buf,
   delete[] field;
 }
 
+static unsigned shardForSessionCookie(char const* sessionCookie, unsigned numShards) {
+  unsigned hash = 0;
+  while (*sessionCookie != '\0') hash = hash*31 + (u_int8_t)*sessionCookie++;
+
+  return hash%numShards;
+}
+
+Boolean RTSPServer::RTSPClientConnection::handOffToShard(unsigned shardIndex) {
+  // We can hand over our socket only if it's not already being used (by us) for anything else:
+  if (shardIndex == fOurRTSPServer.fShardIndex || fRecursionCount > 1
+      || fClientOutputSocket != fClientInputSocket || fOurSessionCookie != NULL
+      || fOurRTSPServer.fTCPStreamingDatabase->Lookup((char const*)(long)fClientOutputSocket) != NULL
+      || RTPInterface::numBytesQueuedForTCPOutput(envir(), fClientOutputSocket) > 0) {
+    return False;
+  }
+
+  envir().taskScheduler().disableBackgroundHandling(fClientInputSocket);
+  fOurRTSPServer.handOffClientSocket(fClientInputSocket, fClientAddr, shardIndex, fRequestBuffer, fRequestBytesAlreadySeen);
+  fClientInputSocket = fClientOutputSocket = -1; // the socket now belongs to the other shard, so we mustn't close it
+  fIsActive = False; // so we'll get deleted
+  return True;
+}
+
 void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
   int numBytesRemaining = 0;
   ++fRecursionCount;
@@ -897,6 +921,15 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
       if (requestIncludedSessionId) {
 	clientSession = (RTSPServer::RTSPClientSession*)(fOurRTSPServer.fClientSessions->Lookup(sessionIdStr));
 	if (clientSession != NULL) clientSession->noteLiveness();
+
+	// If we're one of several shards, and the session belongs to another shard (i.e., the client used a new
+	// TCP connection, which the kernel gave to us), then hand this connection over to that shard instead:
+	unsigned sessionId;
+	if (clientSession == NULL && fOurRTSPServer.fNumShards > 1 && sscanf(sessionIdStr, "%X", &sessionId) == 1
+	    && !fOurRTSPServer.sessionIdIsOurs(sessionId)
+	    && handOffToShard(fOurRTSPServer.shardForSessionId(sessionId))) {
+	  break;
+	}
       }
     
       // We now have a complete RTSP request.
@@ -944,8 +977,11 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 	    u_int32_t sessionId;
 	    do {
 	      sessionId = (u_int32_t)our_random32();
+	      // If we're one of several shards, choose a session id that identifies us as the session's owner:
+	      sessionId += fOurRTSPServer.fShardIndex - sessionId%fOurRTSPServer.fNumShards;
 	      sprintf(sessionIdStr, "%08X", sessionId);
-	    } while (sessionId == 0 || fOurRTSPServer.fClientSessions->Lookup(sessionIdStr) != NULL);
+	    } while (sessionId == 0 || !fOurRTSPServer.sessionIdIsOurs(sessionId)
+		     || fOurRTSPServer.fClientSessions->Lookup(sessionIdStr) != NULL);
 	    clientSession = (RTSPClientSession*)fOurRTSPServer.createNewClientSession(sessionId);
 	    fOurRTSPServer.fClientSessions->Add(sessionIdStr, clientSession);
 	  } else {
@@ -1017,6 +1053,13 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 	  } else {
 	    handleHTTPCmd_StreamingGET(urlSuffix, (char const*)fRequestBuffer);
 	  }
+	} else if (fOurRTSPServer.fNumShards > 1
+		   && (strcmp(cmdName, "GET") == 0 || strcmp(cmdName, "POST") == 0)
+		   && shardForSessionCookie(sessionCookie, fOurRTSPServer.fNumShards) != fOurRTSPServer.fShardIndex
+		   && handOffToShard(shardForSessionCookie(sessionCookie, fOurRTSPServer.fNumShards))) {
+	  // The tunnel's "GET" and "POST" connections must be handled by the same shard,
+	  // so we've handed this connection over to the shard that's chosen by the 'session cookie':
+	  break;
 	} else if (strcmp(cmdName, "GET") == 0) {
 	  handleHTTPCmd_TunnelingGET(sessionCookie);
 	} else if (strcmp(cmdName, "POST") == 0) {
@@ -1046,7 +1089,8 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 #ifdef DEBUG
     fprintf(stderr, "sending response: %s", fResponseBuffer);
 #endif
-    send(fClientOutputSocket, (char const*)fResponseBuffer, strlen((char*)fResponseBuffer), 0);
+    RTPInterface::sendDataOverTCPSocket(envir(), fClientOutputSocket, fResponseBuffer, strlen((char*)fResponseBuffer));
+        // (If we're streaming RTP-over-TCP on this connection, this response will be queued behind any pending RTP/RTCP data.)
     
     if (playAfterSetup) {
       // The client has asked for streaming to commence now, rather than after a
@@ -0,0 +1,305 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A per-environment cache of the SDP parameters (including any 'parameter sets' or other 'config' information)
+// that "OnDemandServerMediaSubsession"s would otherwise get by 'probing' their source
+// Implementation
+
+#include "SDPCache.hh"
+#include "OutputFile.hh"
+
+////////// SDPCacheEntry implementation //////////
+
+SDPCacheEntry::SDPCacheEntry(char const* version, char const* mediaType, unsigned char rtpPayloadType,
+			     unsigned estBitrate, char const* rtpmapLine, char const* auxSDPLine)
+  : fVersion(strDup(version)), fMediaType(strDup(mediaType)), fRTPPayloadType(rtpPayloadType),
+    fEstBitrate(estBitrate), fRTPMapLine(strDup(rtpmapLine == NULL ? "" : rtpmapLine)),
+    fAuxSDPLine(strDup(auxSDPLine == NULL ? "" : auxSDPLine)) {
+}
+
+SDPCacheEntry::~SDPCacheEntry() {
+  delete[] fVersion; delete[] fMediaType; delete[] fRTPMapLine; delete[] fAuxSDPLine;
+}
+
+
+////////// SDPCachePrewarmRequest definition //////////
+
+class SDPCachePrewarmRequest {
+public:
+  SDPCachePrewarmRequest(ServerMediaSession& serverMediaSession)
+    : fNext(NULL), fSessionMediumName(strDup(serverMediaSession.name())), fNumSubsessionsDone(0) {
+  }
+  virtual ~SDPCachePrewarmRequest() { delete[] fSessionMediumName; }
+
+public:
+  SDPCachePrewarmRequest* fNext;
+  char* fSessionMediumName; // we look the session up by name each time, in case it has since been deleted
+  unsigned fNumSubsessionsDone;
+};
+
+
+////////// SDPCache implementation //////////
+
+SDPCache* SDPCache::createNew(UsageEnvironment& env, char const* cacheFileName) {
+  delete ourCache(env);
+
+  SDPCache* newCache = new SDPCache(env, cacheFileName);
+  _Tables::getOurTables(env)->sdpCache = newCache;
+  return newCache;
+}
+
+SDPCache* SDPCache::ourCache(UsageEnvironment& env) {
+  _Tables* ourTables = _Tables::getOurTables(env, False);
+  return ourTables == NULL ? NULL : (SDPCache*)(ourTables->sdpCache);
+}
+
+SDPCache::SDPCache(UsageEnvironment& env, char const* cacheFileName)
+  : fEnv(env), fCacheFileName(strDup(cacheFileName)), fCacheFid(NULL),
+    fEntries(HashTable::create(STRING_HASH_KEYS)),
+    fPrewarmHead(NULL), fPrewarmTail(NULL), fPrewarmTask(NULL),
+    fNumHits(0), fNumMisses(0) {
+  if (fCacheFileName != NULL) loadFromFile();
+}
+
+SDPCache::~SDPCache() {
+  fEnv.taskScheduler().unscheduleDelayedTask(fPrewarmTask);
+  while (fPrewarmHead != NULL) {
+    SDPCachePrewarmRequest* request = fPrewarmHead;
+    fPrewarmHead = request->fNext;
+    delete request;
+  }
+
+  SDPCacheEntry* entry;
+  while ((entry = (SDPCacheEntry*)(fEntries->RemoveNext())) != NULL) delete entry;
+  delete fEntries;
+
+  if (fCacheFid != NULL) fclose(fCacheFid);
+  delete[] fCacheFileName;
+
+  _Tables* ourTables = _Tables::getOurTables(fEnv, False);
+  if (ourTables != NULL && ourTables->sdpCache == this) {
+    ourTables->sdpCache = NULL;
+    ourTables->reclaimIfPossible();
+  }
+}
+
+SDPCacheEntry const* SDPCache::lookup(char const* key, char const* version) {
+  SDPCacheEntry* entry = (SDPCacheEntry*)(fEntries->Lookup(key));
+  if (entry == NULL || strcmp(entry->fVersion, version) != 0) {
+    ++fNumMisses;
+    return NULL;
+  }
+
+  ++fNumHits;
+  return entry;
+}
+
+void SDPCache::add(char const* key, char const* version, char const* mediaType, unsigned char rtpPayloadType,
+		   unsigned estBitrate, char const* rtpmapLine, char const* auxSDPLine) {
+  SDPCacheEntry* entry = new SDPCacheEntry(version, mediaType, rtpPayloadType, estBitrate, rtpmapLine, auxSDPLine);
+  addEntry(key, entry);
+
+  if (fCacheFid != NULL) {
+    writeEntry(fCacheFid, key, entry);
+    fflush(fCacheFid);
+  }
+}
+
+void SDPCache::addEntry(char const* key, SDPCacheEntry* entry) {
+  delete (SDPCacheEntry*)(fEntries->Add(key, entry));
+}
+
+// The cache file contains one line per entry, with the following tab-separated fields:
+//   key, version, media type, RTP payload type, estimated bitrate (kbps), "a=rtpmap:" line, 'aux' SDP line
+// Any tab, CR, LF, or backslash characters within a field are escaped (as "\t", "\r", "\n", and "\\").
+// Because entries are only ever appended, a key can appear more than once; the last such entry is the valid one.
+#define SDP_CACHE_NUM_FIELDS 7
+
+static void writeEscapedField(FILE* fid, char const* str, char terminator) {
+  for (char const* p = str; *p != '\0'; ++p) {
+    switch (*p) {
+      case '\t': { fputs("\\t", fid); break; }
+      case '\r': { fputs("\\r", fid); break; }
+      case '\n': { fputs("\\n", fid); break; }
+      case '\\': { fputs("\\\\", fid); break; }
+      default: { fputc(*p, fid); break; }
+    }
+  }
+  fputc(terminator, fid);
+}
+
+void SDPCache::writeEntry(FILE* fid, char const* key, SDPCacheEntry const* entry) {
+  char numStr[30];
+
+  writeEscapedField(fid, key, '\t');
+  writeEscapedField(fid, entry->fVersion, '\t');
+  writeEscapedField(fid, entry->fMediaType, '\t');
+  sprintf(numStr, "%u", entry->fRTPPayloadType);
+  writeEscapedField(fid, numStr, '\t');
+  sprintf(numStr, "%u", entry->fEstBitrate);
+  writeEscapedField(fid, numStr, '\t');
+  writeEscapedField(fid, entry->fRTPMapLine, '\t');
+  writeEscapedField(fid, entry->fAuxSDPLine, '\n');
+}
+
+static char* readLine(FILE* fid) {
+  // Returns a new string containing the next line (without its terminating LF), or NULL at EOF
+  unsigned bufferSize = 1000, length = 0;
+  char* buffer = new char[bufferSize];
+  int c;
+  while ((c = fgetc(fid)) != EOF && c != '\n') {
+    if (length + 1 >= bufferSize) {
+      char* newBuffer = new char[2*bufferSize];
+      memmove(newBuffer, buffer, length);
+      delete[] buffer; buffer = newBuffer;
+      bufferSize *= 2;
+    }
+    buffer[length++] = (char)c;
+  }
+  if (c == EOF && length == 0) {
+    delete[] buffer;
+    return NULL;
+  }
+
+  buffer[length] = '\0';
+  return buffer;
+}
+
+static unsigned splitAndUnescapeFields(char* line, char** fields, unsigned maxNumFields) {
+  // Splits "line" (in place) at each tab, and unescapes each resulting field.  Returns the number of fields.
+  unsigned numFields = 0;
+  char* from = line;
+  char* to = line;
+  fields[numFields++] = to;
+  while (*from != '\0') {
+    if (*from == '\t') {
+      *to++ = '\0';
+      if (numFields == maxNumFields) return maxNumFields + 1; // too many fields
+      fields[numFields++] = to;
+      ++from;
+    } else if (*from == '\\' && from[1] != '\0') {
+      char c = from[1];
+      *to++ = c == 't' ? '\t' : c == 'r' ? '\r' : c == 'n' ? '\n' : c;
+      from += 2;
+    } else {
+      *to++ = *from++;
+    }
+  }
+  *to = '\0';
+
+  return numFields;
+}
+
+void SDPCache::loadFromFile() {
+  unsigned numLines = 0;
+
+  FILE* fid = fopen(fCacheFileName, "rb");
+  if (fid != NULL) {
+    char* line;
+    while ((line = readLine(fid)) != NULL) {
+      ++numLines;
+      char* fields[SDP_CACHE_NUM_FIELDS];
+      unsigned payloadType, estBitrate;
+      if (splitAndUnescapeFields(line, fields, SDP_CACHE_NUM_FIELDS) == SDP_CACHE_NUM_FIELDS
+	  && sscanf(fields[3], "%u", &payloadType) == 1 && payloadType <= 127
+	  && sscanf(fields[4], "%u", &estBitrate) == 1) {
+	addEntry(fields[0], new SDPCacheEntry(fields[1], fields[2], (unsigned char)payloadType, estBitrate,
+					      fields[5], fields[6]));
+      } // else the line is malformed (e.g., truncated by a crash during a previous write); ignore it
+      delete[] line;
+    }
+    fclose(fid);
+  }
+
+  if (numLines > fEntries->numEntries()) {
+    // The file contains superseded or malformed lines.  Rewrite it, with just the valid entries:
+    fid = OpenOutputFile(fEnv, fCacheFileName);
+    if (fid != NULL) {
+      HashTable::Iterator* iter = HashTable::Iterator::create(*fEntries);
+      char const* key;
+      SDPCacheEntry* entry;
+      while ((entry = (SDPCacheEntry*)(iter->next(key))) != NULL) writeEntry(fid, key, entry);
+      delete iter;
+      fclose(fid);
+    }
+  }
+
+  // Open the file for appending new entries:
+  fCacheFid = fopen(fCacheFileName, "ab");
+  if (fCacheFid == NULL) {
+    fEnv << "SDPCache: Failed to open cache file \"" << fCacheFileName << "\" for writing; new entries won't be saved\n";
+  }
+}
+
+void SDPCache::prewarm(ServerMediaSession& serverMediaSession) {
+  SDPCachePrewarmRequest* request = new SDPCachePrewarmRequest(serverMediaSession);
+  if (fPrewarmTail == NULL) {
+    fPrewarmHead = fPrewarmTail = request;
+  } else {
+    fPrewarmTail->fNext = request;
+    fPrewarmTail = request;
+  }
+
+  if (fPrewarmTask == NULL) fPrewarmTask = fEnv.taskScheduler().scheduleDelayedTask(0, prewarmTask, this);
+}
+
+unsigned SDPCache::numSubsessionsAwaitingPrewarm() const {
+  unsigned result = 0;
+  for (SDPCachePrewarmRequest* request = fPrewarmHead; request != NULL; request = request->fNext) {
+    ServerMediaSession* session;
+    if (!ServerMediaSession::lookupByName(fEnv, request->fSessionMediumName, session)) continue;
+    unsigned numSubsessions = session->numSubsessions();
+    if (numSubsessions > request->fNumSubsessionsDone) result += numSubsessions - request->fNumSubsessionsDone;
+  }
+  return result;
+}
+
+void SDPCache::prewarmTask(void* clientData) {
+  SDPCache* cache = (SDPCache*)clientData;
+  cache->fPrewarmTask = NULL;
+  cache->prewarmNextSubsession();
+}
+
+void SDPCache::prewarmNextSubsession() {
+  // Find the next subsession to prewarm (discarding any requests for sessions that have since been deleted,
+  // or that have been completed):
+  ServerMediaSubsession* subsession = NULL;
+  while (fPrewarmHead != NULL) {
+    SDPCachePrewarmRequest* request = fPrewarmHead;
+    ServerMediaSession* session;
+    if (ServerMediaSession::lookupByName(fEnv, request->fSessionMediumName, session)) {
+      ServerMediaSubsessionIterator iter(*session);
+      for (unsigned i = 0; i <= request->fNumSubsessionsDone; ++i) subsession = iter.next();
+      if (subsession != NULL) {
+	++request->fNumSubsessionsDone;
+	break;
+      }
+    }
+
+    fPrewarmHead = request->fNext;
+    if (fPrewarmHead == NULL) fPrewarmTail = NULL;
+    delete request;
+  }
+  if (subsession == NULL) return; // there's nothing (more) to prewarm
+
+  // Note that this call might run a nested event loop (e.g., to read a H.264 file until its SPS and PPS NAL units
+  // have been seen).  Because our next task hasn't been scheduled yet, we can't be reentered during this time.
+  (void)subsession->sdpLines();
+
+  // Leave it to the event loop to handle any other pending events before we prewarm the next subsession:
+  fPrewarmTask = fEnv.taskScheduler().scheduleDelayedTask(0, prewarmTask, this);
+}
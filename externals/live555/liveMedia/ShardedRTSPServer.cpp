@@ -0,0 +1,163 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A RTSP server that runs several 'shards' - each a "RTSPServer" with its own event loop, running in its own thread -
+// that all listen on the same port, so that the server can use several CPU cores.
+// Implementation
+
+#include "ShardedRTSPServer.hh"
+#include "OurThread.hh"
+
+////////// RTSPServerShard //////////
+
+// A "RTSPServer" that's one of the shards of a "ShardedRTSPServer":
+class RTSPServerShard: public RTSPServer {
+public:
+  static RTSPServerShard* createNew(UsageEnvironment& env, Port& ourPort,
+				    RTSPServer** allShards, unsigned numShards, unsigned shardIndex,
+				    UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds) {
+    int ourSocket = setUpOurSocket(env, ourPort, numShards > 1/*share the port with the other shards*/);
+    if (ourSocket == -1) return NULL;
+
+    return new RTSPServerShard(env, ourSocket, ourPort, allShards, numShards, shardIndex,
+			       authDatabase, reclamationSeconds);
+  }
+
+  char volatile fStopFlag; // our event loop's 'watch variable'
+
+protected:
+  RTSPServerShard(UsageEnvironment& env, int ourSocket, Port ourPort,
+		  RTSPServer** allShards, unsigned numShards, unsigned shardIndex,
+		  UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds)
+    : RTSPServer(env, ourSocket, ourPort, authDatabase, reclamationSeconds),
+      fStopFlag(0) {
+    fNumShards = numShards;
+    fShardIndex = shardIndex;
+    fShards = (GenericMediaServer**)allShards;
+  }
+};
+
+
+////////// ShardedRTSPServer //////////
+
+static void checkForPostedTasks(void* /*clientData*/) {
+}
+
+ShardedRTSPServer*
+ShardedRTSPServer::createNew(UsageEnvironment& env, Port ourPort, unsigned numShards,
+			     createEnvironmentFunc* createEnvironment,
+			     setUpShardFunc* setUpShard, void* clientData,
+			     UserAuthenticationDatabase* authDatabase,
+			     unsigned reclamationSeconds) {
+  if (numShards == 0 || createEnvironment == NULL) {
+    env.setResultMsg("ShardedRTSPServer::createNew(): bad parameters");
+    return NULL;
+  }
+
+  ShardedRTSPServer* newServer = new ShardedRTSPServer(env, ourPort, numShards);
+
+  // First, create each shard (in its own environment).  The first shard chooses our port number, if necessary:
+  for (unsigned i = 0; i < numShards; ++i) {
+    UsageEnvironment* shardEnv = (*createEnvironment)(i, clientData);
+    if (shardEnv == NULL) {
+      env.setResultMsg("ShardedRTSPServer::createNew(): failed to create a shard's environment");
+      Medium::close(newServer);
+      return NULL;
+    }
+
+    // Check that the shard's "TaskScheduler" implements "postTask()", because we'll need it (e.g., to stop the shard):
+    if (!shardEnv->taskScheduler().postTask(checkForPostedTasks, NULL)) {
+      env.setResultMsg("ShardedRTSPServer::createNew(): a shard's \"TaskScheduler\" doesn't implement \"postTask()\"");
+      TaskScheduler* shardScheduler = &shardEnv->taskScheduler();
+      shardEnv->reclaim(); delete shardScheduler;
+      Medium::close(newServer);
+      return NULL;
+    }
+
+    newServer->fShards[i] = RTSPServerShard::createNew(*shardEnv, newServer->fPort, newServer->fShards, numShards, i,
+						       authDatabase, reclamationSeconds);
+    if (newServer->fShards[i] == NULL) {
+      env.setResultMsg(shardEnv->getResultMsg());
+      TaskScheduler* shardScheduler = &shardEnv->taskScheduler();
+      shardEnv->reclaim(); delete shardScheduler;
+      Medium::close(newServer);
+      return NULL;
+    }
+  }
+
+  // Then, let each shard set itself up, before any of them start running:
+  if (setUpShard != NULL) {
+    for (unsigned i = 0; i < numShards; ++i) (*setUpShard)(newServer->fShards[i], i, clientData);
+  }
+
+  // Finally, start each shard's thread:
+  for (unsigned i = 0; i < numShards; ++i) {
+    newServer->fThreads[i] = OurThread::createNew(shardThreadMain, newServer->fShards[i]);
+    if (newServer->fThreads[i] == NULL) {
+      env.setResultMsg("ShardedRTSPServer::createNew(): failed to start a shard's thread");
+      Medium::close(newServer);
+      return NULL;
+    }
+  }
+
+  return newServer;
+}
+
+ShardedRTSPServer::ShardedRTSPServer(UsageEnvironment& env, Port ourPort, unsigned numShards)
+  : Medium(env), fPort(ourPort), fNumShards(numShards) {
+  fShards = new RTSPServer*[fNumShards];
+  fThreads = new OurThread*[fNumShards];
+  for (unsigned i = 0; i < fNumShards; ++i) {
+    fShards[i] = NULL;
+    fThreads[i] = NULL;
+  }
+}
+
+ShardedRTSPServer::~ShardedRTSPServer() {
+  unsigned i;
+
+  // First, stop each shard's thread.  (We can't touch a shard directly while its thread is running,
+  // so we post a task to it instead.)
+  for (i = 0; i < fNumShards; ++i) {
+    if (fThreads[i] != NULL) fShards[i]->envir().taskScheduler().postTask(stopShardTask, fShards[i]);
+  }
+  for (i = 0; i < fNumShards; ++i) {
+    delete fThreads[i]; // waits for the thread to finish
+  }
+
+  // Then, delete each shard, and its environment:
+  for (i = 0; i < fNumShards; ++i) {
+    if (fShards[i] == NULL) continue;
+
+    UsageEnvironment* shardEnv = &fShards[i]->envir();
+    TaskScheduler* shardScheduler = &shardEnv->taskScheduler();
+    Medium::close(fShards[i]);
+    shardEnv->reclaim(); delete shardScheduler;
+  }
+
+  delete[] fThreads;
+  delete[] fShards;
+}
+
+void ShardedRTSPServer::shardThreadMain(void* shard) {
+  RTSPServerShard* ourShard = (RTSPServerShard*)shard;
+  ourShard->envir().taskScheduler().doEventLoop(&ourShard->fStopFlag);
+}
+
+void ShardedRTSPServer::stopShardTask(void* shard) {
+  ((RTSPServerShard*)shard)->fStopFlag = 1;
+}
@@ -19,11 +19,87 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "StreamParser.hh"
+#include "MappedFileSource.hh"
 
 #include <string.h>
 #include <stdlib.h>
+#if defined(__AVX2__)
+#define USE_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2 1
+#include <emmintrin.h>
+#endif
+#if (defined(USE_AVX2) || defined(USE_SSE2)) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define INITIAL_BANK_SIZE 150000
+#define DEFAULT_MAX_BANK_SIZE 100000000
+#define MAPPED_BANK_INCREMENT 1000000 // the minimum number of bytes that we add to a mapped 'bank' at a time
+
+#if defined(USE_AVX2) || defined(USE_SSE2)
+static inline unsigned lowestBitNum(unsigned mask) { // "mask" must be non-zero
+#ifdef _MSC_VER
+  unsigned long result;
+  _BitScanForward(&result, mask);
+  return (unsigned)result;
+#else
+  return (unsigned)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+unsigned char const* StreamParser::findStartCode(unsigned char const* from, unsigned char const* end) {
+  unsigned char const* p = from;
+
+  // A start code prefix begins with a pair of 0x00 bytes.  In coded data, such pairs are rare (because of 'emulation
+  // prevention'), so we first look for them - many bytes at a time - and check the byte after each one that we find:
+#ifdef USE_AVX2
+  __m256i const zeros32 = _mm256_setzero_si256();
+  while (end - p >= 34) { // we look at up to p[33]
+    __m256i z0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const*)p), zeros32);
+    __m256i z1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const*)(p+1)), zeros32);
+    unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(z0, z1));
+    while (mask != 0) {
+      unsigned i = lowestBitNum(mask);
+      if (p[i+2] == 1) return &p[i];
+      mask &= mask - 1;
+    }
+    p += 32;
+  }
+#endif
+#ifdef USE_SSE2
+  __m128i const zeros16 = _mm_setzero_si128();
+  while (end - p >= 18) { // we look at up to p[17]
+    __m128i z0 = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const*)p), zeros16);
+    __m128i z1 = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const*)(p+1)), zeros16);
+    unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(z0, z1));
+    while (mask != 0) {
+      unsigned i = lowestBitNum(mask);
+      if (p[i+2] == 1) return &p[i];
+      mask &= mask - 1;
+    }
+    p += 16;
+  }
+#endif
+
+  // Check the remaining bytes (or all of them, if we don't have SIMD instructions).  If the third byte of a possible
+  // prefix is > 1, then no prefix can include it, so we can move ahead by 3 bytes:
+  while (end - p >= 3) {
+    if (p[2] > 1) {
+      p += 3;
+    } else if (p[2] == 0) {
+      ++p;
+    } else { // p[2] == 1
+      if (p[0] == 0 && p[1] == 0) return p;
+      p += 3;
+    }
+  }
 
-#define BANK_SIZE 150000
+  return end;
+}
 
 void StreamParser::flushInput() {
   fCurParserIndex = fSavedParserIndex = 0;
@@ -43,16 +119,22 @@ StreamParser::StreamParser(FramedSource* inputSource,
     fSavedParserIndex(0), fSavedRemainingUnparsedBits(0),
     fCurParserIndex(0), fRemainingUnparsedBits(0),
     fTotNumValidBytes(0), fHaveSeenEOF(False) {
-  fBank[0] = new unsigned char[BANK_SIZE];
-  fBank[1] = new unsigned char[BANK_SIZE];
-  fCurBankNum = 0;
-  fCurBank = fBank[fCurBankNum];
+  fMappedInputSource = inputSource != NULL && inputSource->isMappedFileSource() ? (MappedFileSource*)inputSource : NULL;
+  fBankSize = INITIAL_BANK_SIZE;
+  fMaxBankSize = DEFAULT_MAX_BANK_SIZE;
+  fBank = fMappedInputSource != NULL ? NULL : new unsigned char[fBankSize];
 
   fLastSeenPresentationTime.tv_sec = 0; fLastSeenPresentationTime.tv_usec = 0;
 }
 
 StreamParser::~StreamParser() {
-  delete[] fBank[0]; delete[] fBank[1];
+  if (fMappedInputSource == NULL) delete[] fBank;
+}
+
+void StreamParser::setMaxBankSize(unsigned maxBankSize) {
+  if (maxBankSize < INITIAL_BANK_SIZE) maxBankSize = INITIAL_BANK_SIZE;
+  if (maxBankSize > 0x80000000) maxBankSize = 0x80000000; // so that doubling the bank size can't overflow
+  fMaxBankSize = maxBankSize;
 }
 
 void StreamParser::saveParserState() {
@@ -65,6 +147,24 @@ void StreamParser::restoreSavedParserState() {
   fRemainingUnparsedBits = fSavedRemainingUnparsedBits;
 }
 
+unsigned char const* StreamParser::skipBytesBeforeStartCode(unsigned& numBytesSkipped) {
+  unsigned char const* from = nextToParse();
+  unsigned char const* end = &curBank()[fTotNumValidBytes];
+
+  unsigned char const* startCode = findStartCode(from, end);
+  if (startCode == end) {
+    // There's no start code prefix in the data that we've read so far, but the last 3 bytes might begin a start code:
+    startCode = end - from > 3 ? end - 3 : from;
+  } else if (startCode > from && startCode[-1] == 0) {
+    --startCode; // it's a 4-byte start code
+  }
+
+  numBytesSkipped = startCode - from;
+  fCurParserIndex += numBytesSkipped;
+  fRemainingUnparsedBits = 0;
+  return from;
+}
+
 void StreamParser::skipBits(unsigned numBits) {
   if (numBits <= fRemainingUnparsedBits) {
     fRemainingUnparsedBits -= numBits;
@@ -112,47 +212,68 @@ unsigned StreamParser::getBits(unsigned numBits) {
   }
 }
 
-unsigned StreamParser::bankSize() const {
-  return BANK_SIZE;
-}
-
 #define NO_MORE_BUFFERED_INPUT 1
 
 void StreamParser::ensureValidBytes1(unsigned numBytesNeeded) {
+  if (fMappedInputSource != NULL) {
+    // Our input is memory-mapped, so we can get more bytes immediately - without copying them - unless we're at EOF:
+    if (getMoreMappedBytes(numBytesNeeded)) return;
+
+    // We're at EOF.  Ask our input source for more data anyway, so that it handles this as usual:
+    fInputSource->getNextFrame(&curBank()[fTotNumValidBytes], 0,
+			       afterGettingBytes, this,
+			       onInputClosure, this);
+
+    throw NO_MORE_BUFFERED_INPUT;
+  }
+
   // We need to read some more bytes from the input source.
   // First, clarify how much data to ask for:
   unsigned maxInputFrameSize = fInputSource->maxFrameSize();
   if (maxInputFrameSize > numBytesNeeded) numBytesNeeded = maxInputFrameSize;
 
-  // First, check whether these new bytes would overflow the current
-  // bank.  If so, start using a new bank now.
-  if (fCurParserIndex + numBytesNeeded > BANK_SIZE) {
-    // Swap banks, but save any still-needed bytes from the old bank:
+  // First, check whether these new bytes would overflow the bank.  If so, move the bytes that we still need (i.e.,
+  // those from the saved parse position onwards) to the start of the bank:
+  if (fCurParserIndex + numBytesNeeded > fBankSize) {
     unsigned numBytesToSave = fTotNumValidBytes - fSavedParserIndex;
     unsigned char const* from = &curBank()[fSavedParserIndex];
-
-    fCurBankNum = (fCurBankNum + 1)%2;
-    fCurBank = fBank[fCurBankNum];
-    memmove(curBank(), from, numBytesToSave);
+    unsigned numBytesToFit = (fCurParserIndex - fSavedParserIndex) + numBytesNeeded;
+
+    if (numBytesToFit > fBankSize/2 && fBankSize < fMaxBankSize) {
+      // These bytes would fill more than half of the bank (e.g., because we're parsing a large frame), so first
+      // enlarge the bank - by doubling it, until they fill no more than half.  This ensures that (no matter how large
+      // the frames are) we don't move much more data than we read.
+      unsigned newBankSize = fBankSize;
+      do newBankSize *= 2; while (numBytesToFit > newBankSize/2 && newBankSize < fMaxBankSize);
+      if (newBankSize > fMaxBankSize) newBankSize = fMaxBankSize;
+
+      unsigned char* newBank = new unsigned char[newBankSize];
+      memcpy(newBank, from, numBytesToSave);
+      delete[] fBank;
+      fBank = newBank;
+      fBankSize = newBankSize;
+    } else {
+      memmove(curBank(), from, numBytesToSave);
+    }
     fCurParserIndex = fCurParserIndex - fSavedParserIndex;
     fSavedParserIndex = 0;
     fTotNumValidBytes = numBytesToSave;
   }
 
   // ASSERT: fCurParserIndex + numBytesNeeded > fTotNumValidBytes
-  //      && fCurParserIndex + numBytesNeeded <= BANK_SIZE
-  if (fCurParserIndex + numBytesNeeded > BANK_SIZE) {
-    // If this happens, it means that we have too much saved parser state.
-    // To fix this, increase BANK_SIZE as appropriate.
+  //      && fCurParserIndex + numBytesNeeded <= fBankSize
+  if (fCurParserIndex + numBytesNeeded > fBankSize) {
+    // If this happens, it means that we have too much saved parser state - more than our maximum bank size.
+    // To fix this, call "setMaxBankSize()" with a larger size.
     fInputSource->envir() << "StreamParser internal error ("
 			  << fCurParserIndex << " + "
 			  << numBytesNeeded << " > "
-			  << BANK_SIZE << ")\n";
+			  << fBankSize << ")\n";
     fInputSource->envir().internalError();
   }
 
-  // Try to read as many new bytes as will fit in the current bank:
-  unsigned maxNumBytesToRead = BANK_SIZE - fTotNumValidBytes;
+  // Try to read as many new bytes as will fit in the bank:
+  unsigned maxNumBytesToRead = fBankSize - fTotNumValidBytes;
   fInputSource->getNextFrame(&curBank()[fTotNumValidBytes],
 			     maxNumBytesToRead,
 			     afterGettingBytes, this,
@@ -161,6 +282,35 @@ void StreamParser::ensureValidBytes1(unsigned numBytesNeeded) {
   throw NO_MORE_BUFFERED_INPUT;
 }
 
+Boolean StreamParser::getMoreMappedBytes(unsigned numBytesNeeded) {
+  // Our 'bank' is a window onto the input source's mapping.  Move the start of this window up to the saved parse
+  // position (because we no longer need the bytes before it), then extend the window by (at least) the bytes we need:
+  if (fSavedParserIndex > 0) {
+    fBank += fSavedParserIndex;
+    fCurParserIndex -= fSavedParserIndex;
+    fTotNumValidBytes -= fSavedParserIndex;
+    fSavedParserIndex = 0;
+  }
+
+  while (fCurParserIndex + numBytesNeeded > fTotNumValidBytes) {
+    unsigned numBytesToGet = fCurParserIndex + numBytesNeeded - fTotNumValidBytes;
+    if (numBytesToGet < MAPPED_BANK_INCREMENT) numBytesToGet = MAPPED_BANK_INCREMENT;
+
+    unsigned numBytesGot;
+    unsigned char const* ptr = fMappedInputSource->getMappedBytes(numBytesToGet, numBytesGot);
+    if (numBytesGot == 0) return False; // EOF
+
+    if (fTotNumValidBytes == 0 || ptr != &fBank[fTotNumValidBytes]) {
+      // Start a new window (e.g., because this is our first data, or because the source was seeked):
+      fBank = (unsigned char*)ptr;
+      fCurParserIndex = fSavedParserIndex = fTotNumValidBytes = 0;
+    }
+    fTotNumValidBytes += numBytesGot;
+  }
+
+  return True;
+}
+
 void StreamParser::afterGettingBytes(void* clientData,
 				     unsigned numBytesRead,
 				     unsigned /*numTruncatedBytes*/,
@@ -172,11 +322,11 @@ void StreamParser::afterGettingBytes(void* clientData,
 
 void StreamParser::afterGettingBytes1(unsigned numBytesRead, struct timeval presentationTime) {
   // Sanity check: Make sure we didn't get too many bytes for our bank:
-  if (fTotNumValidBytes + numBytesRead > BANK_SIZE) {
+  if (fMappedInputSource == NULL && fTotNumValidBytes + numBytesRead > fBankSize) {
     fInputSource->envir()
       << "StreamParser::afterGettingBytes() warning: read "
       << numBytesRead << " bytes; expected no more than "
-      << BANK_SIZE - fTotNumValidBytes << "\n";
+      << fBankSize - fTotNumValidBytes << "\n";
   }
 
   fLastSeenPresentationTime = presentationTime;
@@ -29,6 +29,14 @@ class StreamParser {
 public:
   virtual void flushInput();
 
+  void setMaxBankSize(unsigned maxBankSize);
+      // Our input data is stored in a 'bank' that grows - as needed - to hold whatever data is being parsed (e.g., a
+      // large video frame).  This sets the largest size to which it may grow.
+
+  static unsigned char const* findStartCode(unsigned char const* from, unsigned char const* end);
+      // Returns a pointer to the first 'start code prefix' (0x000001) that lies entirely within [from, end), or "end"
+      // if there's none.  (This is done many bytes at a time, using SIMD instructions if they're available.)
+
 protected: // we're a virtual base class
   typedef void (clientContinueFunc)(void* clientData,
 				    unsigned char* ptr, unsigned size,
@@ -93,6 +101,11 @@ protected: // we're a virtual base class
     fCurParserIndex += numBytes;
   }
 
+  unsigned char const* skipBytesBeforeStartCode(unsigned& numBytesSkipped);
+      // Skips over those bytes - among the ones that we've already read - that precede the next start code
+      // (0x000001, or 0x00000001).  (If we haven't read a start code yet, we skip all but the last 3 bytes, because
+      // these might begin one.)  Returns a pointer to the skipped bytes, which remain valid until we next read input.
+
   void skipBits(unsigned numBits);
   unsigned getBits(unsigned numBits);
       // numBits <= 32; returns data into low-order bits of result
@@ -103,10 +116,10 @@ protected: // we're a virtual base class
 
   Boolean haveSeenEOF() const { return fHaveSeenEOF; }
 
-  unsigned bankSize() const;
+  unsigned bankSize() const { return fBankSize; } // the current size
 
 private:
-  unsigned char* curBank() { return fCurBank; }
+  unsigned char* curBank() { return fBank; }
   unsigned char* nextToParse() { return &curBank()[fCurParserIndex]; }
   unsigned char* lastParsed() { return &curBank()[fCurParserIndex-1]; }
 
@@ -118,6 +131,7 @@ private:
     ensureValidBytes1(numBytesNeeded);
   }
   void ensureValidBytes1(unsigned numBytesNeeded);
+  Boolean getMoreMappedBytes(unsigned numBytesNeeded);
 
   static void afterGettingBytes(void* clientData, unsigned numBytesRead,
 				unsigned numTruncatedBytes,
@@ -130,15 +144,16 @@ private:
 
 private:
   FramedSource* fInputSource; // should be a byte-stream source??
+  class MappedFileSource* fMappedInputSource; // non-NULL iff "fInputSource" is a "MappedFileSource"
   FramedSource::onCloseFunc* fClientOnInputCloseFunc;
   void* fClientOnInputCloseClientData;
   clientContinueFunc* fClientContinueFunc;
   void* fClientContinueClientData;
 
-  // Use a pair of 'banks', and swap between them as they fill up:
-  unsigned char* fBank[2];
-  unsigned char fCurBankNum;
-  unsigned char* fCurBank;
+  // Use a single 'bank'.  When it fills up, we move any still-needed bytes to its start (enlarging it if necessary).
+  // (However, if our input source is a "MappedFileSource", then the 'bank' is instead a window onto its mapping.)
+  unsigned char* fBank;
+  unsigned fBankSize, fMaxBankSize;
 
   // The most recent 'saved' parse position:
   unsigned fSavedParserIndex; // <= fCurParserIndex
@@ -149,7 +164,7 @@ private:
   unsigned char fRemainingUnparsedBits; // in previous byte: [0,7]
 
   // The total number of valid bytes stored in the current bank:
-  unsigned fTotNumValidBytes; // <= BANK_SIZE
+  unsigned fTotNumValidBytes; // <= fBankSize
 
   // Whether we have seen EOF on the input source:
   Boolean fHaveSeenEOF;
@@ -19,10 +19,15 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation.
 
 #include "StreamReplicator.hh"
+#include "MediaSink.hh" // for "OutPacketBuffer::maxSize"
+#include "H264or5VideoStreamFramer.hh" // for "isH264or5KeyFrameNALUnitType()"
 
 ////////// Definition of "StreamReplica": The class that implements each stream replica //////////
 
 class StreamReplica: public FramedSource {
+public: // redefined virtual functions:
+  virtual void requestKeyFrame(); // passes the request on to our replicator's input source
+
 protected:
   friend class StreamReplicator;
   StreamReplica(StreamReplicator& ourReplicator); // called only by "StreamReplicator::createStreamReplica()"
@@ -41,24 +46,83 @@ private:
 
   // Replicas that are currently awaiting data are kept in a (singly-linked) list:
   StreamReplica* fNext;
+
+  // Used only when our replicator has a 'frame ring':
+  u_int64_t fNextFrameNumber; // the number of the frame that we'll read next
+  ReplicatedFrame* fDeliveredFrame; // the frame that we most recently delivered (and still hold a reference to)
+  unsigned fNumFramesSkipped;
 };
 
 
+////////// ReplicatedFrame implementation //////////
+
+ReplicatedFrame::ReplicatedFrame(StreamReplicator* ourReplicator, unsigned bufferSize, ReplicatedFrame* nextInAllFramesList)
+  : fOurReplicator(ourReplicator), fNextInAllFramesList(nextInAllFramesList), fNextFree(NULL), fReferenceCount(0),
+    fData(new unsigned char[bufferSize]), fBufferSize(bufferSize), fFrameSize(0), fNumTruncatedBytes(0),
+    fDurationInMicroseconds(0) {
+  fPresentationTime.tv_sec = fPresentationTime.tv_usec = 0;
+}
+
+ReplicatedFrame::~ReplicatedFrame() {
+  delete[] fData;
+}
+
+void ReplicatedFrame::decrementReferenceCount() {
+  if (fReferenceCount > 0) --fReferenceCount;
+  if (fReferenceCount == 0) {
+    if (fOurReplicator != NULL) {
+      fOurReplicator->freeReplicatedFrame(this);
+    } else {
+      delete this; // our replicator has already gone away
+    }
+  }
+}
+
+
 ////////// StreamReplicator implementation //////////
 
-StreamReplicator* StreamReplicator::createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies) {
-  return new StreamReplicator(env, inputSource, deleteWhenLastReplicaDies);
+StreamReplicator* StreamReplicator::createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies,
+					     unsigned frameRingSize) {
+  return new StreamReplicator(env, inputSource, deleteWhenLastReplicaDies, frameRingSize);
 }
 
-StreamReplicator::StreamReplicator(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies)
+StreamReplicator::StreamReplicator(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies,
+				   unsigned frameRingSize)
   : Medium(env),
     fInputSource(inputSource), fDeleteWhenLastReplicaDies(deleteWhenLastReplicaDies), fInputSourceHasClosed(False),
     fNumReplicas(0), fNumActiveReplicas(0), fNumDeliveriesMadeSoFar(0),
-    fFrameIndex(0), fMasterReplica(NULL), fReplicasAwaitingCurrentFrame(NULL), fReplicasAwaitingNextFrame(NULL) {
+    fFrameIndex(0), fMasterReplica(NULL), fReplicasAwaitingCurrentFrame(NULL), fReplicasAwaitingNextFrame(NULL),
+    fFrameRingSize(frameRingSize), fLastReplicaAwaitingNextFrame(NULL), fFrameRing(NULL), fNumFramesReadIntoRing(0),
+    fFrameBeingRead(NULL), fAllFrames(NULL), fFreeFrames(NULL), fFrameBufferSize(OutPacketBuffer::maxSize),
+    fGOPCacheHNumber(0), fGOPBurstSpeedup(0), fHaveKeyFrame(False), fPreviousFrameWasKeyFrame(False), fKeyFrameNumber(0) {
+  if (fFrameRingSize > 0) {
+    fFrameRing = new ReplicatedFrame*[fFrameRingSize];
+    for (unsigned i = 0; i < fFrameRingSize; ++i) fFrameRing[i] = NULL;
+  }
 }
 
 StreamReplicator::~StreamReplicator() {
   Medium::close(fInputSource);
+
+  if (fFrameRing != NULL) {
+    for (unsigned i = 0; i < fFrameRingSize; ++i) {
+      if (fFrameRing[i] != NULL) fFrameRing[i]->decrementReferenceCount();
+    }
+    delete[] fFrameRing;
+  }
+
+  // Delete each of our frames that's no longer referenced.  (Any that are still referenced will be deleted later,
+  // when their reference count drops to 0.)
+  ReplicatedFrame* frame = fAllFrames;
+  while (frame != NULL) {
+    ReplicatedFrame* next = frame->fNextInAllFramesList;
+    if (frame->fReferenceCount == 0) {
+      delete frame;
+    } else {
+      frame->fOurReplicator = NULL;
+    }
+    frame = next;
+  }
 }
 
 FramedSource* StreamReplicator::createStreamReplica() {
@@ -66,7 +130,35 @@ FramedSource* StreamReplicator::createStreamReplica() {
   return new StreamReplica(*this);
 }
 
+Boolean StreamReplicator::enableGOPCache(unsigned burstSpeedup) {
+  if (fFrameRingSize == 0 || fInputSource == NULL) return False;
+
+  if (fInputSource->isH264VideoStreamFramer()) {
+    fGOPCacheHNumber = 264;
+  } else if (fInputSource->isH265VideoStreamFramer()) {
+    fGOPCacheHNumber = 265;
+  } else {
+    return False;
+  }
+  fGOPBurstSpeedup = burstSpeedup;
+
+  return True;
+}
+
+ReplicatedFrame* StreamReplicator::deliveredFrame(FramedSource* replica) {
+  return replica == NULL ? NULL : ((StreamReplica*)replica)->fDeliveredFrame;
+}
+
+unsigned StreamReplicator::numFramesSkipped(FramedSource* replica) {
+  return replica == NULL ? 0 : ((StreamReplica*)replica)->fNumFramesSkipped;
+}
+
 void StreamReplicator::getNextFrame(StreamReplica* replica) {
+  if (fFrameRingSize > 0) {
+    getNextFrameFromRing(replica);
+    return;
+  }
+
   if (fInputSourceHasClosed) { // handle closure instead
     replica->handleClosure();
     return;
@@ -103,6 +195,11 @@ void StreamReplicator::getNextFrame(StreamReplica* replica) {
 }
 
 void StreamReplicator::deactivateStreamReplica(StreamReplica* replicaBeingDeactivated) {
+  if (fFrameRingSize > 0) {
+    deactivateRingReplica(replicaBeingDeactivated);
+    return;
+  }
+
   if (replicaBeingDeactivated->fFrameIndex == -1) return; // this replica has already been deactivated (or was never activated at all)
 
   // Assert: fNumActiveReplicas > 0
@@ -206,7 +303,12 @@ void StreamReplicator::removeStreamReplica(StreamReplica* replicaBeingRemoved) {
 
 void StreamReplicator::afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
 					 struct timeval presentationTime, unsigned durationInMicroseconds) {
-  ((StreamReplicator*)clientData)->afterGettingFrame(frameSize, numTruncatedBytes, presentationTime, durationInMicroseconds);
+  StreamReplicator* replicator = (StreamReplicator*)clientData;
+  if (replicator->fFrameRingSize > 0) {
+    replicator->afterGettingFrameIntoRing(frameSize, numTruncatedBytes, presentationTime, durationInMicroseconds);
+  } else {
+    replicator->afterGettingFrame(frameSize, numTruncatedBytes, presentationTime, durationInMicroseconds);
+  }
 }
 
 void StreamReplicator::afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes,
@@ -235,6 +337,7 @@ void StreamReplicator::onSourceClosure() {
     replica->fNext = NULL;
     replica->handleClosure();
   }
+  fLastReplicaAwaitingNextFrame = NULL;
   while ((replica = fReplicasAwaitingNextFrame) != NULL) {
     fReplicasAwaitingNextFrame = replica->fNext;
     replica->fNext = NULL;
@@ -298,13 +401,191 @@ void StreamReplicator::deliverReceivedFrame() {
   }
 }
 
+void StreamReplicator::getNextFrameFromRing(StreamReplica* replica) {
+  // First, release the frame (if any) that we delivered to this replica last time:
+  if (replica->fDeliveredFrame != NULL) {
+    replica->fDeliveredFrame->decrementReferenceCount();
+    replica->fDeliveredFrame = NULL;
+  }
+
+  if (replica->fFrameIndex == -1) {
+    // This replica had stopped playing (or had just been created), but is now actively reading.  Note this.
+    // It will get the next frame that we read - or, if we have a GOP cache, the most recent key frame:
+    replica->fFrameIndex = 0;
+    replica->fNextFrameNumber = fNumFramesReadIntoRing;
+    ++fNumActiveReplicas;
+
+    u_int64_t oldestFrameNumber = fNumFramesReadIntoRing > fFrameRingSize ? fNumFramesReadIntoRing - fFrameRingSize : 0;
+    if (fGOPCacheHNumber != 0 && fHaveKeyFrame && fKeyFrameNumber >= oldestFrameNumber) {
+      replica->fNextFrameNumber = fKeyFrameNumber;
+    }
+  }
+
+  if (replica->fNextFrameNumber < fNumFramesReadIntoRing) {
+    // The frame that this replica wants has already been read, so deliver it now:
+    deliverFrameFromRing(replica);
+  } else if (fInputSourceHasClosed) { // handle closure instead
+    replica->handleClosure();
+  } else {
+    // Enqueue this replica (at the end of the queue), to await the next frame:
+    replica->fNext = NULL;
+    if (fLastReplicaAwaitingNextFrame == NULL) {
+      fReplicasAwaitingNextFrame = replica;
+    } else {
+      fLastReplicaAwaitingNextFrame->fNext = replica;
+    }
+    fLastReplicaAwaitingNextFrame = replica;
+
+    if (fInputSource != NULL && !fInputSource->isCurrentlyAwaitingData()) readFrameIntoRing();
+  }
+}
+
+void StreamReplicator::deactivateRingReplica(StreamReplica* replicaBeingDeactivated) {
+  if (replicaBeingDeactivated->fDeliveredFrame != NULL) {
+    replicaBeingDeactivated->fDeliveredFrame->decrementReferenceCount();
+    replicaBeingDeactivated->fDeliveredFrame = NULL;
+  }
+  if (replicaBeingDeactivated->fFrameIndex == -1) return; // this replica has already been deactivated (or was never activated at all)
+
+  // Assert: fNumActiveReplicas > 0
+  if (fNumActiveReplicas == 0) fprintf(stderr, "StreamReplicator::deactivateRingReplica() Internal Error!\n"); // should not happen
+  --fNumActiveReplicas;
+  replicaBeingDeactivated->fFrameIndex = -1;
+
+  // Make sure that the replica is not in our queue:
+  StreamReplica* prev = NULL;
+  for (StreamReplica* r = fReplicasAwaitingNextFrame; r != NULL; prev = r, r = r->fNext) {
+    if (r == replicaBeingDeactivated) {
+      if (prev == NULL) fReplicasAwaitingNextFrame = r->fNext; else prev->fNext = r->fNext;
+      if (fLastReplicaAwaitingNextFrame == r) fLastReplicaAwaitingNextFrame = prev;
+      r->fNext = NULL;
+      break;
+    }
+  }
+
+  if (fNumActiveReplicas == 0 && fInputSource != NULL) fInputSource->stopGettingFrames(); // tell our source to stop too
+}
+
+void StreamReplicator::readFrameIntoRing() {
+  if (fFrameBeingRead == NULL) {
+    if (fFreeFrames != NULL) {
+      fFrameBeingRead = fFreeFrames;
+      fFreeFrames = fFreeFrames->fNextFree;
+      fFrameBeingRead->fNextFree = NULL;
+    } else {
+      fFrameBeingRead = fAllFrames = new ReplicatedFrame(this, fFrameBufferSize, fAllFrames);
+    }
+  }
+
+  fInputSource->getNextFrame(fFrameBeingRead->fData, fFrameBeingRead->fBufferSize,
+			     afterGettingFrame, this, onSourceClosure, this);
+}
+
+void StreamReplicator::afterGettingFrameIntoRing(unsigned frameSize, unsigned numTruncatedBytes,
+						 struct timeval presentationTime, unsigned durationInMicroseconds) {
+  ReplicatedFrame* frame = fFrameBeingRead;
+  fFrameBeingRead = NULL;
+  frame->fFrameSize = frameSize;
+  frame->fNumTruncatedBytes = numTruncatedBytes;
+  frame->fPresentationTime = presentationTime;
+  frame->fDurationInMicroseconds = durationInMicroseconds;
+
+  // Add the frame to the ring (which holds a reference to it), replacing the oldest frame:
+  ReplicatedFrame*& ringSlot = fFrameRing[fNumFramesReadIntoRing%fFrameRingSize];
+  if (ringSlot != NULL) ringSlot->decrementReferenceCount();
+  ringSlot = frame;
+  frame->incrementReferenceCount();
+
+  if (fGOPCacheHNumber != 0) {
+    // Check whether this frame (a NAL unit, possibly preceded by a 'start code') begins a key frame.  (A key frame begins
+    // with the first of a sequence of 'key frame' NAL units - e.g., SPS, PPS, (SEI,) IDR.)
+    unsigned char const* nalUnit = frame->fData;
+    unsigned nalUnitSize = frame->fFrameSize;
+    if (nalUnitSize >= 4 && nalUnit[0] == 0 && nalUnit[1] == 0 && nalUnit[2] == 0 && nalUnit[3] == 1) {
+      nalUnit += 4; nalUnitSize -= 4;
+    } else if (nalUnitSize >= 3 && nalUnit[0] == 0 && nalUnit[1] == 0 && nalUnit[2] == 1) {
+      nalUnit += 3; nalUnitSize -= 3;
+    }
+
+    if (nalUnitSize > 0) {
+      u_int8_t nal_unit_type = fGOPCacheHNumber == 264 ? nalUnit[0]&0x1F : (nalUnit[0]&0x7E)>>1;
+
+      // SEI, 'access unit delimiter', 'end of sequence/stream', and 'filler data' NAL units often appear among (e.g.,
+      // between the parameter sets and the IDR of) a key frame's NAL units, so they neither begin nor end a sequence:
+      Boolean isNeutralNALUnit = fGOPCacheHNumber == 264
+	? (nal_unit_type == 6 || (nal_unit_type >= 9 && nal_unit_type <= 12))
+	: (nal_unit_type >= 35 && nal_unit_type <= 40);
+      if (!isNeutralNALUnit) {
+	Boolean isKeyFrameNALUnit = isH264or5KeyFrameNALUnitType(fGOPCacheHNumber, nal_unit_type);
+	if (isKeyFrameNALUnit && !fPreviousFrameWasKeyFrame) {
+	  fKeyFrameNumber = fNumFramesReadIntoRing;
+	  fHaveKeyFrame = True;
+	}
+	fPreviousFrameWasKeyFrame = isKeyFrameNALUnit;
+      }
+    }
+  }
+  ++fNumFramesReadIntoRing;
+
+  // Deliver frames to the replicas that are waiting for them.  Because a replica might request (and even be delivered)
+  // another frame during delivery, we take each replica from the head of the queue, stopping at the first replica
+  // that's waiting for a frame that we haven't yet read:
+  StreamReplica* replica;
+  while ((replica = fReplicasAwaitingNextFrame) != NULL && replica->fNextFrameNumber < fNumFramesReadIntoRing) {
+    fReplicasAwaitingNextFrame = replica->fNext;
+    if (fReplicasAwaitingNextFrame == NULL) fLastReplicaAwaitingNextFrame = NULL;
+    replica->fNext = NULL;
+
+    deliverFrameFromRing(replica);
+  }
+}
+
+void StreamReplicator::deliverFrameFromRing(StreamReplica* replica) {
+  // If the frame that this replica wants has already left the ring, skip ahead to the oldest frame that's still there:
+  u_int64_t oldestFrameNumber = fNumFramesReadIntoRing > fFrameRingSize ? fNumFramesReadIntoRing - fFrameRingSize : 0;
+  if (replica->fNextFrameNumber < oldestFrameNumber) {
+    replica->fNumFramesSkipped += (unsigned)(oldestFrameNumber - replica->fNextFrameNumber);
+    replica->fNextFrameNumber = oldestFrameNumber;
+  }
+
+  ReplicatedFrame* frame = fFrameRing[(replica->fNextFrameNumber++)%fFrameRingSize];
+  frame->incrementReferenceCount();
+  replica->fDeliveredFrame = frame;
+
+  if (replica->fTo == NULL) {
+    // The replica's reader is 'borrowing' the frame (using "deliveredFrame()"), rather than having it copied:
+    replica->fFrameSize = frame->fFrameSize;
+    replica->fNumTruncatedBytes = frame->fNumTruncatedBytes;
+  } else {
+    unsigned numNewBytesToTruncate
+      = replica->fMaxSize < frame->fFrameSize ? frame->fFrameSize - replica->fMaxSize : 0;
+    replica->fFrameSize = frame->fFrameSize - numNewBytesToTruncate;
+    replica->fNumTruncatedBytes = frame->fNumTruncatedBytes + numNewBytesToTruncate;
+    memmove(replica->fTo, frame->fData, replica->fFrameSize);
+  }
+  replica->fPresentationTime = frame->fPresentationTime;
+  replica->fDurationInMicroseconds = frame->fDurationInMicroseconds;
+  if (fGOPCacheHNumber != 0 && replica->fNextFrameNumber < fNumFramesReadIntoRing) {
+    // This replica has not yet caught up with our input source, so speed up its delivery:
+    replica->fDurationInMicroseconds = fGOPBurstSpeedup == 0 ? 0 : replica->fDurationInMicroseconds/fGOPBurstSpeedup;
+  }
+
+  FramedSource::afterGetting(replica);
+}
+
+void StreamReplicator::freeReplicatedFrame(ReplicatedFrame* frame) {
+  frame->fNextFree = fFreeFrames;
+  fFreeFrames = frame;
+}
+
 
 ////////// StreamReplica implementation //////////
 
 StreamReplica::StreamReplica(StreamReplicator& ourReplicator)
   : FramedSource(ourReplicator.envir()),
     fOurReplicator(ourReplicator),
-    fFrameIndex(-1/*we haven't started playing yet*/), fNext(NULL) {
+    fFrameIndex(-1/*we haven't started playing yet*/), fNext(NULL),
+    fNextFrameNumber(0), fDeliveredFrame(NULL), fNumFramesSkipped(0) {
 }
 
 StreamReplica::~StreamReplica() {
@@ -319,6 +600,10 @@ void StreamReplica::doStopGettingFrames() {
   fOurReplicator.deactivateStreamReplica(this);
 }
 
+void StreamReplica::requestKeyFrame() {
+  if (fOurReplicator.inputSource() != NULL) fOurReplicator.inputSource()->requestKeyFrame();
+}
+
 void StreamReplica::copyReceivedFrame(StreamReplica* toReplica, StreamReplica* fromReplica) {
   // First, figure out how much data to copy.  ("toReplica" might have a smaller buffer than "fromReplica".)
   unsigned numNewBytesToTruncate
@@ -0,0 +1,447 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// Transport-wide congestion control ("draft-holmer-rmcat-transport-wide-cc-extensions-01")
+// Implementation
+
+#include "TransportWideCC.hh"
+#include "GroupsockHelper.hh"
+#include <math.h>
+
+// Packet status symbols (in feedback packets):
+#define STATUS_NOT_RECEIVED 0
+#define STATUS_SMALL_DELTA 1 // received; the receive delta fits in 1 byte (unsigned)
+#define STATUS_LARGE_DELTA 2 // received; the receive delta needs 2 bytes (signed)
+
+#define REFERENCE_TIME_UNIT 64000 // microseconds
+#define RECEIVE_DELTA_UNIT 250 // microseconds
+
+static int64_t uSecondsOf(struct timeval const& tv) {
+  return (int64_t)tv.tv_sec*1000000 + tv.tv_usec;
+}
+
+////////// TransportWideCCFeedbackGenerator //////////
+
+TransportWideCCFeedbackGenerator::TransportWideCCFeedbackGenerator()
+  : fHaveSeenPacket(False), fNextSeqNoToReport(0), fHighestSeqNo(0),
+    fFeedbackPacketCount(0), fNumFeedbacksGenerated(0) {
+  for (unsigned i = 0; i < TWCC_WINDOW_SIZE; ++i) fPackets[i].arrived = False;
+  gettimeofday(&fCreationTime, NULL);
+}
+
+TransportWideCCFeedbackGenerator::~TransportWideCCFeedbackGenerator() {
+}
+
+void TransportWideCCFeedbackGenerator
+::noteIncomingPacket(u_int16_t transportSeqNo, struct timeval const& timeReceived) {
+  if (!fHaveSeenPacket) {
+    fHaveSeenPacket = True;
+    fNextSeqNoToReport = fHighestSeqNo = transportSeqNo;
+  } else {
+    if ((int16_t)(transportSeqNo - fNextSeqNoToReport) < 0) return; // too late; we've already reported it (as lost)
+    if ((int16_t)(transportSeqNo - fHighestSeqNo) > 0) fHighestSeqNo = transportSeqNo;
+    if ((u_int16_t)(fHighestSeqNo - fNextSeqNoToReport) >= TWCC_WINDOW_SIZE) {
+      // We've fallen too far behind in reporting packets, so don't report the oldest ones:
+      fNextSeqNoToReport = fHighestSeqNo - (TWCC_WINDOW_SIZE-1);
+    }
+  }
+
+  ArrivedPacket& packet = fPackets[transportSeqNo%TWCC_WINDOW_SIZE];
+  if (packet.arrived && packet.seqNo == transportSeqNo) return; // a duplicate
+  packet.arrived = True;
+  packet.seqNo = transportSeqNo;
+  packet.timeReceived = uSecondsOf(timeReceived) - uSecondsOf(fCreationTime);
+}
+
+unsigned TransportWideCCFeedbackGenerator::nextFeedback(unsigned char* to, unsigned maxSize) {
+  if (!fHaveSeenPacket || (int16_t)(fHighestSeqNo - fNextSeqNoToReport) < 0) return 0; // nothing to report
+  unsigned numToReport = (u_int16_t)(fHighestSeqNo - fNextSeqNoToReport) + 1;
+
+  // The 'reference time' (in units of 64 ms) is that of the first reported packet that arrived.  (The most
+  // recent packet arrived, so there is one.)
+  int64_t referenceTime = 0;
+  unsigned i;
+  for (i = 0; i < numToReport; ++i) {
+    u_int16_t seqNo = fNextSeqNoToReport + i;
+    ArrivedPacket const& packet = fPackets[seqNo%TWCC_WINDOW_SIZE];
+    if (packet.arrived && packet.seqNo == seqNo) {
+      referenceTime = packet.timeReceived/REFERENCE_TIME_UNIT;
+      break;
+    }
+  }
+
+  // Decide each packet's status (and receive delta), stopping if the feedback would become too big:
+  int64_t prevTimeReceived = referenceTime*REFERENCE_TIME_UNIT;
+  unsigned numDeltaBytes = 0;
+  unsigned numStatuses;
+  for (numStatuses = 0; numStatuses < numToReport; ++numStatuses) {
+    u_int16_t seqNo = fNextSeqNoToReport + numStatuses;
+    ArrivedPacket const& packet = fPackets[seqNo%TWCC_WINDOW_SIZE];
+    unsigned char symbol = STATUS_NOT_RECEIVED;
+    int64_t delta = 0;
+    if (packet.arrived && packet.seqNo == seqNo) {
+      delta = (packet.timeReceived - prevTimeReceived)/RECEIVE_DELTA_UNIT;
+      if (delta >= 0 && delta <= 0xFF) {
+	symbol = STATUS_SMALL_DELTA;
+      } else if (delta >= -0x8000 && delta <= 0x7FFF) {
+	symbol = STATUS_LARGE_DELTA;
+      } else {
+	break; // this packet's arrival time can't be given relative to the previous one's; report it next time
+      }
+    }
+
+    // (A status chunk holds (at least) 7 statuses, and the FCI is padded to a multiple of 4 bytes.)
+    unsigned newNumDeltaBytes = numDeltaBytes + symbol; // (the symbol is also the size of its receive delta)
+    if (((8 + 2*((numStatuses+1+6)/7) + newNumDeltaBytes + 3)&~3) > maxSize) break;
+
+    fStatuses[numStatuses] = symbol;
+    fDeltas[numStatuses] = (int16_t)delta;
+    numDeltaBytes = newNumDeltaBytes;
+    if (symbol != STATUS_NOT_RECEIVED) prevTimeReceived += delta*RECEIVE_DELTA_UNIT;
+  }
+  if (numStatuses == 0) return 0;
+
+  // Now, write the feedback.  First, the base sequence number, the packet status count, the reference time, and the
+  // feedback packet count:
+  unsigned char* ptr = to;
+  *ptr++ = fNextSeqNoToReport>>8; *ptr++ = (unsigned char)fNextSeqNoToReport;
+  *ptr++ = numStatuses>>8; *ptr++ = (unsigned char)numStatuses;
+  *ptr++ = (unsigned char)(referenceTime>>16); *ptr++ = (unsigned char)(referenceTime>>8);
+  *ptr++ = (unsigned char)referenceTime;
+  *ptr++ = fFeedbackPacketCount++;
+
+  // Then, the packet status chunks.  We use a 'run length' chunk for a long run of the same status; otherwise a
+  // 'status vector' chunk with 7 2-bit statuses:
+  for (i = 0; i < numStatuses; ) {
+    unsigned runLength = 1;
+    while (i + runLength < numStatuses && fStatuses[i+runLength] == fStatuses[i] && runLength < 0x1FFF) ++runLength;
+
+    u_int16_t chunk;
+    if (runLength >= 14) {
+      chunk = (fStatuses[i]<<13)|runLength;
+      i += runLength;
+    } else {
+      chunk = 0xC000;
+      for (unsigned j = 0; j < 7; ++j) {
+	if (i + j < numStatuses) chunk |= fStatuses[i+j]<<(12-2*j);
+      }
+      i += 7;
+    }
+    *ptr++ = chunk>>8; *ptr++ = (unsigned char)chunk;
+  }
+
+  // Then, the receive deltas:
+  for (i = 0; i < numStatuses; ++i) {
+    if (fStatuses[i] == STATUS_SMALL_DELTA) {
+      *ptr++ = (unsigned char)fDeltas[i];
+    } else if (fStatuses[i] == STATUS_LARGE_DELTA) {
+      *ptr++ = (u_int16_t)fDeltas[i]>>8; *ptr++ = (unsigned char)fDeltas[i];
+    }
+  }
+  while (((ptr - to)&3) != 0) *ptr++ = 0; // padding
+
+  // Forget the packets that we've now reported:
+  for (i = 0; i < numStatuses; ++i) fPackets[(u_int16_t)(fNextSeqNoToReport + i)%TWCC_WINDOW_SIZE].arrived = False;
+  fNextSeqNoToReport += numStatuses;
+  ++fNumFeedbacksGenerated;
+
+  return ptr - to;
+}
+
+
+////////// SendSideBandwidthEstimator //////////
+
+// Parameters of the delay-based estimation (mostly those suggested in "draft-ietf-rmcat-gcc-02"):
+#define BURST_TIME_INTERVAL 5000 // microseconds: packets sent within this interval are treated as a group
+#define TREND_SMOOTHING_COEFFICIENT 0.9
+#define TREND_THRESHOLD_GAIN 4.0
+#define MAX_NUM_DELTAS_FOR_TREND 60
+#define INITIAL_OVERUSE_THRESHOLD 12.5 // ms
+#define MIN_OVERUSE_THRESHOLD 6.0
+#define MAX_OVERUSE_THRESHOLD 600.0
+#define OVERUSE_THRESHOLD_K_UP 0.0087
+#define OVERUSE_THRESHOLD_K_DOWN 0.039
+#define OVERUSING_TIME_THRESHOLD 10.0 // ms
+
+// Parameters of the rate control:
+#define DECREASE_FACTOR 0.85 // on overuse, the bitrate becomes this times the acked bitrate
+#define MIN_DECREASE_INTERVAL 200000 // microseconds (roughly, a round trip time)
+#define INCREASE_FACTOR_PER_SECOND 1.08
+#define ACKED_BITRATE_WINDOW 500000 // microseconds
+#define LOSS_UPDATE_MIN_NUM_PACKETS 20
+#define HIGH_LOSS_FRACTION 0.10
+#define LOW_LOSS_FRACTION 0.02
+#define MIN_LOSS_DECREASE_INTERVAL 300000 // microseconds
+
+SendSideBandwidthEstimator
+::SendSideBandwidthEstimator(unsigned initialBitrate, unsigned minBitrate, unsigned maxBitrate)
+  : fMinBitrate(minBitrate), fMaxBitrate(maxBitrate < minBitrate ? minBitrate : maxBitrate),
+    fHaveCurrentGroup(False), fHavePreviousGroup(False),
+    fFirstArrivalTimeMs(0.0), fAccumulatedDelay(0.0), fSmoothedDelay(0.0),
+    fNumTrendSamples(0), fNextTrendSample(0), fNumDeltas(0),
+    fModifiedTrend(0.0), fPrevModifiedTrend(0.0), fThreshold(INITIAL_OVERUSE_THRESHOLD), fLastThresholdUpdateMs(-1.0),
+    fTimeOverusing(-1.0), fOveruseCounter(0), fBandwidthUsage(normal),
+    fHaveAckedWindow(False), fAckedWindowStart(0), fAckedWindowBytes(0), fAckedBitrate(0),
+    fNumReportedSinceLossUpdate(0), fNumLostSinceLossUpdate(0), fLossFraction(0.0),
+    fLastUpdateTime(0), fLastDecreaseTime(0), fLastLossDecreaseTime(0),
+    fNumFeedbacksReceived(0), fNumPacketsReported(0), fNumPacketsReportedLost(0) {
+  if (initialBitrate < fMinBitrate) initialBitrate = fMinBitrate;
+  else if (initialBitrate > fMaxBitrate) initialBitrate = fMaxBitrate;
+  fTargetBitrate = fDelayBasedBitrate = initialBitrate;
+  fLossBasedBitrate = fMaxBitrate;
+
+  for (unsigned i = 0; i < TWCC_WINDOW_SIZE; ++i) fPackets[i].size = 0;
+}
+
+SendSideBandwidthEstimator::~SendSideBandwidthEstimator() {
+}
+
+void SendSideBandwidthEstimator
+::noteSentPacket(u_int16_t transportSeqNo, unsigned packetSize, struct timeval const& timeSent) {
+  SentPacket& packet = fPackets[transportSeqNo%TWCC_WINDOW_SIZE];
+  packet.reported = False;
+  packet.seqNo = transportSeqNo;
+  packet.size = packetSize;
+  packet.timeSent = uSecondsOf(timeSent);
+}
+
+Boolean SendSideBandwidthEstimator::handleFeedback(unsigned char const* fci, unsigned fciSize) {
+  if (fciSize < 8) return False;
+  u_int16_t baseSeqNo = (fci[0]<<8)|fci[1];
+  unsigned statusCount = (fci[2]<<8)|fci[3];
+  int32_t referenceTime = (fci[4]<<16)|(fci[5]<<8)|fci[6];
+  if ((referenceTime&0x800000) != 0) referenceTime -= 0x1000000; // it's a signed 24-bit value
+  // (fci[7] is the 'feedback packet count', which we don't use)
+  unsigned char const* ptr = &fci[8];
+  unsigned char const* end = &fci[fciSize];
+  ++fNumFeedbacksReceived;
+
+  // Decode the packet status chunks.  (We look at no more than TWCC_WINDOW_SIZE statuses, but we need to get past
+  // all of the chunks to find the receive deltas.)
+  unsigned numStatuses = 0;
+  while (numStatuses < statusCount) {
+    if (ptr + 2 > end) return False;
+    u_int16_t chunk = (ptr[0]<<8)|ptr[1]; ptr += 2;
+    unsigned numInChunk;
+    if ((chunk&0x8000) == 0) { // a 'run length' chunk
+      numInChunk = chunk&0x1FFF;
+      for (unsigned j = 0; j < numInChunk && numStatuses < statusCount; ++j, ++numStatuses) {
+	if (numStatuses < TWCC_WINDOW_SIZE) fStatuses[numStatuses] = (chunk>>13)&0x3;
+      }
+    } else if ((chunk&0x4000) == 0) { // a 'status vector' chunk, with 14 1-bit statuses
+      for (unsigned j = 0; j < 14 && numStatuses < statusCount; ++j, ++numStatuses) {
+	if (numStatuses < TWCC_WINDOW_SIZE) fStatuses[numStatuses] = (chunk>>(13-j))&0x1;
+      }
+    } else { // a 'status vector' chunk, with 7 2-bit statuses
+      for (unsigned j = 0; j < 7 && numStatuses < statusCount; ++j, ++numStatuses) {
+	if (numStatuses < TWCC_WINDOW_SIZE) fStatuses[numStatuses] = (chunk>>(12-2*j))&0x3;
+      }
+    }
+  }
+  if (numStatuses > TWCC_WINDOW_SIZE) numStatuses = TWCC_WINDOW_SIZE;
+
+  // Then use the receive deltas to get the arrival time of each received packet, and match each reported packet
+  // with the packet that we sent:
+  int64_t timeReceived = (int64_t)referenceTime*REFERENCE_TIME_UNIT;
+  for (unsigned i = 0; i < numStatuses; ++i) {
+    unsigned char symbol = fStatuses[i];
+    if (symbol == STATUS_SMALL_DELTA) {
+      if (ptr + 1 > end) break;
+      timeReceived += ptr[0]*RECEIVE_DELTA_UNIT; ptr += 1;
+    } else if (symbol == STATUS_LARGE_DELTA) {
+      if (ptr + 2 > end) break;
+      timeReceived += (int16_t)((ptr[0]<<8)|ptr[1])*RECEIVE_DELTA_UNIT; ptr += 2;
+    } else if (symbol != STATUS_NOT_RECEIVED) {
+      break; // a reserved status value
+    }
+
+    u_int16_t seqNo = baseSeqNo + i;
+    SentPacket& packet = fPackets[seqNo%TWCC_WINDOW_SIZE];
+    if (packet.size == 0 || packet.seqNo != seqNo || packet.reported) continue; // unknown (e.g., too old), or a repeat
+    packet.reported = True;
+    ++fNumPacketsReported; ++fNumReportedSinceLossUpdate;
+
+    if (symbol == STATUS_NOT_RECEIVED) {
+      ++fNumPacketsReportedLost; ++fNumLostSinceLossUpdate;
+    } else {
+      noteArrivedPacket(packet.timeSent, timeReceived, packet.size);
+    }
+  }
+
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  unsigned oldTargetBitrate = fTargetBitrate;
+  updateBitrates(uSecondsOf(timeNow));
+  return fTargetBitrate != oldTargetBitrate;
+}
+
+void SendSideBandwidthEstimator::noteArrivedPacket(int64_t timeSent, int64_t timeReceived, unsigned packetSize) {
+  // Update the 'acked bitrate' - i.e., the rate at which our packets are arriving:
+  if (!fHaveAckedWindow) {
+    fHaveAckedWindow = True;
+    fAckedWindowStart = timeReceived;
+    fAckedWindowBytes = 0;
+  }
+  fAckedWindowBytes += packetSize;
+  int64_t windowDuration = timeReceived - fAckedWindowStart;
+  if (windowDuration >= ACKED_BITRATE_WINDOW) {
+    fAckedBitrate = (unsigned)((fAckedWindowBytes*8*1000000)/windowDuration);
+    fAckedWindowStart = timeReceived;
+    fAckedWindowBytes = 0;
+  }
+
+  // Packets that were sent in a short burst are treated as a group (because the sender's scheduling - not the
+  // path - determined how they were spaced).  Add this packet to the current group, unless it begins a new one:
+  if (!fHaveCurrentGroup) {
+    fHaveCurrentGroup = True;
+    fCurrentGroup.firstTimeSent = fCurrentGroup.lastTimeSent = timeSent;
+    fCurrentGroup.lastTimeReceived = timeReceived;
+    return;
+  }
+  if (timeSent - fCurrentGroup.firstTimeSent <= BURST_TIME_INTERVAL) {
+    if (timeSent > fCurrentGroup.lastTimeSent) fCurrentGroup.lastTimeSent = timeSent;
+    if (timeReceived > fCurrentGroup.lastTimeReceived) fCurrentGroup.lastTimeReceived = timeReceived;
+    return;
+  }
+
+  // This packet begins a new group.  The (now complete) current group arrived later - relative to the previous
+  // group - than it was sent by the 'delay delta', which grows when a queue builds up:
+  if (fHavePreviousGroup) {
+    double sendDeltaMs = (fCurrentGroup.lastTimeSent - fPreviousGroup.lastTimeSent)/1000.0;
+    double arrivalDeltaMs = (fCurrentGroup.lastTimeReceived - fPreviousGroup.lastTimeReceived)/1000.0;
+    updateTrend(arrivalDeltaMs - sendDeltaMs, sendDeltaMs, fCurrentGroup.lastTimeReceived/1000.0);
+  }
+  fPreviousGroup = fCurrentGroup;
+  fHavePreviousGroup = True;
+  fCurrentGroup.firstTimeSent = fCurrentGroup.lastTimeSent = timeSent;
+  fCurrentGroup.lastTimeReceived = timeReceived;
+}
+
+void SendSideBandwidthEstimator::updateTrend(double delayDeltaMs, double sendDeltaMs, double arrivalTimeMs) {
+  // Smooth the accumulated delay, then estimate its trend (slope) - by linear regression - over a window of
+  // recent samples:
+  if (fNumDeltas == 0) fFirstArrivalTimeMs = arrivalTimeMs;
+  if (fNumDeltas < MAX_NUM_DELTAS_FOR_TREND) ++fNumDeltas;
+  fAccumulatedDelay += delayDeltaMs;
+  fSmoothedDelay = TREND_SMOOTHING_COEFFICIENT*fSmoothedDelay + (1 - TREND_SMOOTHING_COEFFICIENT)*fAccumulatedDelay;
+
+  fTrendX[fNextTrendSample] = arrivalTimeMs - fFirstArrivalTimeMs;
+  fTrendY[fNextTrendSample] = fSmoothedDelay;
+  fNextTrendSample = (fNextTrendSample+1)%TWCC_TREND_WINDOW_SIZE;
+  if (fNumTrendSamples < TWCC_TREND_WINDOW_SIZE) ++fNumTrendSamples;
+
+  if (fNumTrendSamples == TWCC_TREND_WINDOW_SIZE) {
+    double meanX = 0.0, meanY = 0.0;
+    unsigned i;
+    for (i = 0; i < TWCC_TREND_WINDOW_SIZE; ++i) { meanX += fTrendX[i]; meanY += fTrendY[i]; }
+    meanX /= TWCC_TREND_WINDOW_SIZE; meanY /= TWCC_TREND_WINDOW_SIZE;
+    double numerator = 0.0, denominator = 0.0;
+    for (i = 0; i < TWCC_TREND_WINDOW_SIZE; ++i) {
+      numerator += (fTrendX[i] - meanX)*(fTrendY[i] - meanY);
+      denominator += (fTrendX[i] - meanX)*(fTrendX[i] - meanX);
+    }
+    if (denominator != 0.0) fModifiedTrend = fNumDeltas*(numerator/denominator)*TREND_THRESHOLD_GAIN;
+  }
+
+  // Compare the trend against our (adaptive) threshold.  We signal 'overuse' only if it has been exceeded for a while
+  // (and isn't decreasing), to avoid reacting to a brief spike:
+  if (fModifiedTrend > fThreshold) {
+    if (fTimeOverusing < 0.0) fTimeOverusing = sendDeltaMs/2; else fTimeOverusing += sendDeltaMs;
+    ++fOveruseCounter;
+    if (fTimeOverusing > OVERUSING_TIME_THRESHOLD && fOveruseCounter > 1 && fModifiedTrend >= fPrevModifiedTrend) {
+      fTimeOverusing = 0.0;
+      fOveruseCounter = 0;
+      fBandwidthUsage = overusing;
+    }
+  } else if (fModifiedTrend < -fThreshold) {
+    fTimeOverusing = -1.0;
+    fOveruseCounter = 0;
+    fBandwidthUsage = underusing;
+  } else {
+    fTimeOverusing = -1.0;
+    fOveruseCounter = 0;
+    fBandwidthUsage = normal;
+  }
+  fPrevModifiedTrend = fModifiedTrend;
+
+  updateThreshold(arrivalTimeMs);
+}
+
+void SendSideBandwidthEstimator::updateThreshold(double arrivalTimeMs) {
+  // The threshold follows the magnitude of the trend - quickly downwards, slowly upwards - so that we don't get
+  // starved by competing (e.g., TCP) flows, yet still notice a real change.  (Sudden large spikes are ignored.)
+  if (fLastThresholdUpdateMs < 0.0) fLastThresholdUpdateMs = arrivalTimeMs;
+  double absTrend = fabs(fModifiedTrend);
+  if (absTrend > fThreshold + 15.0) {
+    fLastThresholdUpdateMs = arrivalTimeMs;
+    return;
+  }
+
+  double k = absTrend < fThreshold ? OVERUSE_THRESHOLD_K_DOWN : OVERUSE_THRESHOLD_K_UP;
+  double timeDeltaMs = arrivalTimeMs - fLastThresholdUpdateMs;
+  if (timeDeltaMs < 0.0) timeDeltaMs = 0.0; else if (timeDeltaMs > 100.0) timeDeltaMs = 100.0;
+  fThreshold += k*(absTrend - fThreshold)*timeDeltaMs;
+  if (fThreshold < MIN_OVERUSE_THRESHOLD) fThreshold = MIN_OVERUSE_THRESHOLD;
+  else if (fThreshold > MAX_OVERUSE_THRESHOLD) fThreshold = MAX_OVERUSE_THRESHOLD;
+  fLastThresholdUpdateMs = arrivalTimeMs;
+}
+
+void SendSideBandwidthEstimator::updateBitrates(int64_t timeNow) {
+  double secondsSinceLastUpdate = fLastUpdateTime == 0 ? 0.0 : (timeNow - fLastUpdateTime)/1000000.0;
+  if (secondsSinceLastUpdate < 0.0) secondsSinceLastUpdate = 0.0;
+  else if (secondsSinceLastUpdate > 1.0) secondsSinceLastUpdate = 1.0;
+  fLastUpdateTime = timeNow;
+  double increaseFactor = pow(INCREASE_FACTOR_PER_SECOND, secondsSinceLastUpdate);
+
+  // The delay-based bitrate: Decrease it multiplicatively (to below the rate at which packets are now arriving)
+  // on overuse; hold it on underuse (to let queues drain); otherwise increase it slowly - but not too far beyond
+  // the acked bitrate (in case our source isn't using what we already have):
+  double bitrate = fDelayBasedBitrate;
+  if (fBandwidthUsage == overusing) {
+    if (timeNow - fLastDecreaseTime >= MIN_DECREASE_INTERVAL) {
+      double newBitrate = DECREASE_FACTOR*(fAckedBitrate > 0 ? fAckedBitrate : fDelayBasedBitrate);
+      if (newBitrate < bitrate) bitrate = newBitrate;
+      fLastDecreaseTime = timeNow;
+    }
+  } else if (fBandwidthUsage == normal) {
+    double newBitrate = bitrate*increaseFactor;
+    if (fAckedBitrate > 0) {
+      double limit = 1.5*fAckedBitrate + 10000;
+      if (newBitrate > limit) newBitrate = limit > bitrate ? limit : bitrate;
+    }
+    bitrate = newBitrate;
+  }
+  if (bitrate < fMinBitrate) bitrate = fMinBitrate; else if (bitrate > fMaxBitrate) bitrate = fMaxBitrate;
+  fDelayBasedBitrate = (unsigned)bitrate;
+
+  // The loss-based bitrate: Decrease it in proportion to heavy loss; increase it slowly when there's little loss:
+  if (fNumReportedSinceLossUpdate >= LOSS_UPDATE_MIN_NUM_PACKETS) {
+    fLossFraction = (double)fNumLostSinceLossUpdate/fNumReportedSinceLossUpdate;
+    fNumReportedSinceLossUpdate = fNumLostSinceLossUpdate = 0;
+    if (fLossFraction > HIGH_LOSS_FRACTION && timeNow - fLastLossDecreaseTime >= MIN_LOSS_DECREASE_INTERVAL) {
+      fLossBasedBitrate = (unsigned)(fTargetBitrate*(1 - 0.5*fLossFraction));
+      fLastLossDecreaseTime = timeNow;
+    }
+  }
+  if (fLossFraction < LOW_LOSS_FRACTION) {
+    double newBitrate = fLossBasedBitrate*increaseFactor;
+    fLossBasedBitrate = newBitrate > fMaxBitrate ? fMaxBitrate : (unsigned)newBitrate;
+  }
+  if (fLossBasedBitrate < fMinBitrate) fLossBasedBitrate = fMinBitrate;
+
+  fTargetBitrate = fDelayBasedBitrate < fLossBasedBitrate ? fDelayBasedBitrate : fLossBasedBitrate;
+}
@@ -0,0 +1,485 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// Forward error correction for RTP, using the "ulpfec" payload format (RFC 5109)
+// Implementation
+
+#include "ULPFEC.hh"
+#include <string.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// XORs "numBytes" bytes of "from" into "to".  (This is where FEC spends almost all of its time, so we do it
+// 16 bytes at a time, if we can, otherwise 8 bytes at a time.)
+static void xorBytes(unsigned char* to, unsigned char const* from, unsigned numBytes) {
+  unsigned i = 0;
+#ifdef USE_SSE2
+  for (; i + 64 <= numBytes; i += 64) {
+    __m128i a0 = _mm_loadu_si128((__m128i const*)&to[i]);
+    __m128i a1 = _mm_loadu_si128((__m128i const*)&to[i+16]);
+    __m128i a2 = _mm_loadu_si128((__m128i const*)&to[i+32]);
+    __m128i a3 = _mm_loadu_si128((__m128i const*)&to[i+48]);
+    a0 = _mm_xor_si128(a0, _mm_loadu_si128((__m128i const*)&from[i]));
+    a1 = _mm_xor_si128(a1, _mm_loadu_si128((__m128i const*)&from[i+16]));
+    a2 = _mm_xor_si128(a2, _mm_loadu_si128((__m128i const*)&from[i+32]));
+    a3 = _mm_xor_si128(a3, _mm_loadu_si128((__m128i const*)&from[i+48]));
+    _mm_storeu_si128((__m128i*)&to[i], a0);
+    _mm_storeu_si128((__m128i*)&to[i+16], a1);
+    _mm_storeu_si128((__m128i*)&to[i+32], a2);
+    _mm_storeu_si128((__m128i*)&to[i+48], a3);
+  }
+  for (; i + 16 <= numBytes; i += 16) {
+    __m128i a = _mm_loadu_si128((__m128i const*)&to[i]);
+    _mm_storeu_si128((__m128i*)&to[i], _mm_xor_si128(a, _mm_loadu_si128((__m128i const*)&from[i])));
+  }
+#endif
+  for (; i + 8 <= numBytes; i += 8) {
+    u_int64_t a, b;
+    memcpy(&a, &to[i], 8); memcpy(&b, &from[i], 8); // (these compile to unaligned loads)
+    a ^= b;
+    memcpy(&to[i], &a, 8);
+  }
+  for (; i < numBytes; ++i) to[i] ^= from[i];
+}
+
+// Grows "buffer" (of size "bufferSize") - if necessary - so that it holds at least "minSize" bytes.  Any new bytes
+// are zero; existing bytes are kept:
+static void ensureBufferSize(unsigned char*& buffer, unsigned& bufferSize, unsigned minSize) {
+  if (minSize <= bufferSize) return;
+
+  unsigned newSize = bufferSize == 0 ? 2048 : bufferSize;
+  while (newSize < minSize) newSize *= 2;
+  unsigned char* newBuffer = new unsigned char[newSize];
+  if (bufferSize > 0) memcpy(newBuffer, buffer, bufferSize);
+  memset(&newBuffer[bufferSize], 0, newSize - bufferSize);
+  delete[] buffer;
+  buffer = newBuffer; bufferSize = newSize;
+}
+
+#define RTP_HEADER_SIZE 12 // the fixed header.  (Any CSRCs and header extension are protected like the payload.)
+#define FEC_HEADER_SIZE 10
+#define ULP_LEVEL_HEADER_SIZE(longMask) ((longMask) ? 8 : 4)
+
+
+////////// ULPFECEncoder implementation //////////
+
+// The XOR of some media packets (that a FEC packet will protect):
+struct ULPFECEncoder::Parity {
+  unsigned char byte0, byte1; // the XOR of the first two bytes of the packets' RTP headers
+  u_int32_t timestamp; // the XOR of their RTP timestamps
+  u_int16_t length; // the XOR of their lengths (excluding the fixed RTP header)
+  unsigned protectionLength; // the longest of their lengths
+  u_int16_t snBase; // the sequence number of the first packet
+  u_int64_t mask; // bit (ULPFEC_MAX_MASK_SIZE-1-i) is set iff packet "snBase"+i is protected
+  unsigned char* data; // the XOR of the packets (excluding the fixed RTP header), zero-padded
+  unsigned dataBufferSize;
+};
+
+Boolean ULPFECEncoder::matrixIsValid(unsigned numColumns, unsigned numRows) {
+  if (numColumns == 0 || numRows == 0 || (numColumns == 1 && numRows == 1)) return False; // no FEC packets
+  if (numColumns > ULPFEC_MAX_MASK_SIZE) return False; // a row won't fit in a mask
+  if (numRows > 1 && (numRows-1)*numColumns >= ULPFEC_MAX_MASK_SIZE) return False; // a column won't fit in a mask
+  return True;
+}
+
+ULPFECEncoder::ULPFECEncoder(unsigned numColumns, unsigned numRows,
+			     unsigned char fecPayloadType, u_int32_t fecSSRC, u_int16_t initialFECSeqNo)
+  : fNumColumns(numColumns), fNumRows(numRows),
+    fFECPayloadType(fecPayloadType), fFECSSRC(fecSSRC), fFECSeqNo(initialFECSeqNo), fLastMediaTimestamp(0),
+    fPacketNumInMatrix(0), fNumReadyParities(0),
+    fFECPacket(NULL), fFECPacketBufferSize(0) {
+  fRowParity = new Parity;
+  fColumnParities = new Parity[fNumColumns];
+  fRowParity->data = NULL; fRowParity->dataBufferSize = 0;
+  for (unsigned i = 0; i < fNumColumns; ++i) {
+    fColumnParities[i].data = NULL; fColumnParities[i].dataBufferSize = 0;
+  }
+  reset();
+}
+
+ULPFECEncoder::~ULPFECEncoder() {
+  delete[] fRowParity->data; delete fRowParity;
+  for (unsigned i = 0; i < fNumColumns; ++i) delete[] fColumnParities[i].data;
+  delete[] fColumnParities;
+  delete[] fFECPacket;
+}
+
+void ULPFECEncoder::reset() {
+  Parity* parities[2] = { fRowParity, fColumnParities };
+  unsigned numParities[2] = { 1, fNumColumns };
+  for (unsigned j = 0; j < 2; ++j) {
+    for (unsigned i = 0; i < numParities[j]; ++i) {
+      Parity& p = parities[j][i];
+      if (p.data != NULL) memset(p.data, 0, p.dataBufferSize);
+      p.byte0 = p.byte1 = 0; p.timestamp = 0; p.length = 0; p.protectionLength = 0;
+      p.snBase = 0; p.mask = 0;
+    }
+  }
+  fPacketNumInMatrix = 0;
+  fNumReadyParities = 0;
+}
+
+void ULPFECEncoder::addToParity(Parity& parity, unsigned char const* header, unsigned headerSize,
+				unsigned char const* payload, unsigned payloadSize) {
+  u_int16_t seqNo = (header[2]<<8)|header[3];
+  if (parity.mask == 0) parity.snBase = seqNo; // this is the first packet
+  parity.mask |= (u_int64_t)1<<(ULPFEC_MAX_MASK_SIZE-1-(u_int16_t)(seqNo - parity.snBase));
+
+  parity.byte0 ^= header[0];
+  parity.byte1 ^= header[1];
+  parity.timestamp ^= (header[4]<<24)|(header[5]<<16)|(header[6]<<8)|header[7];
+  unsigned length = headerSize - RTP_HEADER_SIZE + payloadSize;
+  parity.length ^= (u_int16_t)length;
+  if (length > parity.protectionLength) parity.protectionLength = length;
+
+  ensureBufferSize(parity.data, parity.dataBufferSize, length);
+  xorBytes(parity.data, &header[RTP_HEADER_SIZE], headerSize - RTP_HEADER_SIZE);
+  xorBytes(&parity.data[headerSize - RTP_HEADER_SIZE], payload, payloadSize);
+}
+
+void ULPFECEncoder::addMediaPacket(unsigned char const* header, unsigned headerSize,
+				   unsigned char const* payload, unsigned payloadSize) {
+  if (headerSize < RTP_HEADER_SIZE) return; // shouldn't happen
+  if (fNumReadyParities > 0) {
+    // Our caller didn't send the FEC packets that were ready (which it should have).  Don't send them later:
+    reset();
+  }
+
+  fLastMediaTimestamp = (header[4]<<24)|(header[5]<<16)|(header[6]<<8)|header[7];
+  unsigned row = fPacketNumInMatrix/fNumColumns;
+  unsigned column = fPacketNumInMatrix%fNumColumns;
+
+  if (fNumColumns > 1) {
+    addToParity(*fRowParity, header, headerSize, payload, payloadSize);
+    if (column == fNumColumns-1) fReadyParities[fNumReadyParities++] = fRowParity;
+  }
+  if (fNumRows > 1) {
+    addToParity(fColumnParities[column], header, headerSize, payload, payloadSize);
+    if (row == fNumRows-1) fReadyParities[fNumReadyParities++] = &fColumnParities[column];
+  }
+
+  if (++fPacketNumInMatrix == fNumColumns*fNumRows) fPacketNumInMatrix = 0;
+}
+
+unsigned char* ULPFECEncoder::nextFECPacket(unsigned& resultPacketSize) {
+  if (fNumReadyParities == 0) {
+    resultPacketSize = 0;
+    return NULL;
+  }
+
+  Parity& parity = *fReadyParities[0];
+  fReadyParities[0] = fReadyParities[1];
+  --fNumReadyParities;
+
+  Boolean longMask = (parity.mask&0xFFFFFFFF) != 0; // i.e., it won't fit in 16 bits
+  unsigned headerSize = RTP_HEADER_SIZE + FEC_HEADER_SIZE + ULP_LEVEL_HEADER_SIZE(longMask);
+  unsigned packetSize = headerSize + parity.protectionLength;
+  ensureBufferSize(fFECPacket, fFECPacketBufferSize, packetSize);
+  unsigned char* p = fFECPacket;
+
+  // The RTP header:
+  *p++ = 0x80; // version 2; no padding, header extension or CSRCs
+  *p++ = fFECPayloadType&0x7F; // 'M' bit 0
+  *p++ = fFECSeqNo>>8; *p++ = (unsigned char)fFECSeqNo; ++fFECSeqNo;
+  *p++ = fLastMediaTimestamp>>24; *p++ = fLastMediaTimestamp>>16;
+  *p++ = fLastMediaTimestamp>>8; *p++ = (unsigned char)fLastMediaTimestamp;
+  *p++ = fFECSSRC>>24; *p++ = fFECSSRC>>16; *p++ = fFECSSRC>>8; *p++ = (unsigned char)fFECSSRC;
+
+  // The FEC header:
+  *p++ = (longMask ? 0x40 : 0x00)|(parity.byte0&0x3F); // 'E' bit 0; 'L' bit; 'P', 'X', 'CC' recovery
+  *p++ = parity.byte1; // 'M', 'PT' recovery
+  *p++ = parity.snBase>>8; *p++ = (unsigned char)parity.snBase;
+  *p++ = parity.timestamp>>24; *p++ = parity.timestamp>>16; *p++ = parity.timestamp>>8; *p++ = (unsigned char)parity.timestamp;
+  *p++ = parity.length>>8; *p++ = (unsigned char)parity.length;
+
+  // The (level 0) ULP header:
+  *p++ = parity.protectionLength>>8; *p++ = (unsigned char)parity.protectionLength;
+  *p++ = (unsigned char)(parity.mask>>40); *p++ = (unsigned char)(parity.mask>>32);
+  if (longMask) {
+    *p++ = (unsigned char)(parity.mask>>24); *p++ = (unsigned char)(parity.mask>>16);
+    *p++ = (unsigned char)(parity.mask>>8); *p++ = (unsigned char)parity.mask;
+  }
+
+  // The (level 0) payload:
+  memcpy(p, parity.data, parity.protectionLength);
+
+  // Reset the parity, for the next packets that it'll protect:
+  memset(parity.data, 0, parity.protectionLength);
+  parity.byte0 = parity.byte1 = 0; parity.timestamp = 0; parity.length = 0; parity.protectionLength = 0;
+  parity.snBase = 0; parity.mask = 0;
+
+  resultPacketSize = packetSize;
+  return fFECPacket;
+}
+
+
+////////// ULPFECDecoder implementation //////////
+
+// How many recent media packets we keep (so that we can use them for recovery).  This must be large enough to cover
+// the span of a FEC packet's mask, plus any delay before the FEC packet arrives:
+#define MEDIA_PACKET_WINDOW_SIZE 256
+// How many FEC packets we keep while they can't (yet) be used, because more than one of their packets is missing:
+#define MAX_NUM_PENDING_FEC_PACKETS 64
+
+struct ULPFECDecoder::MediaPacket {
+  Boolean isValid;
+  u_int16_t seqNo;
+  unsigned char* data; unsigned dataBufferSize;
+  unsigned size;
+};
+
+struct ULPFECDecoder::PendingFECPacket {
+  u_int16_t snBase;
+  u_int64_t mask; // as in "ULPFECEncoder::Parity"
+  unsigned char* data; unsigned dataBufferSize; // the FEC header, ULP header, and payload
+  unsigned size;
+};
+
+ULPFECDecoder::ULPFECDecoder()
+  : fHaveSeenMediaPacket(False), fHighestSeqNo(0), fMediaSSRC(0), fNumPendingFECPackets(0),
+    fNumRecoveredSeqNos(0), fNextRecoveredSeqNoIndex(0),
+    fNumFECPacketsReceived(0), fNumPacketsRecovered(0) {
+  fMediaPackets = new MediaPacket[MEDIA_PACKET_WINDOW_SIZE];
+  for (unsigned i = 0; i < MEDIA_PACKET_WINDOW_SIZE; ++i) {
+    fMediaPackets[i].isValid = False;
+    fMediaPackets[i].data = NULL; fMediaPackets[i].dataBufferSize = 0;
+  }
+  fPendingFECPackets = new PendingFECPacket[MAX_NUM_PENDING_FEC_PACKETS];
+  for (unsigned i = 0; i < MAX_NUM_PENDING_FEC_PACKETS; ++i) {
+    fPendingFECPackets[i].data = NULL; fPendingFECPackets[i].dataBufferSize = 0;
+  }
+  fRecoveredSeqNos = new u_int16_t[MEDIA_PACKET_WINDOW_SIZE];
+}
+
+ULPFECDecoder::~ULPFECDecoder() {
+  for (unsigned i = 0; i < MEDIA_PACKET_WINDOW_SIZE; ++i) delete[] fMediaPackets[i].data;
+  delete[] fMediaPackets;
+  for (unsigned i = 0; i < MAX_NUM_PENDING_FEC_PACKETS; ++i) delete[] fPendingFECPackets[i].data;
+  delete[] fPendingFECPackets;
+  delete[] fRecoveredSeqNos;
+}
+
+void ULPFECDecoder::reset() {
+  for (unsigned i = 0; i < MEDIA_PACKET_WINDOW_SIZE; ++i) fMediaPackets[i].isValid = False;
+  fHaveSeenMediaPacket = False;
+  fNumPendingFECPackets = 0;
+  fNumRecoveredSeqNos = fNextRecoveredSeqNoIndex = 0;
+}
+
+ULPFECDecoder::MediaPacket* ULPFECDecoder::lookupMediaPacket(u_int16_t seqNo) const {
+  MediaPacket& packet = fMediaPackets[seqNo%MEDIA_PACKET_WINDOW_SIZE];
+  return packet.isValid && packet.seqNo == seqNo ? &packet : NULL;
+}
+
+ULPFECDecoder::MediaPacket& ULPFECDecoder::storeMediaPacket(u_int16_t seqNo, unsigned packetSize) {
+  if (!fHaveSeenMediaPacket || (u_int16_t)(seqNo - fHighestSeqNo) < 0x8000) fHighestSeqNo = seqNo;
+  fHaveSeenMediaPacket = True;
+
+  MediaPacket& packet = fMediaPackets[seqNo%MEDIA_PACKET_WINDOW_SIZE];
+  ensureBufferSize(packet.data, packet.dataBufferSize, packetSize);
+  packet.isValid = True;
+  packet.seqNo = seqNo;
+  packet.size = packetSize;
+  return packet;
+}
+
+void ULPFECDecoder::addMediaPacket(unsigned char const* packet, unsigned packetSize) {
+  if (packetSize < RTP_HEADER_SIZE) return;
+  u_int16_t seqNo = (packet[2]<<8)|packet[3];
+  u_int32_t ssrc = (packet[8]<<24)|(packet[9]<<16)|(packet[10]<<8)|packet[11];
+  if (fHaveSeenMediaPacket && ssrc != fMediaSSRC) reset(); // the stream has changed
+  fMediaSSRC = ssrc;
+
+  if (fHaveSeenMediaPacket) {
+    if (lookupMediaPacket(seqNo) != NULL) return; // we already have it (e.g., because we recovered it)
+    if ((u_int16_t)(fHighestSeqNo - seqNo) < 0x8000
+	&& (u_int16_t)(fHighestSeqNo - seqNo) >= MEDIA_PACKET_WINDOW_SIZE) return; // it's too old to be useful
+  }
+  memcpy(storeMediaPacket(seqNo, packetSize).data, packet, packetSize);
+
+  if (fNumPendingFECPackets > 0) tryPendingRecoveries();
+}
+
+void ULPFECDecoder::addFECPacket(unsigned char const* packet, unsigned packetSize) {
+  // Skip over the FEC packet's own RTP header:
+  if (packetSize < RTP_HEADER_SIZE) return;
+  unsigned rtpHeaderSize = RTP_HEADER_SIZE + 4*(packet[0]&0x0F);
+  if ((packet[0]&0x10) != 0 && rtpHeaderSize + 4 <= packetSize) { // there's a header extension
+    rtpHeaderSize += 4 + 4*((packet[rtpHeaderSize+2]<<8)|packet[rtpHeaderSize+3]);
+  }
+  if ((packet[0]&0x20) != 0) { // remove padding
+    if (packet[packetSize-1] > packetSize) return;
+    packetSize -= packet[packetSize-1];
+  }
+  if (rtpHeaderSize + FEC_HEADER_SIZE + ULP_LEVEL_HEADER_SIZE(0) > packetSize) return;
+  packet += rtpHeaderSize; packetSize -= rtpHeaderSize;
+
+  // Check the FEC and ULP headers:
+  if ((packet[0]&0x80) != 0) return; // 'E' bit set: a header extension that we don't understand
+  Boolean longMask = (packet[0]&0x40) != 0;
+  unsigned fecHeadersSize = FEC_HEADER_SIZE + ULP_LEVEL_HEADER_SIZE(longMask);
+  if (fecHeadersSize > packetSize) return;
+  unsigned protectionLength = (packet[10]<<8)|packet[11];
+  if (fecHeadersSize + protectionLength > packetSize) return;
+  ++fNumFECPacketsReceived;
+  if (!fHaveSeenMediaPacket) return; // we can't use this yet
+
+  u_int16_t snBase = (packet[2]<<8)|packet[3];
+  u_int64_t mask = ((u_int64_t)packet[12]<<40)|((u_int64_t)packet[13]<<32);
+  if (longMask) mask |= ((u_int64_t)packet[14]<<24)|(packet[15]<<16)|(packet[16]<<8)|packet[17];
+  if (mask == 0) return;
+  if ((u_int16_t)(fHighestSeqNo - snBase) < 0x8000
+      && (u_int16_t)(fHighestSeqNo - snBase) >= MEDIA_PACKET_WINDOW_SIZE - ULPFEC_MAX_MASK_SIZE) {
+    return; // it protects packets that are too old to be useful
+  }
+
+  // Forget any pending FEC packets that now protect only packets that are too old:
+  unsigned i = 0;
+  while (i < fNumPendingFECPackets) {
+    if ((u_int16_t)(fHighestSeqNo - fPendingFECPackets[i].snBase) < 0x8000
+	&& (u_int16_t)(fHighestSeqNo - fPendingFECPackets[i].snBase) >= MEDIA_PACKET_WINDOW_SIZE - ULPFEC_MAX_MASK_SIZE) {
+      removePendingFECPacket(i);
+    } else {
+      ++i;
+    }
+  }
+  if (fNumPendingFECPackets == MAX_NUM_PENDING_FEC_PACKETS) removePendingFECPacket(0); // the oldest
+
+  PendingFECPacket& fec = fPendingFECPackets[fNumPendingFECPackets++];
+  fec.snBase = snBase;
+  fec.mask = mask;
+  fec.size = fecHeadersSize + protectionLength;
+  ensureBufferSize(fec.data, fec.dataBufferSize, fec.size);
+  memcpy(fec.data, packet, fec.size);
+
+  tryPendingRecoveries();
+}
+
+void ULPFECDecoder::removePendingFECPacket(unsigned index) {
+  // Move the packet's slot (with its buffer) to the end, keeping the remaining packets in arrival order:
+  PendingFECPacket removed = fPendingFECPackets[index];
+  for (unsigned i = index; i+1 < fNumPendingFECPackets; ++i) fPendingFECPackets[i] = fPendingFECPackets[i+1];
+  fPendingFECPackets[--fNumPendingFECPackets] = removed;
+}
+
+void ULPFECDecoder::tryPendingRecoveries() {
+  // Keep going until there's nothing more that we can recover (because each recovered packet might allow another
+  // FEC packet to be used):
+  Boolean haveRecoveredPacket;
+  do {
+    haveRecoveredPacket = False;
+    unsigned i = 0;
+    while (i < fNumPendingFECPackets) {
+      Boolean fecIsFinished;
+      if (tryRecovery(fPendingFECPackets[i], fecIsFinished)) haveRecoveredPacket = True;
+      if (fecIsFinished) {
+	removePendingFECPacket(i);
+      } else {
+	++i;
+      }
+    }
+  } while (haveRecoveredPacket);
+}
+
+Boolean ULPFECDecoder::tryRecovery(PendingFECPacket& fec, Boolean& resultFECIsFinished) {
+  // Check how many of the packets protected by this FEC packet are missing.  We can recover one, but no more:
+  resultFECIsFinished = True; // unless we find that we have to wait
+  unsigned numMissing = 0;
+  u_int16_t missingSeqNo = 0;
+  for (unsigned i = 0; i < ULPFEC_MAX_MASK_SIZE; ++i) {
+    if ((fec.mask&((u_int64_t)1<<(ULPFEC_MAX_MASK_SIZE-1-i))) == 0) continue;
+    u_int16_t seqNo = fec.snBase + i;
+    if (lookupMediaPacket(seqNo) == NULL) {
+      missingSeqNo = seqNo;
+      if (++numMissing > 1) {
+	resultFECIsFinished = False; // we might be able to use this FEC packet later
+	return False;
+      }
+    }
+  }
+  if (numMissing == 0 || fNumRecoveredSeqNos == MEDIA_PACKET_WINDOW_SIZE) return False;
+  if ((u_int16_t)(missingSeqNo - fHighestSeqNo) < 0x8000) {
+    // The missing packet is newer than any that we've seen, so it might just not have arrived yet (e.g., if FEC packets
+    // are sent on a different port).  Don't recover it until we've seen a later packet:
+    resultFECIsFinished = False;
+    return False;
+  }
+
+  // Recover the missing packet, by XORing the FEC packet with the other protected packets:
+  unsigned char const* fecHeader = fec.data;
+  unsigned fecHeadersSize = fec.size - ((fecHeader[10]<<8)|fecHeader[11]);
+  unsigned protectionLength = fec.size - fecHeadersSize;
+  unsigned char byte0 = fecHeader[0];
+  unsigned char byte1 = fecHeader[1];
+  u_int32_t timestamp = (fecHeader[4]<<24)|(fecHeader[5]<<16)|(fecHeader[6]<<8)|fecHeader[7];
+  u_int16_t length = (fecHeader[8]<<8)|fecHeader[9];
+
+  // (We do this in the missing packet's own slot.  But first, check that this slot doesn't hold a newer packet - in
+  // which case the missing packet is too old to be useful.)
+  MediaPacket& oldPacket = fMediaPackets[missingSeqNo%MEDIA_PACKET_WINDOW_SIZE];
+  if (oldPacket.isValid && (u_int16_t)(oldPacket.seqNo - missingSeqNo) < 0x8000) return False;
+  MediaPacket& recovered = storeMediaPacket(missingSeqNo, RTP_HEADER_SIZE + protectionLength);
+  recovered.isValid = False; // for now
+  unsigned char* payload = &recovered.data[RTP_HEADER_SIZE];
+  memcpy(payload, &fecHeader[fecHeadersSize], protectionLength);
+
+  for (unsigned i = 0; i < ULPFEC_MAX_MASK_SIZE; ++i) {
+    if ((fec.mask&((u_int64_t)1<<(ULPFEC_MAX_MASK_SIZE-1-i))) == 0) continue;
+    u_int16_t seqNo = fec.snBase + i;
+    if (seqNo == missingSeqNo) continue;
+
+    MediaPacket* packet = lookupMediaPacket(seqNo);
+    unsigned packetLength = packet->size - RTP_HEADER_SIZE;
+    if (packetLength > protectionLength) return False; // the FEC packet doesn't properly protect this packet
+
+    byte0 ^= packet->data[0];
+    byte1 ^= packet->data[1];
+    timestamp ^= (packet->data[4]<<24)|(packet->data[5]<<16)|(packet->data[6]<<8)|packet->data[7];
+    length ^= (u_int16_t)packetLength;
+    xorBytes(payload, &packet->data[RTP_HEADER_SIZE], packetLength);
+  }
+  if (length > protectionLength) return False; // the FEC packet (or one of the other packets) is bad
+
+  unsigned char* hdr = recovered.data;
+  hdr[0] = 0x80|(byte0&0x3F); // version 2
+  hdr[1] = byte1;
+  hdr[2] = missingSeqNo>>8; hdr[3] = (unsigned char)missingSeqNo;
+  hdr[4] = timestamp>>24; hdr[5] = timestamp>>16; hdr[6] = timestamp>>8; hdr[7] = (unsigned char)timestamp;
+  hdr[8] = fMediaSSRC>>24; hdr[9] = fMediaSSRC>>16; hdr[10] = fMediaSSRC>>8; hdr[11] = (unsigned char)fMediaSSRC;
+  recovered.size = RTP_HEADER_SIZE + length;
+  recovered.isValid = True;
+
+  fRecoveredSeqNos[fNumRecoveredSeqNos++] = missingSeqNo;
+  ++fNumPacketsRecovered;
+  return True;
+}
+
+unsigned char* ULPFECDecoder::nextRecoveredPacket(unsigned& resultPacketSize) {
+  while (fNextRecoveredSeqNoIndex < fNumRecoveredSeqNos) {
+    MediaPacket* packet = lookupMediaPacket(fRecoveredSeqNos[fNextRecoveredSeqNoIndex++]);
+    if (packet != NULL) {
+      resultPacketSize = packet->size;
+      return packet->data;
+    }
+  }
+
+  fNumRecoveredSeqNos = fNextRecoveredSeqNoIndex = 0;
+  resultPacketSize = 0;
+  return NULL;
+}
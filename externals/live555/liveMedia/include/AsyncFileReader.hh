@@ -0,0 +1,130 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A per-environment pool of threads that read from files, so that the event loop never blocks on disk I/O
+// (used by "ByteStreamFileSource")
+// C++ header
+
+#ifndef _ASYNC_FILE_READER_HH
+#define _ASYNC_FILE_READER_HH
+
+#ifndef _MEDIA_HH
+#include "Media.hh"
+#endif
+#include <stdio.h>
+
+// A regular file is always 'readable' (as far as "select()" - or "epoll()" - is concerned), even if reading from it
+// would block (e.g., because its data isn't yet in the OS's cache, and the disk is slow).  So rather than reading
+// from such files from the event loop, we hand each read to one of a small (bounded) pool of threads, and have the
+// event loop called back - using "TaskScheduler::postTask()" - once the data is ready.
+
+class AsyncFileReader; // forward
+
+class AsyncFileReadRequest {
+public:
+  AsyncFileReadRequest(unsigned bufferSize);
+  virtual ~AsyncFileReadRequest();
+
+  unsigned char* buffer() const { return fBuffer; }
+  unsigned bufferSize() const { return fBufferSize; }
+
+  // The following are valid only once the request has completed:
+  u_int64_t fileOffset() const { return fFileOffset; }
+  unsigned numBytesRead() const { return fNumBytesRead; } // < "bufferSize()" iff we reached the end of the file
+  Boolean hadError() const { return fHadError; }
+
+  Boolean isPending() const { return fIsPending; } // i.e., submitted, but not yet completed
+
+private:
+  friend class AsyncFileReader;
+  static void completionHandler(void* request); // called (from the event loop) via "TaskScheduler::postTask()"
+  void doRead(); // called from one of our reader's threads
+
+private:
+  unsigned char* fBuffer;
+  unsigned fBufferSize;
+  int fFileNum;
+  u_int64_t fFileOffset;
+  unsigned fNumBytesRead;
+  Boolean fHadError;
+  Boolean fIsPending, fIsQueued, fIsCancelled;
+  TaskScheduler* fScheduler;
+  void (*fCompletionFunc)(void* clientData, AsyncFileReadRequest* request);
+  void* fClientData;
+  AsyncFileReadRequest* fNext; // in our reader's queue
+};
+
+class AsyncFileReader {
+public:
+  static AsyncFileReader* ourReader(UsageEnvironment& env);
+      // returns our environment's reader (creating it if necessary).  Returns NULL if the environment's "TaskScheduler"
+      // doesn't implement "postTask()", or if no threads could be started (in which case files must be read from the
+      // event loop, as before).
+
+  void incrementReferenceCount() { ++fReferenceCount; }
+  void decrementReferenceCount();
+      // The reader (and its threads) is deleted when its reference count drops to 0.
+
+  typedef void (CompletionFunc)(void* clientData, AsyncFileReadRequest* request);
+  Boolean submit(AsyncFileReadRequest* request, FILE* fid, u_int64_t fileOffset, CompletionFunc* completionFunc, void* clientData);
+      // Asks for "request->bufferSize()" bytes to be read - from "fileOffset" in "fid" (which must be seekable) - into
+      // "request->buffer()".  Once the read has completed, "completionFunc(clientData, request)" is called from the event
+      // loop.  (The request must not already be pending.)  Returns False if the read could not be submitted.
+      // Note: This function (like "cancel()") must be called only from our environment's event loop thread.
+  static unsigned readIfCached(FILE* fid, u_int64_t fileOffset, unsigned char* to, unsigned maxNumBytes,
+			       Boolean& reachedEOF);
+      // Reads - right away (i.e., from the event loop) - as many of the "maxNumBytes" bytes at "fileOffset" as can be
+      // read without blocking (i.e., up to the first one that's not in the OS's cache), returning their number.
+      // "reachedEOF" is set to True iff we stopped because we reached the end of the file.  This is used to avoid the
+      // cost of using a thread when it's not needed.  (This is supported only on Linux; elsewhere, it always returns 0.)
+  void cancel(AsyncFileReadRequest* request);
+      // Cancels "request" (if it's still pending), and deletes it - now, or (if one of our threads might still be
+      // reading into it) once that's safe.  The caller must not use the request again.
+
+  static unsigned numThreads; // used by each new reader (default: 4)
+
+  // Statistics:
+  unsigned numReadsSubmitted() const { return fNumReadsSubmitted; }
+  unsigned numReadsQueued() const; // i.e., waiting for a thread
+  unsigned numReadsCancelled() const { return fNumReadsCancelled; }
+
+private:
+  AsyncFileReader(UsageEnvironment& env);
+  virtual ~AsyncFileReader();
+
+  Boolean startThreads();
+  static void threadMain(void* reader);
+  void threadMain1();
+
+  void lock() const;
+  void unlock() const;
+
+private:
+  UsageEnvironment& fEnv;
+  unsigned fReferenceCount;
+
+  class OurThread** fThreads;
+  unsigned fNumThreads;
+  Boolean fStopping;
+
+  AsyncFileReadRequest* fQueueHead; AsyncFileReadRequest* fQueueTail; // guarded by our lock
+  void* fLock; void* fCondition; // OS-specific mutex and condition variable
+
+  unsigned fNumReadsSubmitted, fNumReadsCancelled;
+};
+
+#endif
@@ -44,10 +44,10 @@ public:
   u_int64_t fileSize() const { return fFileSize; }
       // 0 means zero-length, unbounded, or unknown
 
-  void seekToByteAbsolute(u_int64_t byteNumber, u_int64_t numBytesToStream = 0);
+  virtual void seekToByteAbsolute(u_int64_t byteNumber, u_int64_t numBytesToStream = 0);
     // if "numBytesToStream" is >0, then we limit the stream to that number of bytes, before treating it as EOF
-  void seekToByteRelative(int64_t offset, u_int64_t numBytesToStream = 0);
-  void seekToEnd(); // to force EOF handling on the next read
+  virtual void seekToByteRelative(int64_t offset, u_int64_t numBytesToStream = 0);
+  virtual void seekToEnd(); // to force EOF handling on the next read
 
 protected:
   ByteStreamFileSource(UsageEnvironment& env,
@@ -60,6 +60,17 @@ protected:
 
   static void fileReadableHandler(ByteStreamFileSource* source, int mask);
   void doReadFromFile();
+  void setPresentationTime(); // for the "fFrameSize" bytes just read
+
+private:
+  // Reading ahead (using an "AsyncFileReader"), so that the event loop never blocks on a slow disk:
+  Boolean startReadingAhead();
+  void resetReadAhead(u_int64_t fileOffset);
+  void continueReadingAhead();
+  static void readAheadCompletionHandler(void* clientData, class AsyncFileReadRequest* request);
+  void deliverReadAheadData(Boolean isFromCompletionHandler);
+  static void afterGettingReadAheadData(ByteStreamFileSource* source);
+  u_int64_t currentReadAheadOffset() const;
 
 private:
   // redefined virtual functions:
@@ -68,15 +79,24 @@ private:
 
 protected:
   u_int64_t fFileSize;
-
-private:
   unsigned fPreferredFrameSize;
   unsigned fPlayTimePerFrame;
+  Boolean fLimitNumBytesToStream;
+  u_int64_t fNumBytesToStream; // used iff "fLimitNumBytesToStream" is True
+
+private:
   Boolean fFidIsSeekable;
   unsigned fLastPlayTime;
   Boolean fHaveStartedReading;
-  Boolean fLimitNumBytesToStream;
-  u_int64_t fNumBytesToStream; // used iff "fLimitNumBytesToStream" is True
+
+  // Used when reading ahead:
+  class AsyncFileReader* fAsyncReader; // non-NULL iff we're reading ahead
+  Boolean fHaveCheckedForReadAhead;
+  class AsyncFileReadRequest** fReadAheadChunks; // a ring; those in use are in file order
+  unsigned fFirstReadAheadChunk, fNumReadAheadChunksInUse;
+  unsigned fReadAheadChunkPosition; // the number of bytes already delivered from the first chunk in use
+  u_int64_t fNextReadAheadOffset; // the file offset of the next chunk to be read
+  Boolean fReadAheadReachedEOF, fReadAheadIsPending, fIsAwaitingReadAheadData;
 };
 
 #endif
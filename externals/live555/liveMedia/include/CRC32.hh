@@ -0,0 +1,59 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// The CRC-32 that's used by MPEG-2 Transport Streams (and by Ogg)
+// C++ header
+
+#ifndef _CRC32_HH
+#define _CRC32_HH
+
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+#ifndef _NET_COMMON_H
+#include "NetCommon.h"
+#endif
+
+// The CRC calculation function that Transport Streams use (polynomial 0x04C11DB7, most significant bit first, with no
+// final XOR).  For Transport Stream PSI sections, "initialValue" is 0xFFFFFFFF; for Ogg pages, it's 0.  A long calculation
+// can be split into pieces, by passing the result of each piece as the "initialValue" for the next.
+// Note: The CRC of a PSI section - including its "CRC_32" field - is 0 iff that field is correct.
+u_int32_t calculateCRC(u_int8_t const* data, unsigned dataLength, u_int32_t initialValue = 0xFFFFFFFF);
+
+class CRC32 {
+public:
+  // "calculateCRC()" uses the fastest of these implementations that this CPU supports.  (This is decided - at runtime -
+  // the first time it's called.)
+  enum Implementation {
+    BYTE_AT_A_TIME, // one table lookup per byte
+    SLICING_BY_8, // eight table lookups per 8 bytes, with no dependency between them
+    PCLMUL_FOLDING // x86 carry-less multiplication ("PCLMULQDQ"), folding 64 bytes at a time; used for >= 64 bytes
+  };
+
+  static Boolean isSupported(Implementation implementation);
+  static Implementation implementationInUse();
+  static char const* implementationName(Implementation implementation);
+
+  static u_int32_t calculate(Implementation implementation,
+			     u_int8_t const* data, unsigned dataLength, u_int32_t initialValue = 0xFFFFFFFF);
+      // Uses a specific implementation (which must be supported); for testing and benchmarking.
+
+private:
+  static void initialize();
+};
+
+#endif
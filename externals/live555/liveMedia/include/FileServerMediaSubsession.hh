@@ -25,16 +25,34 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _ON_DEMAND_SERVER_MEDIA_SUBSESSION_HH
 #include "OnDemandServerMediaSubsession.hh"
 #endif
+#ifndef _BYTE_STREAM_FILE_SOURCE_HH
+#include "ByteStreamFileSource.hh"
+#endif
 
 class FileServerMediaSubsession: public OnDemandServerMediaSubsession {
+public:
+  void setUseMappedFile(Boolean useMappedFile = True) { fUseMappedFile = useMappedFile; }
+      // If set, subclasses that read our file as a byte stream will use a (memory-mapped) "MappedFileSource" - if the
+      // file can be mapped - rather than a "ByteStreamFileSource".  This avoids copying the file's data (e.g., for
+      // files that are already in the OS's page cache).  Don't set this for files that are still growing.
+
 protected: // we're a virtual base class
   FileServerMediaSubsession(UsageEnvironment& env, char const* fileName,
 			    Boolean reuseFirstSource);
   virtual ~FileServerMediaSubsession();
 
+  Boolean fileSDPCacheKey(char*& key, char*& version);
+      // A helper function that subclasses can use to implement "sdpCacheKey()": "key" identifies our file (and track),
+      // and "version" is the file's current size and modification time.  (Returns False if the file can't be 'stat'ed.)
+
+  ByteStreamFileSource* createByteStreamFileSource(unsigned preferredFrameSize = 0, unsigned playTimePerFrame = 0);
+      // A helper function that subclasses can use to create a source for our file: a "MappedFileSource" (see above),
+      // or else a "ByteStreamFileSource".  (Returns NULL if the file can't be opened.)
+
 protected:
   char const* fFileName;
   u_int64_t fFileSize; // if known
+  Boolean fUseMappedFile;
 };
 
 #endif
@@ -34,6 +34,9 @@ public:
   // Call before destruction if you want to prevent the destructor from closing the input source
   void detachInputSource();
 
+  // Redefined virtual functions:
+  virtual void requestKeyFrame(); // passes the request on to our input source
+
 protected:
   FramedFilter(UsageEnvironment& env, FramedSource* inputSource);
 	 // abstract base class
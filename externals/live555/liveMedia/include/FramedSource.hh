@@ -55,6 +55,19 @@ public:
       // size of the largest possible frame that we may serve, or 0
       // if no such maximum is known (default)
 
+  virtual void requestKeyFrame();
+      // Asks us to deliver a key frame (e.g., a H.264 IDR picture) as soon as we can - e.g., because a receiver of
+      // the stream has lost synchronization.  The default implementation does nothing.  Filters pass the request on
+      // to their input source; live (encoder) sources can redefine this to ask their encoder for a key frame.
+
+  void allowNextFrameByReference() { fNextFrameMayBeReferenced = True; }
+      // A reader can call this - just before calling "getNextFrame()" - if it will check "referencedFrameData()"
+      // (below) once the frame has been delivered.  This lets us deliver the frame 'by reference', if we can.
+  virtual unsigned char const* referencedFrameData();
+      // If we delivered our most recent frame 'by reference' - i.e., leaving it where it was (e.g., in a memory-mapped
+      // file), rather than copying it to the reader's buffer - returns a pointer to it (which remains valid until the
+      // next "getNextFrame()").  Otherwise (the default), returns NULL.
+
   virtual void doGetNextFrame() = 0;
       // called by getNextFrame()
 
@@ -78,6 +91,7 @@ protected:
   unsigned fNumTruncatedBytes; // out
   struct timeval fPresentationTime; // out
   unsigned fDurationInMicroseconds; // out
+  Boolean fFrameMayBeReferenced; // in: whether the reader called "allowNextFrameByReference()" for this frame
 
 private:
   // redefined virtual functions:
@@ -90,6 +104,7 @@ private:
   void* fOnCloseClientData;
 
   Boolean fIsCurrentlyAwaitingData;
+  Boolean fNextFrameMayBeReferenced;
 };
 
 #endif
@@ -71,7 +71,9 @@ protected:
   virtual ~GenericMediaServer();
   void cleanup(); // MUST be called in the destructor of any subclass of us
 
-  static int setUpOurSocket(UsageEnvironment& env, Port& ourPort);
+  static int setUpOurSocket(UsageEnvironment& env, Port& ourPort, Boolean shareOurPort = False);
+      // If "shareOurPort" is True, then other servers - e.g., the other 'shards' of a "ShardedRTSPServer" - may also
+      // listen on "ourPort" (with the kernel distributing incoming connections among them).
 
   static void incomingConnectionHandler(void*, int /*mask*/);
   void incomingConnectionHandler();
@@ -138,6 +140,24 @@ protected:
   HashTable* fServerMediaSessions; // maps 'stream name' strings to "ServerMediaSession" objects
   HashTable* fClientConnections; // the "ClientConnection" objects that we're using
   HashTable* fClientSessions; // maps 'session id' strings to "ClientSession" objects
+
+protected:
+  // Support for running as one of several 'shards' (each with its own event loop, running in its own thread)
+  // that share the same port.  (See "ShardedRTSPServer".)  Each shard uses only session ids that are equal to
+  // its shard index (modulo the number of shards), so any shard can tell which shard owns a session:
+  Boolean sessionIdIsOurs(u_int32_t sessionId) const { return sessionId%fNumShards == fShardIndex; }
+  unsigned shardForSessionId(u_int32_t sessionId) const { return sessionId%fNumShards; }
+  void handOffClientSocket(int clientSocket, struct sockaddr_in const& clientAddr, unsigned toShardIndex,
+			   unsigned char const* requestBytes, unsigned numRequestBytes);
+      // Hands "clientSocket" (whose background handling must already have been turned off) to another shard,
+      // which handles it - from its own thread - as a new connection, beginning with the (already-read) "requestBytes".
+
+private:
+  static void adoptClientSocket(void* clientSocketHandOff); // called (from its own thread) by the shard that's handed a socket
+
+protected:
+  unsigned fNumShards, fShardIndex; // by default, 1 and 0 (i.e., we're not sharded)
+  GenericMediaServer** fShards; // (if non-NULL) "fNumShards" servers, including us (at index "fShardIndex")
 };
 
 // A data structure used for optional user/password authentication:
@@ -51,6 +51,8 @@ protected: // redefined virtual functions
   virtual RTPSink* createNewRTPSink(Groupsock* rtpGroupsock,
                                     unsigned char rtpPayloadTypeIfDynamic,
 				    FramedSource* inputSource);
+  virtual Boolean sdpCacheKey(char*& key, char*& version);
+  virtual FramedSource* createNewStreamSourceFromReplica(FramedSource* replica);
 
 private:
   char* fAuxSDPLine;
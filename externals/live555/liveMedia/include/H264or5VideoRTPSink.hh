@@ -47,6 +47,9 @@ private: // redefined virtual functions:
                                       unsigned numRemainingBytes);
   virtual Boolean frameCanAppearAfterPacketStart(unsigned char const* frameStart,
 						 unsigned numBytesInFrame) const;
+  virtual Boolean frameBeginsKeyFrame(unsigned char const* frameStart,
+				      unsigned numBytesInFrame) const;
+  virtual unsigned char const* referencedFrameData();
 
 protected:
   int fHNumber;
@@ -84,4 +84,8 @@ unsigned removeH264or5EmulationBytes(u_int8_t* to, unsigned toMaxSize,
 				     u_int8_t* from, unsigned fromSize);
     // returns the size of the copy; it will be <= min(toMaxSize,fromSize)
 
+// A general routine for checking whether a (H.264 or H.265) NAL unit type is one at which a decoder can begin decoding:
+// a parameter set (VPS, SPS or PPS), or an IDR (H.264) or IRAP (H.265) picture:
+Boolean isH264or5KeyFrameNALUnitType(int hNumber, u_int8_t nal_unit_type);
+
 #endif
@@ -44,6 +44,12 @@ public:
   void setNumTSPacketsToStream(unsigned long numTSRecordsToStream);
   void setPCRLimit(float pcrLimit);
 
+  void setPSICRCChecking(Boolean checkCRCs = True);
+      // If set, we check the "CRC_32" of each PAT and PMT section (that lies within a single TS packet) in our input.
+      // (The data is still passed through unchanged; the results are available via the following counters.)
+  u_int64_t numPSISectionsChecked() const { return fNumPSISectionsChecked; }
+  u_int64_t numPSICRCErrors() const { return fNumPSICRCErrors; }
+
 protected:
   MPEG2TransportStreamFramer(UsageEnvironment& env, FramedSource* inputSource);
       // called only by createNew()
@@ -53,6 +59,9 @@ private:
   // Redefined virtual functions:
   virtual void doGetNextFrame();
   virtual void doStopGettingFrames();
+  virtual unsigned char const* referencedFrameData();
+      // If our reader allows it, and our input source (e.g., a "MappedFileSource") delivers its data 'by reference',
+      // then we do so also.
 
 private:
   static void afterGettingFrame(void* clientData, unsigned frameSize,
@@ -62,7 +71,8 @@ private:
   void afterGettingFrame1(unsigned frameSize,
 			  struct timeval presentationTime);
 
-  Boolean updateTSPacketDurationEstimate(unsigned char* pkt, double timeNow);
+  Boolean updateTSPacketDurationEstimate(unsigned char const* pkt, double timeNow);
+  void checkPSICRCs(unsigned char const* pkt);
 
 private:
   u_int64_t fTSPacketCount;
@@ -73,6 +83,9 @@ private:
   unsigned long fNumTSPacketsToStream; // used iff "fLimitNumTSPacketsToStream" is True
   Boolean fLimitTSPacketsToStreamByPCR;
   float fPCRLimit; // used iff "fLimitTSPacketsToStreamByPCR" is True
+  unsigned char const* fReferencedFrameData; // non-NULL iff our most recent frame was delivered 'by reference'
+  u_int8_t* fPMT_PIDs; // a bitmap of the PMT PIDs that we've seen in the PAT; non-NULL iff we're checking PSI CRCs
+  u_int64_t fNumPSISectionsChecked, fNumPSICRCErrors;
 };
 
 #endif
@@ -28,6 +28,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _MPEG_1OR2_DEMUX_HH
 #include "MPEG1or2Demux.hh" // for SCR
 #endif
+#ifndef _CRC32_HH
+#include "CRC32.hh" // for "calculateCRC()", which Transport Streams use (and which we make public here as well)
+#endif
 
 #define PID_TABLE_SIZE 256
 
@@ -80,9 +83,4 @@ private:
   Boolean fIsFirstAdaptationField;
 };
 
-
-// The CRC calculation function that Transport Streams use.  We make this function public
-// here in case it's useful elsewhere:
-u_int32_t calculateCRC(u_int8_t const* data, unsigned dataLength, u_int32_t initialValue = 0xFFFFFFFF);
-
 #endif
@@ -51,6 +51,7 @@ protected: // redefined virtual functions
   virtual RTPSink* createNewRTPSink(Groupsock* rtpGroupsock,
                                     unsigned char rtpPayloadTypeIfDynamic,
 				    FramedSource* inputSource);
+  virtual Boolean sdpCacheKey(char*& key, char*& version);
 
 private:
   char* fAuxSDPLine;
@@ -42,6 +42,10 @@ public:
 
   void flushInput(); // called if there is a discontinuity (seeking) in the input
 
+  void setMaxParserBufferSize(unsigned maxBufferSize);
+      // Sets the largest size to which our parser's input buffer may grow.  (This buffer must hold each frame - or
+      // H.264/H.265 NAL unit - as it's being parsed.  It starts small, and grows as needed, up to 100 MBytes by default.)
+
 protected:
   MPEGVideoStreamFramer(UsageEnvironment& env, FramedSource* inputSource);
       // we're an abstract base class
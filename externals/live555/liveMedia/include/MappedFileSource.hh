@@ -0,0 +1,88 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A file source that is a plain byte stream (rather than frames), read from a memory-mapped file
+// C++ header
+
+#ifndef _MAPPED_FILE_SOURCE_HH
+#define _MAPPED_FILE_SOURCE_HH
+
+#ifndef _BYTE_STREAM_FILE_SOURCE_HH
+#include "ByteStreamFileSource.hh"
+#endif
+
+// A "MappedFileSource" can be used wherever a "ByteStreamFileSource" is used.  Because the file's data is read directly
+// from the mapping, no system call - or copy from the kernel - is needed for each read.  In addition:
+//   - Parsers that read from a "MappedFileSource" (i.e., those used by "H264VideoStreamFramer", "H265VideoStreamFramer",
+//     "MPEG1or2VideoStreamFramer", "MPEG4VideoStreamFramer", "AC3AudioStreamFramer", and "MPEG1or2Demux") parse
+//     directly from the mapping, rather than first copying the data into a buffer of their own.
+//   - A reader that calls "allowNextFrameByReference()" (e.g., a "MPEG2TransportStreamFramer" that's being read by a
+//     "MultiFramedRTPSink") is given each frame as a pointer into the mapping, rather than as a copy.
+// Note, however, that the mapping covers only those bytes that were in the file when it was opened, so this class
+// should not be used for files that are still growing.  Nor should it be used for files that might be truncated (or
+// rewritten in place) while they're being read: Because the mapping is shared with the file, touching a part of it that's
+// no longer in the file raises a SIGBUS signal.  (Each time we read ahead - every few MBytes - we check the file's size,
+// and stop at its new end if it has shrunk.  But this can't protect data that has already been read ahead, or that a
+// reader is still using.)
+
+class MappedFileSource: public ByteStreamFileSource {
+public:
+  static MappedFileSource* createNew(UsageEnvironment& env,
+				     char const* fileName,
+				     unsigned preferredFrameSize = 0,
+				     unsigned playTimePerFrame = 0);
+      // Returns NULL if the file can't be opened or mapped (e.g., because it's not a regular file, or - on a 32-bit
+      // system - because it's too large).  In that case, you could use a "ByteStreamFileSource" instead.
+
+  unsigned char const* getMappedBytes(unsigned maxNumBytes, unsigned& numBytes);
+      // Reads up to "maxNumBytes" bytes from the current position in the file, returning a pointer to them - within our
+      // mapping, which remains valid for as long as we exist - and their number ("numBytes", which is 0 at EOF).
+      // (This is used to implement parsing directly from the mapping.)
+
+  // redefined virtual functions:
+  virtual void seekToByteAbsolute(u_int64_t byteNumber, u_int64_t numBytesToStream = 0);
+  virtual void seekToByteRelative(int64_t offset, u_int64_t numBytesToStream = 0);
+  virtual void seekToEnd();
+  virtual unsigned char const* referencedFrameData();
+
+protected:
+  MappedFileSource(UsageEnvironment& env, FILE* fid,
+		   unsigned preferredFrameSize, unsigned playTimePerFrame);
+      // called only by createNew()
+  virtual ~MappedFileSource();
+
+private:
+  Boolean mapFile();
+  void extendReadAhead(u_int64_t newReadAheadPosition);
+
+private: // redefined virtual functions:
+  virtual Boolean isMappedFileSource() const;
+  virtual void doGetNextFrame();
+  virtual void doStopGettingFrames();
+
+private:
+  unsigned char const* fMappedData;
+#if defined(__WIN32__) || defined(_WIN32)
+  void* fMappingHandle;
+#endif
+  u_int64_t fMappingSize; // the original "fFileSize" (which shrinks if the file is truncated)
+  u_int64_t fCurPosition; // within the mapping; <= fFileSize
+  u_int64_t fReadAheadPosition; // how far we've asked the OS to read ahead
+  unsigned char const* fReferencedFrameData; // non-NULL iff our most recent frame was delivered 'by reference'
+};
+
+#endif
@@ -125,6 +125,9 @@ public:
 
   MediaLookupTable* mediaTable;
   void* socketTable;
+  void* packetBufferPool;
+  void* sdpCache;
+  void* asyncFileReader;
 
 protected:
   _Tables(UsageEnvironment& env);
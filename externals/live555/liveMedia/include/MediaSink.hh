@@ -97,6 +97,18 @@ public:
 
   void skipBytes(unsigned numBytes);
 
+  // 'Scatter-gather' support: The packet can end with a 'payload' that isn't copied into our buffer, but is instead
+  // referenced where it already is (e.g., in the buffer of the source that delivered it).  The referenced data must
+  // remain valid until the packet has been sent (or until "resetOffset()" is called).
+  void setPayloadReference(unsigned char const* payload, unsigned payloadSize) {
+    fPayloadReference = payload; fPayloadReferenceSize = payloadSize;
+  }
+  unsigned char const* payloadReference() const { return fPayloadReference; }
+  unsigned payloadReferenceSize() const { return fPayloadReferenceSize; }
+  Boolean havePayloadReference() const { return fPayloadReference != NULL; }
+  void copyInPayloadReference();
+      // copies any referenced payload into our buffer (so that more data can then be enqueued after it)
+
   Boolean isPreferredSize() const {return fCurOffset >= fPreferred;}
   Boolean wouldOverflow(unsigned numBytes) const {
     return (fCurOffset+numBytes) > fMax;
@@ -120,7 +132,7 @@ public:
 
   void adjustPacketStart(unsigned numBytes);
   void resetPacketStart();
-  void resetOffset() { fCurOffset = 0; }
+  void resetOffset() { fCurOffset = 0; fPayloadReference = NULL; fPayloadReferenceSize = 0; }
   void resetOverflowData() { fOverflowDataOffset = fOverflowDataSize = 0; }
 
 private:
@@ -130,6 +142,9 @@ private:
   unsigned fOverflowDataOffset, fOverflowDataSize;
   struct timeval fOverflowPresentationTime;
   unsigned fOverflowDurationInMicroseconds;
+
+  unsigned char const* fPayloadReference;
+  unsigned fPayloadReferenceSize;
 };
 
 #endif
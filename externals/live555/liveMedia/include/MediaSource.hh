@@ -45,6 +45,7 @@ public:
   virtual Boolean isDVVideoStreamFramer() const;
   virtual Boolean isJPEGVideoSource() const;
   virtual Boolean isAMRAudioSource() const;
+  virtual Boolean isMappedFileSource() const;
 
 protected:
   MediaSource(UsageEnvironment& env); // abstract base class
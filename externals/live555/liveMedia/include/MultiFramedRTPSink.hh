@@ -26,6 +26,10 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "RTPSink.hh"
 #endif
 
+struct RetransmissionHistoryEntry; // forward
+class ULPFECEncoder; // forward
+class SendSideBandwidthEstimator; // forward
+
 class MultiFramedRTPSink: public RTPSink {
 public:
   void setPacketSizes(unsigned preferredPacketSize, unsigned maxPacketSize);
@@ -37,6 +41,66 @@ public:
     fOnSendErrorData = onSendErrorFuncData;
   }
 
+  Boolean enableRetransmissions(unsigned historySize, unsigned char rtxPayloadType = 0, u_int32_t rtxSSRC = 0);
+      // Keeps a copy of each of the last "historySize" RTP packets that we sent, so that we can retransmit any of them
+      // that a receiver reports - in a RTCP generic NACK (RFC 4585) - as lost.  If "rtxPayloadType" is non-zero, packets
+      // are retransmitted in the "rtx" payload format (RFC 4588), using this payload type and "rtxSSRC" (or a random
+      // SSRC, if "rtxSSRC" is 0).  Otherwise, packets are retransmitted 'in place' (i.e., exactly as they were sent).
+      // (Note that a retransmitted packet goes to all of our destinations.)
+      // Call with "historySize" == 0 to stop keeping a history.  Returns False iff "historySize" is too large.
+  unsigned char rtxPayloadType() const { return fRTXPayloadType; } // 0 if we're not using the "rtx" payload format
+  u_int32_t rtxSSRC() const { return fRTXSSRC; }
+  static unsigned minRetransmissionInterval; // in microseconds (default: 10000)
+      // A packet is not retransmitted again if it was already retransmitted less than this long ago.  (This stops
+      // a burst of NACKs for the same packet - e.g., from several receivers - causing a burst of retransmissions.)
+
+  // Retransmission statistics:
+  unsigned retransmissionHistorySize() const { return fRetransmissionHistorySize; } // (max) number of packets
+  unsigned numPacketsInRetransmissionHistory() const { return fNumPacketsInRetransmissionHistory; }
+  unsigned numPacketsNACKed() const { return fNumPacketsNACKed; }
+  unsigned numPacketsRetransmitted() const { return fNumPacketsRetransmitted; }
+  unsigned numNACKedPacketsNotInHistory() const { return fNumNACKedPacketsNotInHistory; } // (e.g., too old)
+  unsigned numRetransmissionsSuppressed() const { return fNumRetransmissionsSuppressed; } // see "minRetransmissionInterval"
+  u_int64_t numBytesRetransmitted() const { return fNumBytesRetransmitted; }
+  double retransmissionRate() const { return fPacketCount == 0 ? 0.0 : (double)fNumPacketsRetransmitted/fPacketCount; }
+      // the number of packets retransmitted, per (original) packet sent
+
+  Boolean enableFEC(unsigned numColumns, unsigned numRows, unsigned char fecPayloadType,
+		    Groupsock* fecGroupsock = NULL, u_int32_t fecSSRC = 0);
+      // Sends forward error correction packets - in the "ulpfec" payload format (RFC 5109) - that let receivers
+      // recover lost packets without a retransmission (e.g., when there's no return path).  The packets that we send
+      // are protected in 'matrices' of "numColumns" x "numRows" packets: a FEC packet (the XOR of the packets in a row)
+      // is sent after each row (if "numColumns" > 1), and a FEC packet (the XOR of the packets in a column) after
+      // each column (if "numRows" > 1).  (So the overhead is 1/"numColumns" + 1/"numRows" packets per packet sent.)
+      // FEC packets use payload type "fecPayloadType", and SSRC "fecSSRC" (or a random SSRC, if "fecSSRC" is 0).
+      // They are sent on "fecGroupsock" if this is non-NULL; otherwise, on our own groupsock (or TCP connection(s)).
+      // Call with "numColumns" == 0 to stop sending FEC packets.  Returns False iff the matrix size is not supported
+      // (a column may span at most 48 packets).
+  unsigned numFECPacketsSent() const { return fNumFECPacketsSent; }
+  u_int64_t numFECBytesSent() const { return fNumFECBytesSent; }
+  double fecOverhead() const { return fPacketCount == 0 ? 0.0 : (double)fNumFECPacketsSent/fPacketCount; }
+      // the number of FEC packets sent, per (media) packet sent
+
+  Boolean enableTransportWideCC(u_int8_t extensionId,
+				unsigned initialBitrate, unsigned minBitrate, unsigned maxBitrate);
+      // Numbers each RTP packet that we send with a 'transport-wide sequence number' (in a RFC 8285 one-byte header
+      // extension, with id "extensionId" (1-14)), and - from the RTCP transport-wide feedback packets that receivers
+      // send (see "MultiFramedRTPSource::enableTransportWideCCFeedback()") - estimates the bitrate (in bits per
+      // second, between "minBitrate" and "maxBitrate") at which we can send without congesting the network.  (See
+      // "TransportWideCC.hh".)  Our source should then try to produce data at (no more than) this 'target bitrate'.
+      // This should be called before "startPlaying()".  Call with "extensionId" == 0 to stop.  Returns False iff
+      // "extensionId" is invalid.
+      // (Note that retransmitted and FEC packets are not numbered, and so are not counted in the estimate.)
+  typedef void (TargetBitrateHandlerFunc)(void* clientData, unsigned targetBitrate /*bits per second*/);
+  void setTargetBitrateHandler(TargetBitrateHandlerFunc* handler, void* clientData) {
+    // Can be used to set a callback function to be called whenever our 'target bitrate' changes:
+    fTargetBitrateHandler = handler;
+    fTargetBitrateHandlerData = clientData;
+  }
+  u_int8_t transportWideCCExtensionId() const { return fTransportWideCCExtensionId; } // 0 if not enabled
+  unsigned targetBitrate() const; // in bits per second (0 if not enabled)
+  SendSideBandwidthEstimator* bandwidthEstimator() const { return fBandwidthEstimator; } // for more statistics
+
 protected:
   MultiFramedRTPSink(UsageEnvironment& env,
 		     Groupsock* rtpgs, unsigned char rtpPayloadType,
@@ -72,6 +136,17 @@ protected:
       // frame of size "newFrameSize" to the current RTP packet.
       // (By default, this just calls "numOverflowBytes()", but subclasses can redefine
       // this to (e.g.) impose a granularity upon RTP payload fragments.)
+  virtual Boolean frameBeginsKeyFrame(unsigned char const* frameStart,
+				      unsigned numBytesInFrame) const;
+      // whether a receiver could start decoding at this frame (or frame fragment) (default: True)
+      // (This is used to decide where to resume sending - after dropping packets - to a slow RTP-over-TCP client.)
+  virtual unsigned char const* referencedFrameData();
+      // If our source (e.g., a filter that we created ourself) delivered its most recent frame 'by reference' - i.e.,
+      // without copying it into the buffer that we gave it - returns a pointer to the frame's data (which must remain
+      // valid until we next ask the source for a frame).  Otherwise, returns NULL.  (The default implementation
+      // returns our source's "referencedFrameData()".)
+      // A frame that's delivered by reference - and that is the only frame in its packet - is sent directly
+      // from the source's buffer (see "OutPacketBuffer::setPayloadReference()"), rather than being copied.
 
   // Functions that might be called by doSpecialFrameHandling(), or other subclass virtual functions:
   Boolean isFirstPacket() const { return fIsFirstPacket; }
@@ -90,12 +165,15 @@ protected:
   void setFramePadding(unsigned numPaddingBytes);
   unsigned numFramesUsedSoFar() const { return fNumFramesUsedSoFar; }
   unsigned ourMaxPacketSize() const { return fOurMaxPacketSize; }
+  unsigned rtpHeaderExtensionSize() const { return fRTPHeaderExtensionSize; } // (in addition to the 12-byte RTP header)
 
 public: // redefined virtual functions:
   virtual void stopPlaying();
 
 protected: // redefined virtual functions:
   virtual Boolean continuePlaying();
+  virtual Boolean retransmitPacket(u_int16_t seqNo);
+  virtual void handleTransportWideCCFeedback(unsigned char const* fci, unsigned fciSize);
 
 private:
   void buildAndSendPacket(Boolean isFirstPacket);
@@ -110,8 +188,12 @@ private:
 				unsigned durationInMicroseconds);
   void afterGettingFrame1(unsigned numBytesRead, unsigned numTruncatedBytes,
 			  struct timeval presentationTime,
-			  unsigned durationInMicroseconds);
+			  unsigned durationInMicroseconds,
+			  unsigned char const* frameReference = NULL/*if the frame is in our buffer*/);
   Boolean isTooBigForAPacket(unsigned numBytes) const;
+  void addPacketToRetransmissionHistory();
+  void deleteRetransmissionHistory();
+  void sendFECPackets();
 
   static void ourHandleClosure(void* clientData);
 
@@ -124,6 +206,7 @@ private:
   Boolean fPreviousFrameEndedFragmentation;
 
   Boolean fIsFirstPacket;
+  Boolean fPacketBeginsKeyFrame;
   struct timeval fNextSendTime;
   unsigned fTimestampPosition;
   unsigned fSpecialHeaderPosition;
@@ -132,9 +215,34 @@ private:
   unsigned fCurFrameSpecificHeaderSize; // size in bytes of cur frame-specific header
   unsigned fTotalFrameSpecificHeaderSizes; // size of all frame-specific hdrs in pkt
   unsigned fOurMaxPacketSize;
+  unsigned fRTPHeaderExtensionSize;
+  unsigned fTransportSeqNoPosition;
 
   onSendErrorFunc* fOnSendErrorFunc;
   void* fOnSendErrorData;
+
+  // Retransmission state:
+  RetransmissionHistoryEntry* fRetransmissionHistory; // indexed by sequence number (modulo its size)
+  unsigned char* fRetransmissionHistoryBuffer;
+  unsigned fRetransmissionHistorySize, fRetransmissionHistoryMaxPacketSize, fNumPacketsInRetransmissionHistory;
+  unsigned char fRTXPayloadType;
+  u_int32_t fRTXSSRC;
+  u_int16_t fRTXSeqNo;
+  unsigned fNumPacketsNACKed, fNumPacketsRetransmitted, fNumNACKedPacketsNotInHistory, fNumRetransmissionsSuppressed;
+  u_int64_t fNumBytesRetransmitted;
+
+  // FEC state:
+  ULPFECEncoder* fFECEncoder; // non-NULL iff we're sending FEC packets
+  Groupsock* fFECGroupsock; // NULL if FEC packets are sent using our own "RTPInterface"
+  unsigned fNumFECPacketsSent;
+  u_int64_t fNumFECBytesSent;
+
+  // Transport-wide congestion control state:
+  u_int8_t fTransportWideCCExtensionId; // 0 if not enabled
+  u_int16_t fTransportSeqNo;
+  SendSideBandwidthEstimator* fBandwidthEstimator; // non-NULL iff enabled
+  TargetBitrateHandlerFunc* fTargetBitrateHandler;
+  void* fTargetBitrateHandlerData;
 };
 
 #endif
@@ -28,8 +28,70 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 class BufferedPacket; // forward
 class BufferedPacketFactory; // forward
+class PacketBufferPool; // forward
 
 class MultiFramedRTPSource: public RTPSource {
+public:
+  void setPacketReadBatchSize(unsigned maxPacketsPerRead);
+      // If "maxPacketsPerRead" > 1, then - when our socket becomes readable - we read up to this many packets at once
+      // (using a single "recvmmsg()" system call, if the platform supports it), rather than one packet at a time.
+      // (Each packet is read into a 64 kByte buffer from our environment's "PacketBufferPool", so this many such buffers
+      // may be in use at once.)
+      // This applies only to RTP-over-UDP.
+  static unsigned defaultPacketReadBatchSize; // the initial 'packet read batch size' of each new source (default: 1)
+
+  void enableNACKs(class RTCPInstance* rtcpInstance, unsigned char rtxPayloadType = 0);
+      // If "rtcpInstance" is non-NULL, then - whenever we notice a gap in the sequence numbers of incoming packets - we
+      // use it to send a RTCP generic NACK (RFC 4585), asking the sender to retransmit the missing packets.  (If a
+      // missing packet still hasn't arrived after a while, we ask again, up to a limit.)  If "rtxPayloadType" is
+      // non-zero, we also accept retransmitted packets in the "rtx" payload format (RFC 4588), with this payload type.
+      // Note that a missing packet is waited for only until our 'packet reordering threshold time' is exceeded, so
+      // this should be large enough to allow for a retransmission - e.g., by calling the following function.
+      // (Call with "rtcpInstance" == NULL to stop sending NACKs.)
+  void setAdaptivePacketReorderingThresholdTime(unsigned minUSeconds, unsigned maxUSeconds);
+      // Rather than waiting a fixed time (see "setPacketReorderingThresholdTime()") for a missing packet before giving
+      // up on it, wait a time that's computed from the measured interarrival jitter (and - if NACKs are enabled - from
+      // the measured time that it takes for a NACKed packet to arrive), but that's within these limits.
+      // (Calling "setPacketReorderingThresholdTime()" - with a fixed time - turns this off again.)
+  unsigned packetReorderingThresholdTime() const; // in microseconds (the current value, if it's adaptive)
+
+  void enableKeyFrameRequests(class RTCPInstance* rtcpInstance, unsigned minUSecondsBetweenRequests = 500000);
+      // If "rtcpInstance" is non-NULL, then - whenever we give up on a missing packet (so that the receiver's decoder
+      // will be missing data until the next key frame), or whenever our downstream object calls "requestKeyFrame()" on
+      // us - we use it to send a RTCP "Picture Loss Indication" (RFC 4585), asking the sender for a new key frame.
+      // Requests are sent no more often than "minUSecondsBetweenRequests"; a request that comes sooner than this is
+      // deferred until then.  (Call with "rtcpInstance" == NULL to stop sending requests.)
+
+  // Packet loss statistics:
+  unsigned numPacketsNACKed() const { return fNumPacketsNACKed; } // (each packet is counted once, however often it's NACKed)
+  unsigned numNACKsSent() const { return fNumNACKsSent; } // the number of RTCP NACK packets that we sent
+  unsigned numPacketsRecovered() const; // the number of NACKed packets that then arrived in time
+  unsigned numPacketsLost() const; // the number of packets that we gave up waiting for
+  unsigned estimatedRetransmissionTime() const; // the average time (in microseconds) for a NACKed packet to arrive
+  unsigned numKeyFrameRequestsSent() const { return fNumKeyFrameRequestsSent; } // the number of RTCP "PLI"s that we sent
+
+  void enableFEC(unsigned char fecPayloadType, Groupsock* fecGroupsock = NULL);
+      // Uses incoming forward error correction packets - in the "ulpfec" payload format (RFC 5109), with payload type
+      // "fecPayloadType" - to recover lost packets (see "MultiFramedRTPSink::enableFEC()").  FEC packets are read from
+      // "fecGroupsock" if this is non-NULL; otherwise, they are expected on our own groupsock, along with the media
+      // packets.  (Call with "fecPayloadType" == 0 to stop using FEC.)
+      // Note that a missing packet is waited for only until our 'packet reordering threshold time' is exceeded, so
+      // this should be long enough for the FEC packet(s) that protect it to arrive.
+  unsigned numFECPacketsReceived() const;
+  unsigned numPacketsRecoveredByFEC() const;
+
+  void enableTransportWideCCFeedback(class RTCPInstance* rtcpInstance, u_int8_t extensionId,
+				     unsigned feedbackIntervalUSeconds = 50000);
+      // If "rtcpInstance" is non-NULL, then we note the arrival time of each incoming packet that has a
+      // 'transport-wide sequence number' (in a RFC 8285 one-byte header extension, with id "extensionId"), and -
+      // every "feedbackIntervalUSeconds" - use "rtcpInstance" to send a RTCP transport-wide feedback packet reporting
+      // these arrivals, so that the sender can estimate the available bandwidth (see
+      // "MultiFramedRTPSink::enableTransportWideCC()").  (Call with "rtcpInstance" == NULL to stop.)
+  unsigned numTransportWideCCFeedbacksSent() const { return fNumTransportWideCCFeedbacksSent; }
+
+  // redefined virtual functions:
+  virtual void requestKeyFrame();
+
 protected:
   MultiFramedRTPSource(UsageEnvironment& env, Groupsock* RTPgs,
 		       unsigned char rtpPayloadFormat,
@@ -63,9 +125,27 @@ private:
 private:
   void reset();
   void doGetNextFrame1();
+  void handlePacketLoss();
+      // sends any NACKs that are due, updates an adaptive reordering threshold time, and arranges to be called again
+  static void packetLossTimeoutHandler(void* clientData);
+  void packetLossTimeoutHandler1();
+  void sendKeyFrameRequest();
+  static void keyFrameRequestHandler(void* clientData);
 
   static void networkReadHandler(MultiFramedRTPSource* source, int /*mask*/);
   void networkReadHandler1();
+  void readPacketBatch();
+  Boolean storeIncomingPacket(BufferedPacket* bPacket, struct sockaddr_in& fromAddress,
+			      Boolean isRecoveredPacket = False);
+      // checks the RTP header of a newly-read (or recovered) packet, and - if it's OK - stores it in our reordering buffer
+  void handleFECPacket(unsigned char const* packet, unsigned packetSize, struct sockaddr_in& fromAddress);
+  void storeRecoveredPackets(struct sockaddr_in& fromAddress); // any that our FEC decoder has just recovered
+  static void fecNetworkReadHandler(MultiFramedRTPSource* source, int /*mask*/);
+  void fecNetworkReadHandler1();
+  void noteTransportWideSeqNo(unsigned char const* headerExtension, unsigned headerExtensionSize,
+			      struct timeval const& timeReceived);
+  void sendTransportWideCCFeedback();
+  static void transportWideCCFeedbackHandler(void* clientData);
 
   Boolean fAreDoingNetworkReads;
   BufferedPacket* fPacketReadInProgress;
@@ -73,6 +153,31 @@ private:
   Boolean fPacketLossInFragmentedFrame;
   unsigned char* fSavedTo;
   unsigned fSavedMaxSize;
+  unsigned fPacketReadBatchSize;
+  unsigned fDirectDeliveryDepth;
+
+  class RTCPInstance* fNACKRTCPInstance; // non-NULL iff NACKs are enabled
+  unsigned char fRTXPayloadType;
+  Boolean fHaveAdaptiveThresholdTime;
+  unsigned fMinThresholdTime, fMaxThresholdTime;
+  TaskToken fPacketLossTimeoutTask;
+  unsigned fNumPacketsNACKed, fNumNACKsSent;
+  class RTCPInstance* fKeyFrameRequestRTCPInstance; // non-NULL iff key frame requests are enabled
+  unsigned fMinKeyFrameRequestInterval;
+  struct timeval fLastKeyFrameRequestTime;
+  TaskToken fKeyFrameRequestTask; // non-NULL iff a key frame request has been deferred
+  unsigned fNumKeyFrameRequestsSent;
+  class ULPFECDecoder* fFECDecoder; // non-NULL iff FEC is enabled
+  unsigned char fFECPayloadType;
+  Groupsock* fFECGroupsock; // non-NULL iff FEC packets are read from a separate groupsock
+  unsigned char* fFECReadBuffer; // used only if "fFECGroupsock" is non-NULL
+  u_int32_t fLastReceivedFECSSRC;
+  class RTCPInstance* fTransportWideCCRTCPInstance; // non-NULL iff transport-wide feedback is enabled
+  u_int8_t fTransportWideCCExtensionId;
+  unsigned fTransportWideCCFeedbackInterval;
+  class TransportWideCCFeedbackGenerator* fTransportWideCCFeedbackGenerator;
+  TaskToken fTransportWideCCFeedbackTask;
+  unsigned fNumTransportWideCCFeedbacksSent;
 
   // A buffer to (optionally) hold incoming pkts that have been reorderered
   class ReorderingPacketBuffer* fReorderingBuffer;
@@ -92,6 +197,15 @@ public:
   unsigned useCount() const { return fUseCount; }
 
   Boolean fillInData(RTPInterface& rtpInterface, struct sockaddr_in& fromAddress, Boolean& packetReadWasIncomplete);
+  Boolean fillInData(unsigned char const* packet, unsigned packetSize);
+      // copies a packet that we didn't read from the network (e.g., one that was recovered using FEC)
+  static unsigned fillInDataBatch(RTPInterface& rtpInterface, BufferedPacket** packets, unsigned numPackets,
+				  struct sockaddr_in* fromAddresses);
+      // Reads up to "numPackets" (UDP) packets at once - one into each of "packets"; returns the number read.
+
+  void setPacketBufferPool(PacketBufferPool* pool) { fPool = pool; }
+      // If set, our data buffer comes from "pool" - and only while we hold data; otherwise, we allocate our own buffer.
+  void releaseBuffer(); // called when we no longer hold data
   void assignMiscParams(unsigned short rtpSeqNo, unsigned rtpTimestamp,
 			struct timeval presentationTime,
 			Boolean hasBeenSyncedUsingRTCP,
@@ -117,7 +231,9 @@ public:
   unsigned bytesAvailable() const { return fPacketSize - fTail; }
 
 protected:
-  virtual void reset();
+  virtual void reset(); // called once we have a buffer, before new data is read into it
+  virtual unsigned tailroom() const;
+      // the number of bytes (if any) that we might append to our data, after it's read (default: 0)
   virtual unsigned nextEnclosedFrameSize(unsigned char*& framePtr,
 					 unsigned dataSize);
       // The above function has been deprecated.  Instead, new subclasses should use:
@@ -132,6 +248,13 @@ protected:
   unsigned fTail;
 
 private:
+  Boolean resizeBuffer(unsigned minSize);
+      // replaces our buffer with one (from our pool, if any) that holds at least "minSize" bytes, keeping our data
+  Boolean prepareBufferForNewData(); // discards any existing data, makes sure that our buffer is full size, then "reset()"s
+  void shrinkBuffer(); // once we've read new data, moves it to a smaller buffer from our pool (if any), if possible
+
+private:
+  PacketBufferPool* fPool;
   BufferedPacket* fNextPacket; // used to link together packets
 
   unsigned fUseCount;
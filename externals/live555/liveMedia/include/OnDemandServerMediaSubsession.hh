@@ -34,6 +34,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _RTCP_HH
 #include "RTCP.hh"
 #endif
+#ifndef _SDP_CACHE_HH
+#include "SDPCache.hh"
+#endif
+#ifndef _STREAM_REPLICATOR_HH
+#include "StreamReplicator.hh"
+#endif
 
 class OnDemandServerMediaSubsession: public ServerMediaSubsession {
 protected: // we're a virtual base class
@@ -102,6 +108,15 @@ protected: // new virtual functions, may be redefined by a subclass:
   virtual Groupsock* createGroupsock(struct in_addr const& addr, Port port);
   virtual RTCPInstance* createRTCP(Groupsock* RTCPgs, unsigned totSessionBW, /* in kbps */
 				   unsigned char const* cname, RTPSink* sink);
+  virtual Boolean sdpCacheKey(char*& key, char*& version);
+      // If our SDP description can be stored in (and later retrieved from) our environment's "SDPCache", returns True,
+      // and sets "key" (identifying our source) and "version" (identifying its current contents) to new strings.
+      // (The default implementation returns False.  Don't redefine it unless "duration()" - which "sdpLines()" uses -
+      //  can be computed without first calling "createNewStreamSource()".)
+  virtual FramedSource* createNewStreamSourceFromReplica(FramedSource* replica);
+      // Used only if "enableGOPCache()" was called: Returns the source - to be fed to "createNewRTPSink()" - for a new
+      // replica of our (shared) stream source.  The default implementation returns "replica" itself; H.264 and H.265
+      // subsessions redefine it to add a 'discrete' framer.
 
 public:
   void multiplexRTCPWithRTP() { fMultiplexRTCPWithRTP = True; }
@@ -115,18 +130,33 @@ public:
 
   void sendRTCPAppPacket(u_int8_t subtype, char const* name,
 			 u_int8_t* appDependentData, unsigned appDependentDataSize);
-    // Sends a custom RTCP "APP" packet to the most recent client (if "reuseFirstSource" was False),
-    // or to all current clients (if "reuseFirstSource" was True).
+    // Sends a custom RTCP "APP" packet to the most recent client (if "reuseFirstSource" was False, or if
+    // "enableGOPCache()" was called), or to all current clients (if "reuseFirstSource" was True).
     // The parameters correspond to their
     // respective fields as described in the RTP/RTCP definition (RFC 3550).
     // Note that only the low-order 5 bits of "subtype" are used, and only the first 4 bytes
     // of "name" are used.  (If "name" has fewer than 4 bytes, or is NULL,
     // then the remaining bytes are '\0'.)
 
+  Boolean enableGOPCache(unsigned frameRingSize, unsigned burstSpeedup = 0);
+    // Used only if "reuseFirstSource" was True.  Rather than sending the same RTP stream to every client, reads our (one)
+    // stream source through a "StreamReplicator" that has a 'frame ring' of "frameRingSize" frames, and a 'GOP cache' (see
+    // "StreamReplicator::enableGOPCache()"), and gives each client its own replica (and "RTPSink").  A new (H.264 or H.265)
+    // client then starts at the most recent key frame, rather than waiting for the next one.  (The ring must be large
+    // enough to hold a whole GOP; each of its frames takes "OutPacketBuffer::maxSize" bytes.)
+    // Call this before the first client sets up a stream.  Returns False (and does nothing) if "reuseFirstSource" was
+    // False, or if "frameRingSize" is 0.
+
 private:
   void setSDPLinesFromRTPSink(RTPSink* rtpSink, FramedSource* inputSource,
-			      unsigned estBitrate);
+			      unsigned estBitrate, SDPCache* sdpCache,
+			      char const* cacheKey, char const* cacheVersion);
+  void setSDPLines(char const* mediaType, unsigned char rtpPayloadType, unsigned estBitrate,
+		   char const* rtpmapLine, char const* auxSDPLine);
       // used to implement "sdpLines()"
+  FramedSource* createNewReplicaSource(unsigned clientSessionId, unsigned& estBitrate);
+  void closeReplicatorIfUnused();
+      // used to implement "enableGOPCache()"
 
 protected:
   char* fSDPLines;
@@ -140,6 +170,9 @@ private:
   char fCNAME[100]; // for RTCP
   RTCPAppHandlerFunc* fAppHandlerTask;
   void* fAppHandlerClientData;
+  unsigned fGOPCacheFrameRingSize, fGOPCacheBurstSpeedup;
+  StreamReplicator* fReplicator; // used only with a GOP cache; created for the first client's stream
+  unsigned fReplicatorInputBitrate;
   friend class StreamState;
 };
 
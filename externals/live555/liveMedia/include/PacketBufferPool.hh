@@ -0,0 +1,81 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A per-environment pool of packet buffers, used by the "BufferedPacket"s of all "MultiFramedRTPSource"s
+// C++ header
+
+#ifndef _PACKET_BUFFER_POOL_HH
+#define _PACKET_BUFFER_POOL_HH
+
+#ifndef _MEDIA_HH
+#include "Media.hh"
+#endif
+
+// Buffers come in several 'size classes' (256, 2048, 16384, and 65536 bytes).  An incoming packet is read into a
+// buffer of the largest size, but is then moved into the smallest buffer that will hold it, so that packets that are
+// waiting to be delivered use (roughly) only as much memory as they need.
+#define PACKET_BUFFER_POOL_NUM_SIZE_CLASSES 4
+
+class PacketBufferPool {
+public:
+  static PacketBufferPool* ourPool(UsageEnvironment& env);
+      // returns our environment's pool (creating it if necessary)
+
+  void incrementReferenceCount() { ++fReferenceCount; }
+  void decrementReferenceCount();
+      // The pool is deleted when its reference count drops to 0.  (Each "MultiFramedRTPSource" holds a reference.)
+
+  unsigned char* allocateBuffer(unsigned minSize, unsigned& resultBufferSize);
+      // Returns NULL (with "resultBufferSize" == 0) if "minSize" is larger than our largest size class
+  void releaseBuffer(unsigned char* buffer, unsigned bufferSize);
+      // "bufferSize" must be the "resultBufferSize" that was returned when the buffer was allocated
+
+  static unsigned maxBufferSize();
+  static unsigned bufferSizeFor(unsigned minSize); // the size of the buffer that we'd allocate for "minSize" bytes
+  static unsigned bufferSizeForSizeClass(unsigned sizeClass);
+
+  // The contiguous 'slab' (if any) from which buffers are carved (before we allocate any from the heap):
+  static unsigned slabSize; // of each new pool (default: 0, meaning 'no slab')
+
+  // Statistics:
+  unsigned numBuffersInUse(unsigned sizeClass) const;
+  unsigned maxNumBuffersInUse(unsigned sizeClass) const; // the 'high-water mark'
+  unsigned numFreeBuffers(unsigned sizeClass) const;
+  unsigned numBuffersFromSlab(unsigned sizeClass) const;
+  u_int64_t numBytesInUse() const { return fNumBytesInUse; }
+  u_int64_t maxNumBytesInUse() const { return fMaxNumBytesInUse; } // the 'high-water mark'
+  unsigned numSlabBytesUsed() const { return fNumSlabBytesUsed; }
+
+private:
+  PacketBufferPool(UsageEnvironment& env);
+  virtual ~PacketBufferPool();
+
+private:
+  UsageEnvironment& fEnv;
+  unsigned fReferenceCount;
+
+  unsigned char* fSlab;
+  unsigned fSlabSize, fNumSlabBytesUsed;
+
+  struct SizeClass {
+    unsigned char* freeList; // linked through the first bytes of each free buffer
+    unsigned numInUse, maxNumInUse, numFree, numFromSlab;
+  } fSizeClasses[PACKET_BUFFER_POOL_NUM_SIZE_CLASSES];
+  u_int64_t fNumBytesInUse, fMaxNumBytesInUse;
+};
+
+#endif
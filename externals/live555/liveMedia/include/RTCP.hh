@@ -95,6 +95,17 @@ public:
       // Note that only the low-order 5 bits of "subtype" are used, and only the first 4 bytes
       // of "name" are used.  (If "name" has fewer than 4 bytes, or is NULL,
       // then the remaining bytes are '\0'.)
+  void sendNACK(u_int32_t mediaSourceSSRC, u_int16_t const* seqNos, unsigned numSeqNos);
+      // Sends a RTCP generic NACK (RFC 4585) to the peer(s), asking the sender of the RTP stream with SSRC
+      // "mediaSourceSSRC" to retransmit the packets with the "numSeqNos" sequence numbers "seqNos" (which must be
+      // in increasing order).  Like "sendAppPacket()", this sends the feedback packet on its own (i.e., not as part of
+      // a compound RTCP packet).
+  void sendPLI(u_int32_t mediaSourceSSRC);
+      // Sends a RTCP "Picture Loss Indication" (RFC 4585) to the peer(s), asking the sender of the RTP stream with
+      // SSRC "mediaSourceSSRC" for a new key frame.  (Like "sendNACK()", this is sent on its own.)
+  void sendTransportWideCCFeedback(u_int32_t mediaSourceSSRC, unsigned char const* fci, unsigned fciSize);
+      // Sends a RTCP transport-wide congestion control feedback packet (see "TransportWideCC.hh") - with the given
+      // 'FCI' - to the peer(s).  (Like "sendNACK()", this is sent on its own.)
 
   Groupsock* RTCPgs() const { return fRTCPInterface.gs(); }
 
@@ -189,6 +200,7 @@ private:
   AddressPortLookupTable* fSpecificRRHandlerTable;
   RTCPAppHandlerFunc* fAppHandlerTask;
   void* fAppHandlerClientData;
+  u_int32_t fLastFIRSenderSSRC; int fLastFIRSeqNo; // used to ignore repeated "FIR" requests
 
 public: // because this stuff is used by an external "C" function
   void schedule(double nextTime);
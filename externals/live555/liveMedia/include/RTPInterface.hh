@@ -40,6 +40,13 @@ typedef void ServerRequestAlternativeByteHandler(void* instance, u_int8_t reques
 // the same TCP connection.  A RTSP server implementation would supply a function like this - as a parameter to
 // "ServerMediaSubsession::startStream()".
 
+// What to do when a RTP-over-TCP client can't keep up with the stream (so that the data that we've queued for output
+// on its TCP connection would exceed the queue's maximum size):
+enum TCPOutputOverflowPolicy {
+  TCP_OUTPUT_DROP_UNTIL_KEY_FRAME, // drop packets (on the overflowing channel) until one that begins a 'key frame'
+  TCP_OUTPUT_DISCONNECT // close the connection
+};
+
 class tcpStreamRecord {
 public:
   tcpStreamRecord(int streamSocketNum, unsigned char streamChannelId,
@@ -66,7 +73,35 @@ public:
 						     ServerRequestAlternativeByteHandler* handler, void* clientData);
   static void clearServerRequestAlternativeByteHandler(UsageEnvironment& env, int socketNum);
 
-  Boolean sendPacket(unsigned char* packet, unsigned packetSize);
+  // RTP-over-TCP output is never blocking.  Instead, data that can't be sent immediately is queued (separately for
+  // each TCP socket), and sent later, when the socket becomes writable.  The size of this queue is bounded;
+  // when the queue overflows, the socket's "TCPOutputOverflowPolicy" is applied.  (Data that can't be dropped - e.g.,
+  // RTSP responses - may also be queued beyond the maximum size, but only up to twice that size; if it would overflow
+  // even this, the connection is closed.)
+  static unsigned defaultMaxTCPOutputQueueSize; // in bytes (default: 1 MByte)
+  static TCPOutputOverflowPolicy defaultTCPOutputOverflowPolicy; // default: TCP_OUTPUT_DROP_UNTIL_KEY_FRAME
+  static void setTCPOutputQueueParameters(UsageEnvironment& env, int socketNum,
+					  unsigned maxQueueSize, TCPOutputOverflowPolicy overflowPolicy);
+  static unsigned numBytesQueuedForTCPOutput(UsageEnvironment& env, int socketNum);
+  static unsigned numPacketsDroppedForTCPOutput(UsageEnvironment& env, int socketNum);
+      // Note: Once a socket's last RTP/RTCP stream has gone, any output that's still queued on the socket (perhaps
+      // including a partly-written packet, or RTSP responses) continues to be written, before the socket is handed
+      // back to its RTSP server or client (via its 'alternative byte handler').
+  static void discardQueuedTCPOutput(UsageEnvironment& env, int socketNum);
+      // Call this before closing a socket that might have been used for RTP/RTCP-over-TCP.  Any output that's still
+      // queued on the socket is discarded, and the socket is no longer used.
+
+  static int sendDataOverTCPSocket(UsageEnvironment& env, int socketNum, u_int8_t const* data, unsigned dataSize);
+      // Like "send()", except that - if RTP/RTCP packets are queued for output on this socket - the data is queued
+      // behind them, rather than being sent immediately (where it could become interleaved within a packet).
+      // A RTSP server uses this to send responses.
+
+  Boolean sendPacket(unsigned char* packet, unsigned packetSize, Boolean packetBeginsKeyFrame = True);
+      // "packetBeginsKeyFrame" is used only for RTP-over-TCP output, when dropping packets to a slow client.
+  Boolean sendPacket(unsigned char* header, unsigned headerSize,
+		     unsigned char const* payload, unsigned payloadSize, Boolean packetBeginsKeyFrame = True);
+      // Sends a packet that consists of "header" followed by "payload" (which needn't be contiguous with it),
+      // without first copying them together.
   void startNetworkReading(TaskScheduler::BackgroundHandlerProc*
                            handlerProc);
   Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
@@ -81,6 +116,13 @@ public:
   // Otherwise (if "tcpSocketNum" >= 0), the packet was received (interleaved) over TCP, and
   //   "tcpStreamChannelId" will return the channel id.
 
+  Boolean nextReadIsOverTCP() const { return fNextTCPReadStreamSocketNum >= 0; }
+  Boolean handleReadBatch(unsigned char** buffers, unsigned const* bufferMaxSizes, unsigned numBuffers,
+			  // out parameters:
+			  unsigned* bytesRead, struct sockaddr_in* fromAddresses, unsigned& numPacketsRead);
+      // Reads up to "numBuffers" packets at once from our 'groupsock' (see "Groupsock::handleReadBatch()").
+      // This must not be called if "nextReadIsOverTCP()"; instead, use "handleRead()".
+
   void stopNetworkReading();
 
   UsageEnvironment& envir() const { return fOwner->envir(); }
@@ -99,8 +141,8 @@ public:
 private:
   // Helper functions for sending a RTP or RTCP packet over a TCP connection:
   Boolean sendRTPorRTCPPacketOverTCP(unsigned char* packet, unsigned packetSize,
-				     int socketNum, unsigned char streamChannelId);
-  Boolean sendDataOverTCP(int socketNum, u_int8_t const* data, unsigned dataSize, Boolean forceSendToSucceed);
+				     unsigned char const* payload, unsigned payloadSize,
+				     int socketNum, unsigned char streamChannelId, Boolean packetBeginsKeyFrame);
 
 private:
   friend class SocketDescriptor;
@@ -86,6 +86,9 @@ public:
   }
   unsigned& estimatedBitrate() { return fEstimatedBitrate; } // kbps; usually 0 (i.e., unset)
 
+  unsigned numKeyFrameRequests() const { return fNumKeyFrameRequests; }
+      // the number of times that a receiver asked us (in a RTCP "PLI" or "FIR") for a key frame
+
 protected:
   RTPSink(UsageEnvironment& env,
 	  Groupsock* rtpGS, unsigned char rtpPayloadType,
@@ -104,6 +107,14 @@ protected:
   u_int32_t convertToRTPTimestamp(struct timeval tv);
   unsigned packetCount() const {return fPacketCount;}
   unsigned octetCount() const {return fOctetCount;}
+  virtual Boolean retransmitPacket(u_int16_t seqNo);
+      // called when a receiver reports (in a RTCP generic NACK) that it lost the packet with sequence number "seqNo".
+      // Returns True iff the packet was retransmitted.  (The default implementation does nothing, and returns False.)
+  void handleKeyFrameRequest();
+      // called when a receiver asks (in a RTCP "PLI" or "FIR") for a key frame.  We pass the request on to our source.
+  virtual void handleTransportWideCCFeedback(unsigned char const* fci, unsigned fciSize);
+      // called when a receiver sends a RTCP transport-wide feedback packet (see "TransportWideCC.hh"); "fci" is the
+      // part after the media source's SSRC.  (The default implementation does nothing.)
 
 protected:
   RTPInterface fRTPInterface;
@@ -126,6 +137,7 @@ private:
   unsigned fNumChannels;
   struct timeval fCreationTime;
   unsigned fEstimatedBitrate; // set on creation if known; otherwise 0
+  unsigned fNumKeyFrameRequests;
 
   RTPTransmissionStatsDB* fTransmissionStatsDB;
 };
@@ -180,6 +180,8 @@ public: // should be protected, but some old compilers complain otherwise
     Boolean authenticationOK(char const* cmdName, char const* urlSuffix, char const* fullRequestStr);
     void changeClientInputSocket(int newSocketNum, unsigned char const* extraData, unsigned extraDataSize);
       // used to implement RTSP-over-HTTP tunneling
+    Boolean handOffToShard(unsigned shardIndex);
+      // used when we're one of several shards (see "ShardedRTSPServer"); returns True iff our socket was handed over
     static void continueHandlingREGISTER(ParamsForREGISTER* params);
     virtual void continueHandlingREGISTER1(ParamsForREGISTER* params);
 
@@ -0,0 +1,102 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A per-environment cache of the SDP parameters (including any 'parameter sets' or other 'config' information)
+// that "OnDemandServerMediaSubsession"s would otherwise get by 'probing' their source
+// C++ header
+
+#ifndef _SDP_CACHE_HH
+#define _SDP_CACHE_HH
+
+#ifndef _SERVER_MEDIA_SESSION_HH
+#include "ServerMediaSession.hh"
+#endif
+
+class SDPCachePrewarmRequest; // forward
+
+class SDPCacheEntry {
+public:
+  char const* mediaType() const { return fMediaType; }
+  unsigned char rtpPayloadType() const { return fRTPPayloadType; }
+  unsigned estBitrate() const { return fEstBitrate; } // kbps
+  char const* rtpmapLine() const { return fRTPMapLine; }
+  char const* auxSDPLine() const { return fAuxSDPLine; }
+
+private:
+  friend class SDPCache;
+  SDPCacheEntry(char const* version, char const* mediaType, unsigned char rtpPayloadType,
+		unsigned estBitrate, char const* rtpmapLine, char const* auxSDPLine);
+  virtual ~SDPCacheEntry();
+
+private:
+  char* fVersion;
+  char* fMediaType;
+  unsigned char fRTPPayloadType;
+  unsigned fEstBitrate;
+  char* fRTPMapLine;
+  char* fAuxSDPLine;
+};
+
+class SDPCache {
+public:
+  static SDPCache* createNew(UsageEnvironment& env, char const* cacheFileName = NULL);
+      // Creates our environment's cache (deleting any previous one).  If "cacheFileName" is non-NULL, the cache is
+      // persistent: It is loaded from this file (if it exists), and each new entry is appended to it.
+  static SDPCache* ourCache(UsageEnvironment& env); // returns NULL if no cache has been created
+  virtual ~SDPCache();
+
+  SDPCacheEntry const* lookup(char const* key, char const* version);
+      // Returns NULL if there's no entry for "key", or if the entry is for a different "version" (i.e., it's stale)
+  void add(char const* key, char const* version, char const* mediaType, unsigned char rtpPayloadType,
+	   unsigned estBitrate, char const* rtpmapLine, char const* auxSDPLine);
+      // Adds (or replaces) the entry for "key"
+
+  void prewarm(ServerMediaSession& serverMediaSession);
+      // Arranges for each of "serverMediaSession"s subsessions to generate (and thus cache) its SDP description -
+      // one subsession at a time, from the event loop - so that this doesn't have to be done later, when handling
+      // a RTSP "DESCRIBE" command.  (It's OK if "serverMediaSession" is deleted before this has completed.)
+
+  // Statistics:
+  unsigned numEntries() const { return fEntries->numEntries(); }
+  unsigned numHits() const { return fNumHits; }
+  unsigned numMisses() const { return fNumMisses; } // includes lookups of stale entries
+  unsigned numSubsessionsAwaitingPrewarm() const;
+
+private:
+  SDPCache(UsageEnvironment& env, char const* cacheFileName);
+
+  void loadFromFile();
+  void writeEntry(FILE* fid, char const* key, SDPCacheEntry const* entry);
+  void addEntry(char const* key, SDPCacheEntry* entry);
+
+  static void prewarmTask(void* clientData);
+  void prewarmNextSubsession();
+
+private:
+  UsageEnvironment& fEnv;
+  char* fCacheFileName;
+  FILE* fCacheFid; // open for appending
+  HashTable* fEntries; // indexed by key
+
+  SDPCachePrewarmRequest* fPrewarmHead;
+  SDPCachePrewarmRequest* fPrewarmTail;
+  TaskToken fPrewarmTask;
+
+  unsigned fNumHits, fNumMisses;
+};
+
+#endif
@@ -0,0 +1,85 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A RTSP server that runs several 'shards' - each a "RTSPServer" with its own event loop, running in its own thread -
+// that all listen on the same port, so that the server can use several CPU cores.
+// C++ header
+
+#ifndef _SHARDED_RTSP_SERVER_HH
+#define _SHARDED_RTSP_SERVER_HH
+
+#ifndef _RTSP_SERVER_HH
+#include "RTSPServer.hh"
+#endif
+
+class OurThread; // forward
+
+// Each shard has its own "UsageEnvironment" (and "TaskScheduler"), and its own listening socket (using "SO_REUSEPORT"),
+// so the kernel distributes new connections among the shards.  (This is supported on Linux (3.9 and later) and on
+// recent BSDs; on other platforms, "createNew()" fails unless "numShards" is 1.)
+//
+// Because the library is not thread-safe, nothing can be shared between shards: Each shard has its own copy of
+// each "ServerMediaSession", which is created by a 'set up' function that's called once for each shard.
+// A client session stays with the shard that created it - including any RTP/RTCP-over-TCP streaming, which uses
+// the session's RTSP connection.  If a client uses a new TCP connection for a session (or for RTSP-over-HTTP
+// tunneling), and the kernel gives that connection to a different shard, then the connection is handed over to the
+// session's own shard.
+
+class ShardedRTSPServer: public Medium {
+public:
+  typedef UsageEnvironment* (createEnvironmentFunc)(unsigned shardIndex, void* clientData);
+      // Should return a new "UsageEnvironment" (with its own "TaskScheduler") for the shard - e.g.:
+      //     TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+      //     return BasicUsageEnvironment::createNew(*scheduler);
+      // The environment's "TaskScheduler" must implement "postTask()"; if it doesn't, "createNew()" fails.
+  typedef void (setUpShardFunc)(RTSPServer* shard, unsigned shardIndex, void* clientData);
+      // Should create the shard's "ServerMediaSession"s (in "shard->envir()"), and add them to "shard".
+      // (This is called - for each shard - before any of the shards' threads are started.)
+
+  static ShardedRTSPServer* createNew(UsageEnvironment& env, Port ourPort, unsigned numShards,
+				      createEnvironmentFunc* createEnvironment,
+				      setUpShardFunc* setUpShard, void* clientData = NULL,
+				      UserAuthenticationDatabase* authDatabase = NULL,
+				      unsigned reclamationSeconds = 65);
+      // If ourPort.num() == 0, we'll choose the port number
+      // Note: The caller is responsible for reclaiming "authDatabase" (which is shared - read-only - by all shards)
+      // Once this returns, each shard's thread is running its event loop.  Calling "Medium::close()" on the result
+      // stops each thread, then deletes each shard (and its "UsageEnvironment" and "TaskScheduler").
+
+  unsigned numShards() const { return fNumShards; }
+  RTSPServer* shard(unsigned shardIndex) const { return shardIndex < fNumShards ? fShards[shardIndex] : NULL; }
+      // Note: A shard (and anything in its environment) may be used only from the shard's own thread
+      //     - e.g., from a task that's posted (using "shard->envir().taskScheduler().postTask()") to it.
+  Port port() const { return fPort; }
+
+protected:
+  ShardedRTSPServer(UsageEnvironment& env, Port ourPort, unsigned numShards);
+      // called only by "createNew()"
+  virtual ~ShardedRTSPServer();
+
+private:
+  static void shardThreadMain(void* shard);
+  static void stopShardTask(void* shard); // posted to a shard, to stop its event loop
+
+private:
+  Port fPort;
+  unsigned fNumShards;
+  RTSPServer** fShards;
+  OurThread** fThreads;
+};
+
+#endif
@@ -26,19 +26,76 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 class StreamReplica; // forward
+class StreamReplicator; // forward
+
+// A frame read from a "StreamReplicator"s input source - when the replicator is using a 'frame ring' (see below).
+// Frames are reference-counted, so that replicas (and their readers) can share them, without copying:
+class ReplicatedFrame {
+public:
+  unsigned char* data() const { return fData; }
+  unsigned frameSize() const { return fFrameSize; }
+  unsigned numTruncatedBytes() const { return fNumTruncatedBytes; }
+  struct timeval presentationTime() const { return fPresentationTime; }
+  unsigned durationInMicroseconds() const { return fDurationInMicroseconds; }
+
+  void incrementReferenceCount() { ++fReferenceCount; }
+  void decrementReferenceCount();
+      // When the reference count drops to 0, the frame's buffer is returned to its replicator, for reuse.
+
+private:
+  friend class StreamReplicator;
+  ReplicatedFrame(StreamReplicator* ourReplicator, unsigned bufferSize, ReplicatedFrame* nextInAllFramesList);
+  virtual ~ReplicatedFrame();
+
+private:
+  StreamReplicator* fOurReplicator; // NULL if the replicator has been deleted (while we were still referenced)
+  ReplicatedFrame* fNextInAllFramesList;
+  ReplicatedFrame* fNextFree;
+  unsigned fReferenceCount;
+
+  unsigned char* fData;
+  unsigned fBufferSize, fFrameSize, fNumTruncatedBytes;
+  struct timeval fPresentationTime;
+  unsigned fDurationInMicroseconds;
+};
 
 class StreamReplicator: public Medium {
 public:
-  static StreamReplicator* createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies = True);
+  static StreamReplicator* createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies = True,
+				     unsigned frameRingSize = 0);
     // If "deleteWhenLastReplicaDies" is True (the default), then the "StreamReplicator" object is deleted when (and only when)
     //   all replicas have been deleted.  (In this case, you must *not* call "Medium::close()" on the "StreamReplicator" object,
     //   unless you never created any replicas from it to begin with.)
     // If "deleteWhenLastReplicaDies" is False, then the "StreamReplicator" object remains in existence, even when all replicas
     //   have been deleted.  (This allows you to create new replicas later, if you wish.)  In this case, you delete the
     //   "StreamReplicator" object by calling "Medium::close()" on it - but you must do so only when "numReplicas()" returns 0.
+    // If "frameRingSize" is 0 (the default), then each frame is read directly into one replica's buffer, and copied from
+    //   there to the others.  The input source is read only as fast as the slowest replica.
+    // If "frameRingSize" > 0, then each frame is read (once) into a reference-counted "ReplicatedFrame", and the most recent
+    //   "frameRingSize" frames are kept in a ring.  Each replica then reads from the ring at its own pace; the input source is
+    //   read as fast as the fastest replica.  A replica that falls more than "frameRingSize" frames behind skips ahead to
+    //   the oldest frame in the ring.  Also, a reader of a replica can avoid copying frames altogether, by calling
+    //   "getNextFrame()" with a NULL "to" parameter (and a "maxSize" of 0), and then using "deliveredFrame()" (below).
+    //   (Each "ReplicatedFrame" buffer has size "OutPacketBuffer::maxSize" - as set when the "StreamReplicator" is created.)
 
   FramedSource* createStreamReplica();
 
+  Boolean enableGOPCache(unsigned burstSpeedup = 0);
+    // Makes each new replica start at the most recent 'key frame' (IDR or IRAP picture - preceded by any parameter sets)
+    // that's still in our 'frame ring' - rather than at the next frame to be read - so that a new client can begin
+    // decoding immediately.  (The ring must therefore be large enough to hold a whole 'GOP'.)  Until a replica has caught up
+    // with the input source, the durations of the frames delivered to it are divided by "burstSpeedup" (or set to 0 - so that
+    // the frames are delivered as fast as the replica's reader will take them - if "burstSpeedup" is 0).
+    // This requires a 'frame ring', and an input source that's a "H264VideoStreamFramer" or "H265VideoStreamFramer"
+    // (or a 'discrete' framer); otherwise, it returns False (and does nothing).
+
+  static ReplicatedFrame* deliveredFrame(FramedSource* replica);
+    // Returns the frame that was most recently delivered to "replica" (which must have been created by "createStreamReplica()"),
+    // or NULL if the replicator is not using a 'frame ring'.  The frame remains valid until the replica's next "getNextFrame()"
+    // (or longer, if you call "incrementReferenceCount()" on it, and later, "decrementReferenceCount()").
+  static unsigned numFramesSkipped(FramedSource* replica);
+    // The number of frames that "replica" has skipped, because it fell too far behind the other replicas
+
   unsigned numReplicas() const { return fNumReplicas; }
 
   FramedSource* inputSource() const { return fInputSource; }
@@ -47,7 +104,8 @@ public:
   void detachInputSource() { fInputSource = NULL; }
 
 protected:
-  StreamReplicator(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies);
+  StreamReplicator(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies,
+		   unsigned frameRingSize);
     // called only by "createNew()"
   virtual ~StreamReplicator();
 
@@ -71,6 +129,16 @@ private:
 
   void deliverReceivedFrame();
 
+  // Routines used only when we have a 'frame ring':
+  friend class ReplicatedFrame;
+  void getNextFrameFromRing(StreamReplica* replica);
+  void deactivateRingReplica(StreamReplica* replica);
+  void readFrameIntoRing();
+  void afterGettingFrameIntoRing(unsigned frameSize, unsigned numTruncatedBytes,
+				 struct timeval presentationTime, unsigned durationInMicroseconds);
+  void deliverFrameFromRing(StreamReplica* replica);
+  void freeReplicatedFrame(ReplicatedFrame* frame);
+
 private:
   FramedSource* fInputSource;
   Boolean fDeleteWhenLastReplicaDies, fInputSourceHasClosed; 
@@ -80,5 +148,21 @@ private:
   StreamReplica* fMasterReplica; // the first replica that requests each frame.  We use its buffer when copying to the others.
   StreamReplica* fReplicasAwaitingCurrentFrame; // other than the 'master' replica
   StreamReplica* fReplicasAwaitingNextFrame; // replicas that have already received the current frame, and have asked for the next
+
+  // Used only when we have a 'frame ring':
+  unsigned fFrameRingSize;
+  StreamReplica* fLastReplicaAwaitingNextFrame; // replicas awaiting a frame from the ring are kept in FIFO order
+  ReplicatedFrame** fFrameRing;
+  u_int64_t fNumFramesReadIntoRing; // frame #n is at "fFrameRing[n%fFrameRingSize]"
+  ReplicatedFrame* fFrameBeingRead;
+  ReplicatedFrame* fAllFrames; // a list of all of the frames that we've allocated
+  ReplicatedFrame* fFreeFrames;
+  unsigned fFrameBufferSize;
+
+  // Used only when we have a 'GOP cache':
+  int fGOPCacheHNumber; // 264 or 265 (or 0, if we don't have a GOP cache)
+  unsigned fGOPBurstSpeedup;
+  Boolean fHaveKeyFrame, fPreviousFrameWasKeyFrame;
+  u_int64_t fKeyFrameNumber; // the frame (in the ring) at which the most recent key frame begins
 };
 #endif
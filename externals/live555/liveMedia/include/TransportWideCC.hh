@@ -0,0 +1,143 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// Transport-wide congestion control ("draft-holmer-rmcat-transport-wide-cc-extensions-01")
+// (used to implement "MultiFramedRTPSink::enableTransportWideCC()" and
+// "MultiFramedRTPSource::enableTransportWideCCFeedback()")
+// C++ header
+
+#ifndef _TRANSPORT_WIDE_CC_HH
+#define _TRANSPORT_WIDE_CC_HH
+
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+#ifndef _NET_COMMON_H
+#include "NetCommon.h"
+#endif
+
+// A sender numbers each RTP packet that it sends with a 'transport-wide sequence number', carried in a one-byte
+// RTP header extension (RFC 8285).  The receiver reports - in RTCP transport-wide feedback packets (RTPFB, FMT 15) -
+// which of these packets arrived, and when.  From these reports, the sender estimates the bitrate that the path can
+// carry, using (a simplified version of) the delay-based 'Google Congestion Control' algorithm (draft-ietf-rmcat-gcc):
+// A steady increase in the packets' one-way delay means that a queue is building up somewhere along the path, so the
+// bitrate is decreased; otherwise it is slowly increased.  Heavy packet loss also limits the bitrate.
+
+#define TRANSPORT_WIDE_CC_EXTENSION_URI "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01"
+    // (for use in a SDP "a=extmap:" line)
+
+#define TWCC_WINDOW_SIZE 4096 // the number of recent packets (sent or received) that we remember
+#define TWCC_TREND_WINDOW_SIZE 20 // the number of (smoothed) delay samples from which the delay trend is computed
+
+class TransportWideCCFeedbackGenerator { // used by receivers
+public:
+  TransportWideCCFeedbackGenerator();
+  virtual ~TransportWideCCFeedbackGenerator();
+
+  void noteIncomingPacket(u_int16_t transportSeqNo, struct timeval const& timeReceived);
+  unsigned nextFeedback(unsigned char* to, unsigned maxSize);
+      // Writes the 'FCI' (i.e., the part after the media source's SSRC) of the next RTCP feedback packet to be sent -
+      // reporting (in order) the packets up to the most recent one - and returns its size.  Returns 0 if there's
+      // nothing (more) to report.  (Call this repeatedly, because one feedback packet might not report everything.)
+
+  unsigned numFeedbacksGenerated() const { return fNumFeedbacksGenerated; }
+
+private:
+  struct ArrivedPacket {
+    Boolean arrived;
+    u_int16_t seqNo;
+    int64_t timeReceived; // in microseconds, since our creation
+  } fPackets[TWCC_WINDOW_SIZE]; // indexed by sequence number (modulo TWCC_WINDOW_SIZE)
+  struct timeval fCreationTime;
+  Boolean fHaveSeenPacket;
+  u_int16_t fNextSeqNoToReport, fHighestSeqNo;
+  u_int8_t fFeedbackPacketCount;
+  unsigned fNumFeedbacksGenerated;
+  unsigned char fStatuses[TWCC_WINDOW_SIZE]; int16_t fDeltas[TWCC_WINDOW_SIZE]; // used when building a feedback
+};
+
+class SendSideBandwidthEstimator { // used by senders
+public:
+  SendSideBandwidthEstimator(unsigned initialBitrate, unsigned minBitrate, unsigned maxBitrate);
+      // (all in bits per second)
+  virtual ~SendSideBandwidthEstimator();
+
+  void noteSentPacket(u_int16_t transportSeqNo, unsigned packetSize, struct timeval const& timeSent);
+  Boolean handleFeedback(unsigned char const* fci, unsigned fciSize);
+      // Processes the 'FCI' of an incoming RTCP transport-wide feedback packet.  Returns True iff our target
+      // bitrate changed as a result.
+
+  unsigned targetBitrate() const { return fTargetBitrate; } // bits per second
+  unsigned delayBasedBitrate() const { return fDelayBasedBitrate; }
+  unsigned lossBasedBitrate() const { return fLossBasedBitrate; }
+  unsigned ackedBitrate() const { return fAckedBitrate; } // the bitrate at which packets are arriving (0 if unknown)
+  double lossFraction() const { return fLossFraction; } // among recently reported packets
+
+  enum BandwidthUsage { normal, overusing, underusing };
+  BandwidthUsage bandwidthUsage() const { return fBandwidthUsage; } // as currently detected from the delay trend
+  double delayTrend() const { return fModifiedTrend; }
+  double overuseThreshold() const { return fThreshold; }
+
+  unsigned numFeedbacksReceived() const { return fNumFeedbacksReceived; }
+  unsigned numPacketsReported() const { return fNumPacketsReported; }
+  unsigned numPacketsReportedLost() const { return fNumPacketsReportedLost; }
+
+private:
+  void noteArrivedPacket(int64_t timeSent, int64_t timeReceived, unsigned packetSize);
+  void updateTrend(double delayDeltaMs, double sendDeltaMs, double arrivalTimeMs);
+  void updateThreshold(double arrivalTimeMs);
+  void updateBitrates(int64_t timeNow);
+
+private:
+  unsigned fMinBitrate, fMaxBitrate;
+  unsigned fTargetBitrate, fDelayBasedBitrate, fLossBasedBitrate;
+
+  struct SentPacket {
+    Boolean reported;
+    u_int16_t seqNo;
+    unsigned size; // 0 if the entry is unused
+    int64_t timeSent; // in microseconds
+  } fPackets[TWCC_WINDOW_SIZE]; // indexed by sequence number (modulo TWCC_WINDOW_SIZE)
+  unsigned char fStatuses[TWCC_WINDOW_SIZE]; // used when parsing a feedback
+
+  // Delay-based estimation:
+  struct PacketGroup { // packets that were sent in a short burst
+    int64_t firstTimeSent, lastTimeSent, lastTimeReceived;
+  } fCurrentGroup, fPreviousGroup;
+  Boolean fHaveCurrentGroup, fHavePreviousGroup;
+  double fFirstArrivalTimeMs, fAccumulatedDelay, fSmoothedDelay;
+  double fTrendX[TWCC_TREND_WINDOW_SIZE], fTrendY[TWCC_TREND_WINDOW_SIZE]; unsigned fNumTrendSamples, fNextTrendSample;
+  unsigned fNumDeltas;
+  double fModifiedTrend, fPrevModifiedTrend, fThreshold, fLastThresholdUpdateMs;
+  double fTimeOverusing; unsigned fOveruseCounter;
+  BandwidthUsage fBandwidthUsage;
+
+  // Acked bitrate (measured over windows of arrival time):
+  Boolean fHaveAckedWindow;
+  int64_t fAckedWindowStart; u_int64_t fAckedWindowBytes;
+  unsigned fAckedBitrate;
+
+  // Loss:
+  unsigned fNumReportedSinceLossUpdate, fNumLostSinceLossUpdate;
+  double fLossFraction;
+
+  int64_t fLastUpdateTime, fLastDecreaseTime, fLastLossDecreaseTime;
+
+  unsigned fNumFeedbacksReceived, fNumPacketsReported, fNumPacketsReportedLost;
+};
+
+#endif
@@ -0,0 +1,126 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// Forward error correction for RTP, using the "ulpfec" payload format (RFC 5109)
+// (used to implement "MultiFramedRTPSink::enableFEC()" and "MultiFramedRTPSource::enableFEC()")
+// C++ header
+
+#ifndef _ULPFEC_HH
+#define _ULPFEC_HH
+
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+#ifndef _NET_COMMON_H
+#include "NetCommon.h"
+#endif
+
+// Media packets are protected in 'matrices' of "numColumns" x "numRows" consecutive packets (filled in row by row).
+// A 'row' FEC packet (the XOR of the packets in a row) is sent after each row (if "numColumns" > 1), and a 'column'
+// FEC packet (the XOR of the packets in a column) is sent after each column's last packet (if "numRows" > 1).
+// A lost packet can be recovered from any row or column FEC packet that protects it, once the other packets
+// protected by that FEC packet have been received.  Packets recovered in one direction can then allow further
+// recovery in the other, so (e.g.) any single lost packet - or a burst of up to "numColumns" lost packets - in a
+// matrix can be recovered.
+// Because a ULPFEC packet's mask covers at most 48 sequence numbers, a column can span at most 48 packets.
+
+#define ULPFEC_MAX_MASK_SIZE 48
+
+class ULPFECEncoder {
+public:
+  static Boolean matrixIsValid(unsigned numColumns, unsigned numRows);
+
+  ULPFECEncoder(unsigned numColumns, unsigned numRows,
+		unsigned char fecPayloadType, u_int32_t fecSSRC, u_int16_t initialFECSeqNo);
+      // "numColumns" and "numRows" must be valid (see above)
+  virtual ~ULPFECEncoder();
+
+  void addMediaPacket(unsigned char const* header, unsigned headerSize,
+		      unsigned char const* payload, unsigned payloadSize);
+      // Protects a media RTP packet (which is given as its RTP header - plus any other headers - and its payload).
+      // This should be done for each packet, in sequence number order, as it is sent.
+  unsigned char* nextFECPacket(unsigned& resultPacketSize);
+      // After "addMediaPacket()", returns each FEC packet (a complete RTP packet) that's now ready to be sent, then
+      // NULL.  (The returned data remains valid until the next call.)
+
+  unsigned numColumns() const { return fNumColumns; }
+  unsigned numRows() const { return fNumRows; }
+
+private:
+  struct Parity; // forward
+  void reset();
+  void addToParity(Parity& parity, unsigned char const* header, unsigned headerSize,
+		   unsigned char const* payload, unsigned payloadSize);
+
+private:
+  unsigned fNumColumns, fNumRows;
+  unsigned char fFECPayloadType;
+  u_int32_t fFECSSRC;
+  u_int16_t fFECSeqNo;
+  u_int32_t fLastMediaTimestamp;
+
+  Parity* fRowParity;
+  Parity* fColumnParities; // "fNumColumns" of these
+  unsigned fPacketNumInMatrix; // 0 .. fNumColumns*fNumRows-1
+
+  Parity* fReadyParities[2]; // those whose FEC packet is ready to be sent (at most a row and a column at once)
+  unsigned fNumReadyParities;
+  unsigned char* fFECPacket; unsigned fFECPacketBufferSize; // the most recently returned FEC packet
+};
+
+class ULPFECDecoder {
+public:
+  ULPFECDecoder();
+  virtual ~ULPFECDecoder();
+
+  void addMediaPacket(unsigned char const* packet, unsigned packetSize);
+      // Notes a (complete) media RTP packet that has just arrived
+  void addFECPacket(unsigned char const* packet, unsigned packetSize);
+      // Notes a (complete) FEC RTP packet that has just arrived
+  unsigned char* nextRecoveredPacket(unsigned& resultPacketSize);
+      // After "addMediaPacket()" or "addFECPacket()", returns each media RTP packet that has now been recovered, then
+      // NULL.  (The returned data remains valid until the next call to any of these functions.)
+
+  void reset(); // e.g., if the media stream's SSRC changes
+
+  unsigned numFECPacketsReceived() const { return fNumFECPacketsReceived; }
+  unsigned numPacketsRecovered() const { return fNumPacketsRecovered; }
+
+private:
+  struct MediaPacket; struct PendingFECPacket; // forward
+  MediaPacket* lookupMediaPacket(u_int16_t seqNo) const;
+  MediaPacket& storeMediaPacket(u_int16_t seqNo, unsigned packetSize);
+  Boolean tryRecovery(PendingFECPacket& fec, Boolean& resultFECIsFinished);
+  void tryPendingRecoveries();
+  void removePendingFECPacket(unsigned index);
+
+private:
+  MediaPacket* fMediaPackets; // a window of recently-received (or recovered) packets, indexed by sequence number
+  Boolean fHaveSeenMediaPacket;
+  u_int16_t fHighestSeqNo;
+  u_int32_t fMediaSSRC;
+
+  PendingFECPacket* fPendingFECPackets; // those that can't yet be used (because >1 of their packets are missing)
+  unsigned fNumPendingFECPackets;
+
+  u_int16_t* fRecoveredSeqNos; // those that we've recovered, but that haven't yet been returned
+  unsigned fNumRecoveredSeqNos, fNextRecoveredSeqNoIndex;
+
+  unsigned fNumFECPacketsReceived, fNumPacketsRecovered;
+};
+
+#endif
@@ -51,6 +51,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MPEG2TransportStreamTrickModeFilter.hh"
 #include "ByteStreamMultiFileSource.hh"
 #include "ByteStreamMemoryBufferSource.hh"
+#include "MappedFileSource.hh"
+#include "AsyncFileReader.hh"
+#include "CRC32.hh"
 #include "BasicUDPSource.hh"
 #include "SimpleRTPSource.hh"
 #include "MPEG1or2AudioRTPSource.hh"
@@ -126,5 +129,10 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MatroskaFileServerDemux.hh"
 #include "OggFileServerDemux.hh"
 #include "ProxyServerMediaSession.hh"
+#include "ShardedRTSPServer.hh"
+#include "PacketBufferPool.hh"
+#include "SDPCache.hh"
+#include "ULPFEC.hh"
+#include "TransportWideCC.hh"
 
 #endif
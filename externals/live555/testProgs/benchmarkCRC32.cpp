@@ -0,0 +1,127 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// A program that checks each of the "CRC32" implementations that this CPU supports against a simple (bit-at-a-time)
+// reference - for random lengths, alignments, initial values, and split points - and then measures the throughput of
+// each, for data sizes from 16 bytes (the smallest PSI sections) to 64 kBytes.
+// main program
+
+#include "liveMedia.hh"
+#include "GroupsockHelper.hh"
+#include <stdio.h>
+
+#define NUM_IMPLEMENTATIONS 3 /* BYTE_AT_A_TIME, SLICING_BY_8, PCLMUL_FOLDING */
+#define DATA_SIZE 65536
+#define MAX_OFFSET 16 /* so that each implementation sees misaligned data */
+#define NUM_TRIALS 200000
+#define NUM_BYTES_TO_TIME 200000000 /* for each implementation, and each data size */
+
+static u_int8_t data[DATA_SIZE + MAX_OFFSET];
+static unsigned numComparisons = 0, numErrors = 0;
+static volatile u_int32_t resultSink;
+
+static double timeNow() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec/1000000.0;
+}
+
+static u_int32_t referenceCRC(u_int8_t const* data, unsigned dataLength, u_int32_t crc) {
+  while (dataLength-- > 0) {
+    crc ^= (u_int32_t)(*data++) << 24;
+    for (unsigned i = 0; i < 8; ++i) crc = (crc & 0x80000000) != 0 ? (crc<<1)^0x04C11DB7 : crc<<1;
+  }
+  return crc;
+}
+
+static void compare(char const* what, unsigned dataLength, u_int32_t result, u_int32_t expectedResult) {
+  ++numComparisons;
+  if (result != expectedResult && numErrors++ < 10) {
+    fprintf(stderr, "%s: %u bytes: got 0x%08x; expected 0x%08x\n", what, dataLength, result, expectedResult);
+  }
+}
+
+static void checkImplementations() {
+  // First, a known value (for CRC-32/MPEG-2):
+  compare("calculateCRC(\"123456789\")", 9, calculateCRC((u_int8_t const*)"123456789", 9), 0x0376E6E7);
+
+  our_srandom(1);
+  for (unsigned trial = 0; trial < NUM_TRIALS; ++trial) {
+    // Half the trials use lengths of up to 300 bytes (typical of PSI sections); the others, up to 5000 bytes:
+    unsigned dataLength = our_random32()%(trial < NUM_TRIALS/2 ? 300 : 5000);
+    u_int8_t const* from = &data[our_random32()%MAX_OFFSET];
+    u_int32_t initialValue = trial%3 == 0 ? 0xFFFFFFFF : trial%3 == 1 ? 0 : our_random32();
+    u_int32_t expectedResult = referenceCRC(from, dataLength, initialValue);
+
+    for (int i = 0; i < NUM_IMPLEMENTATIONS; ++i) {
+      CRC32::Implementation implementation = (CRC32::Implementation)i;
+      if (!CRC32::isSupported(implementation)) continue;
+      compare(CRC32::implementationName(implementation), dataLength,
+	      CRC32::calculate(implementation, from, dataLength, initialValue), expectedResult);
+    }
+    compare("calculateCRC()", dataLength, calculateCRC(from, dataLength, initialValue), expectedResult);
+
+    // Also check a calculation that's split into two pieces:
+    unsigned splitPoint = dataLength == 0 ? 0 : our_random32()%dataLength;
+    compare("calculateCRC() (split)", dataLength,
+	    calculateCRC(&from[splitPoint], dataLength - splitPoint, calculateCRC(from, splitPoint, initialValue)),
+	    expectedResult);
+  }
+}
+
+static void timeImplementation(CRC32::Implementation implementation, unsigned dataLength) {
+  unsigned const numCalls = NUM_BYTES_TO_TIME/dataLength;
+  u_int32_t result = 0;
+
+  // Use the best of 3 runs:
+  double bestDuration = 0.0;
+  for (unsigned run = 0; run < 3; ++run) {
+    double start = timeNow();
+    for (unsigned i = 0; i < numCalls; ++i) result ^= CRC32::calculate(implementation, data, dataLength, result);
+    double duration = timeNow() - start;
+    if (run == 0 || duration < bestDuration) bestDuration = duration;
+  }
+
+  resultSink ^= result; // ensures that the calculation isn't optimized away
+  printf(" %15.0f", (double)numCalls*dataLength/bestDuration/1000000.0);
+}
+
+int main(int /*argc*/, char** /*argv*/) {
+  our_srandom(0);
+  for (unsigned i = 0; i < sizeof data; ++i) data[i] = (u_int8_t)our_random32();
+
+  checkImplementations();
+  printf("%u comparisons with the reference CRC: %u errors\n", numComparisons, numErrors);
+  printf("\"calculateCRC()\" uses: %s\n", CRC32::implementationName(CRC32::implementationInUse()));
+
+  printf("Throughput (MBytes/s):\n%8s", "bytes");
+  for (int i = 0; i < NUM_IMPLEMENTATIONS; ++i) {
+    if (CRC32::isSupported((CRC32::Implementation)i)) printf(" %15s", CRC32::implementationName((CRC32::Implementation)i));
+  }
+  printf("\n");
+
+  unsigned const dataLengths[] = { 16, 188, 1024, DATA_SIZE };
+  for (unsigned j = 0; j < sizeof dataLengths/sizeof dataLengths[0]; ++j) {
+    printf("%8u", dataLengths[j]);
+    for (int i = 0; i < NUM_IMPLEMENTATIONS; ++i) {
+      if (!CRC32::isSupported((CRC32::Implementation)i)) continue;
+      timeImplementation((CRC32::Implementation)i, dataLengths[j]);
+    }
+    printf("\n");
+  }
+
+  return numErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,207 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// A program that measures the cost of the "HandlerSet" operations that a "BasicTaskScheduler" performs for each
+// "setBackgroundHandling()" call, and for each socket that becomes ready: registering a handler, clearing and
+// re-assigning it (as when read handling is turned off and on), and looking it up.  It also checks the results.
+// Finally, it checks that a "EpollTaskScheduler" that handles several ready sockets per step still handles a regular file
+// (which "epoll()" can't watch) while many sockets are continually ready.
+// main program
+
+#include "BasicUsageEnvironment.hh"
+#include "HandlerSet.hh"
+#include "GroupsockHelper.hh"
+#include <stdio.h>
+#if defined(__linux__) && !defined(NO_EPOLL)
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#define FIRST_SOCKET_NUM 3
+#define NUM_ROUNDS 20
+
+static double timeNow() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec/1000000.0;
+}
+
+static void dummyHandler(void* /*clientData*/, int /*mask*/) {
+}
+
+static void* clientDataFor(int socketNum) {
+  return (void*)(long)(socketNum + 1000);
+}
+
+static unsigned numErrors = 0;
+
+static void check(HandlerSet& handlerSet, int socketNum, Boolean shouldBePresent) {
+  HandlerDescriptor* handler = handlerSet.lookupHandler(socketNum);
+  if (shouldBePresent) {
+    if (handler == NULL || handler->socketNum != socketNum || handler->clientData != clientDataFor(socketNum)) {
+      fprintf(stderr, "socket %d: wrong or missing handler\n", socketNum);
+      ++numErrors;
+    }
+  } else if (handler != NULL) {
+    fprintf(stderr, "socket %d: unexpected handler\n", socketNum);
+    ++numErrors;
+  }
+}
+
+static void run(unsigned numSockets) {
+  HandlerSet handlerSet;
+  int const lastSocketNum = FIRST_SOCKET_NUM + (int)numSockets - 1;
+  int socketNum;
+
+  double start = timeNow();
+  for (socketNum = FIRST_SOCKET_NUM; socketNum <= lastSocketNum; ++socketNum) {
+    handlerSet.assignHandler(socketNum, SOCKET_READABLE, dummyHandler, clientDataFor(socketNum));
+  }
+  double registered = timeNow();
+
+  unsigned numFound = 0;
+  for (unsigned round = 0; round < NUM_ROUNDS; ++round) {
+    for (socketNum = FIRST_SOCKET_NUM; socketNum <= lastSocketNum; ++socketNum) {
+      handlerSet.clearHandler(socketNum);
+      handlerSet.assignHandler(socketNum, SOCKET_READABLE, dummyHandler, clientDataFor(socketNum));
+      if (handlerSet.lookupHandler(socketNum) != NULL) ++numFound;
+    }
+  }
+  double toggled = timeNow();
+
+  printf("%8u sockets: register %9.3f ms; clear+assign+lookup %8.3f us per socket (%u of %u found)\n",
+	 numSockets, (registered - start)*1000, (toggled - registered)*1e6/(NUM_ROUNDS*numSockets),
+	 numFound, NUM_ROUNDS*numSockets);
+  if (numFound != NUM_ROUNDS*numSockets) ++numErrors;
+
+  // Check the results, including for socket numbers that are too large for the table:
+  for (socketNum = FIRST_SOCKET_NUM; socketNum <= lastSocketNum; ++socketNum) check(handlerSet, socketNum, True);
+  check(handlerSet, lastSocketNum + 1, False);
+
+  int const hugeSocketNum = 0x7FFFFFF0;
+  handlerSet.assignHandler(hugeSocketNum, SOCKET_READABLE, dummyHandler, clientDataFor(hugeSocketNum));
+  check(handlerSet, hugeSocketNum, True);
+
+  // Moving a handler must also drop any (stale) handler that's already registered for the new socket number:
+  handlerSet.moveHandler(FIRST_SOCKET_NUM, lastSocketNum);
+  HandlerDescriptor* moved = handlerSet.lookupHandler(lastSocketNum);
+  if (moved == NULL || moved->clientData != clientDataFor(FIRST_SOCKET_NUM)) {
+    fprintf(stderr, "moveHandler(%d, %d) failed\n", FIRST_SOCKET_NUM, lastSocketNum);
+    ++numErrors;
+  }
+  check(handlerSet, FIRST_SOCKET_NUM, False);
+
+  // Finally, clear every handler, and check (using an iterator, as "select()" does) that none remain:
+  for (socketNum = FIRST_SOCKET_NUM; socketNum <= lastSocketNum; ++socketNum) handlerSet.clearHandler(socketNum);
+  handlerSet.clearHandler(hugeSocketNum);
+  HandlerIterator iter(handlerSet);
+  if (iter.next() != NULL) {
+    fprintf(stderr, "handlers remain after clearing them all\n");
+    ++numErrors;
+  }
+}
+
+#if defined(__linux__) && !defined(NO_EPOLL)
+#define NUM_BUSY_SOCKET_PAIRS 64
+#define MAX_HANDLERS_PER_STEP 16
+#define NUM_FILE_HANDLER_CALLS_TO_WAIT_FOR 1000
+
+static unsigned numFileHandlerCalls, numSocketHandlerCalls;
+static char eventLoopWatchVariable;
+
+static void fileHandler(void* /*clientData*/, int /*mask*/) {
+  if (++numFileHandlerCalls == NUM_FILE_HANDLER_CALLS_TO_WAIT_FOR) eventLoopWatchVariable = 1;
+}
+
+static void busySocketHandler(void* /*clientData*/, int /*mask*/) {
+  ++numSocketHandlerCalls; // we don't read the socket, so it stays readable
+}
+
+static void timeout(void* /*clientData*/) {
+  eventLoopWatchVariable = 1;
+}
+
+static void checkUnpollableFileIsHandled() {
+  EpollTaskScheduler* scheduler = EpollTaskScheduler::createNew();
+  if (scheduler == NULL) return;
+  scheduler->setMaxSocketHandlersPerStep(MAX_HANDLERS_PER_STEP);
+
+  // Make each of many sockets continually readable (more of them than we handle per step):
+  int socketPairs[NUM_BUSY_SOCKET_PAIRS][2];
+  unsigned i;
+  for (i = 0; i < NUM_BUSY_SOCKET_PAIRS; ++i) {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, socketPairs[i]) < 0) {
+      fprintf(stderr, "socketpair() failed\n");
+      ++numErrors;
+      return;
+    }
+    if (write(socketPairs[i][1], "x", 1) != 1) ++numErrors;
+    scheduler->turnOnBackgroundReadHandling(socketPairs[i][0], busySocketHandler, NULL);
+  }
+
+  // Also read from a regular file:
+  FILE* file = tmpfile();
+  if (file == NULL) {
+    fprintf(stderr, "tmpfile() failed\n");
+    ++numErrors;
+    return;
+  }
+  scheduler->turnOnBackgroundReadHandling(fileno(file), fileHandler, NULL);
+
+  numFileHandlerCalls = numSocketHandlerCalls = 0;
+  eventLoopWatchVariable = 0;
+  TaskToken timeoutTask = scheduler->scheduleDelayedTask(2000000/*2 seconds*/, timeout, NULL);
+  double start = timeNow();
+  scheduler->doEventLoop(&eventLoopWatchVariable);
+  double duration = timeNow() - start;
+  scheduler->unscheduleDelayedTask(timeoutTask);
+
+  printf("EpollTaskScheduler (%d handlers per step), %d busy sockets and 1 regular file: in %.3f s, %u socket handler calls, %u file handler calls\n",
+	 MAX_HANDLERS_PER_STEP, NUM_BUSY_SOCKET_PAIRS, duration, numSocketHandlerCalls, numFileHandlerCalls);
+  if (numFileHandlerCalls < NUM_FILE_HANDLER_CALLS_TO_WAIT_FOR) {
+    fprintf(stderr, "the regular file's handler was starved\n");
+    ++numErrors;
+  }
+
+  scheduler->turnOffBackgroundReadHandling(fileno(file));
+  fclose(file);
+  for (i = 0; i < NUM_BUSY_SOCKET_PAIRS; ++i) {
+    scheduler->turnOffBackgroundReadHandling(socketPairs[i][0]);
+    close(socketPairs[i][0]); close(socketPairs[i][1]);
+  }
+  delete scheduler;
+}
+#endif
+
+int main(int argc, char** argv) {
+  unsigned numSockets = 10000;
+  if (argc > 1 && (sscanf(argv[1], "%u", &numSockets) != 1 || numSockets < 2)) {
+    fprintf(stderr, "usage: %s [<num-sockets> (at least 2; default 10000)]\n", argv[0]);
+    return 1;
+  }
+
+  run(numSockets/100 < 2 ? 2 : numSockets/100);
+  run(numSockets);
+#if defined(__linux__) && !defined(NO_EPOLL)
+  checkUnpollableFileIsHandled();
+#endif
+
+  if (numErrors > 0) {
+    fprintf(stderr, "%u errors\n", numErrors);
+    return 1;
+  }
+  return 0;
+}
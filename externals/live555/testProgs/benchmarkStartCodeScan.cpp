@@ -0,0 +1,301 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// A program that measures how fast the H.264, H.265 and MPEG-1/2 video 'framers' - whose parsers spend most of their
+// time looking for start codes - can parse a (synthetic, in-memory) video stream.  It also checks that each framer
+// outputs exactly the data that it should - including when the stream is read in small pieces, so that start codes
+// get split between reads.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include <stdio.h>
+#include <string.h>
+
+#define STREAM_SIZE 24000000 /* for timing */
+#define SMALL_STREAM_SIZE 500000 /* for checking, while reading in small pieces */
+#define MAX_NAL_UNIT_PAYLOAD_SIZE 60000
+#define MAX_OUTPUT_FRAME_SIZE 1000000
+
+enum StreamType { H264_STREAM, H265_STREAM, MPEG2_STREAM };
+static char const* streamTypeName[] = { "H.264", "H.265", "MPEG-2" };
+
+static UsageEnvironment* env;
+
+// A synthetic stream, with a record of the data that a framer should output for it:
+class SyntheticStream {
+public:
+  SyntheticStream(StreamType streamType, unsigned zeroBytePercentage, unsigned maxSize);
+  virtual ~SyntheticStream();
+
+  StreamType streamType() const { return fStreamType; }
+  unsigned zeroBytePercentage() const { return fZeroBytePercentage; }
+  u_int8_t* data() const { return fData; }
+  unsigned size() const { return fSize; }
+
+  // For H.264 and H.265, the framer should output each NAL unit (without its start code):
+  unsigned numNALUnits() const { return fNumNALUnits; }
+  unsigned nalUnitOffset(unsigned i) const { return fNALUnitOffsets[i]; }
+  unsigned nalUnitSize(unsigned i) const { return fNALUnitOffsets[i+1] - fNALUnitStartCodeSizes[i+1] - fNALUnitOffsets[i]; }
+  // For MPEG-1/2, the framer's output should simply be the stream, divided into slices (and headers):
+  unsigned lastSliceOffset() const { return fLastSliceOffset; }
+  // (Note, however, that the framers don't output the data after the stream's last start code - i.e., its last NAL unit
+  // or slice.)
+
+private:
+  void addByte(u_int8_t byte);
+  void addPayload(unsigned payloadSize);
+  void addStartCode(unsigned startCodeSize, u_int8_t code);
+  void addNALUnit(u_int8_t header1, u_int8_t header2, unsigned headerSize);
+  void addMPEG2Picture(Boolean beginsGOP);
+
+private:
+  StreamType fStreamType;
+  unsigned fZeroBytePercentage;
+  u_int8_t* fData;
+  unsigned fSize;
+  unsigned fNumNALUnits;
+  unsigned* fNALUnitOffsets; // the offset of the start of each NAL unit's header (and, at the end, the stream's size)
+  unsigned* fNALUnitStartCodeSizes;
+  unsigned fLastSliceOffset;
+};
+
+SyntheticStream::SyntheticStream(StreamType streamType, unsigned zeroBytePercentage, unsigned maxSize)
+  : fStreamType(streamType), fZeroBytePercentage(zeroBytePercentage),
+    fData(new u_int8_t[maxSize]), fSize(0), fNumNALUnits(0),
+    fNALUnitOffsets(new unsigned[maxSize/8]), fNALUnitStartCodeSizes(new unsigned[maxSize/8]), fLastSliceOffset(0) {
+  our_srandom(1);
+  unsigned const headroom = MAX_NAL_UNIT_PAYLOAD_SIZE*2; // enough for a NAL unit or a MPEG picture
+  if (fStreamType == MPEG2_STREAM) {
+    for (unsigned pictureNum = 0; fSize + headroom < maxSize; ++pictureNum) addMPEG2Picture(pictureNum%12 == 0);
+  } else {
+    for (unsigned nalUnitNum = 0; fSize + headroom < maxSize; ++nalUnitNum) {
+      // Alternate between a 'key frame' and several other frames (each a single NAL unit):
+      Boolean isKeyFrame = nalUnitNum%30 == 0;
+      if (fStreamType == H264_STREAM) {
+	addNALUnit(isKeyFrame ? 0x65 : 0x41, 0, 1);
+      } else {
+	addNALUnit(isKeyFrame ? (19<<1) : (1<<1), 0x01, 2);
+      }
+    }
+  }
+  fNALUnitOffsets[fNumNALUnits] = fSize;
+  fNALUnitStartCodeSizes[fNumNALUnits] = 0;
+}
+
+SyntheticStream::~SyntheticStream() {
+  delete[] fNALUnitStartCodeSizes;
+  delete[] fNALUnitOffsets;
+  delete[] fData;
+}
+
+void SyntheticStream::addByte(u_int8_t byte) {
+  // Insert an 'emulation prevention' byte, if needed, so that the data can't contain a start code:
+  if (byte <= 3 && fSize >= 2 && fData[fSize-1] == 0 && fData[fSize-2] == 0) fData[fSize++] = 3;
+  fData[fSize++] = byte;
+}
+
+void SyntheticStream::addPayload(unsigned payloadSize) {
+  for (unsigned i = 0; i < payloadSize; ++i) {
+    u_int8_t byte = (u_int8_t)our_random();
+    if (our_random()%100 < fZeroBytePercentage) byte = 0;
+    addByte(byte);
+  }
+  addByte(0x80); // the payload mustn't end with a zero byte
+}
+
+void SyntheticStream::addStartCode(unsigned startCodeSize, u_int8_t code) {
+  if (startCodeSize == 4) fData[fSize++] = 0;
+  fData[fSize++] = 0; fData[fSize++] = 0; fData[fSize++] = 1;
+  fData[fSize++] = code;
+}
+
+void SyntheticStream::addNALUnit(u_int8_t header1, u_int8_t header2, unsigned headerSize) {
+  unsigned startCodeSize = our_random()%2 == 0 ? 3 : 4;
+  addStartCode(startCodeSize, header1);
+  fNALUnitStartCodeSizes[fNumNALUnits] = startCodeSize;
+  fNALUnitOffsets[fNumNALUnits++] = fSize - 1;
+  if (headerSize == 2) fData[fSize++] = header2;
+
+  addPayload(1 + our_random()%MAX_NAL_UNIT_PAYLOAD_SIZE);
+}
+
+void SyntheticStream::addMPEG2Picture(Boolean beginsGOP) {
+  if (beginsGOP) {
+    // A 'video sequence header' (352x288, 4:3, 25 fps), then a 'GOP header':
+    u_int8_t const vsh[] = { 0x16, 0x01, 0x20, 0x23, 0xFF, 0xFF, 0xE0, 0x18 };
+    addStartCode(3, 0xB3);
+    for (unsigned i = 0; i < sizeof vsh; ++i) fData[fSize++] = vsh[i];
+    u_int8_t const gop[] = { 0x00, 0x08, 0x00, 0x40 };
+    addStartCode(3, 0xB8);
+    for (unsigned i = 0; i < sizeof gop; ++i) fData[fSize++] = gop[i];
+  }
+
+  // A 'picture header' (an I picture, if it begins a GOP; otherwise, a P picture), then some slices:
+  addStartCode(3, 0x00);
+  fData[fSize++] = 0x00; fData[fSize++] = beginsGOP ? 0x0F : 0x17; fData[fSize++] = 0xFF; fData[fSize++] = 0xF8;
+  unsigned numSlices = 1 + our_random()%18;
+  for (unsigned slice = 1; slice <= numSlices; ++slice) {
+    fLastSliceOffset = fSize;
+    addStartCode(3, (u_int8_t)slice);
+    addPayload(1 + our_random()%(MAX_NAL_UNIT_PAYLOAD_SIZE/8));
+  }
+}
+
+// Our input source delivers a stream from memory - like a file source, each read is completed via the event loop
+// (which also keeps the framer's parser from recursing once per read):
+class StreamSource: public FramedSource {
+public:
+  StreamSource(UsageEnvironment& env, SyntheticStream& stream, unsigned readSize)
+    : FramedSource(env), fStream(stream), fReadSize(readSize), fNumBytesRead(0) {
+  }
+
+private:
+  virtual void doGetNextFrame() {
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, deliverData, this);
+  }
+
+  static void deliverData(void* clientData) {
+    ((StreamSource*)clientData)->deliverData();
+  }
+  void deliverData() {
+    nextTask() = NULL;
+    unsigned numBytesRemaining = fStream.size() - fNumBytesRead;
+    if (numBytesRemaining == 0) {
+      handleClosure();
+      return;
+    }
+
+    fFrameSize = fMaxSize;
+    if (fReadSize > 0 && fFrameSize > fReadSize) fFrameSize = fReadSize;
+    if (fFrameSize > numBytesRemaining) fFrameSize = numBytesRemaining;
+    memmove(fTo, &fStream.data()[fNumBytesRead], fFrameSize);
+    fNumBytesRead += fFrameSize;
+    gettimeofday(&fPresentationTime, NULL);
+    FramedSource::afterGetting(this);
+  }
+
+private:
+  SyntheticStream& fStream;
+  unsigned fReadSize, fNumBytesRead;
+};
+
+// Reading a stream through a framer:
+
+static char eventLoopWatchVariable;
+static u_int8_t outputFrame[MAX_OUTPUT_FRAME_SIZE];
+static FramedSource* framer;
+static SyntheticStream* currentStream;
+static unsigned numFramesOutput, numBytesOutput, numMismatches;
+
+static void onFramerClosure(void* /*clientData*/) {
+  eventLoopWatchVariable = 1;
+}
+
+static void afterGettingFrame(void* /*clientData*/, unsigned frameSize, unsigned numTruncatedBytes,
+			      struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+  if (currentStream->streamType() == MPEG2_STREAM) {
+    // The frame should be the next part of the stream:
+    if (numTruncatedBytes > 0 || numBytesOutput + frameSize > currentStream->size()
+	|| memcmp(outputFrame, &currentStream->data()[numBytesOutput], frameSize) != 0) {
+      ++numMismatches;
+    }
+  } else {
+    // The frame should be the next NAL unit:
+    unsigned i = numFramesOutput;
+    if (numTruncatedBytes > 0 || i >= currentStream->numNALUnits() || frameSize != currentStream->nalUnitSize(i)
+	|| memcmp(outputFrame, &currentStream->data()[currentStream->nalUnitOffset(i)], frameSize) != 0) {
+      ++numMismatches;
+    }
+  }
+  ++numFramesOutput;
+  numBytesOutput += frameSize;
+
+  framer->getNextFrame(outputFrame, sizeof outputFrame, afterGettingFrame, NULL, onFramerClosure, NULL);
+}
+
+static double readStream(SyntheticStream& stream, unsigned readSize) {
+  StreamSource* source = new StreamSource(*env, stream, readSize);
+  switch (stream.streamType()) {
+    case H264_STREAM: { framer = H264VideoStreamFramer::createNew(*env, source); break; }
+    case H265_STREAM: { framer = H265VideoStreamFramer::createNew(*env, source); break; }
+    case MPEG2_STREAM: { framer = MPEG1or2VideoStreamFramer::createNew(*env, source); break; }
+  }
+  currentStream = &stream;
+  numFramesOutput = numBytesOutput = numMismatches = 0;
+  eventLoopWatchVariable = 0;
+
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+  framer->getNextFrame(outputFrame, sizeof outputFrame, afterGettingFrame, NULL, onFramerClosure, NULL);
+  env->taskScheduler().doEventLoop(&eventLoopWatchVariable);
+  gettimeofday(&end, NULL);
+
+  Medium::close(framer); // this also closes "source"
+  return (end.tv_sec - start.tv_sec) + (end.tv_usec - (int)start.tv_usec)/1000000.0;
+}
+
+static Boolean outputWasCorrect(SyntheticStream& stream) {
+  Boolean allDataOutput = stream.streamType() == MPEG2_STREAM
+    ? numBytesOutput == stream.lastSliceOffset()
+    : numFramesOutput == stream.numNALUnits() - 1;
+  return numMismatches == 0 && allDataOutput;
+}
+
+static Boolean testStream(StreamType streamType, unsigned zeroBytePercentage) {
+  Boolean ok = True;
+
+  // First, time reading the stream (using the best of several runs), checking the output each time:
+  SyntheticStream stream(streamType, zeroBytePercentage, STREAM_SIZE);
+  double bestDuration = 0.0;
+  for (unsigned run = 0; run < 3; ++run) {
+    double duration = readStream(stream, 0);
+    if (run == 0 || duration < bestDuration) bestDuration = duration;
+    if (!outputWasCorrect(stream)) ok = False;
+  }
+  printf("%-6s %2u%% zero bytes: %8.1f MB/s (%u frames)", streamTypeName[streamType], zeroBytePercentage,
+	 stream.size()/bestDuration/1000000.0, numFramesOutput);
+  if (!ok) printf("; ERROR: %u frames (%u bytes) output; %u mismatched", numFramesOutput, numBytesOutput, numMismatches);
+
+  // Then, check the output when a (smaller) stream is read in small pieces, so that start codes get split between reads:
+  SyntheticStream smallStream(streamType, zeroBytePercentage, SMALL_STREAM_SIZE);
+  unsigned const readSizes[] = { 1, 7, 333 };
+  for (unsigned i = 0; i < sizeof readSizes/sizeof readSizes[0]; ++i) {
+    readStream(smallStream, readSizes[i]);
+    if (!outputWasCorrect(smallStream)) {
+      printf("%s reading %u bytes at a time: %u frames (%u bytes) output; %u mismatched",
+	     ok ? "; ERROR:" : ",", readSizes[i], numFramesOutput, numBytesOutput, numMismatches);
+      ok = False;
+    }
+  }
+  printf("%s\n", ok ? "; output OK" : "");
+  return ok;
+}
+
+int main(int /*argc*/, char** /*argv*/) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  Boolean ok = True;
+  if (!testStream(H264_STREAM, 0)) ok = False;
+  if (!testStream(H265_STREAM, 0)) ok = False;
+  if (!testStream(H264_STREAM, 30)) ok = False;
+  if (!testStream(MPEG2_STREAM, 0)) ok = False;
+
+  env->reclaim(); delete scheduler;
+  return ok ? 0 : 1;
+}
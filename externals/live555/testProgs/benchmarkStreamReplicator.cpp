@@ -0,0 +1,237 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// A program that measures the cost of fanning out a stream of (large) frames to many replicas, using a
+// "StreamReplicator" - either without a 'frame ring' (the original behavior), or with one (copying each frame to each
+// replica's reader, or letting each reader 'borrow' it).  It also runs a test in which one replica is slow, and checks
+// that each replica's reader receives its frames intact, and in order.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include <stdio.h>
+
+#define FRAME_RING_SIZE 8
+
+enum Mode { NO_RING, RING_AND_COPY, RING_AND_BORROW };
+static char const* modeName[] = { "no ring", "ring+copy", "ring+borrow" };
+
+static UsageEnvironment* env;
+static char eventLoopWatchVariable;
+static unsigned frameSize, numFramesToGenerate, numFramesGenerated;
+static unsigned numErrors = 0;
+
+static double timeNow() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec/1000000.0;
+}
+
+// Our input source generates "numFramesToGenerate" frames, each of size "frameSize", as fast as they're requested.
+// Each frame begins and ends with its (4-byte) frame number; the rest of each frame is left as-is (so that generating
+// a frame costs almost nothing).
+class FrameGenerator: public FramedSource {
+public:
+  FrameGenerator(UsageEnvironment& env)
+    : FramedSource(env) {
+  }
+
+private:
+  virtual void doGetNextFrame() {
+    if (numFramesGenerated >= numFramesToGenerate) {
+      eventLoopWatchVariable = 1;
+      return;
+    }
+    // Deliver the frame via the event loop, as a real source would:
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, deliverFrame, this);
+  }
+
+  static void deliverFrame(void* clientData) {
+    FrameGenerator* source = (FrameGenerator*)clientData;
+    if (frameSize > source->fMaxSize) {
+      source->fFrameSize = 0;
+      source->fNumTruncatedBytes = frameSize;
+    } else {
+      source->fFrameSize = frameSize;
+      source->fNumTruncatedBytes = 0;
+      writeFrameNumber(source->fTo, numFramesGenerated);
+      writeFrameNumber(&source->fTo[frameSize - 4], numFramesGenerated);
+    }
+    ++numFramesGenerated;
+    gettimeofday(&source->fPresentationTime, NULL);
+    FramedSource::afterGetting(source);
+  }
+
+  static void writeFrameNumber(unsigned char* to, unsigned frameNumber) {
+    to[0] = frameNumber>>24; to[1] = frameNumber>>16; to[2] = frameNumber>>8; to[3] = frameNumber;
+  }
+};
+
+static unsigned readFrameNumber(unsigned char const* from) {
+  return (from[0]<<24)|(from[1]<<16)|(from[2]<<8)|from[3];
+}
+
+// Each reader reads from one replica, either immediately, or after a delay:
+class ReplicaReader {
+public:
+  ReplicaReader()
+    : fReplica(NULL), fBuffer(NULL), fMode(NO_RING), fDelay(0), fNextReadTask(NULL),
+      fNumFramesReceived(0), fNextFrameNumber(0) {
+  }
+  virtual ~ReplicaReader() {
+    env->taskScheduler().unscheduleDelayedTask(fNextReadTask);
+    Medium::close(fReplica);
+    delete[] fBuffer;
+  }
+
+  void start(StreamReplicator* replicator, Mode mode, unsigned delay) {
+    fReplica = replicator->createStreamReplica();
+    fMode = mode;
+    if (fMode != RING_AND_BORROW) fBuffer = new unsigned char[frameSize];
+    fDelay = delay;
+    readNextFrame();
+  }
+
+  unsigned numFramesReceived() const { return fNumFramesReceived; }
+  unsigned numFramesSkipped() const { return fMode == NO_RING ? 0 : StreamReplicator::numFramesSkipped(fReplica); }
+
+private:
+  void readNextFrame() {
+    fNextReadTask = NULL;
+    if (fMode == RING_AND_BORROW) {
+      fReplica->getNextFrame(NULL, 0, afterGettingFrame, this, NULL, this);
+    } else {
+      fReplica->getNextFrame(fBuffer, frameSize, afterGettingFrame, this, NULL, this);
+    }
+  }
+  static void readNextFrame(void* clientData) {
+    ((ReplicaReader*)clientData)->readNextFrame();
+  }
+
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned /*numTruncatedBytes*/,
+				struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+    ((ReplicaReader*)clientData)->afterGettingFrame(frameSize);
+  }
+  void afterGettingFrame(unsigned receivedFrameSize) {
+    unsigned char const* frame = fMode == RING_AND_BORROW ? StreamReplicator::deliveredFrame(fReplica)->data() : fBuffer;
+
+    // Check that we got the next frame - or (if we're allowed to skip frames) a later one - intact:
+    unsigned frameNumber = readFrameNumber(frame);
+    if (receivedFrameSize != frameSize || readFrameNumber(&frame[frameSize - 4]) != frameNumber
+	|| frameNumber < fNextFrameNumber || (frameNumber > fNextFrameNumber && fMode == NO_RING)) {
+      if (numErrors++ < 10) {
+	fprintf(stderr, "%s: expected frame %u (size %u); got frame %u (size %u), ending with frame number %u\n",
+		modeName[fMode], fNextFrameNumber, frameSize, frameNumber, receivedFrameSize,
+		readFrameNumber(&frame[frameSize - 4]));
+      }
+    }
+    fNextFrameNumber = frameNumber + 1;
+    ++fNumFramesReceived;
+
+    if (fDelay > 0) {
+      fNextReadTask = env->taskScheduler().scheduleDelayedTask(fDelay, readNextFrame, this);
+    } else {
+      readNextFrame();
+    }
+  }
+
+private:
+  FramedSource* fReplica;
+  unsigned char* fBuffer;
+  Mode fMode;
+  unsigned fDelay;
+  TaskToken fNextReadTask;
+  unsigned fNumFramesReceived, fNextFrameNumber;
+};
+
+static double run(Mode mode, unsigned numReplicas, unsigned numFrames, unsigned slowReaderDelay,
+		  unsigned& numFramesToFastReader, unsigned& numFramesToSlowReader, unsigned& numFramesSkipped) {
+  numFramesToGenerate = numFrames;
+  numFramesGenerated = 0;
+  eventLoopWatchVariable = 0;
+
+  StreamReplicator* replicator
+    = StreamReplicator::createNew(*env, new FrameGenerator(*env), True, mode == NO_RING ? 0 : FRAME_RING_SIZE);
+  ReplicaReader* readers = new ReplicaReader[numReplicas];
+
+  double start = timeNow();
+  for (unsigned i = 0; i < numReplicas; ++i) {
+    readers[i].start(replicator, mode, i == 0 ? slowReaderDelay : 0); // reader 0 is (perhaps) the slow one
+  }
+  env->taskScheduler().doEventLoop(&eventLoopWatchVariable);
+  double end = timeNow();
+
+  numFramesToSlowReader = readers[0].numFramesReceived();
+  numFramesSkipped = readers[0].numFramesSkipped();
+  numFramesToFastReader = readers[numReplicas-1].numFramesReceived();
+  for (unsigned i = 1; i < numReplicas; ++i) {
+    if (readers[i].numFramesReceived() + 1 < numFramesGenerated) { // (the last frame might still be being delivered)
+      if (numErrors++ < 10) {
+	fprintf(stderr, "%s: reader %u received only %u of %u frames\n",
+		modeName[mode], i, readers[i].numFramesReceived(), numFramesGenerated);
+      }
+    }
+  }
+
+  delete[] readers; // this also deletes "replicator" (and its input source), when the last replica is closed
+  return end - start;
+}
+
+int main(int argc, char** argv) {
+  unsigned numFrames = 2000;
+  frameSize = 500000;
+  if (argc > 1 && (sscanf(argv[1], "%u", &frameSize) != 1 || frameSize < 8)) {
+    fprintf(stderr, "usage: %s [<frame-size> (at least 8; default 500000) [<num-frames> (default 2000)]]\n", argv[0]);
+    return 1;
+  }
+  if (argc > 2 && (sscanf(argv[2], "%u", &numFrames) != 1 || numFrames == 0)) numFrames = 2000;
+
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+  OutPacketBuffer::maxSize = frameSize; // sets the size of each frame ring buffer
+
+  unsigned numFramesToFastReader, numFramesToSlowReader, numFramesSkipped;
+  unsigned const replicaCounts[] = { 1, 10, 50 };
+  printf("Time per input frame (%u frames of %u bytes):\n", numFrames, frameSize);
+  printf("  replicas %12s %12s %12s\n", modeName[NO_RING], modeName[RING_AND_COPY], modeName[RING_AND_BORROW]);
+  for (unsigned i = 0; i < sizeof replicaCounts/sizeof replicaCounts[0]; ++i) {
+    printf("  %8u", replicaCounts[i]);
+    for (int mode = NO_RING; mode <= RING_AND_BORROW; ++mode) {
+      double duration = run((Mode)mode, replicaCounts[i], numFrames, 0,
+			    numFramesToFastReader, numFramesToSlowReader, numFramesSkipped);
+      printf(" %9.1f us", duration*1e6/numFrames);
+    }
+    printf("\n");
+  }
+
+  // Then, with one slow reader (that waits 10 ms before requesting each frame):
+  unsigned const numSlowTestFrames = 500;
+  printf("10 replicas, one of which waits 10 ms before reading each frame (%u frames):\n", numSlowTestFrames);
+  for (int mode = NO_RING; mode <= RING_AND_COPY; ++mode) {
+    double duration = run((Mode)mode, 10, numSlowTestFrames, 10000,
+			  numFramesToFastReader, numFramesToSlowReader, numFramesSkipped);
+    printf("  %-12s %6.2f s; a fast replica received %u frames; the slow replica received %u (and skipped %u)\n",
+	   modeName[mode], duration, numFramesToFastReader, numFramesToSlowReader, numFramesSkipped);
+  }
+
+  env->reclaim(); delete scheduler;
+  if (numErrors > 0) {
+    fprintf(stderr, "%u errors\n", numErrors);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,160 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// A program that measures the cost of scheduling, rescheduling and unscheduling delayed tasks, using either a
+// "DelayQueue" (the default) or a "TimerWheel" (see "BasicTaskScheduler::createNew()").  It also checks that
+// - with each - tasks still fire in time order, and never early.
+// main program
+
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A "DelayQueue" takes O(n) time per operation, so - by default - we don't time it with more tasks than this:
+#define MAX_NUM_TASKS_FOR_DELAY_QUEUE 20000
+
+// Each task is scheduled to fire between 1 and 61 seconds from now (but the tasks being timed never actually fire):
+#define MIN_TASK_DELAY 1000000
+#define TASK_DELAY_RANGE 60000000
+
+static double timeNow() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec/1000000.0;
+}
+
+static int64_t randomDelay() {
+  return MIN_TASK_DELAY + (int64_t)(our_random32()%TASK_DELAY_RANGE);
+}
+
+static void noOpTask(void* /*clientData*/) {
+}
+
+static void timeScheduler(unsigned numTasks, Boolean useTimerWheel) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew(10000, useTimerWheel);
+  TaskToken* tokens = new TaskToken[numTasks];
+  unsigned const numReschedules = numTasks < 10000 ? numTasks : 10000;
+  unsigned i;
+
+  our_srandom(1);
+  double start = timeNow();
+  for (i = 0; i < numTasks; ++i) tokens[i] = scheduler->scheduleDelayedTask(randomDelay(), noOpTask, NULL);
+  double scheduled = timeNow();
+  for (i = 0; i < numReschedules; ++i) {
+    scheduler->rescheduleDelayedTask(tokens[our_random32()%numTasks], randomDelay(), noOpTask, NULL);
+  }
+  double rescheduled = timeNow();
+  for (i = 0; i < numTasks; ++i) scheduler->unscheduleDelayedTask(tokens[i]);
+  double unscheduled = timeNow();
+
+  printf("%-10s %8u tasks: schedule %9.3f us, reschedule %9.3f us, unschedule %9.3f us (per task)\n",
+	 useTimerWheel ? "TimerWheel" : "DelayQueue", numTasks,
+	 (scheduled - start)*1e6/numTasks, (rescheduled - scheduled)*1e6/numReschedules,
+	 (unscheduled - rescheduled)*1e6/numTasks);
+
+  delete[] tokens;
+  delete scheduler;
+}
+
+// Checking that tasks fire in order:
+
+#define NUM_ORDERED_TASKS 2000
+#define MAX_ORDERED_TASK_DELAY 300 /* milliseconds */
+    // (Delays are whole milliseconds, so that tasks with different delays can't be reordered by the (few microseconds)
+    // that pass between our noting a task's due time, and the scheduler noting it.  For the same reason, tasks with the
+    // same delay are allowed to fire up to ORDER_TOLERANCE seconds out of order.)
+#define ORDER_TOLERANCE 0.0001
+
+struct OrderedTask {
+  double dueTime;
+};
+
+static unsigned numTasksFired;
+static double lastDueTime;
+static unsigned numOutOfOrder, numEarly;
+static char eventLoopWatchVariable;
+
+static void orderedTask(void* clientData) {
+  OrderedTask* task = (OrderedTask*)clientData;
+  if (task->dueTime < lastDueTime - ORDER_TOLERANCE) ++numOutOfOrder;
+  if (timeNow() < task->dueTime - 0.0005/*allow for rounding*/) ++numEarly;
+  lastDueTime = task->dueTime;
+
+  if (++numTasksFired == NUM_ORDERED_TASKS) eventLoopWatchVariable = 1;
+}
+
+static Boolean checkOrder(Boolean useTimerWheel) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew(10000, useTimerWheel);
+  OrderedTask* tasks = new OrderedTask[NUM_ORDERED_TASKS];
+  numTasksFired = numOutOfOrder = numEarly = 0;
+  lastDueTime = 0.0;
+  eventLoopWatchVariable = 0;
+
+  our_srandom(2);
+  for (unsigned i = 0; i < NUM_ORDERED_TASKS; ++i) {
+    int64_t delay = (our_random32()%MAX_ORDERED_TASK_DELAY)*1000;
+    tasks[i].dueTime = timeNow() + delay/1000000.0;
+    scheduler->scheduleDelayedTask(delay, orderedTask, &tasks[i]);
+  }
+  scheduler->doEventLoop(&eventLoopWatchVariable);
+
+  printf("%-10s %u tasks fired: %u out of order, %u early\n",
+	 useTimerWheel ? "TimerWheel" : "DelayQueue", numTasksFired, numOutOfOrder, numEarly);
+
+  delete[] tasks;
+  delete scheduler;
+  return numOutOfOrder == 0 && numEarly == 0;
+}
+
+static void usage(char const* progName) {
+  fprintf(stderr, "usage: %s [-a] [<num-tasks> ...]\n", progName);
+  fprintf(stderr, "\t(\"-a\" also times the \"DelayQueue\" with more than %d tasks, which can take minutes)\n",
+	  MAX_NUM_TASKS_FOR_DELAY_QUEUE);
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  char const* progName = argv[0];
+  Boolean timeAllDelayQueues = False;
+  if (argc > 1 && strcmp(argv[1], "-a") == 0) {
+    timeAllDelayQueues = True;
+    ++argv; --argc;
+  }
+
+  unsigned defaultNumTasks[] = { 1000, 10000, 100000, 1000000 };
+  unsigned numRuns = sizeof defaultNumTasks/sizeof defaultNumTasks[0];
+  unsigned* numTasks = defaultNumTasks;
+  if (argc > 1) {
+    numRuns = argc - 1;
+    numTasks = new unsigned[numRuns];
+    for (unsigned i = 0; i < numRuns; ++i) {
+      if (sscanf(argv[i+1], "%u", &numTasks[i]) != 1 || numTasks[i] == 0) usage(progName);
+    }
+  }
+
+  for (unsigned i = 0; i < numRuns; ++i) {
+    if (numTasks[i] <= MAX_NUM_TASKS_FOR_DELAY_QUEUE || timeAllDelayQueues) timeScheduler(numTasks[i], False);
+    timeScheduler(numTasks[i], True);
+  }
+
+  Boolean ok = checkOrder(False);
+  if (!checkOrder(True)) ok = False;
+  if (numTasks != defaultNumTasks) delete[] numTasks;
+
+  return ok ? 0 : 1;
+}